@@ -0,0 +1,559 @@
+/**
+ * @file bench.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the Message Bus benchmark. It measures the throughput
+ * of mb_send and mb_receive, and the latency from sending a message to
+ * receiving it, over a sweep of payload sizes, subscriber fan-out, pipe
+ * depths and producer counts.
+ *
+ * Each pipe has a single receiving task, as in the flight software, so the
+ * number of consumer tasks is the fan-out. Each configuration runs in its
+ * own process so that the pipes it creates, which MB cannot delete, are
+ * released before the next configuration runs.
+ *
+ * The results are written to stdout as CSV, with one row per configuration,
+ * so that the results of different builds can be compared.
+ */
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "os_definitions.h"
+#include "os_queue.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_time.h"
+
+#include "fsw_definitions.h"
+#include "msg_definitions.h"
+#include "msg.h"
+#include "mb.h"
+
+
+/**
+ * This definition is the number of elements in an array.
+ */
+#define BENCH_ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+
+/**
+ * This definition is the number of messages sent in each configuration,
+ * unless given with the -n option.
+ */
+#define BENCH_DEFAULT_NUM_MSGS 20000
+
+/**
+ * This definition is the largest payload in the sweep. Each payload
+ * starts with the time the message was sent.
+ */
+#define BENCH_MAX_PAYLOAD_BYTES 1024
+
+/**
+ * This definition is the most producer or consumer tasks in the sweep.
+ */
+#define BENCH_MAX_TASKS 4
+
+/**
+ * This definition is the stack size of the benchmark tasks.
+ */
+#define BENCH_TASK_STACK_SIZE (256 * 1024)
+
+/**
+ * This definition is the priority of the benchmark tasks. All tasks have
+ * the same priority so that producers and consumers share the processors.
+ */
+#define BENCH_TASK_PRIORITY 10
+
+/**
+ * This definition is how long a consumer waits for a message before
+ * deciding that no more messages are coming.
+ */
+#define BENCH_RECEIVE_TIMEOUT OS_CONFIG_CLOCK_RATE
+
+/**
+ * This definition is the most time a configuration may take, in seconds,
+ * before its process is stopped.
+ */
+#define BENCH_CONFIG_TIMEOUT_SECONDS 120
+
+/**
+ * This definition is the exit status of a configuration whose pipes could
+ * not be created, such as mqueue pipes deeper than the system allows.
+ */
+#define BENCH_EXIT_SKIPPED 2
+
+
+/**
+ * This structure is a single configuration of the benchmark.
+ */
+typedef struct
+{
+    uint32_t payload_bytes; /*<< The size of each message after its header */
+    uint32_t fan_out;       /*<< The number of pipes receiving each message */
+    uint32_t pipe_depth;    /*<< The number of messages each pipe can hold */
+    uint32_t num_producers; /*<< The number of tasks sending messages */
+    uint32_t num_msgs;      /*<< The number of messages sent by all producers */
+} Bench_Config;
+
+/**
+ * This structure is the state of a producer task.
+ */
+typedef struct
+{
+    uint32_t num_msgs;      /*<< The number of messages to send */
+    uint32_t payload_bytes; /*<< The size of each message after its header */
+    uint32_t errors;        /*<< The number of failed sends */
+} Bench_Producer;
+
+/**
+ * This structure is the state of a consumer task.
+ */
+typedef struct
+{
+    MB_Pipe pipe;           /*<< The pipe to receive from */
+    uint32_t expected;      /*<< The number of messages to receive */
+    uint32_t num_received;  /*<< The number of messages received */
+    uint32_t errors;        /*<< The number of failed receives */
+    uint64_t *latencies;    /*<< The latency of each received message, in nanoseconds */
+} Bench_Consumer;
+
+
+/**
+ * The payload sizes in the sweep, in bytes.
+ */
+static const uint32_t gvBench_payload_sizes[] = { 16, 256, BENCH_MAX_PAYLOAD_BYTES };
+
+/**
+ * The number of pipes each message is sent to in the sweep.
+ */
+static const uint32_t gvBench_fan_outs[] = { 1, BENCH_MAX_TASKS };
+
+/**
+ * The pipe depths in the sweep, in messages.
+ */
+static const uint32_t gvBench_pipe_depths[] = { 4, 8, 64 };
+
+/**
+ * The number of producer tasks in the sweep.
+ */
+static const uint32_t gvBench_producer_counts[] = { 1, BENCH_MAX_TASKS };
+
+/**
+ * This semaphore is given once for each producer to start sending.
+ */
+static OS_Sem gvBench_start;
+
+/**
+ * This semaphore is given by each task when it is done.
+ */
+static OS_Sem gvBench_done;
+
+
+/**
+ * @brief bench_run
+ *
+ * This function runs a single configuration and prints its results.
+ *
+ * @param[in] config - the configuration to run.
+ *
+ * @return EXIT_SUCCESS if every message was received, BENCH_EXIT_SKIPPED
+ * if the pipes could not be created, or EXIT_FAILURE otherwise.
+ */
+int bench_run(const Bench_Config *config);
+
+/**
+ * @brief bench_producer
+ *
+ * This task sends messages stamped with the time they are sent.
+ *
+ * @param[in] argument - a pointer to the Bench_Producer for this task.
+ */
+void bench_producer(void *argument);
+
+/**
+ * @brief bench_consumer
+ *
+ * This task receives messages from a pipe and records their latency.
+ *
+ * @param[in] argument - a pointer to the Bench_Consumer for this task.
+ */
+void bench_consumer(void *argument);
+
+/**
+ * @brief bench_compare
+ *
+ * This function compares two latencies for qsort.
+ */
+int bench_compare(const void *first, const void *second);
+
+/**
+ * @brief bench_backend
+ *
+ * This function names the queue backend used for MB pipes in this build.
+ */
+const char *bench_backend(void);
+
+
+int main(int argc, char *argv[])
+{
+    bool success = true;
+
+    bool header = true;
+
+    uint32_t num_msgs = BENCH_DEFAULT_NUM_MSGS;
+
+    int option = 0;
+
+    while ((option = getopt(argc, argv, "n:H")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                num_msgs = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'H':
+                header = false;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n num_msgs] [-H]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (header)
+    {
+        printf("backend,payload_bytes,fan_out,pipe_depth,producers,consumers,"
+               "messages,deliveries,errors,seconds,msgs_per_sec,"
+               "p50_ns,p99_ns,p999_ns,max_ns\n");
+    }
+
+    uint32_t num_configs = BENCH_ARRAY_SIZE(gvBench_payload_sizes) *
+                           BENCH_ARRAY_SIZE(gvBench_fan_outs) *
+                           BENCH_ARRAY_SIZE(gvBench_pipe_depths) *
+                           BENCH_ARRAY_SIZE(gvBench_producer_counts);
+
+    for (uint32_t config_index = 0; config_index < num_configs; config_index++)
+    {
+        // the configuration index counts through every combination of the
+        // sweep, with the producer count changing fastest.
+        uint32_t remaining = config_index;
+
+        Bench_Config config;
+        config.num_msgs = num_msgs;
+
+        config.num_producers = gvBench_producer_counts[remaining % BENCH_ARRAY_SIZE(gvBench_producer_counts)];
+        remaining /= BENCH_ARRAY_SIZE(gvBench_producer_counts);
+
+        config.pipe_depth = gvBench_pipe_depths[remaining % BENCH_ARRAY_SIZE(gvBench_pipe_depths)];
+        remaining /= BENCH_ARRAY_SIZE(gvBench_pipe_depths);
+
+        config.fan_out = gvBench_fan_outs[remaining % BENCH_ARRAY_SIZE(gvBench_fan_outs)];
+        remaining /= BENCH_ARRAY_SIZE(gvBench_fan_outs);
+
+        config.payload_bytes = gvBench_payload_sizes[remaining];
+
+        // output is flushed so the child process does not print it again
+        fflush(stdout);
+
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            alarm(BENCH_CONFIG_TIMEOUT_SECONDS);
+
+            int run_status = bench_run(&config);
+
+            fflush(stdout);
+
+            exit(run_status);
+        }
+
+        int status = EXIT_FAILURE;
+
+        if ((pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFEXITED(status))
+        {
+            status = WEXITSTATUS(status);
+        }
+        else
+        {
+            status = EXIT_FAILURE;
+        }
+
+        if (status != EXIT_SUCCESS)
+        {
+            fprintf(stderr,
+                    "%s: payload %u fan out %u depth %u producers %u %s\n",
+                    bench_backend(),
+                    config.payload_bytes,
+                    config.fan_out,
+                    config.pipe_depth,
+                    config.num_producers,
+                    (status == BENCH_EXIT_SKIPPED) ? "skipped, pipes could not be created" : "failed");
+
+            success = success && (status == BENCH_EXIT_SKIPPED);
+        }
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int bench_run(const Bench_Config *config)
+{
+    int status = EXIT_SUCCESS;
+
+    bool success = true;
+
+    Bench_Producer producers[BENCH_MAX_TASKS];
+    Bench_Consumer consumers[BENCH_MAX_TASKS];
+
+    OS_Task tasks[2 * BENCH_MAX_TASKS];
+    uint32_t num_tasks = 0;
+
+    uint64_t *latencies = NULL;
+
+    uint64_t start = 0;
+    uint64_t end = 0;
+
+    memset(producers, 0, sizeof(producers));
+    memset(consumers, 0, sizeof(consumers));
+
+    if (mb_initialize() != FSW_RESULT_OKAY)
+    {
+        success = false;
+    }
+
+    if (success)
+    {
+        success = (os_sem_create(&gvBench_start) == OS_RESULT_OKAY) &&
+                  (os_sem_create(&gvBench_done) == OS_RESULT_OKAY);
+    }
+
+    if (success)
+    {
+        latencies = (uint64_t*)calloc((size_t)config->fan_out * config->num_msgs, sizeof(uint64_t));
+
+        success = latencies != NULL;
+    }
+
+    for (uint32_t index = 0; success && (index < config->fan_out); index++)
+    {
+        consumers[index].expected = config->num_msgs;
+        consumers[index].latencies = &latencies[(size_t)index * config->num_msgs];
+
+        success =
+            (mb_create_pipe(&consumers[index].pipe,
+                            config->pipe_depth,
+                            sizeof(MSG_Header) + config->payload_bytes) == MB_RESULT_OKAY) &&
+            (mb_register_packet(consumers[index].pipe, MSG_PACKETID_HEALTHANDSTATUS) == MB_RESULT_OKAY);
+
+        if (!success)
+        {
+            status = BENCH_EXIT_SKIPPED;
+        }
+    }
+
+    for (uint32_t index = 0; success && (index < config->fan_out); index++)
+    {
+        success = os_task_spawn(&tasks[num_tasks],
+                                bench_consumer,
+                                &consumers[index],
+                                BENCH_TASK_PRIORITY,
+                                BENCH_TASK_STACK_SIZE) == OS_RESULT_OKAY;
+        num_tasks++;
+    }
+
+    for (uint32_t index = 0; success && (index < config->num_producers); index++)
+    {
+        // the last producer also sends the remainder of the messages
+        producers[index].num_msgs = config->num_msgs / config->num_producers;
+        if (index == (config->num_producers - 1))
+        {
+            producers[index].num_msgs += config->num_msgs % config->num_producers;
+        }
+        producers[index].payload_bytes = config->payload_bytes;
+
+        success = os_task_spawn(&tasks[num_tasks],
+                                bench_producer,
+                                &producers[index],
+                                BENCH_TASK_PRIORITY,
+                                BENCH_TASK_STACK_SIZE) == OS_RESULT_OKAY;
+        num_tasks++;
+    }
+
+    if (success)
+    {
+        start = os_timestamp_nanoseconds();
+
+        for (uint32_t index = 0; index < config->num_producers; index++)
+        {
+            (void)os_sem_give(&gvBench_start);
+        }
+
+        for (uint32_t index = 0; index < num_tasks; index++)
+        {
+            (void)os_sem_take(&gvBench_done, OS_TIMEOUT_WAIT_FOREVER);
+        }
+
+        end = os_timestamp_nanoseconds();
+    }
+
+    if (success)
+    {
+        uint32_t errors = 0;
+        uint32_t deliveries = 0;
+
+        for (uint32_t index = 0; index < config->num_producers; index++)
+        {
+            errors += producers[index].errors;
+        }
+
+        // gather every consumer's latencies at the start of the array
+        for (uint32_t index = 0; index < config->fan_out; index++)
+        {
+            errors += consumers[index].errors;
+
+            memmove(&latencies[deliveries],
+                    consumers[index].latencies,
+                    consumers[index].num_received * sizeof(uint64_t));
+
+            deliveries += consumers[index].num_received;
+        }
+
+        qsort(latencies, deliveries, sizeof(uint64_t), bench_compare);
+
+        double seconds = (double)(end - start) / (double)OS_NANOSECONDS_PER_SECOND;
+
+        uint64_t last = (deliveries > 0) ? (deliveries - 1) : 0;
+
+        printf("%s,%u,%u,%u,%u,%u,%u,%u,%u,%.6f,%.0f,%llu,%llu,%llu,%llu\n",
+               bench_backend(),
+               config->payload_bytes,
+               config->fan_out,
+               config->pipe_depth,
+               config->num_producers,
+               config->fan_out,
+               config->num_msgs,
+               deliveries,
+               errors,
+               seconds,
+               (double)config->num_msgs / seconds,
+               (unsigned long long)latencies[(last * 500) / 1000],
+               (unsigned long long)latencies[(last * 990) / 1000],
+               (unsigned long long)latencies[(last * 999) / 1000],
+               (unsigned long long)latencies[last]);
+
+        success = (errors == 0) && (deliveries == (config->fan_out * config->num_msgs));
+    }
+
+    if (!success && (status == EXIT_SUCCESS))
+    {
+        status = EXIT_FAILURE;
+    }
+
+    // the process exits after each configuration, so the latencies are
+    // not freed while tasks might still be using them.
+
+    return status;
+}
+
+void bench_producer(void *argument)
+{
+    Bench_Producer *producer = (Bench_Producer*)argument;
+
+    _Alignas(uint64_t) uint8_t message[sizeof(MSG_Header) + BENCH_MAX_PAYLOAD_BYTES];
+
+    MSG_Header *header = (MSG_Header*)message;
+
+    memset(message, 0, sizeof(message));
+
+    (void)msg_telemetry_message(header, MSG_PACKETID_HEALTHANDSTATUS, producer->payload_bytes);
+
+    (void)os_sem_take(&gvBench_start, OS_TIMEOUT_WAIT_FOREVER);
+
+    for (uint32_t index = 0; index < producer->num_msgs; index++)
+    {
+        uint64_t sent = os_timestamp_nanoseconds();
+
+        memcpy(&message[sizeof(MSG_Header)], &sent, sizeof(sent));
+
+        if (mb_send(header, OS_TIMEOUT_WAIT_FOREVER) != MB_RESULT_OKAY)
+        {
+            producer->errors++;
+        }
+    }
+
+    (void)os_sem_give(&gvBench_done);
+}
+
+void bench_consumer(void *argument)
+{
+    Bench_Consumer *consumer = (Bench_Consumer*)argument;
+
+    _Alignas(uint64_t) uint8_t message[sizeof(MSG_Header) + BENCH_MAX_PAYLOAD_BYTES];
+
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    while ((result != MB_RESULT_TIMEOUT) && (consumer->num_received < consumer->expected))
+    {
+        uint32_t msg_size = sizeof(message);
+
+        result = mb_receive(consumer->pipe,
+                            (MSG_Header*)message,
+                            &msg_size,
+                            BENCH_RECEIVE_TIMEOUT);
+
+        uint64_t received = os_timestamp_nanoseconds();
+
+        if (result == MB_RESULT_OKAY)
+        {
+            uint64_t sent = 0;
+
+            memcpy(&sent, &message[sizeof(MSG_Header)], sizeof(sent));
+
+            consumer->latencies[consumer->num_received] = received - sent;
+            consumer->num_received++;
+        }
+        else if (result != MB_RESULT_TIMEOUT)
+        {
+            consumer->errors++;
+        }
+    }
+
+    (void)os_sem_give(&gvBench_done);
+}
+
+int bench_compare(const void *first, const void *second)
+{
+    uint64_t first_latency = *(const uint64_t*)first;
+    uint64_t second_latency = *(const uint64_t*)second;
+
+    return (first_latency > second_latency) - (first_latency < second_latency);
+}
+
+const char *bench_backend(void)
+{
+    const char *backend = "mpsc_ring";
+
+    if (MB_PIPE_QUEUE_TYPE == OS_QUEUE_TYPE_SPSC)
+    {
+        backend = "spsc_ring";
+    }
+    else if (MB_PIPE_QUEUE_TYPE == OS_QUEUE_TYPE_DEFAULT)
+    {
+#if defined(OS_WSL)
+        backend = "portable";
+#else
+        backend = "mqueue";
+#endif
+    }
+
+    return backend;
+}
@@ -0,0 +1,356 @@
+/**
+ * @file bench_jitter.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the Task Manager release jitter benchmark. It runs a
+ * single task under the Task Manager and measures how accurately the task
+ * is released, for a periodic task released by the scheduler each slot and
+ * for high rate tasks released by their own timed waits, with and without
+ * busy-waiting for the end of each release.
+ *
+ * The accuracy is measured as the difference between the time from one
+ * release to the next and the task's period, which does not depend on
+ * when the schedule started. The release jitter that TM records for the
+ * task is reported alongside it. Each configuration runs in its own
+ * process, as TM can only be initialized once.
+ *
+ * The results are written to stdout as CSV, with one row per configuration.
+ */
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "unistd.h"
+#include "sys/wait.h"
+
+#include "os_definitions.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_time.h"
+
+#include "fsw_definitions.h"
+#include "tm_definitions.h"
+#include "tm.h"
+
+
+/**
+ * This definition is the number of elements in an array.
+ */
+#define BENCH_JITTER_ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+
+/**
+ * This definition is the number of releases measured in each configuration,
+ * unless given with the -n option.
+ */
+#define BENCH_JITTER_DEFAULT_NUM_RELEASES 2000
+
+/**
+ * This definition is the TM task id of the measured task.
+ */
+#define BENCH_JITTER_TASK_ID 10
+
+/**
+ * This definition is the stack size of the measured task.
+ */
+#define BENCH_JITTER_TASK_STACK_SIZE (256 * 1024)
+
+/**
+ * This definition is the priority of the measured task, which is above
+ * the TM workers so that only the scheduler and timer task preempt it.
+ */
+#define BENCH_JITTER_TASK_PRIORITY 1
+
+/**
+ * This definition is the time the measured task busy-waits for each
+ * release in the configurations that spin, in nanoseconds.
+ */
+#define BENCH_JITTER_SPIN_NS 50000
+
+/**
+ * This definition is the most time a configuration may take, in seconds,
+ * before its process is stopped.
+ */
+#define BENCH_JITTER_CONFIG_TIMEOUT_SECONDS 120
+
+
+/**
+ * This structure is a single configuration of the benchmark.
+ */
+typedef struct
+{
+    bool high_rate;     /*<< Whether the task is a high rate task, rather than periodic */
+    uint64_t period_ns; /*<< The period of the task */
+    uint64_t spin_ns;   /*<< The time the task busy-waits for each release */
+} Bench_JitterConfig;
+
+
+/**
+ * The configurations of the benchmark. The periodic task runs every slot,
+ * which is the fastest a periodic task can run.
+ */
+static const Bench_JitterConfig gvBench_jitter_configs[] =
+{
+    { false, TM_SLOT_NANOSECONDS, 0 },
+    { true, TM_SLOT_NANOSECONDS, 0 },
+    { true, 1000000, 0 },
+    { true, 1000000, BENCH_JITTER_SPIN_NS },
+    { true, 250000, 0 },
+    { true, 250000, BENCH_JITTER_SPIN_NS },
+};
+
+/**
+ * This semaphore is given by the measured task when it is done.
+ */
+static OS_Sem gvBench_jitter_done;
+
+/**
+ * The time of each of the measured task's releases.
+ */
+static uint64_t *gvBench_jitter_releases;
+
+/**
+ * The number of releases the measured task records.
+ */
+static uint32_t gvBench_jitter_num_releases;
+
+
+/**
+ * @brief bench_jitter_run
+ *
+ * This function runs a single configuration and prints its results.
+ *
+ * @param[in] config - the configuration to run.
+ * @param[in] num_releases - the number of releases to measure.
+ *
+ * @return EXIT_SUCCESS if the task was released every time, or EXIT_FAILURE.
+ */
+int bench_jitter_run(const Bench_JitterConfig *config, uint32_t num_releases);
+
+/**
+ * @brief bench_jitter_task
+ *
+ * This task records the time of each of its releases, and signals the
+ * benchmark when it has recorded them all.
+ *
+ * @param[in] argument - unused.
+ */
+void bench_jitter_task(void *argument);
+
+/**
+ * @brief bench_jitter_compare
+ *
+ * This function compares two durations for qsort.
+ */
+int bench_jitter_compare(const void *first, const void *second);
+
+
+int main(int argc, char *argv[])
+{
+    bool success = true;
+
+    bool header = true;
+
+    uint32_t num_releases = BENCH_JITTER_DEFAULT_NUM_RELEASES;
+
+    int option = 0;
+
+    while ((option = getopt(argc, argv, "n:H")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                num_releases = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'H':
+                header = false;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n num_releases] [-H]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (num_releases == 0)
+    {
+        fprintf(stderr, "at least one release must be measured\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (header)
+    {
+        printf("task,period_ns,spin_ns,releases,overruns,"
+               "p50_ns,p99_ns,p999_ns,max_ns,"
+               "tm_jitter_mean_us,tm_jitter_max_us\n");
+    }
+
+    for (uint32_t index = 0; index < BENCH_JITTER_ARRAY_SIZE(gvBench_jitter_configs); index++)
+    {
+        const Bench_JitterConfig *config = &gvBench_jitter_configs[index];
+
+        // output is flushed so the child process does not print it again
+        fflush(stdout);
+
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            alarm(BENCH_JITTER_CONFIG_TIMEOUT_SECONDS);
+
+            int run_status = bench_jitter_run(config, num_releases);
+
+            fflush(stdout);
+
+            exit(run_status);
+        }
+
+        int status = EXIT_FAILURE;
+
+        if ((pid > 0) && (waitpid(pid, &status, 0) == pid) && WIFEXITED(status))
+        {
+            status = WEXITSTATUS(status);
+        }
+        else
+        {
+            status = EXIT_FAILURE;
+        }
+
+        if (status != EXIT_SUCCESS)
+        {
+            fprintf(stderr,
+                    "%s task period %llu spin %llu failed\n",
+                    config->high_rate ? "high rate" : "periodic",
+                    (unsigned long long)config->period_ns,
+                    (unsigned long long)config->spin_ns);
+
+            success = false;
+        }
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int bench_jitter_run(const Bench_JitterConfig *config, uint32_t num_releases)
+{
+    bool success = true;
+
+    TM_TaskTiming timing;
+
+    // the first release starts the first interval
+    gvBench_jitter_num_releases = num_releases + 1;
+
+    gvBench_jitter_releases = (uint64_t*)calloc(gvBench_jitter_num_releases, sizeof(uint64_t));
+
+    success = (gvBench_jitter_releases != NULL) &&
+              (os_sem_create(&gvBench_jitter_done) == OS_RESULT_OKAY) &&
+              (tm_initialize() == FSW_RESULT_OKAY);
+
+    if (success)
+    {
+        TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+        if (config->high_rate)
+        {
+            tm_result = tm_high_rate_task("bench_jitter",
+                                          BENCH_JITTER_TASK_ID,
+                                          bench_jitter_task,
+                                          NULL,
+                                          config->period_ns,
+                                          config->spin_ns,
+                                          TM_SLOTS_PER_FRAME,
+                                          BENCH_JITTER_TASK_STACK_SIZE,
+                                          BENCH_JITTER_TASK_PRIORITY);
+        }
+        else
+        {
+            tm_result = tm_periodic_task("bench_jitter",
+                                         BENCH_JITTER_TASK_ID,
+                                         bench_jitter_task,
+                                         NULL,
+                                         (int)(config->period_ns / TM_SLOT_NANOSECONDS),
+                                         TM_SLOTS_PER_FRAME,
+                                         BENCH_JITTER_TASK_STACK_SIZE,
+                                         BENCH_JITTER_TASK_PRIORITY);
+        }
+
+        success = (tm_result == TM_RESULT_OKAY) && (tm_start() == TM_RESULT_OKAY);
+    }
+
+    if (success)
+    {
+        (void)os_sem_take(&gvBench_jitter_done, OS_TIMEOUT_WAIT_FOREVER);
+
+        success = tm_get_task_timing(BENCH_JITTER_TASK_ID, &timing) == TM_RESULT_OKAY;
+    }
+
+    if (success)
+    {
+        // the intervals are stored over the release times, which are each
+        // read before they are overwritten.
+        uint64_t *errors = gvBench_jitter_releases;
+
+        for (uint32_t index = 0; index < num_releases; index++)
+        {
+            uint64_t interval = gvBench_jitter_releases[index + 1] - gvBench_jitter_releases[index];
+
+            if (interval > config->period_ns)
+            {
+                errors[index] = interval - config->period_ns;
+            }
+            else
+            {
+                errors[index] = config->period_ns - interval;
+            }
+        }
+
+        qsort(errors, num_releases, sizeof(uint64_t), bench_jitter_compare);
+
+        uint64_t last = num_releases - 1;
+
+        printf("%s,%llu,%llu,%u,%u,%llu,%llu,%llu,%llu,%u,%u\n",
+               config->high_rate ? "high_rate" : "periodic",
+               (unsigned long long)config->period_ns,
+               (unsigned long long)config->spin_ns,
+               num_releases,
+               timing.overruns,
+               (unsigned long long)errors[(last * 500) / 1000],
+               (unsigned long long)errors[(last * 990) / 1000],
+               (unsigned long long)errors[(last * 999) / 1000],
+               (unsigned long long)errors[last],
+               timing.jitter.mean_us,
+               timing.jitter.max_us);
+    }
+
+    // the process exits after each configuration, so TM is not shut down
+    // and the release times are not freed.
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void bench_jitter_task(void *argument)
+{
+    (void)argument;
+
+    uint32_t num_recorded = 0;
+
+    while (tm_running(BENCH_JITTER_TASK_ID) && (num_recorded < gvBench_jitter_num_releases))
+    {
+        gvBench_jitter_releases[num_recorded] = os_timestamp_nanoseconds();
+        num_recorded++;
+    }
+
+    // the task's timing is read once it has stopped calling tm_running
+    (void)os_sem_give(&gvBench_jitter_done);
+}
+
+int bench_jitter_compare(const void *first, const void *second)
+{
+    uint64_t first_error = *(const uint64_t*)first;
+    uint64_t second_error = *(const uint64_t*)second;
+
+    return (first_error > second_error) - (first_error < second_error);
+}
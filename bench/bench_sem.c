@@ -0,0 +1,275 @@
+/**
+ * @file bench_sem.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the OS semaphore benchmark. It measures the time taken
+ * by os_sem_give and os_sem_take when the semaphore is available, and the
+ * time for a give to wake tasks blocked taking a semaphore, as when TM
+ * releases its periodic tasks each slot.
+ *
+ * The semaphore implementation is chosen at build time, so the benchmark
+ * is built once for each implementation, and the results are written to
+ * stdout as CSV so that the implementations can be compared.
+ */
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "unistd.h"
+
+#include "os_definitions.h"
+#include "os_sem.h"
+#include "os_task.h"
+#include "os_time.h"
+
+
+/**
+ * This definition is the number of operations in each test, unless
+ * given with the -n option.
+ */
+#define BENCH_SEM_DEFAULT_NUM_OPS 200000
+
+/**
+ * This definition is the number of tasks released together in the
+ * release test.
+ */
+#define BENCH_SEM_NUM_RELEASED 4
+
+/**
+ * This definition is the stack size of the benchmark tasks.
+ */
+#define BENCH_SEM_TASK_STACK_SIZE (256 * 1024)
+
+/**
+ * This definition is the priority of the benchmark tasks.
+ */
+#define BENCH_SEM_TASK_PRIORITY 10
+
+/**
+ * This definition is the timeout used by the timed take test. The semaphore
+ * is always available, so the timeout only matters for what it costs.
+ */
+#define BENCH_SEM_TIMEOUT OS_CONFIG_CLOCK_RATE
+
+
+/**
+ * This structure is the state of a task released by the benchmark.
+ */
+typedef struct
+{
+    OS_Sem release;    /*<< The semaphore given to release this task */
+    uint32_t num_ops;  /*<< The number of times this task is released */
+} Bench_SemTask;
+
+
+/**
+ * This semaphore is given by each released task to acknowledge a release.
+ */
+static OS_Sem gvBench_sem_done;
+
+/**
+ * The tasks released by the benchmark.
+ */
+static Bench_SemTask gvBench_sem_tasks[BENCH_SEM_NUM_RELEASED];
+
+
+/**
+ * @brief bench_sem_uncontended
+ *
+ * This function gives and then takes a semaphore without blocking.
+ *
+ * @param[in] num_ops - the number of give and take pairs.
+ * @param[in] timeout - the timeout given to each take.
+ *
+ * @return true if every give and take succeeded.
+ */
+bool bench_sem_uncontended(uint32_t num_ops, OS_Timeout timeout);
+
+/**
+ * @brief bench_sem_release
+ *
+ * This function releases tasks blocked on their semaphores, and waits
+ * for each task to acknowledge its release before releasing them again.
+ *
+ * @param[in] num_ops - the number of times the tasks are released.
+ * @param[in] num_tasks - the number of tasks released together.
+ *
+ * @return true if every task was spawned and released.
+ */
+bool bench_sem_release(uint32_t num_ops, uint32_t num_tasks);
+
+/**
+ * @brief bench_sem_task
+ *
+ * This task waits to be released, and acknowledges each release.
+ *
+ * @param[in] argument - a pointer to the Bench_SemTask for this task.
+ */
+void bench_sem_task(void *argument);
+
+/**
+ * @brief bench_sem_report
+ *
+ * This function prints a row of results.
+ *
+ * @param[in] test - the name of the test.
+ * @param[in] num_tasks - the number of released tasks in the test.
+ * @param[in] num_ops - the number of operations in the test.
+ * @param[in] nanoseconds - the time the test took.
+ */
+void bench_sem_report(const char *test, uint32_t num_tasks, uint32_t num_ops, uint64_t nanoseconds);
+
+
+int main(int argc, char *argv[])
+{
+    bool success = true;
+
+    bool header = true;
+
+    uint32_t num_ops = BENCH_SEM_DEFAULT_NUM_OPS;
+
+    int option = 0;
+
+    uint64_t start = 0;
+
+    while ((option = getopt(argc, argv, "n:H")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                num_ops = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'H':
+                header = false;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n num_ops] [-H]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (header)
+    {
+        printf("backend,test,tasks,operations,seconds,ns_per_op\n");
+    }
+
+    success = os_sem_create(&gvBench_sem_done) == OS_RESULT_OKAY;
+
+    if (success)
+    {
+        start = os_timestamp_nanoseconds();
+        success = bench_sem_uncontended(num_ops, OS_TIMEOUT_WAIT_FOREVER);
+        bench_sem_report("uncontended", 0, num_ops, os_timestamp_nanoseconds() - start);
+    }
+
+    if (success)
+    {
+        start = os_timestamp_nanoseconds();
+        success = bench_sem_uncontended(num_ops, BENCH_SEM_TIMEOUT);
+        bench_sem_report("uncontended_timeout", 0, num_ops, os_timestamp_nanoseconds() - start);
+    }
+
+    // the released tasks run until the process exits, so each release test
+    // uses its own tasks, and releases them the same number of times.
+    if (success)
+    {
+        start = os_timestamp_nanoseconds();
+        success = bench_sem_release(num_ops / BENCH_SEM_NUM_RELEASED, 1);
+        bench_sem_report("ping_pong", 1, num_ops / BENCH_SEM_NUM_RELEASED, os_timestamp_nanoseconds() - start);
+    }
+
+    if (success)
+    {
+        start = os_timestamp_nanoseconds();
+        success = bench_sem_release(num_ops / BENCH_SEM_NUM_RELEASED, BENCH_SEM_NUM_RELEASED);
+        bench_sem_report("release", BENCH_SEM_NUM_RELEASED, num_ops / BENCH_SEM_NUM_RELEASED, os_timestamp_nanoseconds() - start);
+    }
+
+    if (!success)
+    {
+        fprintf(stderr, "semaphore benchmark failed\n");
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+bool bench_sem_uncontended(uint32_t num_ops, OS_Timeout timeout)
+{
+    bool success = true;
+
+    for (uint32_t index = 0; success && (index < num_ops); index++)
+    {
+        success = (os_sem_give(&gvBench_sem_done) == OS_RESULT_OKAY) &&
+                  (os_sem_take(&gvBench_sem_done, timeout) == OS_RESULT_OKAY);
+    }
+
+    return success;
+}
+
+bool bench_sem_release(uint32_t num_ops, uint32_t num_tasks)
+{
+    bool success = true;
+
+    OS_Task tasks[BENCH_SEM_NUM_RELEASED];
+
+    for (uint32_t task_index = 0; success && (task_index < num_tasks); task_index++)
+    {
+        gvBench_sem_tasks[task_index].num_ops = num_ops;
+
+        success =
+            (os_sem_create(&gvBench_sem_tasks[task_index].release) == OS_RESULT_OKAY) &&
+            (os_task_spawn(&tasks[task_index],
+                           bench_sem_task,
+                           &gvBench_sem_tasks[task_index],
+                           BENCH_SEM_TASK_PRIORITY,
+                           BENCH_SEM_TASK_STACK_SIZE) == OS_RESULT_OKAY);
+    }
+
+    for (uint32_t index = 0; success && (index < num_ops); index++)
+    {
+        for (uint32_t task_index = 0; task_index < num_tasks; task_index++)
+        {
+            (void)os_sem_give(&gvBench_sem_tasks[task_index].release);
+        }
+
+        for (uint32_t task_index = 0; task_index < num_tasks; task_index++)
+        {
+            (void)os_sem_take(&gvBench_sem_done, OS_TIMEOUT_WAIT_FOREVER);
+        }
+    }
+
+    return success;
+}
+
+void bench_sem_task(void *argument)
+{
+    Bench_SemTask *task = (Bench_SemTask*)argument;
+
+    for (uint32_t index = 0; index < task->num_ops; index++)
+    {
+        (void)os_sem_take(&task->release, OS_TIMEOUT_WAIT_FOREVER);
+        (void)os_sem_give(&gvBench_sem_done);
+    }
+}
+
+void bench_sem_report(const char *test, uint32_t num_tasks, uint32_t num_ops, uint64_t nanoseconds)
+{
+    const char *backend = "sem_t";
+
+#if defined(OS_SEM_FUTEX)
+    backend = "futex";
+#endif
+
+    printf("%s,%s,%u,%u,%.6f,%.1f\n",
+           backend,
+           test,
+           num_tasks,
+           num_ops,
+           (double)nanoseconds / (double)OS_NANOSECONDS_PER_SECOND,
+           (num_ops > 0) ? ((double)nanoseconds / (double)num_ops) : 0.0);
+}
@@ -32,7 +32,10 @@ FSW_RESULT_ENUM em_initialize(void);
  *
  * @author Noah Ryan
  *
- * This function sends an event message.
+ * This function raises an event. The event is queued on the calling task's
+ * event ring and published later by the EM task, so this function never
+ * blocks. If the ring is full, the event is dropped and counted.
+ * Published events are also written to the event log.
  */
 void em_event(FSW_MODULEID_ENUM module_id,
               uint16_t event_id,
@@ -43,6 +46,107 @@ void em_event(FSW_MODULEID_ENUM module_id,
               uint32_t param3,
               uint32_t param4);
 
+/**
+ * @brief em_filter_event
+ *
+ * This function limits the rate of an event. The event may be raised
+ * 'burst' times in a row, and after that once per 'period'. Events beyond
+ * this rate are suppressed before they are queued, and reported later
+ * by the EM task in a single EM_EVENT_ID_EVENTS_SUPPRESSED event.
+ *
+ * Registering a filter for an event that already has one replaces its
+ * rate. Filters are registered during initialization, and are cleared
+ * by em_initialize.
+ *
+ * @param[in] module_id - the module raising the event.
+ * @param[in] event_id - the module's event id.
+ * @param[in] burst - the number of events allowed in a row, at least 1.
+ * @param[in] period - the time in clock ticks to earn back one event, at least 1.
+ *
+ * @return An EM result type either indicating success (EM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+EM_RESULT_ENUM em_filter_event(FSW_MODULEID_ENUM module_id,
+                               uint16_t event_id,
+                               uint32_t burst,
+                               OS_Timeout period);
+
+/**
+ * @brief em_drain
+ *
+ * This function publishes the events queued in every task's event ring,
+ * receiving them from each ring in batches. Each event is stamped with
+ * its sequence number as it is published. It then reports the events
+ * suppressed by each filter that has earned back an event.
+ *
+ * This function must only be called from one task at a time. It is called
+ * by the EM task.
+ *
+ * @return The number of events published, including reports of
+ * suppressed events.
+ */
+uint32_t em_drain(void);
+
+/**
+ * @brief em_task
+ *
+ * This is the main task of the Event Message module. It drains the event
+ * rings each period.
+ *
+ * @param[in] argument - this argument is not used, but is provided
+ * because all tasks registered with Task Manager take 1 argument.
+ */
+void em_task(void *argument);
+
+/**
+ * @brief em_log_next_sequence
+ *
+ * This function provides the sequence of the next entry written to the
+ * event log. Log sequences count every event logged, and continue across
+ * restarts as long as the log file is kept.
+ *
+ * @return The next log sequence, or 0 if the log is not mapped.
+ */
+uint64_t em_log_next_sequence(void);
+
+/**
+ * @brief em_log_tail
+ *
+ * This function copies the last events in the event log, oldest first.
+ * Events that are overwritten or being written during the copy are
+ * skipped, so fewer events than requested may be copied.
+ *
+ * @param[out] entries - the log entries copied.
+ * @param[in] max_entries - the number of entries to copy.
+ * @param[out] num_entries - the number of entries copied.
+ *
+ * @return An EM result type either indicating success (EM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+EM_RESULT_ENUM em_log_tail(EM_LogEntry *entries,
+                           uint32_t max_entries,
+                           uint32_t *num_entries);
+
+/**
+ * @brief em_log_since
+ *
+ * This function copies the events in the event log starting at a given
+ * log sequence, oldest first. If the sequence has already been overwritten,
+ * the copy starts at the oldest event in the log.
+ *
+ * @param[in] sequence - the log sequence of the first event to copy.
+ * @param[out] entries - the log entries copied.
+ * @param[in] max_entries - the maximum number of entries to copy.
+ * @param[out] num_entries - the number of entries copied.
+ *
+ * @return An EM result type either indicating success (EM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+EM_RESULT_ENUM em_log_since(uint64_t sequence,
+                            EM_LogEntry *entries,
+                            uint32_t max_entries,
+                            uint32_t *num_entries);
+
 /**
  * @brief em_get_status
  *
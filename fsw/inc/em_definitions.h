@@ -9,6 +9,10 @@
 #define __EM_DEFINITIONS_H__
 
 #include "stdint.h"
+#include "stdbool.h"
+#include "stdatomic.h"
+
+#include "os_definitions.h"
 
 #include "fsw_definitions.h"
 #include "msg_definitions.h"
@@ -21,6 +25,88 @@
  */
 #define EM_NUM_PARAMS 5
 
+/**
+ * This definition is the number of event rings. Each task raising events
+ * claims its own ring the first time it calls em_event, and releases it
+ * when it exits. Tasks beyond this number publish their events directly.
+ */
+#define EM_NUM_RINGS 16
+
+/**
+ * This definition is the number of events each ring can hold before
+ * further events from its task are dropped.
+ */
+#define EM_RING_DEPTH 64
+
+/**
+ * This definition is the number of events received from a ring at a time
+ * when the rings are drained.
+ */
+#define EM_DRAIN_BATCH_SIZE 16
+
+/**
+ * This definition is the maximum number of event filters.
+ */
+#define EM_MAX_FILTERS 32
+
+/**
+ * This definition is the number of bits in each module's filter mask.
+ * An event id sets bit (event_id % EM_FILTER_MASK_BITS) in its module's
+ * mask when a filter is registered for it.
+ */
+#define EM_FILTER_MASK_BITS 64
+
+/**
+ * This definition is the default number of events a filtered event may
+ * raise in a burst before it is suppressed.
+ */
+#define EM_FILTER_DEFAULT_BURST 4
+
+/**
+ * This definition is the default time, in clock ticks, for a filtered
+ * event to earn back one event of its burst.
+ */
+#define EM_FILTER_DEFAULT_PERIOD OS_CONFIG_CLOCK_RATE
+
+/**
+ * This definition is the event raised by the EM module to report events
+ * suppressed by a filter. Its parameters are the module id and event id
+ * of the suppressed event, the number of events suppressed, and the
+ * seconds and nanoseconds of the timestamp of the first event suppressed.
+ */
+#define EM_EVENT_ID_EVENTS_SUPPRESSED 1
+
+/**
+ * This definition is the path of the event log file. Every published event
+ * is also written to this file, which is kept across restarts.
+ */
+#ifndef EM_LOG_PATH
+#define EM_LOG_PATH "em_events.log"
+#endif
+
+/**
+ * This definition is the number of events kept in the event log. Once the
+ * log is full, each event overwrites the oldest event in the log.
+ */
+#define EM_LOG_NUM_ENTRIES 1024
+
+/**
+ * This definition marks a log file written by the EM module.
+ */
+#define EM_LOG_MAGIC 0x454D4C47
+
+/**
+ * This definition is the version of the event log file layout. A log file
+ * with a different version is cleared when it is opened.
+ */
+#define EM_LOG_VERSION 1
+
+/**
+ * This definition is the sequence of a log slot that has never been
+ * written, or is being written.
+ */
+#define EM_LOG_SEQUENCE_NONE UINT64_MAX
+
 /**
  * The EM_RESULT_ENUM gives the result type for Event Module functions.
  * It either indicates a success (EM_RESULT_OKAY) or provides an
@@ -32,6 +118,8 @@ typedef enum
   EM_RESULT_OKAY              = 1,
   EM_RESULT_COULD_NOT_SEND    = 2,
   EM_RESULT_INVALID_ARGUMENTS = 3,
+  EM_RESULT_FILTERS_FULL      = 4,
+  EM_RESULT_LOG_UNAVAILABLE   = 5,
   EM_RESULT_NUM_EVENTS
 } EM_RESULT_ENUM;
 
@@ -44,9 +132,68 @@ typedef struct
   FSW_MODULEID_ENUM module;
   uint16_t event_id;
   uint16_t line_number;
+  uint32_t sequence;
   uint32_t params[EM_NUM_PARAMS];
 } EM_Event;
 
+/**
+ * The event record is the compact form of an event stored in an event ring
+ * until the EM task publishes it as an EM_Event.
+ */
+typedef struct EM_Record
+{
+  uint16_t module; /*<< The FSW_MODULEID_ENUM of the module raising the event */
+  uint16_t event_id; /*<< The module's event id */
+  uint32_t line_number; /*<< The line the event was raised on */
+  uint32_t params[EM_NUM_PARAMS]; /*<< The event parameters */
+} EM_Record;
+
+/**
+ * The log entry is an event read back from the event log.
+ */
+typedef struct EM_LogEntry
+{
+  uint64_t sequence; /*<< The event's position in the log, counted across restarts */
+  uint64_t timestamp_ns; /*<< The timestamp at which the event was published */
+  EM_Event event; /*<< The event as it was published */
+} EM_LogEntry;
+
+/**
+ * The log slot is an entry as it is stored in the event log file.
+ * The slot's sequence is EM_LOG_SEQUENCE_NONE while the slot is written,
+ * and is only set to the entry's sequence once the entry is complete,
+ * so a reader can tell whether its copy of the slot is whole.
+ */
+typedef struct EM_LogSlot
+{
+  atomic_ullong sequence; /*<< The sequence of the entry, or EM_LOG_SEQUENCE_NONE */
+  uint64_t timestamp_ns; /*<< The timestamp at which the event was published */
+  EM_Event event; /*<< The event as it was published */
+} EM_LogSlot;
+
+/**
+ * The log header is at the start of the event log file, followed by
+ * EM_LOG_NUM_ENTRIES slots. The entry with a given sequence is always
+ * in slot (sequence % num_entries), so the log is read without searching.
+ */
+typedef struct EM_LogHeader
+{
+  uint32_t magic; /*<< EM_LOG_MAGIC once the log is initialized */
+  uint32_t version; /*<< EM_LOG_VERSION */
+  uint32_t num_entries; /*<< The number of slots in the log */
+  uint32_t slot_size; /*<< The size of each slot in bytes */
+  atomic_ullong next_sequence; /*<< The sequence of the next entry written */
+} EM_LogHeader;
+
+/**
+ * The event log file is the header followed by its slots.
+ */
+typedef struct EM_LogFile
+{
+  EM_LogHeader header; /*<< The log's header */
+  EM_LogSlot slots[EM_LOG_NUM_ENTRIES]; /*<< The log's entries */
+} EM_LogFile;
+
 /**
  * This struct is the Event Message module's status structure.
  */
@@ -56,14 +203,67 @@ typedef struct EM_Status
   uint32_t messages_sent;
   uint32_t message_errors;
   uint32_t invalid_msg_received;
+  uint32_t events_dropped;
+  uint32_t events_filtered;
+  uint32_t events_logged;
 } EM_Status;
 
+/**
+ * The EM_COUNTER_ENUM is the index of each count in the EM status within
+ * the EM module's sharded counters. Every task raising events counts in its
+ * own shard, and the counts are only summed by em_get_status.
+ */
+typedef enum
+{
+  EM_COUNTER_MESSAGES_RECEIVED    = 0, /*<< EM_Status messages_received */
+  EM_COUNTER_MESSAGES_SENT        = 1, /*<< EM_Status messages_sent */
+  EM_COUNTER_MESSAGE_ERRORS       = 2, /*<< EM_Status message_errors */
+  EM_COUNTER_INVALID_MSG_RECEIVED = 3, /*<< EM_Status invalid_msg_received */
+  EM_COUNTER_EVENTS_DROPPED       = 4, /*<< EM_Status events_dropped */
+  EM_COUNTER_EVENTS_FILTERED      = 5, /*<< EM_Status events_filtered */
+  EM_COUNTER_EVENTS_LOGGED        = 6, /*<< EM_Status events_logged */
+  EM_COUNTER_NUM_COUNTERS              /*<< Number of EM counters */
+} EM_COUNTER_ENUM;
+
+_Static_assert(EM_COUNTER_NUM_COUNTERS <= OS_COUNTER_MAX_COUNTERS,
+               "EM counters must fit in a set of OS counters");
+
+/**
+ * This struct is a filter limiting the rate of a single event.
+ *
+ * The filter is a token bucket holding 'burst' events, refilled with one
+ * event every 'period_ns'. The bucket is kept as the time at which it will
+ * be full again, so taking an event is a single compare-and-swap that
+ * pushes this time out by one period, and an event is suppressed when it
+ * would push the time more than a full bucket past the current time.
+ */
+typedef struct EM_Filter
+{
+  uint16_t module; /*<< The FSW_MODULEID_ENUM of the filtered event */
+  uint16_t event_id; /*<< The module's event id of the filtered event */
+  uint64_t period_ns; /*<< The time to earn back one event */
+  uint64_t burst_ns; /*<< The time to refill the bucket from empty */
+  atomic_ullong full_ns; /*<< The timestamp at which the bucket is full again */
+  atomic_uint suppressed; /*<< The number of events suppressed and not yet reported */
+  atomic_ullong suppressed_since_ns; /*<< The timestamp of the first event suppressed */
+} EM_Filter;
+
 /**
  * This struct provides the Event Message module's state
  */
 typedef struct EM_State
 {
-  EM_Status status;
+  OS_Counters counters; /*<< The counts reported in EM_Status, indexed by EM_COUNTER_ENUM */
+  OS_Queue rings[EM_NUM_RINGS]; /*<< The event ring of each task raising events */
+  atomic_bool ring_claimed[EM_NUM_RINGS]; /*<< Whether each ring is claimed by a task */
+  atomic_uint num_rings; /*<< The number of rings drained, up to the last ring ever claimed */
+  bool rings_created; /*<< The rings are created once, and kept when the module is reinitialized */
+  atomic_uint sequence; /*<< The sequence number of the next event published */
+  EM_Filter filters[EM_MAX_FILTERS]; /*<< The registered event filters */
+  atomic_uint num_filters; /*<< The number of registered event filters */
+  atomic_ullong filter_masks[FSW_MODULEID_NUM_IDS]; /*<< The event ids of each module that may have a filter */
+  OS_MappedFile log_file; /*<< The mapping of the event log file, kept when the module is reinitialized */
+  EM_LogFile *log; /*<< The event log, or NULL if the log file could not be mapped */
 } EM_State;
 
 #endif // ndef __EM_DEFINITIONS_H__ */
@@ -79,6 +79,9 @@ typedef enum
 	FSW_RESULT_TASK_REGISTRATION_ERROR = 2, /*<< Error when registering a task */
 	FSW_RESULT_OS_TIMER_CREATE_ERROR   = 3, /*<< Error when creating a timer */
 	FSW_RESULT_OS_SEM_CREATE_ERROR     = 4, /*<< Error when creating a semaphore */
+	FSW_RESULT_OS_QUEUE_CREATE_ERROR   = 5, /*<< Error when creating a queue */
+	FSW_RESULT_OS_MAP_ERROR            = 6, /*<< Error when mapping a file */
+	FSW_RESULT_TLM_PACKET_ERROR        = 7, /*<< Error when registering a telemetry packet */
 	FSW_RESULT_NUM_RESULTS  /*<< Number of FSW result values */
 } FSW_RESULT_ENUM;
 
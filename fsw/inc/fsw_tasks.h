@@ -25,6 +25,7 @@
 /* Task Names */
 #define FSW_TASK_NAME_MAIN "Main"
 #define FSW_TASK_NAME_TLM "Telemetry"
+#define FSW_TASK_NAME_EM "Events"
 #define FSW_TASK_NAME_TM_SCHEDULER "TmScheduler"
 
 /* Task Rates */
@@ -33,6 +34,11 @@
  */
 #define FSW_TASK_RATE_1_HZ TM_SYSTEM_CLOCK_TICKS_PER_SECOND 
 
+/**
+ * This definition is the period of a 100 Hz task.
+ */
+#define FSW_TASK_RATE_100_HZ (TM_SYSTEM_CLOCK_TICKS_PER_SECOND / 100)
+
 
 /**
  * This definition is the heartbeat rate of a task that checks in
@@ -47,11 +53,55 @@
  */
 #define FSW_PRIORITY_TLM_TASK 25
 
+/**
+ * This definition is the task priority of the Event Message task.
+ * Events are published ahead of telemetry.
+ */
+#define FSW_PRIORITY_EM_TASK 20
+
 /**
  * This definition is the task priority of the Task Scheduler task.
  */
 #define TM_SCHEDULER_PRIORITY 1
 
+/**
+ * This definition is the task priority of the Task Manager's callback
+ * workers. Callbacks run just below the scheduler that releases them.
+ */
+#define FSW_PRIORITY_TM_WORKER 2
+
+/* Task CPUs */
+/**
+ * This definition is the CPUs the Task Scheduler task runs on. The
+ * scheduler releases every other task, so it may be pinned to an isolated
+ * CPU to keep its release times steady. By default it runs on any CPU.
+ */
+#ifndef FSW_CPUS_TM_SCHEDULER
+#define FSW_CPUS_TM_SCHEDULER OS_CPU_MASK_ANY
+#endif
+
+/**
+ * This definition is the CPUs the Telemetry task runs on. Bulk tasks such
+ * as telemetry may be kept off the CPUs given to time critical tasks.
+ */
+#ifndef FSW_CPUS_TLM_TASK
+#define FSW_CPUS_TLM_TASK OS_CPU_MASK_ANY
+#endif
+
+/**
+ * This definition is the CPUs the Event Message task runs on.
+ */
+#ifndef FSW_CPUS_EM_TASK
+#define FSW_CPUS_EM_TASK OS_CPU_MASK_ANY
+#endif
+
+/**
+ * This definition is the CPUs the Task Manager's callback workers run on.
+ */
+#ifndef FSW_CPUS_TM_WORKERS
+#define FSW_CPUS_TM_WORKERS OS_CPU_MASK_ANY
+#endif
+
 /* Task Ids */
 /**
  * This definition is the task id for the main task that starts
@@ -69,5 +119,10 @@
  */
 #define FSW_TASK_ID_TLM 3
 
+/**
+ * This definition is the task id for the Event Message task.
+ */
+#define FSW_TASK_ID_EM 4
+
 
 #endif /* ndef __FSW_TASKS_H__ */
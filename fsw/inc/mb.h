@@ -45,6 +45,22 @@ FSW_RESULT_ENUM mb_initialize(void);
  */
 MB_RESULT_ENUM mb_send(MSG_Header *message, OS_Timeout timeout);
 
+/**
+ * @brief This function sends a message on the message bus with a priority.
+ * mb_send sends messages with MB_PRIORITY_NORMAL, and every pipe gives out
+ * its higher priority messages before its lower priority messages.
+ *
+ * @param[in] message - a pointer to the message to send.
+ * @param[in] priority - the priority of the message.
+ * @param[in] timeout - a timeout value for how long to wait for space on a pipe.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_send_priority(MSG_Header *message,
+                                MB_PRIORITY_ENUM priority,
+                                OS_Timeout timeout);
+
 /**
  * @brief This function receives a message from a particular pipe. This will
  * fill out the message buffer provided with a message, or return an error
@@ -52,7 +68,8 @@ MB_RESULT_ENUM mb_send(MSG_Header *message, OS_Timeout timeout);
  *
  * @param[in] pipeId - the pipe to receive from.
  * @param[out] message - the message buffer to fill out with a new. message.
- * @param[in] msg_size - the size of the message buffer, in bytes.
+ * @param[in,out] msg_size - the size of the message buffer, in bytes. This is
+ *                           filled out with the size of the received message.
  * @param[in] timeout - the timeout indicating how long to wait for a message (in
  *                      system clock ticks).
  *
@@ -64,13 +81,79 @@ MB_RESULT_ENUM mb_receive(MB_Pipe pipeId,
                           uint32_t *msg_size,
                           OS_Timeout timeout);
 
+/**
+ * @brief This function receives the highest priority message from a pipe,
+ * as with mb_receive, and provides the priority it was sent with.
+ *
+ * @param[in] pipe_id - the pipe to receive from.
+ * @param[out] message - the message buffer to fill out with a new message.
+ * @param[in,out] msg_size - the size of the message buffer, in bytes. This is
+ *                           filled out with the size of the received message.
+ * @param[out] priority - filled out with the priority of the received message.
+ * @param[in] timeout - the timeout indicating how long to wait for a message (in
+ *                      system clock ticks).
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_receive_priority(MB_Pipe pipe_id,
+                                   MSG_Header *message,
+                                   uint32_t *msg_size,
+                                   MB_PRIORITY_ENUM *priority,
+                                   OS_Timeout timeout);
+
+/**
+ * @brief This function sends a batch of messages on the message bus. Each
+ * pipe receives every message in the batch that is registered to it, in
+ * order, with a single queue operation. The messages are sent with
+ * MB_PRIORITY_NORMAL.
+ *
+ * @param[in] messages - an array of pointers to the messages to send.
+ * @param[in] num_msgs - the number of messages, up to MB_MAX_BATCH_MSGS.
+ * @param[in] timeout - a timeout value for how long to wait for space on a pipe.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_send_batch(MSG_Header **messages,
+                             uint32_t num_msgs,
+                             OS_Timeout timeout);
+
+/**
+ * @brief This function receives up to 'max_msgs' messages from a pipe. It
+ * waits up to the timeout for the first message, and then takes the
+ * messages already on the pipe without waiting again.
+ *
+ * @param[in] pipe_id - the pipe to receive from.
+ * @param[out] buffer - a buffer of 'max_msgs' messages of 'msg_size_bytes'
+ *                      each. Message n is placed at offset n * msg_size_bytes.
+ * @param[in] msg_size_bytes - the space for each message in the buffer.
+ * @param[in] max_msgs - the maximum number of messages to receive.
+ * @param[out] msg_sizes - an array of 'max_msgs' sizes, filled out with the
+ *                         size of each received message.
+ * @param[out] num_msgs - filled out with the number of messages received.
+ * @param[in] timeout - the timeout indicating how long to wait for a message (in
+ *                      system clock ticks).
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_receive_batch(MB_Pipe pipe_id,
+                                uint8_t *buffer,
+                                uint32_t msg_size_bytes,
+                                uint32_t max_msgs,
+                                uint32_t *msg_sizes,
+                                uint32_t *num_msgs,
+                                OS_Timeout timeout);
+
 /**
  * @brief This function creates a pipe. A pipe can have packet types registered,
  * and a call to mb_send will send the packet to all registered pipes.
  *
  * @param[out] pipe - a pointer to a message pipe handle, which will be filled out with
  *               a new message pipe handle.
- * @param[in] msg_size_bytes - the maximum numnber of bytes in a message
+ * @param[in] msg_size_bytes - the maximum numnber of bytes in a message, including
+ *                            its header
  * @param[in] num_msgs - the maximum number of messages that can be queued for this pipe
  *
  * @return Either success (MB_RESULT_OKAY), or an error code indicating the
@@ -80,6 +163,80 @@ MB_RESULT_ENUM mb_create_pipe(MB_Pipe *pipe,
                               uint32_t num_msgs,
                               uint32_t msg_size_bytes);
 
+/**
+ * @brief This function creates a loan pipe. A loan pipe holds only pointers to
+ * buffers in the Message Bus loan pool, so placing a message on it costs the
+ * same regardless of the message size.
+ *
+ * Loan pipes can be read with mb_receive_loan without copying the message, or
+ * with mb_receive, which copies the message out and releases it.
+ *
+ * @param[out] pipe - a pointer to a message pipe handle, which will be filled out with
+ *               a new message pipe handle.
+ * @param[in] num_msgs - the maximum number of messages that can be queued for this pipe
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_create_loan_pipe(MB_Pipe *pipe, uint32_t num_msgs);
+
+/**
+ * @brief This function loans a buffer from the Message Bus loan pool. The
+ * caller fills out the message in place and then either publishes it with
+ * mb_publish or returns it with mb_release.
+ *
+ * @param[out] message - filled out with a pointer to the loaned buffer.
+ * @param[in] size_bytes - the size of the message, including its header.
+ *
+ * @return Either success (MB_RESULT_OKAY), MB_RESULT_NO_BUFFERS if the pool
+ *         is exhausted, or an error code indicating the source of the error.
+ */
+MB_RESULT_ENUM mb_loan(MSG_Header **message, uint32_t size_bytes);
+
+/**
+ * @brief This function publishes a loaned message on the message bus. Loan
+ * pipes receive a pointer to the message, and copy pipes receive a copy.
+ * The message is sent with MB_PRIORITY_NORMAL.
+ *
+ * The caller's reference to the message is released by this function, even
+ * when an error is returned, so the message must not be used afterwards.
+ *
+ * @param[in] message - a message loaned with mb_loan.
+ * @param[in] timeout - a timeout value for how long to wait for space on each pipe.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_publish(MSG_Header *message, OS_Timeout timeout);
+
+/**
+ * @brief This function receives a message from a loan pipe without copying
+ * it. The message must be given back with mb_release once the receiver is
+ * done with it.
+ *
+ * @param[in] pipe_id - the loan pipe to receive from.
+ * @param[out] message - filled out with a pointer to the received message.
+ * @param[in] timeout - the timeout indicating how long to wait for a message (in
+ *                      system clock ticks).
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_receive_loan(MB_Pipe pipe_id,
+                               MSG_Header **message,
+                               OS_Timeout timeout);
+
+/**
+ * @brief This function releases a reference to a loaned message. The buffer
+ * returns to the loan pool when its last reference is released.
+ *
+ * @param[in] message - a message from mb_loan or mb_receive_loan.
+ *
+ * @return Either success (MB_RESULT_OKAY), or MB_RESULT_INVALID_ARGUMENTS if
+ *         the message is not a loaned buffer with an outstanding reference.
+ */
+MB_RESULT_ENUM mb_release(MSG_Header *message);
+
 /**
  * @brief This function registers a message to receive on a pipe. Messages
  * sent on the message bus will be delivered to any pipe listening for that
@@ -9,6 +9,7 @@
 #define __MB_DEFINITIONS_H__
 
 #include "stdint.h"
+#include "stdatomic.h"
 
 #include "os_queue.h"
 
@@ -23,10 +24,45 @@
 #define MB_MAX_NUM_PIPES 100
 
 /**
- * This definition controls the maximum number of
- * pipes that can be registered for a particular packet.
+ * This definition is the number of 64 bit words in a packet's
+ * subscriber mask, which has a bit for every pipe.
  */
-#define MB_MAX_PIPES_PER_PACKET 10
+#define MB_PIPE_MASK_WORDS ((MB_MAX_NUM_PIPES + 63) / 64)
+
+/**
+ * This definition is the alignment of each packet's routing entry, so
+ * that finding a packet's subscribers reads a single cache line.
+ */
+#define MB_CACHE_LINE_BYTES 64
+
+/**
+ * This definition is the number of buffers in the Message Bus loan pool.
+ * A loaned buffer is held until every pipe it was published to has
+ * released it.
+ */
+#define MB_NUM_LOAN_BUFFERS 32
+
+/**
+ * This definition is the size of each buffer in the loan pool, including
+ * the message header.
+ */
+#define MB_LOAN_BUFFER_SIZE_BYTES 1024
+
+/**
+ * This definition is the maximum number of messages in a batch given to
+ * mb_send_batch, and the most messages a loan pipe gives to a single call
+ * to mb_receive_batch.
+ */
+#define MB_MAX_BATCH_MSGS 16
+
+/**
+ * This definition is the type of OS queue used for pipes. Pipes have many
+ * senders and a single receiving task, so by default they are lock-free
+ * MPSC rings. It can be set to OS_QUEUE_TYPE_DEFAULT to use the OS queue.
+ */
+#ifndef MB_PIPE_QUEUE_TYPE
+#define MB_PIPE_QUEUE_TYPE OS_QUEUE_TYPE_MPSC
+#endif
 
 /**
  * This event message indicates that a message could not be sent.
@@ -57,18 +93,86 @@ typedef enum
     MB_RESULT_SEND_ERROR         = 9,  /*<< Message send error */
     MB_RESULT_INVALID_PACKET_ID  = 10, /*<< Invalid packet id given */
     MB_RESULT_NO_RECEIVER        = 11, /*<< No receiver available to receive a message */
+    MB_RESULT_NO_BUFFERS         = 12, /*<< No buffer was available in the loan pool */
+    MB_RESULT_MSG_TOO_LARGE      = 13, /*<< A message did not fit in the provided buffer */
     MB_RESULT_NUM_RESULTS              /*<< Number of result values for MB */
 } MB_RESULT_ENUM;
 
 /**
- * This structure contains the data related to pipes. This is used
+ * The MB_PIPETYPE_ENUM indicates how messages are placed on a pipe.
+ * Copy pipes hold a copy of each message, while loan pipes hold only a
+ * pointer to a buffer in the Message Bus loan pool.
+ */
+typedef enum
+{
+    MB_PIPETYPE_INVALID = 0, /*<< Invalid pipe type */
+    MB_PIPETYPE_COPY    = 1, /*<< Messages are copied onto the pipe */
+    MB_PIPETYPE_LOAN    = 2, /*<< Pointers to loaned buffers are placed on the pipe */
+} MB_PIPETYPE_ENUM;
+
+/**
+ * The MB_PRIORITY_ENUM is the priority of a message on a pipe. A pipe gives
+ * out its highest priority messages first, so commands and events are not
+ * held up behind a backlog of bulk telemetry. Messages of the same priority
+ * are received in the order they were sent.
+ */
+typedef enum
+{
+    MB_PRIORITY_LOW      = 0, /*<< Bulk data, received after all other messages */
+    MB_PRIORITY_NORMAL   = 1, /*<< The priority of messages sent with mb_send */
+    MB_PRIORITY_HIGH     = 2, /*<< Latency sensitive messages such as events */
+    MB_PRIORITY_CRITICAL = 3, /*<< Messages such as commands that bypass all other traffic */
+    MB_PRIORITY_NUM_PRIORITIES /*<< Number of message priorities */
+} MB_PRIORITY_ENUM;
+
+// each MB priority is carried directly as an OS queue priority
+_Static_assert(MB_PRIORITY_NUM_PRIORITIES == OS_QUEUE_NUM_PRIORITIES,
+               "MB priorities must match the OS queue priorities");
+_Static_assert(MB_PRIORITY_NORMAL == OS_QUEUE_PRIORITY_DEFAULT,
+               "MB_PRIORITY_NORMAL must match the OS queue default priority");
+
+/**
+ * The MB_COUNTER_ENUM is the index of each count in the MB status within
+ * the MB module's sharded counters. Every sender and receiver counts in its
+ * own shard, and the counts are only summed by mb_get_status.
+ */
+typedef enum
+{
+    MB_COUNTER_MESSAGES_SENT          = 0, /*<< MB_Status messages_sent */
+    MB_COUNTER_MESSAGES_RECEIVED      = 1, /*<< MB_Status messages_received */
+    MB_COUNTER_MESSAGE_SENT_ERRORS    = 2, /*<< MB_Status message_sent_errors */
+    MB_COUNTER_MESSAGE_RECEIVE_ERRORS = 3, /*<< MB_Status message_receive_errors */
+    MB_COUNTER_LOAN_ERRORS            = 4, /*<< MB_Status loan_errors */
+    MB_COUNTER_NUM_COUNTERS                /*<< Number of MB counters */
+} MB_COUNTER_ENUM;
+
+_Static_assert(MB_COUNTER_NUM_COUNTERS <= OS_COUNTER_MAX_COUNTERS,
+               "MB counters must fit in a set of OS counters");
+
+/**
+ * This structure is a buffer in the Message Bus loan pool. The reference
+ * count is the number of holders of the buffer- the task that loaned it
+ * until it is published, and each pipe it was placed on until the
+ * message is released by the receiver.
+ */
+typedef struct
+{
+  atomic_uint references;                             /*<< The number of holders of this buffer. 0 means the buffer is free */
+  _Alignas(8) uint8_t data[MB_LOAN_BUFFER_SIZE_BYTES]; /*<< The message stored in this buffer */
+} MB_LoanBuffer;
+
+/**
+ * This structure contains the routing data for a packet. This is used
  * when registering packet types with a pipe, and when sending
  * a message on a pipe.
+ *
+ * Registering sets a pipe's bit with an atomic OR, so pipes can be
+ * registered at runtime while other tasks are sending.
  */
 typedef struct
 {
-  uint32_t num_queues;                       /*<< The number of queues used in the 'queues' array */
-  uint32_t queues[MB_MAX_PIPES_PER_PACKET];  /*<< The array of queues associated with the packet that MB_PacketData tracks */
+  _Alignas(MB_CACHE_LINE_BYTES)
+  atomic_uint_least64_t subscribers[MB_PIPE_MASK_WORDS]; /*<< Bit n of word n / 64 is set if pipe n receives the packet */
 } MB_PacketData;
 
 /**
@@ -85,6 +189,7 @@ typedef struct
     int32_t  send_error_code;          /*<< The error code returned from the os_queue on the last send error */
     uint32_t receive_error_pipe_id;    /*<< The pipe ID that caused the last receive error */
     int32_t  receive_error_code;       /*<< The error code returned from the os_queue on the last receive error */
+    uint32_t loan_errors;              /*<< A count of failed attempts to loan a buffer from the loan pool */
 } MB_Status;
 
 /**
@@ -94,8 +199,13 @@ typedef struct
 {
   uint32_t num_pipes;                                 /*<< The number of allocated pipes in the 'pipes' array */
   OS_Queue pipes[MB_MAX_NUM_PIPES];                   /*<< The queues allocated to receive packets */
+  MB_PIPETYPE_ENUM pipe_types[MB_MAX_NUM_PIPES];      /*<< The type of each allocated pipe */
   MB_PacketData packets[MSG_PACKETID_NUM_PACKET_IDS]; /*<< The packet structures tracking which queues are used to receive which packets */
-  MB_Status status;                                   /*<< The MB module status structure reported in health and status */
+  MB_Status status;                                   /*<< The last send and receive errors. The counts are kept in 'counters' */
+  OS_Seqlock status_lock;                             /*<< Gives mb_get_status a consistent copy of 'status' */
+  OS_Counters counters;                               /*<< The counts reported in 'status', indexed by MB_COUNTER_ENUM */
+  atomic_uint next_loan;                              /*<< The loan buffer index to start searching from on the next loan */
+  MB_LoanBuffer loans[MB_NUM_LOAN_BUFFERS];           /*<< The loan pool used for zero-copy messages */
 } MB_State;
 
 #endif // ndef __MB_DEFINITIONS_H__ */
@@ -49,6 +49,7 @@ typedef enum
     MSG_PACKETID_HEALTHANDSTATUS = 1, /*<< Health and Status packet ID */
     MSG_PACKETID_EVENT           = 2, /*<< Event packet ID */
     MSG_PACKETID_COMMAND         = 3, /*<< Command packet ID */
+    MSG_PACKETID_DELTA           = 4, /*<< Delta encoded telemetry packet ID */
     MSG_PACKETID_NUM_PACKET_IDS,      /*<< Number of packet IDs */
 } MSG_PACKETID_ENUM;
 
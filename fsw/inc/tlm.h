@@ -20,14 +20,100 @@ FSW_RESULT_ENUM tlm_initialize(void);
 
 /**
  * This is the main task of the Telemetry module.
- * It is responsible for sending the health and status packet
- * to the Message Bus.
+ * It runs TLM_CYCLES_PER_SECOND times a second, and sends each
+ * telemetry packet on the cycles it is due.
  *
  * @param[in] unused - this argument is not used, but is provided
  * because all tasks registered with Task Manager take 1 argument.
  */
 void tlm_telemetry_task(void *argument);
 
+/**
+ * @brief tlm_register_packet
+ *
+ * This function registers a telemetry packet. The packets in the telemetry
+ * packet table are registered by tlm_initialize, which also clears any
+ * packets registered before it.
+ *
+ * @param[in] definition - the packet's definition, which is copied.
+ *
+ * @return A TLM result type either indicating success (TLM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+TLM_RESULT_ENUM tlm_register_packet(const TLM_PacketDefinition *definition);
+
+/**
+ * @brief tlm_collect
+ *
+ * This function runs one collection cycle, building and sending each
+ * packet that is due on the cycle. Each packet is built by calling its
+ * status providers directly into the packet.
+ *
+ * @return The number of packets sent.
+ */
+uint32_t tlm_collect(void);
+
+/**
+ * @brief tlm_delta_encode
+ *
+ * This function delta encodes a telemetry packet relative to the last
+ * packet encoded with the same state. A keyframe with every word of the
+ * packet is encoded instead for the first packet, once every
+ * 'keyframe_period' packets, and whenever a delta would be no smaller.
+ *
+ * @param[in,out] state - the encoder state, zeroed before the first packet.
+ * @param[in] keyframe_period - the number of packets per keyframe.
+ * @param[in] packet - the packet to encode.
+ * @param[out] delta - the encoded MSG_PACKETID_DELTA packet.
+ * @param[in] delta_size_bytes - the size of the buffer at 'delta'.
+ *
+ * @return A TLM result type either indicating success (TLM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+TLM_RESULT_ENUM tlm_delta_encode(TLM_DeltaState *state,
+                                 uint32_t keyframe_period,
+                                 const MSG_Header *packet,
+                                 MSG_Header *delta,
+                                 uint32_t delta_size_bytes);
+
+/**
+ * @brief tlm_delta_decoder_init
+ *
+ * This function initializes a delta decoder, which then waits for a
+ * keyframe of each packet. If a null pointer is provided, then it will
+ * do nothing.
+ */
+void tlm_delta_decoder_init(TLM_DeltaDecoder *decoder);
+
+/**
+ * @brief tlm_delta_decode
+ *
+ * This function decodes a MSG_PACKETID_DELTA packet into the packet it
+ * encodes. If a packet was lost, deltas of that packet are rejected with
+ * TLM_RESULT_NO_KEYFRAME until its next keyframe is decoded.
+ *
+ * @param[in,out] decoder - the decoder, initialized with tlm_delta_decoder_init.
+ * @param[in] delta - the delta encoded packet.
+ * @param[out] packet - the decoded packet.
+ * @param[in] packet_size_bytes - the size of the buffer at 'packet'.
+ *
+ * @return A TLM result type either indicating success (TLM_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+TLM_RESULT_ENUM tlm_delta_decode(TLM_DeltaDecoder *decoder,
+                                 const MSG_Header *delta,
+                                 MSG_Header *packet,
+                                 uint32_t packet_size_bytes);
+
+/**
+ * @brief tlm_get_task_timing
+ *
+ * This function provides the timing of the next registered task after
+ * the one last provided, so that each task's timing is reported in turn.
+ * If a null pointer is provided, then it will do nothing.
+ */
+void tlm_get_task_timing(TLM_TaskTimingStatus *timing);
+
 /**
  * @brief tlm_get_status
  *
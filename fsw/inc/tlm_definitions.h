@@ -9,8 +9,9 @@
 #define __TLM_DEFINITIONS_H__
 
 #include "stdint.h"
+#include "stdbool.h"
 
-#include "tlm_definitions.h"
+#include "msg_definitions.h"
 #include "mb_definitions.h"
 #include "em_definitions.h"
 #include "tm_definitions.h"
@@ -23,6 +24,88 @@
  */
 #define TLM_EVENT_ID_TLM_ERROR 1
 
+/**
+ * This definition is the task id reported with the task timing in health
+ * and status when no task is registered with the Task Manager.
+ */
+#define TLM_TIMING_NO_TASK (-1)
+
+/**
+ * This definition is the number of times per second the telemetry task
+ * runs. Each packet's period is a number of these collection cycles.
+ */
+#define TLM_CYCLES_PER_SECOND 10
+
+/**
+ * This definition is the period, in collection cycles, of a 1 Hz packet.
+ */
+#define TLM_PERIOD_1_HZ TLM_CYCLES_PER_SECOND
+
+/**
+ * This definition is the maximum number of telemetry packet definitions.
+ */
+#define TLM_MAX_PACKETS 8
+
+/**
+ * This definition is the maximum number of status providers in a
+ * telemetry packet.
+ */
+#define TLM_MAX_PACKET_PROVIDERS 8
+
+/**
+ * This definition is the maximum size of a telemetry packet, including
+ * the message header. Packets must fit in a loan buffer to be received
+ * on a loan pipe.
+ */
+#define TLM_MAX_PACKET_SIZE_BYTES MB_LOAN_BUFFER_SIZE_BYTES
+
+/**
+ * This definition is the number of 32 bit words in the largest packet's
+ * data. Delta encoding compares packets one word at a time.
+ */
+#define TLM_DELTA_MAX_WORDS ((TLM_MAX_PACKET_SIZE_BYTES - sizeof(MSG_Header) + 3) / 4)
+
+/**
+ * This definition is the number of 32 bit words in the bitmap of changed
+ * words in a delta encoded packet.
+ */
+#define TLM_DELTA_BITMAP_WORDS ((TLM_DELTA_MAX_WORDS + 31) / 32)
+
+/**
+ * This definition is the default number of packets sent between keyframes
+ * for a delta encoded packet. Every keyframe period packets, the whole
+ * packet is sent, so a receiver that missed a packet can decode again.
+ */
+#define TLM_DELTA_DEFAULT_KEYFRAME_PERIOD 10
+
+/**
+ * This definition is the flag set in a delta header when the packet is a
+ * keyframe, carrying every word of the packet's data.
+ */
+#define TLM_DELTA_FLAG_KEYFRAME 0x01
+
+/**
+ * This definition defines the provider function for a status function and
+ * the status type it fills out, such as
+ * TLM_PROVIDER_FUNCTION(mb_get_status, MB_Status). The status function takes
+ * a pointer to its status type, so it can not be called through a
+ * TLM_ProviderFunction. Instead, the provider function, named after it,
+ * passes it the status converted to its type.
+ */
+#define TLM_PROVIDER_FUNCTION(function, type) \
+  static void function##_provider(void *status) \
+  { \
+    function((type*)status); \
+  }
+
+/**
+ * This definition creates a status provider for a status function and
+ * the status type it fills out, such as TLM_PROVIDER(mb_get_status, MB_Status).
+ * The provider function must be defined first with TLM_PROVIDER_FUNCTION.
+ */
+#define TLM_PROVIDER(function, type) \
+  { function##_provider, sizeof(type), _Alignof(type) }
+
 
 /**
  * This enum is the result enum for the Telemetry module.
@@ -33,9 +116,25 @@ typedef enum TLM_RESULT_ENUM
 {
   TLM_RESULT_INVALID = 0, /*<< Invalid result */
   TLM_RESULT_OKAY    = 1, /*<< Success */
+  TLM_RESULT_INVALID_ARGUMENTS = 2, /*<< Invalid arguments provided to a function */
+  TLM_RESULT_PACKETS_FULL      = 3, /*<< The maximum number of packets was reached */
+  TLM_RESULT_PACKET_TOO_LARGE  = 4, /*<< A packet's status does not fit in a packet */
+  TLM_RESULT_NULL_POINTER      = 5, /*<< A null pointer was detected */
+  TLM_RESULT_INVALID_PACKET    = 6, /*<< A delta encoded packet was malformed */
+  TLM_RESULT_NO_KEYFRAME       = 7, /*<< A delta can not be decoded until a keyframe is received */
   TLM_RESULT_NUM_RESULTS /**< The number of Telemetry module result types */
 } TLM_RESULT_ENUM;
 
+/**
+ * The TLM_ENCODING_ENUM is how a telemetry packet is sent.
+ */
+typedef enum TLM_ENCODING_ENUM
+{
+  TLM_ENCODING_FULL  = 0, /*<< The whole packet is sent each time */
+  TLM_ENCODING_DELTA = 1, /*<< Only the words changed since the last packet are sent */
+  TLM_ENCODING_NUM_ENCODINGS /*<< The number of telemetry encodings */
+} TLM_ENCODING_ENUM;
+
 /**
  * This struct is the status structure for the Telemetry module.
  */
@@ -45,17 +144,125 @@ typedef struct TLM_Status
   uint32_t telemetry_errors;
 } TLM_Status;
 
+/**
+ * This type is a status provider's function, which fills out the
+ * provider's status.
+ */
+typedef void (*TLM_ProviderFunction)(void *status);
+
+/**
+ * This struct is a status provider, which fills out one part of a
+ * telemetry packet. It is usually created with TLM_PROVIDER.
+ */
+typedef struct TLM_Provider
+{
+  TLM_ProviderFunction function; /*<< The function filling out the status */
+  uint32_t size_bytes; /*<< The size of the status */
+  uint32_t alignment; /*<< The alignment of the status type */
+} TLM_Provider;
+
+/**
+ * This struct is the definition of a telemetry packet. The packet's data
+ * is the status of each of its providers in order, each aligned as it
+ * would be as a member of a struct, so a packet can be read as a struct
+ * with a member for each provider.
+ *
+ * The packet is built and sent on the cycles where
+ * (cycle % period) == phase, so packets with the same period can be
+ * spread across cycles.
+ */
+typedef struct TLM_PacketDefinition
+{
+  MSG_PACKETID_ENUM packet_id; /*<< The packet id the packet is sent with */
+  uint32_t period; /*<< The period of the packet, in collection cycles */
+  uint32_t phase; /*<< The cycle within the period the packet is sent on */
+  TLM_ENCODING_ENUM encoding; /*<< How the packet is sent */
+  uint32_t keyframe_period; /*<< For delta encoding, the packets sent per keyframe */
+  uint32_t num_providers; /*<< The number of providers in 'providers' */
+  TLM_Provider providers[TLM_MAX_PACKET_PROVIDERS]; /*<< The packet's status providers, in order */
+} TLM_PacketDefinition;
+
+/**
+ * This struct is the header of a delta encoded packet, which is sent with
+ * the packet id MSG_PACKETID_DELTA.
+ *
+ * A keyframe is followed by every word of the packet's data. Otherwise the
+ * header is followed by a bitmap with a bit for each word of the packet's
+ * data, set if the word changed since the last packet, and then by each
+ * changed word in order.
+ */
+typedef struct TLM_DeltaHeader
+{
+  uint8_t packet_id; /*<< The MSG_PACKETID_ENUM of the encoded packet */
+  uint8_t flags; /*<< TLM_DELTA_FLAG_KEYFRAME for a keyframe */
+  uint16_t sequence; /*<< Counts the packets encoded, so a lost packet is seen */
+  uint16_t length; /*<< The length of the encoded packet's data */
+  uint16_t num_changed; /*<< The number of words following the header or bitmap */
+} TLM_DeltaHeader;
+
+/**
+ * This struct is the state of a delta encoder or decoder for one packet,
+ * which is the last packet's data that the next delta is relative to.
+ */
+typedef struct TLM_DeltaState
+{
+  uint32_t words[TLM_DELTA_MAX_WORDS]; /*<< The last packet's data */
+  uint16_t length; /*<< The length of the last packet's data */
+  uint16_t sequence; /*<< The sequence of the next packet */
+  bool valid; /*<< Whether 'words' holds a packet the next delta is relative to */
+  uint32_t since_keyframe; /*<< For an encoder, the packets encoded since the last keyframe */
+} TLM_DeltaState;
+
+/**
+ * This struct is a decoder for delta encoded packets, with the state of
+ * each packet id.
+ */
+typedef struct TLM_DeltaDecoder
+{
+  TLM_DeltaState packets[MSG_PACKETID_NUM_PACKET_IDS]; /*<< The state of each packet id */
+} TLM_DeltaDecoder;
+
+/**
+ * This struct is a registered telemetry packet.
+ */
+typedef struct TLM_Packet
+{
+  TLM_PacketDefinition definition; /*<< The packet's definition */
+  uint32_t offsets[TLM_MAX_PACKET_PROVIDERS]; /*<< The offset of each provider's status after the header */
+  uint32_t size_bytes; /*<< The size of the packet, including the header */
+  TLM_DeltaState delta; /*<< For delta encoding, the last packet sent */
+} TLM_Packet;
+
 /**
  * This struct is the state struct of the Telemetry module.
  */
 typedef struct TLM_State
 {
   TLM_Status status;
+  OS_Seqlock status_lock; /*<< Gives tlm_get_status a consistent copy of 'status' */
+  TM_TaskId timing_task_id; /*<< The task whose timing was last reported */
+  TLM_Packet packets[TLM_MAX_PACKETS]; /*<< The registered telemetry packets */
+  uint32_t num_packets; /*<< The number of registered packets */
+  uint32_t cycle; /*<< The number of collection cycles run */
 } TLM_State;
 
+/**
+ * This struct is the timing of one task, reported in turn for each
+ * registered task.
+ */
+typedef struct TLM_TaskTimingStatus
+{
+  TM_TaskId  task_id; /*<< The task id of 'timing', or TLM_TIMING_NO_TASK */
+  TM_TaskTiming timing; /*<< The timing of the task */
+} TLM_TaskTimingStatus;
+
 /**
  * This struct contains the status structure of all modules in the flight
- * software.
+ * software. It is the layout of the health and status packet defined in
+ * the telemetry packet table.
+ *
+ * The timing of every task does not fit in one packet, so each packet
+ * carries the timing of the next registered task in turn.
  */
 typedef struct TLM_HealthAndStatus
 {
@@ -63,6 +270,8 @@ typedef struct TLM_HealthAndStatus
   MB_Status  mb;
   EM_Status  em;
   TM_Status  tm;
+  TM_CpuUsage cpu; /*<< The CPU usage of each task over the last frame */
+  TLM_TaskTimingStatus timing; /*<< The timing of one task */
 } TLM_HealthAndStatus;
 
 /**
@@ -75,4 +284,8 @@ typedef struct TLM_HealthAndStatusMessage
   TLM_HealthAndStatus telemetry;
 } TLM_HealthAndStatusMessage;
 
+// health and status must fit in a loan buffer to be received on a loan pipe
+_Static_assert(sizeof(TLM_HealthAndStatusMessage) <= MB_LOAN_BUFFER_SIZE_BYTES,
+               "The health and status packet must fit in an MB loan buffer");
+
 #endif // ndef __TLM_DEFINITIONS_H__ */
@@ -79,13 +79,54 @@ TM_RESULT_ENUM tm_event_task(char *task_name,
                              int stack_size,
                              int priority);
 
+/**
+ * @brief tm_high_rate_task
+ *
+ * This task registers a task to run at a period given in nanoseconds,
+ * which can be shorter than a schedule slot. The task is not released by
+ * the scheduler- instead its calls to tm_running sleep until an absolute
+ * deadline on the monotonic clock, so its releases do not wait on the
+ * schedule timer and do not drift.
+ *
+ * The sleep can end late by the OS's wakeup latency. A task registered
+ * with a spin time wakes that long before each release and busy-waits
+ * until it is due, trading CPU time for release accuracy.
+ *
+ * @param[in] task_name - a string to use as a name for the task.
+ * @param[in] task_id - a unique integer identifying the task.
+ * @param[in] task_function - a function pointer to use when spawning the task.
+ * @param[in] task_argument - a single argument to provide to the start function.
+ * @param[in] period_ns - the period at which to run the task, in nanoseconds.
+ * @param[in] spin_ns - the time before each release to busy-wait rather than
+ *                      sleep, in nanoseconds. This must be less than the period.
+ * @param[in] heartbeat_period - the maximum number of schedule slots between
+ *                               heartbeats for this task.
+ * @param[in] stack_size - the stack size to give to the task when it is spawned
+ * @param[in] priority - the task priority.
+ */
+TM_RESULT_ENUM tm_high_rate_task(char *task_name,
+                                 TM_TaskId task_id,
+                                 OS_TASK_FUNC *task_function,
+                                 void *task_argument,
+                                 uint64_t period_ns,
+                                 uint64_t spin_ns,
+                                 int heartbeat_period,
+                                 int stack_size,
+                                 int priority);
+
 /**
  * @brief tm_callback_task
  *
- * This task registers a task which is run as a callback in the Task Manager
- * module's Scheduler task. These tasks are scheduled based on a provided period,
- * in schedule slot increments. If the TM_SYSTEM_CLOCK_TICKS_PER_SLOT is 1,
- * then this is the number of system clock ticks between when this callback is run.
+ * This task registers a task which is run as a callback when released by the
+ * Task Manager module's Scheduler task. These tasks are scheduled based on a
+ * provided period, in schedule slot increments. If the
+ * TM_SYSTEM_CLOCK_TICKS_PER_SLOT is 1, then this is the number of system clock
+ * ticks between when this callback is run.
+ *
+ * The callback is run by one of the Task Manager's worker tasks, so a long
+ * callback does not delay the schedule. A callback that is still queued or
+ * running when it is released again is counted as an overrun rather than
+ * queued twice. See tm_callback_inline for short callbacks.
  *
  * @param[in] task_name - a string to use as a name for the task.
  * @param[in] task_id - a unique integer identifying the task.
@@ -99,6 +140,33 @@ TM_RESULT_ENUM tm_callback_task(char *task_name,
                                 void *task_argument,
                                 int period);
 
+/**
+ * @brief tm_task_affinity
+ *
+ * This function restricts a registered periodic, high rate or event task to a set of
+ * CPUs. The task is spawned on these CPUs when the Task Manager starts, so
+ * this must be called after the task is registered and before tm_start.
+ * Registering a task again lets it run on any CPU.
+ *
+ * @param[in] task_id - the id of a registered periodic, high rate or event task.
+ * @param[in] cpus - the CPUs the task may run on, or OS_CPU_MASK_ANY.
+ */
+TM_RESULT_ENUM tm_task_affinity(TM_TaskId task_id, OS_CpuMask cpus);
+
+/**
+ * @brief tm_callback_inline
+ *
+ * This function sets whether a registered callback task runs inline in the
+ * scheduler task rather than in a worker. This avoids the handoff to a
+ * worker for callbacks that are trivially short, but such a callback
+ * delays every task released after it. Registering a task again runs it
+ * in a worker.
+ *
+ * @param[in] task_id - the id of a registered callback task.
+ * @param[in] run_inline - true to run the callback in the scheduler.
+ */
+TM_RESULT_ENUM tm_callback_inline(TM_TaskId task_id, bool run_inline);
+
 /**
  * @brief tm_monitor_task
  *
@@ -125,6 +193,43 @@ TM_RESULT_ENUM tm_monitor_task(char *task_name, TM_TaskId task_id);
  */
 void tm_scheduler_task(void *argument);
 
+/**
+ * @brief tm_workers_start
+ *
+ * This function spawns the Task Manager's callback workers. It is called
+ * by tm_start. Until the workers are started, callbacks run inline.
+ *
+ * @return TM_RESULT_OKAY, TM_RESULT_SEM_CREATE_ERROR or
+ * TM_RESULT_TASK_SPAWN_ERROR. Callbacks are given to the workers that
+ * were spawned even if others failed.
+ */
+TM_RESULT_ENUM tm_workers_start(void);
+
+/**
+ * @brief tm_workers_dispatch
+ *
+ * This function queues a callback task on a worker, waking a worker to
+ * run it. Workers are given callbacks in turn, and an idle worker steals
+ * callbacks queued behind a busy one.
+ *
+ * @param[in] task_id - the id of the callback task to run.
+ *
+ * @return true if the callback was queued, or false if every worker's
+ * queue is full or no workers are running.
+ */
+bool tm_workers_dispatch(TM_TaskId task_id);
+
+/**
+ * @brief tm_worker_task
+ *
+ * This function is the task of a callback worker. It runs the callbacks
+ * from its own queue, and then those stolen from other workers, and
+ * blocks when there are none.
+ *
+ * @param[in] argument - the worker's TM_Worker.
+ */
+void tm_worker_task(void *argument);
+
 /**
  * @brief tm_running
  *
@@ -133,6 +238,9 @@ void tm_scheduler_task(void *argument);
  * This function will block rate tasks until they are ready to be
  * run. For other tasks, this function will return without blocking.
  *
+ * Each call records the time the task took since its last call, and for
+ * rate tasks, how late the task started after it was released.
+ *
  * @param[in] task_id - the task id of the current task. This is used to
  *            determine the task type.
  *
@@ -150,16 +258,38 @@ bool tm_running(TM_TaskId task_id);
  */
 void tm_stop(void);
 
+/**
+ * @brief tm_shutdown
+ *
+ * This function stops the Task Manager schedule and waits for the spawned
+ * periodic, high rate and event tasks and callback workers to exit, joining each one. Periodic tasks are
+ * released so that they see the stop, and high rate tasks see it at their
+ * next release, but event tasks must return to tm_running on their own
+ * before the deadline.
+ *
+ * @param[in] timeout - the number of OS clock ticks to wait for all tasks,
+ * shared between the tasks, or OS_TIMEOUT_WAIT_FOREVER.
+ *
+ * @return TM_RESULT_OKAY if every task was joined, or
+ * TM_RESULT_SHUTDOWN_TIMEOUT if any task had not exited by the deadline.
+ * Tasks that were not joined can be joined by calling this function again.
+ */
+TM_RESULT_ENUM tm_shutdown(OS_Timeout timeout);
+
 /**
  * @brief tm_start
  *
- * This function starts the Task Manager schedule. It spawns all tasks,
- * and starts the timer which driver the schedule.
+ * This function starts the Task Manager schedule. It compiles the schedule
+ * table from the registered tasks, spawns all tasks, and starts the timer
+ * which driver the schedule.
  *
  * @return a TM_RESULT_ENUM that indicating either a successful start,
  * or indicates an error.
  * TM_RESULT_TIMER_ERROR indicates that the schedule timer could not be started.
  * TM_RESULT_TASK_SPAWN_ERROR indicates that one or more tasks failed.
+ * TM_RESULT_SCHEDULE_ERROR indicates that the registered task periods need a
+ * longer major frame than TM_MAX_SCHEDULE_SLOTS, or more releases than
+ * TM_MAX_SCHEDULE_ENTRIES. In this case no tasks are spawned.
  *
  * Note that if the timer fails, then this will be returned even if one or more
  * task fails to spawn. This is in order to attempt to start the system even if
@@ -176,4 +306,36 @@ TM_RESULT_ENUM tm_start(void);
  */
 void tm_get_status(TM_Status *status);
 
+/**
+ * @brief tm_get_cpu_usage
+ *
+ * This function provides the CPU utilization of each spawned task, and the
+ * CPU headroom of the system, measured over the last frame. It does not
+ * provide a return- if a null pointer is provided, then it will do nothing.
+ */
+void tm_get_cpu_usage(TM_CpuUsage *usage);
+
+/**
+ * @brief tm_get_task_timing
+ *
+ * This function provides the timing recorded for a registered task.
+ *
+ * @param[in] task_id - the task id of the task.
+ * @param[out] timing - a non-NULL pointer to fill out with the task's timing.
+ *
+ * @return TM_RESULT_OKAY on success, TM_RESULT_NULL_POINTER if 'timing' is
+ * NULL, or TM_RESULT_INVALID_ARGUMENT if no task is registered with the id.
+ */
+TM_RESULT_ENUM tm_get_task_timing(TM_TaskId task_id, TM_TaskTiming *timing);
+
+/**
+ * @brief tm_histogram_record
+ *
+ * This function records a duration in a timing histogram.
+ *
+ * @param[in,out] histogram - a non-NULL pointer to the histogram to update.
+ * @param[in] nanoseconds - the duration to record.
+ */
+void tm_histogram_record(TM_Histogram *histogram, uint64_t nanoseconds);
+
 #endif // ndef __TM_INTERFACE_H__ */
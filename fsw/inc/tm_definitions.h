@@ -10,7 +10,10 @@
 
 #include "stdint.h" 
 #include "stdbool.h" 
+#include "stdatomic.h"
 
+#include "os_types.h"
+#include "os_task.h"
 #include "os_sem.h"
 #include "os_timer.h"
 
@@ -28,6 +31,46 @@
  */
 #define TM_SYSTEM_CLOCK_TICKS_PER_SLOT 1
 
+/**
+ * This definition is the number of schedule slots in a frame. A frame is
+ * one second of the schedule, and slot overruns are counted by their
+ * position in the frame.
+ */
+#define TM_SLOTS_PER_FRAME (TM_SYSTEM_CLOCK_TICKS_PER_SECOND / TM_SYSTEM_CLOCK_TICKS_PER_SLOT)
+
+/**
+ * This definition is the number of OS clock ticks in a schedule slot. This is
+ * the period of the timer that drives the schedule.
+ */
+#define TM_OS_TICKS_PER_SLOT \
+    ((TM_SYSTEM_CLOCK_TICKS_PER_SLOT * OS_CONFIG_CLOCK_RATE) / TM_SYSTEM_CLOCK_TICKS_PER_SECOND)
+
+/**
+ * This definition is the length of a schedule slot in nanoseconds.
+ */
+#define TM_SLOT_NANOSECONDS ((uint64_t)TM_OS_TICKS_PER_SLOT * OS_CONFIG_CLOCK_TICK_NANOSECONDS)
+
+/**
+ * This definition is the maximum length of the schedule's major frame, in
+ * slots. The major frame is the hyperperiod of the registered tasks- the
+ * least common multiple of their periods- after which the schedule repeats.
+ */
+#define TM_MAX_SCHEDULE_SLOTS (TM_SLOTS_PER_FRAME * 10)
+
+/**
+ * This definition is the maximum number of task releases in the schedule's
+ * major frame, summed over all slots.
+ */
+#define TM_MAX_SCHEDULE_ENTRIES 4096
+
+/**
+ * This definition is the number of buckets in a timing histogram.
+ * Bucket 0 counts samples under 1 microsecond, bucket n counts samples from
+ * 2^(n-1) up to 2^n microseconds, and the last bucket also counts
+ * everything longer.
+ */
+#define TM_HISTOGRAM_NUM_BUCKETS 20
+
 /**
  * This definition is the maximum number of tasks that can be registered
  * with the Task Manager module.
@@ -35,14 +78,38 @@
 #define TM_MAX_TASKS 100
 
 /**
- * This definition is the period of the scheduler task
+ * This definition is the number of worker tasks that run callback tasks
+ * for the scheduler.
+ */
+#define TM_NUM_WORKERS 2
+
+/**
+ * This definition is the number of callbacks that can be queued on each
+ * worker. This must be a power of two.
+ */
+#define TM_WORKER_QUEUE_SIZE 32
+
+_Static_assert((TM_WORKER_QUEUE_SIZE & (TM_WORKER_QUEUE_SIZE - 1)) == 0,
+               "The worker queue size must be a power of two");
+
+/**
+ * This definition is the CPU utilization of a task that keeps one CPU busy,
+ * in hundredths of a percent. Utilization and headroom are given in these
+ * units.
+ */
+#define TM_CPU_UTILIZATION_FULL 10000
+
+/**
+ * This definition is the heartbeat period of the scheduler task, which
+ * provides a heartbeat each time it wakes.
  */
-#define TM_SCHEDULER_PERIOD 1
+#define TM_SCHEDULER_HEARTBEAT_PERIOD 1
 
 /**
- * This definition is the priority of the scheduler task
+ * This definition is the number of OS clock ticks tm_shutdown waits for
+ * all tasks to exit when the system shuts down.
  */
-#define TM_SCHEDULER_PERIOD 1
+#define TM_SHUTDOWN_TIMEOUT OS_CONFIG_CLOCK_RATE
 
 /**
  * The name of the Task Manager's schedule task
@@ -80,6 +147,8 @@ typedef enum
 	TM_RESULT_TIMER_ERROR       = 4, /**< Timer error */
 	TM_RESULT_TASK_SPAWN_ERROR  = 5, /**< Task spawn returned an error */
 	TM_RESULT_SEM_CREATE_ERROR  = 6, /**< Semaphore create returned an error */
+	TM_RESULT_SCHEDULE_ERROR    = 7, /**< The registered tasks do not fit in the schedule table */
+	TM_RESULT_SHUTDOWN_TIMEOUT  = 8, /**< One or more tasks did not exit by the shutdown deadline */
 	TM_RESULT_NUM_RESULTS
 } TM_RESULT_ENUM;
 
@@ -89,11 +158,13 @@ typedef enum
  */
 typedef enum
 {
-	TM_TASKTYPE_INVALID  = 0, /*<< Invalid task type */
-	TM_TASKTYPE_PERIODIC = 1, /*<< Periodic task, scheduled at a fixed rate */
-	TM_TASKTYPE_EVENT    = 2, /*<< Aperiodic task, or run on external events */
-	TM_TASKTYPE_CALLBACK = 3, /*<< Periodic task, called as a callback in the scheulder task */
-	TM_TASKTYPE_MONITOR  = 4, /*<< External task, does not participate in heartbeat */
+	TM_TASKTYPE_INVALID   = 0, /*<< Invalid task type */
+	TM_TASKTYPE_PERIODIC  = 1, /*<< Periodic task, scheduled at a fixed rate */
+	TM_TASKTYPE_HIGH_RATE = 2, /*<< Periodic task, released by its own timed waits at a period in nanoseconds */
+	TM_TASKTYPE_EVENT     = 3, /*<< Aperiodic task, or run on external events */
+	TM_TASKTYPE_CALLBACK  = 4, /*<< Periodic task, called as a callback in the scheulder task */
+	TM_TASKTYPE_MONITOR   = 5, /*<< External task, does not participate in heartbeat */
+	TM_TASKTYPE_NUM_TYPES     /*<< Number of task types */
 } TM_TASKTYPE_ENUM;
 
 /**
@@ -108,6 +179,37 @@ typedef enum
 	TM_TASKSTATUS_ERROR            = 4,
 } TM_TASKSTATUS_ENUM;
 
+/**
+ * This struct is a histogram of durations, such as a task's execution time.
+ * Durations are recorded in microseconds.
+ */
+typedef struct
+{
+	uint32_t count;    /*<< The number of samples recorded */
+	uint32_t min_us;   /*<< The shortest sample */
+	uint32_t max_us;   /*<< The longest sample */
+	uint32_t mean_us;  /*<< The mean of all samples */
+	uint64_t total_us; /*<< The sum of all samples */
+	uint32_t buckets[TM_HISTOGRAM_NUM_BUCKETS]; /*<< Sample counts, log2 bucketed (see TM_HISTOGRAM_NUM_BUCKETS) */
+} TM_Histogram;
+
+/**
+ * This struct contains the timing that Task Manager records for a task.
+ *
+ * For a periodic task, the release jitter is the time from when the
+ * scheduler released the task until tm_running returned to it, and the
+ * execution time is the time from then until its next tm_running call.
+ * A high rate task is timed in the same way, from when each release was due.
+ * For an event task, the execution time is the time between tm_running
+ * calls. A callback task is timed by the scheduler around the callback.
+ */
+typedef struct
+{
+	TM_Histogram execution; /*<< The time taken by each run of the task */
+	TM_Histogram jitter;    /*<< The lateness of each release of the task */
+	uint32_t overruns;      /*<< Releases that found the task still running */
+} TM_TaskTiming;
+
 /**
  * This struct contains the information that Task Manager keeps on each
  * task, including its type and status.
@@ -117,40 +219,131 @@ typedef struct
 	TM_TASKTYPE_ENUM type;
 	uint32_t schedule_period;
 	uint32_t heartbeat_period;
-	uint32_t ticks;
+	atomic_uint ticks; /*<< Slots since the last heartbeat, written by the task and the scheduler */
 	OS_TASK_FUNC *function;
 	void *argument;
 	int stack_size;
 	int priority;
+	OS_CpuMask cpus; /*<< The CPUs the task is spawned on, or OS_CPU_MASK_ANY */
 	OS_Sem semaphore;
     OS_Task os_task;
     char name[TM_MAX_TASK_NAME_LENGTH];
+    TM_TaskTiming timing; /*<< Timing of the task's runs */
+    OS_Seqlock timing_lock; /*<< Gives tm_get_task_timing consistent copies of 'timing' */
+    atomic_uint_least64_t release_ns; /*<< When the task was last released, in nanoseconds */
+    uint64_t start_ns; /*<< When the task last returned from tm_running, in nanoseconds */
+    atomic_bool executing; /*<< Whether the task is between tm_running calls */
+    uint64_t cpu_ns; /*<< The task's CPU time at the last CPU sample, in nanoseconds */
+    bool run_inline; /*<< Whether a callback task runs in the scheduler rather than a worker */
+    uint64_t period_ns; /*<< The period of a high rate task, in nanoseconds */
+    uint64_t spin_ns; /*<< How long a high rate task busy-waits for each release, rather than sleeping */
 } TM_Task;
 
+/**
+ * This struct is the schedule table, which lists the tasks released in
+ * each slot of the major frame. It is compiled from the registered periodic
+ * and callback tasks when the schedule is started.
+ *
+ * The ids of the tasks released in slot n are stored in 'task_ids' from
+ * index slot_starts[n] up to slot_starts[n + 1].
+ */
+typedef struct
+{
+	uint32_t num_slots; /*<< The length of the major frame, in slots */
+	uint16_t slot_starts[TM_MAX_SCHEDULE_SLOTS + 1]; /*<< The index of each slot's first entry in 'task_ids' */
+	uint16_t task_ids[TM_MAX_SCHEDULE_ENTRIES]; /*<< The tasks released in each slot, in slot order */
+} TM_Schedule;
+
+_Static_assert(TM_MAX_SCHEDULE_ENTRIES <= UINT16_MAX,
+               "Schedule entries must be indexable by the slot starts");
+_Static_assert(TM_MAX_TASKS <= UINT16_MAX,
+               "Task ids must fit in the schedule table");
+
 /**
  * This struct provides the status of the Task Manager module.
  */
 typedef struct
 {
-	uint32_t cycle;
+	uint32_t cycle; /*<< The number of times the scheduler has woken for a slot */
 	TM_TaskBitField tasks_scheduled;
 	TM_TaskBitField tasks_missed_heartbeat;
+	TM_Histogram release_jitter; /*<< The lateness of each of the scheduler's wakeups */
+	uint16_t slot_overruns[TM_SLOTS_PER_FRAME]; /*<< Slots, by position in the frame, started a full slot late */
+	uint32_t tick_overruns; /*<< Schedule timer expirations missed while an earlier one was handled */
 } TM_Status;
 
+/**
+ * This struct is the queue of callbacks given to a worker. Only the
+ * scheduler adds callbacks, at the bottom, while the worker and any other
+ * worker stealing from it take callbacks from the top. Taking a callback
+ * claims it by advancing the top, so no lock is needed.
+ */
+typedef struct
+{
+	atomic_uint top;    /*<< The index of the next callback to take */
+	atomic_uint bottom; /*<< The index of the next free entry, advanced only by the scheduler */
+	atomic_uint task_ids[TM_WORKER_QUEUE_SIZE];
+} TM_WorkQueue;
+
+/**
+ * This struct is a worker task, which runs the callbacks dispatched to it
+ * by the scheduler, and steals callbacks from other workers when its own
+ * queue is empty.
+ */
+typedef struct
+{
+	TM_WorkQueue queue;
+	OS_Sem wake;      /*<< Given when a callback may be waiting for the worker */
+	OS_Task os_task;
+	atomic_bool busy; /*<< Whether the worker is running callbacks, rather than waiting for one */
+	uint32_t index;   /*<< The worker's index in the pool */
+} TM_Worker;
+
+/**
+ * This struct provides the CPU usage measured by the Task Manager module
+ * over the last frame. Callback tasks run in the scheduler or the workers,
+ * so their CPU time is only counted in the headroom.
+ */
+typedef struct
+{
+	uint32_t headroom; /*<< CPU time left unused by the process, in TM_CPU_UTILIZATION_FULL units summed over all CPUs */
+	uint16_t num_cpus; /*<< The number of CPUs online */
+	uint16_t tasks[TM_MAX_TASKS]; /*<< The utilization of each spawned task, by task id */
+} TM_CpuUsage;
+
 /**
  * This struct is the state of the Task Manager module.
  */
 typedef struct
 {
 	TM_Status status;
+	TM_CpuUsage cpu_usage;
+	OS_Seqlock status_lock; /*<< Gives tm_get_status and tm_get_cpu_usage consistent copies */
+
+	uint64_t cpu_sample_ns; /*<< When the CPU usage was last sampled, in nanoseconds */
+	uint64_t process_cpu_ns; /*<< The process's CPU time at the last sample, in nanoseconds */
 
 	bool continue_running;
 
 	OS_Sem schedule_semaphore;
 	OS_Timer schedule_timer;
+	uint64_t schedule_start_ns; /*<< When the schedule was started, in nanoseconds */
+	uint64_t slot_release_ns; /*<< When the current slot was due to start, in nanoseconds */
+	uint64_t slot_number; /*<< The number of the current slot, counted from 0 at the start of the schedule */
+	uint64_t wake_release_ns; /*<< When the slot the scheduler is next woken for is due, in nanoseconds */
+	TM_Schedule schedule; /*<< The tasks released in each slot */
 
 	uint16_t num_tasks;
 	TM_Task tasks[TM_MAX_TASKS];
+
+	// the registered tasks are indexed so that only they are visited
+	// each slot, rather than every entry in 'tasks'.
+	TM_TaskId active_tasks[TM_MAX_TASKS]; /*<< The ids of registered tasks, grouped by type in id order */
+	uint16_t type_starts[TM_TASKTYPE_NUM_TYPES + 1]; /*<< The index of each type's first task in 'active_tasks' */
+
+	TM_Worker workers[TM_NUM_WORKERS];
+	uint32_t num_workers; /*<< The number of workers spawned, or 0 to run every callback inline */
+	uint32_t next_worker; /*<< The worker given the next callback */
 } TM_State;
 
 #endif // ndef __TM_DEFINITIONS_H__ */
@@ -4,32 +4,540 @@
  * @author Noah Ryan
  *
  * This file contains the implementation of Event Message module functions.
+ *
+ * Events are not published by the task raising them. Each task queues its
+ * events on its own single producer ring, and the EM task drains the rings
+ * in batches and publishes the events on the Message Bus. Raising an event
+ * is a copy into the ring, and never blocks the caller on the Message Bus.
+ *
+ * Events may also be given a filter limiting their rate. A suppressed event
+ * is rejected before it is queued, and the EM task later reports how many
+ * events each filter suppressed in a single event.
+ *
+ * Every published event is also written to the event log, a circular log
+ * file mapped into memory. Writing an event is a copy into the mapping,
+ * and the log is kept across restarts. The entry with a given sequence is
+ * always in the same slot, so the last events, or the events since a
+ * sequence, are read back without searching the log.
  */
 #include "stddef.h"
 #include "stdint.h"
+#include "stdbool.h"
+#include "stdatomic.h"
 #include "string.h"
 
+#include "os_counter.h"
+#include "os_map.h"
+#include "os_queue.h"
+#include "os_task.h"
+#include "os_time.h"
+
 #include "fsw_definitions.h"
+#include "fsw_tasks.h"
 
 #include "msg.h"
 #include "mb.h"
+#include "tm.h"
 
 #include "em_definitions.h"
 #include "em.h"
 
 
+/**
+ * This definition is the ring index of a task that could not claim a ring.
+ */
+#define EM_RING_NONE UINT32_MAX
+
+
 EM_State gvEM_state = {0};
 
+/**
+ * The ring claimed by the current task, plus one, so that 0 means the
+ * task has not claimed a ring yet.
+ */
+static _Thread_local uint32_t tvEM_ring_index = 0;
+
+
+/**
+ * @brief em_create_rings
+ *
+ * This function creates the event rings, and zeros the module state.
+ *
+ * @return An FSW result type either indicating success (FSW_RESULT_OKAY)
+ * or FSW_RESULT_OS_QUEUE_CREATE_ERROR.
+ */
+FSW_RESULT_ENUM em_create_rings(void);
+
+/**
+ * @brief em_discard_rings
+ *
+ * This function discards any events left in the event rings. It is used
+ * when the module is reinitialized, and must not be called while tasks
+ * are raising events.
+ */
+void em_discard_rings(void);
+
+/**
+ * @brief em_task_ring
+ *
+ * This function provides the calling task's event ring, claiming the first
+ * unclaimed ring the first time it is called by a task. The ring is
+ * released when the task exits, so tasks spawned again on a restart claim
+ * rings of their own.
+ *
+ * @return The task's ring, or NULL if the rings have not been created
+ * or every ring has been claimed.
+ */
+OS_Queue *em_task_ring(void);
+
+/**
+ * @brief em_release_ring
+ *
+ * This function releases the calling task's event ring. It is called by
+ * the task when it exits, and any events left in the ring are still
+ * published when the rings are drained.
+ *
+ * @param[in] argument - the claimed flag of the task's ring.
+ */
+void em_release_ring(void *argument);
+
+/**
+ * @brief em_reset_filters
+ *
+ * This function removes every event filter.
+ */
+void em_reset_filters(void);
+
+/**
+ * @brief em_filter_take
+ *
+ * This function takes an event from a filter's bucket, if the bucket
+ * is not empty.
+ *
+ * @param[in] filter - the filter to take an event from.
+ * @param[in] now_ns - the current timestamp in nanoseconds.
+ *
+ * @return true if an event was taken, or false if the bucket is empty.
+ */
+bool em_filter_take(EM_Filter *filter, uint64_t now_ns);
+
+/**
+ * @brief em_filter_admit
+ *
+ * This function checks whether an event may be raised. Events without a
+ * filter are always admitted, and only cost a check of their module's
+ * filter mask. Events rejected by their filter are counted by the filter
+ * so they can be reported later.
+ *
+ * @param[in] module_id - the module raising the event.
+ * @param[in] event_id - the module's event id.
+ *
+ * @return true if the event may be raised, or false if it is suppressed.
+ */
+bool em_filter_admit(FSW_MODULEID_ENUM module_id, uint16_t event_id);
+
+/**
+ * @brief em_filter_report
+ *
+ * This function publishes an EM_EVENT_ID_EVENTS_SUPPRESSED event for each
+ * filter with suppressed events, once the filter's bucket allows it.
+ *
+ * @return The number of events published.
+ */
+uint32_t em_filter_report(void);
+
+/**
+ * @brief em_publish
+ *
+ * This function stamps an event record with the next sequence number and
+ * sends it on the Message Bus as an EM_Event.
+ *
+ * @param[in] record - the event to publish.
+ */
+void em_publish(EM_Record *record);
+
+/**
+ * @brief em_log_open
+ *
+ * This function maps the event log file. A file that does not hold a log
+ * with the current layout is cleared, and a valid log is kept so that its
+ * entries, and its sequence, continue from before the restart.
+ *
+ * @return An FSW result type either indicating success (FSW_RESULT_OKAY)
+ * or FSW_RESULT_OS_MAP_ERROR.
+ */
+FSW_RESULT_ENUM em_log_open(void);
+
+/**
+ * @brief em_log_write
+ *
+ * This function writes a published event to the next slot of the event
+ * log. It does nothing if the log is not mapped.
+ *
+ * @param[in] event - the event to log.
+ */
+void em_log_write(EM_Event *event);
+
+/**
+ * @brief em_log_read
+ *
+ * This function copies the log entries starting at a given sequence, up
+ * to the next entry to be written. Entries that are overwritten or being
+ * written during the copy are skipped.
+ *
+ * @param[in] sequence - the sequence of the first entry to copy.
+ * @param[out] entries - the entries copied.
+ * @param[in] max_entries - the number of entries that fit in 'entries'.
+ * @param[out] num_entries - the number of entries copied.
+ */
+void em_log_read(uint64_t sequence,
+                 EM_LogEntry *entries,
+                 uint32_t max_entries,
+                 uint32_t *num_entries);
+
 
 FSW_RESULT_ENUM em_initialize(void)
 {
     FSW_RESULT_ENUM result = FSW_RESULT_OKAY;
 
+    // the rings are kept when the module is reinitialized, as the tasks
+    // that claimed them still refer to them.
+    if (!gvEM_state.rings_created)
+    {
+        result = em_create_rings();
+    }
+    else
+    {
+        em_discard_rings();
+    }
+
+    os_counters_init(&gvEM_state.counters);
+    atomic_store(&gvEM_state.sequence, 0);
+    em_reset_filters();
+
+    if (result == FSW_RESULT_OKAY)
+    {
+        TM_RESULT_ENUM tm_result =
+            tm_periodic_task(FSW_TASK_NAME_EM,
+                             FSW_TASK_ID_EM,
+                             em_task,
+                             FSW_TASK_NO_ARGUMENT,
+                             FSW_TASK_RATE_100_HZ,
+                             FSW_HEARBEAT_RATE_1_HZ,
+                             FSW_DEFAULT_STACK_SIZE,
+                             FSW_PRIORITY_EM_TASK);
+
+        if (tm_result == TM_RESULT_OKAY)
+        {
+            tm_result = tm_task_affinity(FSW_TASK_ID_EM, FSW_CPUS_EM_TASK);
+        }
+
+        if (tm_result != TM_RESULT_OKAY)
+        {
+            result = FSW_RESULT_TASK_REGISTRATION_ERROR;
+        }
+    }
+
+    // the log, like the rings, is kept when the module is reinitialized.
+    // Events are still published if the log can not be mapped.
+    if (gvEM_state.rings_created && (gvEM_state.log == NULL))
+    {
+        FSW_RESULT_ENUM log_result = em_log_open();
+
+        if (result == FSW_RESULT_OKAY)
+        {
+            result = log_result;
+        }
+    }
+
+    return result;
+}
+
+FSW_RESULT_ENUM em_create_rings(void)
+{
+    FSW_RESULT_ENUM result = FSW_RESULT_OKAY;
+
+    // the rings are only created once, before the log is mapped
     memset(&gvEM_state, 0, sizeof(gvEM_state));
 
+    for (uint32_t ring_index = 0; (ring_index < EM_NUM_RINGS) && (result == FSW_RESULT_OKAY); ring_index++)
+    {
+        // each ring has a single task sending, and only the EM task receiving
+        OS_RESULT_ENUM os_result =
+            os_queue_create_type(&gvEM_state.rings[ring_index],
+                                 EM_RING_DEPTH,
+                                 sizeof(EM_Record),
+                                 OS_QUEUE_TYPE_SPSC);
+
+        if (os_result != OS_RESULT_OKAY)
+        {
+            result = FSW_RESULT_OS_QUEUE_CREATE_ERROR;
+        }
+    }
+
+    if (result == FSW_RESULT_OKAY)
+    {
+        gvEM_state.rings_created = true;
+    }
+
+    return result;
+}
+
+void em_discard_rings(void)
+{
+    EM_Record record;
+    uint32_t record_size = sizeof(record);
+
+    for (uint32_t ring_index = 0; ring_index < EM_NUM_RINGS; ring_index++)
+    {
+        while (os_queue_receive(&gvEM_state.rings[ring_index],
+                                (uint8_t*)&record,
+                                &record_size,
+                                OS_TIMEOUT_NO_WAIT) == OS_RESULT_OKAY)
+        {
+            record_size = sizeof(record);
+        }
+    }
+}
+
+OS_Queue *em_task_ring(void)
+{
+    OS_Queue *ring = NULL;
+
+    // rings are only claimed once they exist, as creating them resets the
+    // claimed rings.
+    if (!gvEM_state.rings_created)
+    {
+        // no ring is returned
+    }
+    else if (tvEM_ring_index == 0)
+    {
+        tvEM_ring_index = EM_RING_NONE;
+
+        for (uint32_t ring_index = 0; (ring_index < EM_NUM_RINGS) && (tvEM_ring_index == EM_RING_NONE); ring_index++)
+        {
+            bool claimed = false;
+
+            if (atomic_compare_exchange_strong(&gvEM_state.ring_claimed[ring_index], &claimed, true))
+            {
+                tvEM_ring_index = ring_index + 1;
+
+                // the ring is drained from now on, before the task sends to it
+                uint32_t num_rings = atomic_load(&gvEM_state.num_rings);
+                while ((num_rings < tvEM_ring_index) &&
+                       !atomic_compare_exchange_weak(&gvEM_state.num_rings, &num_rings, tvEM_ring_index))
+                {
+                }
+
+                // a thread that was not spawned as a task can not register
+                // the hook, and keeps its ring for as long as it runs.
+                (void)os_task_on_exit(em_release_ring, &gvEM_state.ring_claimed[ring_index]);
+            }
+        }
+    }
+
+    if ((tvEM_ring_index != 0) && (tvEM_ring_index != EM_RING_NONE))
+    {
+        ring = &gvEM_state.rings[tvEM_ring_index - 1];
+    }
+
+    return ring;
+}
+
+void em_release_ring(void *argument)
+{
+    tvEM_ring_index = 0;
+
+    // the task has sent its last event, so the ring's next task is again
+    // its only producer.
+    atomic_store((atomic_bool*)argument, false);
+}
+
+void em_reset_filters(void)
+{
+    atomic_store(&gvEM_state.num_filters, 0);
+
+    for (uint32_t module_index = 0; module_index < FSW_MODULEID_NUM_IDS; module_index++)
+    {
+        atomic_store(&gvEM_state.filter_masks[module_index], 0);
+    }
+}
+
+EM_RESULT_ENUM em_filter_event(FSW_MODULEID_ENUM module_id,
+                               uint16_t event_id,
+                               uint32_t burst,
+                               OS_Timeout period)
+{
+    EM_RESULT_ENUM result = EM_RESULT_OKAY;
+
+    EM_Filter *filter = NULL;
+
+    if ((module_id == FSW_MODULEID_INVALID) || (module_id >= FSW_MODULEID_NUM_IDS) ||
+        (burst == 0) || (period == 0))
+    {
+        result = EM_RESULT_INVALID_ARGUMENTS;
+    }
+
+    if (result == EM_RESULT_OKAY)
+    {
+        uint32_t num_filters = atomic_load(&gvEM_state.num_filters);
+
+        for (uint32_t filter_index = 0; (filter_index < num_filters) && (filter == NULL); filter_index++)
+        {
+            if ((gvEM_state.filters[filter_index].module == module_id) &&
+                (gvEM_state.filters[filter_index].event_id == event_id))
+            {
+                filter = &gvEM_state.filters[filter_index];
+            }
+        }
+
+        if (filter == NULL)
+        {
+            if (num_filters < EM_MAX_FILTERS)
+            {
+                filter = &gvEM_state.filters[num_filters];
+                filter->module = module_id;
+                filter->event_id = event_id;
+                atomic_store(&filter->suppressed, 0);
+                atomic_store(&filter->suppressed_since_ns, 0);
+            }
+            else
+            {
+                result = EM_RESULT_FILTERS_FULL;
+            }
+        }
+    }
+
+    if (result == EM_RESULT_OKAY)
+    {
+        filter->period_ns = (uint64_t)period * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+        filter->burst_ns = filter->period_ns * burst;
+
+        // the bucket starts full
+        atomic_store(&filter->full_ns, 0);
+
+        // the filter is complete before it can be found by em_filter_admit
+        uint32_t filter_index = (uint32_t)(filter - gvEM_state.filters);
+        if (filter_index == atomic_load(&gvEM_state.num_filters))
+        {
+            atomic_store(&gvEM_state.num_filters, filter_index + 1);
+        }
+
+        atomic_fetch_or(&gvEM_state.filter_masks[module_id],
+                        1ULL << (event_id % EM_FILTER_MASK_BITS));
+    }
+
     return result;
 }
 
+bool em_filter_take(EM_Filter *filter, uint64_t now_ns)
+{
+    bool taken = false;
+    bool empty = false;
+
+    uint64_t full_ns = atomic_load(&filter->full_ns);
+
+    while (!taken && !empty)
+    {
+        // a bucket that was full before now is only full from now on
+        uint64_t start_ns = full_ns;
+        if (start_ns < now_ns)
+        {
+            start_ns = now_ns;
+        }
+
+        uint64_t next_full_ns = start_ns + filter->period_ns;
+
+        if ((next_full_ns - now_ns) > filter->burst_ns)
+        {
+            empty = true;
+        }
+        else
+        {
+            // on failure, full_ns is reloaded and the event is taken again
+            taken = atomic_compare_exchange_weak(&filter->full_ns, &full_ns, next_full_ns);
+        }
+    }
+
+    return taken;
+}
+
+bool em_filter_admit(FSW_MODULEID_ENUM module_id, uint16_t event_id)
+{
+    bool admitted = true;
+
+    uint64_t mask = atomic_load_explicit(&gvEM_state.filter_masks[module_id], memory_order_relaxed);
+
+    if ((mask & (1ULL << (event_id % EM_FILTER_MASK_BITS))) != 0)
+    {
+        EM_Filter *filter = NULL;
+
+        uint32_t num_filters = atomic_load(&gvEM_state.num_filters);
+
+        for (uint32_t filter_index = 0; (filter_index < num_filters) && (filter == NULL); filter_index++)
+        {
+            if ((gvEM_state.filters[filter_index].module == module_id) &&
+                (gvEM_state.filters[filter_index].event_id == event_id))
+            {
+                filter = &gvEM_state.filters[filter_index];
+            }
+        }
+
+        if (filter != NULL)
+        {
+            uint64_t now_ns = os_timestamp_nanoseconds();
+
+            admitted = em_filter_take(filter, now_ns);
+
+            if (!admitted)
+            {
+                // the first event suppressed since the last report marks
+                // the start of the suppressed events
+                if (atomic_fetch_add(&filter->suppressed, 1) == 0)
+                {
+                    atomic_store(&filter->suppressed_since_ns, now_ns);
+                }
+            }
+        }
+    }
+
+    return admitted;
+}
+
+uint32_t em_filter_report(void)
+{
+    uint32_t num_published = 0;
+
+    uint32_t num_filters = atomic_load(&gvEM_state.num_filters);
+
+    for (uint32_t filter_index = 0; filter_index < num_filters; filter_index++)
+    {
+        EM_Filter *filter = &gvEM_state.filters[filter_index];
+
+        if ((atomic_load_explicit(&filter->suppressed, memory_order_relaxed) > 0) &&
+            em_filter_take(filter, os_timestamp_nanoseconds()))
+        {
+            uint64_t since_ns = atomic_load(&filter->suppressed_since_ns);
+            uint32_t suppressed = atomic_exchange(&filter->suppressed, 0);
+
+            EM_Record record;
+            record.module = FSW_MODULEID_EM;
+            record.event_id = EM_EVENT_ID_EVENTS_SUPPRESSED;
+            record.line_number = __LINE__;
+            record.params[0] = filter->module;
+            record.params[1] = filter->event_id;
+            record.params[2] = suppressed;
+            record.params[3] = (uint32_t)(since_ns / OS_NANOSECONDS_PER_SECOND);
+            record.params[4] = (uint32_t)(since_ns % OS_NANOSECONDS_PER_SECOND);
+
+            em_publish(&record);
+            num_published++;
+        }
+    }
+
+    return num_published;
+}
+
 void em_event(FSW_MODULEID_ENUM module_id,
               uint16_t event_id,
               uint32_t line_number,
@@ -39,36 +547,320 @@ void em_event(FSW_MODULEID_ENUM module_id,
               uint32_t param3,
               uint32_t param4)
 {
-    if ((module_id != FSW_MODULEID_INVALID) && (module_id < FSW_MODULEID_NUM_IDS))
+    if ((module_id == FSW_MODULEID_INVALID) || (module_id >= FSW_MODULEID_NUM_IDS))
     {
-        EM_Event event;
+        os_counters_add(&gvEM_state.counters, EM_COUNTER_INVALID_MSG_RECEIVED, 1);
+    }
+    else if (!em_filter_admit(module_id, event_id))
+    {
+        // suppressed events are counted by their filter, and never queued
+        os_counters_add(&gvEM_state.counters, EM_COUNTER_EVENTS_FILTERED, 1);
+    }
+    else
+    {
+        EM_Record record;
+
+        record.module = module_id;
+        record.event_id = event_id;
+        record.line_number = line_number;
+        record.params[0] = param0;
+        record.params[1] = param1;
+        record.params[2] = param2;
+        record.params[3] = param3;
+        record.params[4] = param4;
+
+        OS_Queue *ring = em_task_ring();
+        if (ring != NULL)
+        {
+            OS_RESULT_ENUM os_result =
+                os_queue_send(ring, (uint8_t*)&record, sizeof(record), OS_TIMEOUT_NO_WAIT);
 
-        msg_telemetry_message(&event.header, MSG_PACKETID_EVENT, sizeof(EM_Event));
+            if (os_result != OS_RESULT_OKAY)
+            {
+                os_counters_add(&gvEM_state.counters, EM_COUNTER_EVENTS_DROPPED, 1);
+            }
+        }
+        else
+        {
+            // tasks without a ring publish their own events
+            em_publish(&record);
+        }
+    }
+}
 
-        event.module = module_id;
-        event.event_id = event_id;
-        event.line_number = line_number;
-        event.params[0] = param0;
-        event.params[1] = param1;
-        event.params[2] = param2;
-        event.params[3] = param3;
-        event.params[4] = param4;
+void em_publish(EM_Record *record)
+{
+    EM_Event event;
+
+    // the message length is the size of the data after the header
+    msg_telemetry_message(&event.header,
+                          MSG_PACKETID_EVENT,
+                          sizeof(EM_Event) - sizeof(MSG_Header));
+
+    event.module = record->module;
+    event.event_id = record->event_id;
+    event.line_number = record->line_number;
+    event.params[0] = record->params[0];
+    event.params[1] = record->params[1];
+    event.params[2] = record->params[2];
+    event.params[3] = record->params[3];
+    event.params[4] = record->params[4];
 
-        MB_RESULT_ENUM mb_result;
-        mb_result = mb_send((MSG_Header*)&event, OS_TIMEOUT_NO_WAIT);
+    // every event is given a sequence number, even if it is not sent,
+    // so gaps in the sequence show where events were lost.
+    event.sequence = atomic_fetch_add_explicit(&gvEM_state.sequence, 1, memory_order_relaxed);
 
-        if (mb_result == MB_RESULT_OKAY)
+    MB_RESULT_ENUM mb_result;
+    // events are sent ahead of telemetry so that they are not
+    // delayed by a telemetry backlog.
+    mb_result = mb_send_priority((MSG_Header*)&event, MB_PRIORITY_HIGH, OS_TIMEOUT_NO_WAIT);
+
+    if (mb_result == MB_RESULT_OKAY)
+    {
+        os_counters_add(&gvEM_state.counters, EM_COUNTER_MESSAGES_RECEIVED, 1);
+    }
+    else
+    {
+        os_counters_add(&gvEM_state.counters, EM_COUNTER_MESSAGE_ERRORS, 1);
+    }
+
+    // events are logged whether or not they were sent, so an event with
+    // no subscriber is not lost.
+    em_log_write(&event);
+}
+
+FSW_RESULT_ENUM em_log_open(void)
+{
+    FSW_RESULT_ENUM result = FSW_RESULT_OKAY;
+
+    OS_RESULT_ENUM os_result =
+        os_map_file(&gvEM_state.log_file, EM_LOG_PATH, sizeof(EM_LogFile));
+
+    if (os_result != OS_RESULT_OKAY)
+    {
+        result = FSW_RESULT_OS_MAP_ERROR;
+    }
+
+    if (result == FSW_RESULT_OKAY)
+    {
+        EM_LogFile *log = (EM_LogFile*)gvEM_state.log_file.data;
+
+        if ((log->header.magic != EM_LOG_MAGIC) ||
+            (log->header.version != EM_LOG_VERSION) ||
+            (log->header.num_entries != EM_LOG_NUM_ENTRIES) ||
+            (log->header.slot_size != sizeof(EM_LogSlot)))
         {
-            gvEM_state.status.messages_received++;
+            // the magic is cleared first, so a log that is only partly
+            // cleared when the process exits is cleared again on restart.
+            log->header.magic = 0;
+
+            for (uint32_t slot_index = 0; slot_index < EM_LOG_NUM_ENTRIES; slot_index++)
+            {
+                atomic_store(&log->slots[slot_index].sequence, EM_LOG_SEQUENCE_NONE);
+            }
+
+            atomic_store(&log->header.next_sequence, 0);
+            log->header.version = EM_LOG_VERSION;
+            log->header.num_entries = EM_LOG_NUM_ENTRIES;
+            log->header.slot_size = sizeof(EM_LogSlot);
+
+            atomic_thread_fence(memory_order_release);
+            log->header.magic = EM_LOG_MAGIC;
+        }
+
+        gvEM_state.log = log;
+    }
+
+    return result;
+}
+
+void em_log_write(EM_Event *event)
+{
+    EM_LogFile *log = gvEM_state.log;
+
+    if (log != NULL)
+    {
+        uint64_t sequence =
+            atomic_fetch_add_explicit(&log->header.next_sequence, 1, memory_order_relaxed);
+
+        EM_LogSlot *slot = &log->slots[sequence % EM_LOG_NUM_ENTRIES];
+
+        // the slot is marked as being written before it is changed, so a
+        // reader copying the slot sees that its copy is not whole.
+        atomic_store_explicit(&slot->sequence, EM_LOG_SEQUENCE_NONE, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+
+        slot->timestamp_ns = os_timestamp_nanoseconds();
+        slot->event = *event;
+
+        atomic_store_explicit(&slot->sequence, sequence, memory_order_release);
+
+        os_counters_add(&gvEM_state.counters, EM_COUNTER_EVENTS_LOGGED, 1);
+    }
+}
+
+void em_log_read(uint64_t sequence,
+                 EM_LogEntry *entries,
+                 uint32_t max_entries,
+                 uint32_t *num_entries)
+{
+    EM_LogFile *log = gvEM_state.log;
+
+    uint64_t next_sequence = atomic_load(&log->header.next_sequence);
+
+    // entries older than a full log have been overwritten
+    if ((next_sequence > EM_LOG_NUM_ENTRIES) &&
+        (sequence < (next_sequence - EM_LOG_NUM_ENTRIES)))
+    {
+        sequence = next_sequence - EM_LOG_NUM_ENTRIES;
+    }
+
+    *num_entries = 0;
+
+    for (; (sequence < next_sequence) && (*num_entries < max_entries); sequence++)
+    {
+        EM_LogSlot *slot = &log->slots[sequence % EM_LOG_NUM_ENTRIES];
+        EM_LogEntry *entry = &entries[*num_entries];
+
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) == sequence)
+        {
+            entry->sequence = sequence;
+            entry->timestamp_ns = slot->timestamp_ns;
+            entry->event = slot->event;
+
+            // the copy is only kept if the slot was not rewritten during it
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence)
+            {
+                *num_entries += 1;
+            }
+        }
+    }
+}
+
+uint64_t em_log_next_sequence(void)
+{
+    uint64_t next_sequence = 0;
+
+    if (gvEM_state.log != NULL)
+    {
+        next_sequence = atomic_load(&gvEM_state.log->header.next_sequence);
+    }
+
+    return next_sequence;
+}
+
+EM_RESULT_ENUM em_log_tail(EM_LogEntry *entries,
+                           uint32_t max_entries,
+                           uint32_t *num_entries)
+{
+    EM_RESULT_ENUM result = EM_RESULT_OKAY;
+
+    if ((entries == NULL) || (num_entries == NULL))
+    {
+        result = EM_RESULT_INVALID_ARGUMENTS;
+    }
+    else if (gvEM_state.log == NULL)
+    {
+        result = EM_RESULT_LOG_UNAVAILABLE;
+    }
+
+    if (result == EM_RESULT_OKAY)
+    {
+        uint64_t sequence = em_log_next_sequence();
+
+        if (sequence > max_entries)
+        {
+            sequence -= max_entries;
         }
         else
         {
-            gvEM_state.status.message_errors++;
+            sequence = 0;
         }
+
+        em_log_read(sequence, entries, max_entries, num_entries);
     }
-    else
+
+    return result;
+}
+
+EM_RESULT_ENUM em_log_since(uint64_t sequence,
+                            EM_LogEntry *entries,
+                            uint32_t max_entries,
+                            uint32_t *num_entries)
+{
+    EM_RESULT_ENUM result = EM_RESULT_OKAY;
+
+    if ((entries == NULL) || (num_entries == NULL))
+    {
+        result = EM_RESULT_INVALID_ARGUMENTS;
+    }
+    else if (gvEM_state.log == NULL)
+    {
+        result = EM_RESULT_LOG_UNAVAILABLE;
+    }
+
+    if (result == EM_RESULT_OKAY)
+    {
+        em_log_read(sequence, entries, max_entries, num_entries);
+    }
+
+    return result;
+}
+
+uint32_t em_drain(void)
+{
+    uint32_t num_published = 0;
+
+    EM_Record records[EM_DRAIN_BATCH_SIZE];
+    uint32_t record_sizes[EM_DRAIN_BATCH_SIZE];
+
+    uint32_t num_rings = atomic_load(&gvEM_state.num_rings);
+
+    for (uint32_t ring_index = 0; ring_index < num_rings; ring_index++)
+    {
+        // at most a ring's depth of events is received from each ring per
+        // call, so a task raising events continuously does not hold the
+        // EM task on its ring.
+        uint32_t num_batches = 0;
+        uint32_t num_received = EM_DRAIN_BATCH_SIZE;
+
+        while ((num_received == EM_DRAIN_BATCH_SIZE) &&
+               (num_batches < (EM_RING_DEPTH / EM_DRAIN_BATCH_SIZE)))
+        {
+            num_received = 0;
+
+            // an empty ring times out immediately, with nothing received
+            (void)os_queue_receive_batch(&gvEM_state.rings[ring_index],
+                                         (uint8_t*)records,
+                                         sizeof(EM_Record),
+                                         record_sizes,
+                                         EM_DRAIN_BATCH_SIZE,
+                                         &num_received,
+                                         OS_TIMEOUT_NO_WAIT);
+
+            for (uint32_t record_index = 0; record_index < num_received; record_index++)
+            {
+                em_publish(&records[record_index]);
+            }
+
+            num_published += num_received;
+            num_batches++;
+        }
+    }
+
+    num_published += em_filter_report();
+
+    return num_published;
+}
+
+void em_task(void *argument)
+{
+    (void)argument;
+
+    while (tm_running(FSW_TASK_ID_EM))
     {
-        gvEM_state.status.invalid_msg_received++;
+        (void)em_drain();
     }
 }
 
@@ -76,6 +868,12 @@ void em_get_status(EM_Status *status)
 {
     if (status != NULL)
     {
-        *status = gvEM_state.status;
+        status->messages_received = os_counters_sum(&gvEM_state.counters, EM_COUNTER_MESSAGES_RECEIVED);
+        status->messages_sent = os_counters_sum(&gvEM_state.counters, EM_COUNTER_MESSAGES_SENT);
+        status->message_errors = os_counters_sum(&gvEM_state.counters, EM_COUNTER_MESSAGE_ERRORS);
+        status->invalid_msg_received = os_counters_sum(&gvEM_state.counters, EM_COUNTER_INVALID_MSG_RECEIVED);
+        status->events_dropped = os_counters_sum(&gvEM_state.counters, EM_COUNTER_EVENTS_DROPPED);
+        status->events_filtered = os_counters_sum(&gvEM_state.counters, EM_COUNTER_EVENTS_FILTERED);
+        status->events_logged = os_counters_sum(&gvEM_state.counters, EM_COUNTER_EVENTS_LOGGED);
     }
 }
@@ -14,6 +14,9 @@
 #include "unity.h"
 #include "unity_fixture.h"
 
+#include "os_sem.h"
+#include "os_task.h"
+
 #include "fsw_definitions.h"
 #include "mb_definitions.h"
 #include "mb.h"
@@ -24,16 +27,35 @@
 
 #define FSW_EM_TEST_EVENT_ID 1
 #define FSW_EM_TEST_LINE_ID 2
+#define FSW_EM_TEST_NUM_TASKS (2 * EM_NUM_RINGS)
+#define FSW_EM_TEST_FILTER_BURST 2
+#define FSW_EM_TEST_FILTER_PERIOD 20
+#define FSW_EM_TEST_NUM_FILTERED 5
+#define FSW_EM_TEST_NUM_LOGGED 3
+
+
+void em_test_exit_hook(void *argument)
+{
+    (void)os_sem_give((OS_Sem*)argument);
+}
 
+void em_test_event_task(void *argument)
+{
+    // this hook is registered before the task claims its ring, so it runs
+    // after the ring is released.
+    (void)os_task_on_exit(em_test_exit_hook, argument);
 
-// We need access to the EM state to assert on its fields. 
-extern EM_State gvEM_state;
+    em_event(FSW_MODULEID_EM,
+             FSW_EM_TEST_EVENT_ID,
+             FSW_EM_TEST_LINE_ID,
+             1, 2, 3, 4, 5);
+}
 
 TEST_GROUP(FSW_EM);
 
 TEST_SETUP(FSW_EM)
 {
-    // this call never fails.
+    // the result is not checked, as the EM task is not run by these tests
     (void)em_initialize();
 }
 
@@ -43,33 +65,42 @@ TEST_TEAR_DOWN(FSW_EM)
 
 TEST(FSW_EM, invalid_module)
 {
+    EM_Status status;
+
     em_event(FSW_MODULEID_INVALID,
              FSW_EM_TEST_EVENT_ID,
              FSW_EM_TEST_LINE_ID,
              1, 2, 3, 4, 5);
-    TEST_ASSERT_EQUAL(0, gvEM_state.status.messages_received);
-    TEST_ASSERT_EQUAL(1, gvEM_state.status.invalid_msg_received);
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.messages_received);
+    TEST_ASSERT_EQUAL(1, status.invalid_msg_received);
 
     em_event(FSW_MODULEID_NUM_IDS,
              FSW_EM_TEST_EVENT_ID,
              FSW_EM_TEST_LINE_ID,
              1, 2, 3, 4, 5);
-    TEST_ASSERT_EQUAL(0, gvEM_state.status.messages_received);
-    TEST_ASSERT_EQUAL(2, gvEM_state.status.invalid_msg_received);
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.messages_received);
+    TEST_ASSERT_EQUAL(2, status.invalid_msg_received);
 }
 
 TEST(FSW_EM, msg_error)
 {
+    EM_Status status;
+
     em_event(FSW_MODULEID_EM,
              FSW_EM_TEST_EVENT_ID,
              FSW_EM_TEST_LINE_ID,
              1, 2, 3, 4, 5);
-    TEST_ASSERT_EQUAL(0, gvEM_state.status.messages_received);
-    TEST_ASSERT_EQUAL(1, gvEM_state.status.message_errors);
+    TEST_ASSERT_EQUAL(1, em_drain());
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.messages_received);
+    TEST_ASSERT_EQUAL(1, status.message_errors);
 }
 
 TEST(FSW_EM, msg_valid)
 {
+    EM_Status status;
     MB_RESULT_ENUM mb_result;
     MB_Pipe pipe;
     mb_result = mb_create_pipe(&pipe, 1, sizeof(EM_Event));
@@ -82,8 +113,190 @@ TEST(FSW_EM, msg_valid)
              FSW_EM_TEST_EVENT_ID,
              FSW_EM_TEST_LINE_ID,
              1, 2, 3, 4, 5);
-    TEST_ASSERT_EQUAL(0, gvEM_state.status.message_errors);
-    TEST_ASSERT_EQUAL(1, gvEM_state.status.messages_received);
+
+    // the event is not published until the rings are drained
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.messages_received);
+
+    TEST_ASSERT_EQUAL(1, em_drain());
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.message_errors);
+    TEST_ASSERT_EQUAL(1, status.messages_received);
+
+    EM_Event event;
+    uint32_t event_size = sizeof(event);
+    mb_result = mb_receive(pipe, &event.header, &event_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+    TEST_ASSERT_EQUAL(FSW_MODULEID_EM, event.module);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_EVENT_ID, event.event_id);
+    TEST_ASSERT_EQUAL(0, event.sequence);
+    TEST_ASSERT_EQUAL(5, event.params[4]);
+}
+
+TEST(FSW_EM, ring_full)
+{
+    EM_Status status;
+
+    for (int event_index = 0; event_index < EM_RING_DEPTH + 1; event_index++)
+    {
+        em_event(FSW_MODULEID_EM,
+                 FSW_EM_TEST_EVENT_ID,
+                 FSW_EM_TEST_LINE_ID,
+                 event_index, 0, 0, 0, 0);
+    }
+
+    // the event raised on a full ring is dropped, without blocking
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(1, status.events_dropped);
+
+    // every queued event is published, and the rings are left empty
+    TEST_ASSERT_EQUAL(EM_RING_DEPTH, em_drain());
+    TEST_ASSERT_EQUAL(0, em_drain());
+
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(EM_RING_DEPTH, status.messages_received + status.message_errors);
+}
+
+TEST(FSW_EM, filter)
+{
+    EM_Status status;
+    EM_RESULT_ENUM em_result;
+    MB_RESULT_ENUM mb_result;
+    MB_Pipe pipe;
+    mb_result = mb_create_pipe(&pipe, FSW_EM_TEST_NUM_FILTERED, sizeof(EM_Event));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    mb_result = mb_register_packet(pipe, MSG_PACKETID_EVENT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    em_result = em_filter_event(FSW_MODULEID_INVALID, FSW_EM_TEST_EVENT_ID, 1, 1);
+    TEST_ASSERT_EQUAL(EM_RESULT_INVALID_ARGUMENTS, em_result);
+
+    em_result = em_filter_event(FSW_MODULEID_EM, FSW_EM_TEST_EVENT_ID, 0, 1);
+    TEST_ASSERT_EQUAL(EM_RESULT_INVALID_ARGUMENTS, em_result);
+
+    em_result = em_filter_event(FSW_MODULEID_EM,
+                                FSW_EM_TEST_EVENT_ID,
+                                FSW_EM_TEST_FILTER_BURST,
+                                FSW_EM_TEST_FILTER_PERIOD);
+    TEST_ASSERT_EQUAL(EM_RESULT_OKAY, em_result);
+
+    for (int event_index = 0; event_index < FSW_EM_TEST_NUM_FILTERED; event_index++)
+    {
+        em_event(FSW_MODULEID_EM,
+                 FSW_EM_TEST_EVENT_ID,
+                 FSW_EM_TEST_LINE_ID,
+                 event_index, 0, 0, 0, 0);
+    }
+
+    // an event without a filter is not limited by other events' filters
+    em_event(FSW_MODULEID_EM,
+             FSW_EM_TEST_EVENT_ID + 1,
+             FSW_EM_TEST_LINE_ID,
+             0, 0, 0, 0, 0);
+
+    // only the burst is queued, and the bucket is empty until a period passes
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_FILTERED - FSW_EM_TEST_FILTER_BURST, status.events_filtered);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_FILTER_BURST + 1, em_drain());
+
+    // the suppressed events are reported together once the filter allows it
+    os_task_delay(FSW_EM_TEST_FILTER_PERIOD + 1);
+    TEST_ASSERT_EQUAL(1, em_drain());
+    TEST_ASSERT_EQUAL(0, em_drain());
+
+    EM_Event event;
+    uint32_t event_size;
+    for (int event_index = 0; event_index < FSW_EM_TEST_FILTER_BURST + 2; event_index++)
+    {
+        event_size = sizeof(event);
+        mb_result = mb_receive(pipe, &event.header, &event_size, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+    }
+
+    TEST_ASSERT_EQUAL(FSW_MODULEID_EM, event.module);
+    TEST_ASSERT_EQUAL(EM_EVENT_ID_EVENTS_SUPPRESSED, event.event_id);
+    TEST_ASSERT_EQUAL(FSW_MODULEID_EM, event.params[0]);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_EVENT_ID, event.params[1]);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_FILTERED - FSW_EM_TEST_FILTER_BURST, event.params[2]);
+}
+
+TEST(FSW_EM, log)
+{
+    EM_Status status;
+    EM_RESULT_ENUM em_result;
+    EM_LogEntry entries[FSW_EM_TEST_NUM_LOGGED + 1];
+    uint32_t num_entries;
+
+    em_result = em_log_tail(NULL, 1, &num_entries);
+    TEST_ASSERT_EQUAL(EM_RESULT_INVALID_ARGUMENTS, em_result);
+
+    // the log is kept from earlier tests and runs, so only the events
+    // logged by this test are checked
+    uint64_t sequence = em_log_next_sequence();
+
+    for (int event_index = 0; event_index < FSW_EM_TEST_NUM_LOGGED; event_index++)
+    {
+        em_event(FSW_MODULEID_EM,
+                 FSW_EM_TEST_EVENT_ID,
+                 FSW_EM_TEST_LINE_ID,
+                 event_index, 0, 0, 0, 0);
+    }
+
+    // events are logged whether or not they could be sent
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED, em_drain());
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED, status.messages_received + status.message_errors);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED, status.events_logged);
+    TEST_ASSERT_EQUAL(sequence + FSW_EM_TEST_NUM_LOGGED, em_log_next_sequence());
+
+    em_result = em_log_since(sequence, entries, FSW_EM_TEST_NUM_LOGGED + 1, &num_entries);
+    TEST_ASSERT_EQUAL(EM_RESULT_OKAY, em_result);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED, num_entries);
+
+    for (int event_index = 0; event_index < FSW_EM_TEST_NUM_LOGGED; event_index++)
+    {
+        TEST_ASSERT_EQUAL(sequence + event_index, entries[event_index].sequence);
+        TEST_ASSERT_EQUAL(event_index, entries[event_index].event.sequence);
+        TEST_ASSERT_EQUAL(event_index, entries[event_index].event.params[0]);
+    }
+
+    // the tail is the last events, oldest first
+    em_result = em_log_tail(entries, 2, &num_entries);
+    TEST_ASSERT_EQUAL(EM_RESULT_OKAY, em_result);
+    TEST_ASSERT_EQUAL(2, num_entries);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED - 2, entries[0].event.params[0]);
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_LOGGED - 1, entries[1].event.params[0]);
+
+    // there are no events since the last one logged
+    em_result = em_log_since(em_log_next_sequence(), entries, 1, &num_entries);
+    TEST_ASSERT_EQUAL(EM_RESULT_OKAY, em_result);
+    TEST_ASSERT_EQUAL(0, num_entries);
+}
+
+TEST(FSW_EM, ring_released)
+{
+    EM_Status status;
+    OS_Task task;
+    OS_Sem exited;
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_create(&exited));
+
+    // more tasks than rings raise events one after another, and each
+    // queues its event on the ring released by the task before it.
+    for (int task_index = 0; task_index < FSW_EM_TEST_NUM_TASKS; task_index++)
+    {
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY,
+                          os_task_spawn(&task, em_test_event_task, &exited, 20, 1024 * 64));
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_take(&exited, 1000));
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&task, OS_TIMEOUT_WAIT_FOREVER));
+    }
+
+    // no task published its own event
+    em_get_status(&status);
+    TEST_ASSERT_EQUAL(0, status.messages_received + status.message_errors);
+
+    TEST_ASSERT_EQUAL(FSW_EM_TEST_NUM_TASKS, em_drain());
 }
 
 TEST_GROUP_RUNNER(FSW_EM)
@@ -91,5 +304,9 @@ TEST_GROUP_RUNNER(FSW_EM)
     RUN_TEST_CASE(FSW_EM, invalid_module);
     RUN_TEST_CASE(FSW_EM, msg_error);
     RUN_TEST_CASE(FSW_EM, msg_valid);
+    RUN_TEST_CASE(FSW_EM, ring_full);
+    RUN_TEST_CASE(FSW_EM, ring_released);
+    RUN_TEST_CASE(FSW_EM, filter);
+    RUN_TEST_CASE(FSW_EM, log);
 }
 
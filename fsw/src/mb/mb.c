@@ -8,8 +8,14 @@
  * This file contains the implementation of Message Bus module functions.
  */
 #include "stddef.h"
+#include "stdint.h"
+#include "stdbool.h"
 #include "stdlib.h"
 #include "string.h"
+#include "stdatomic.h"
+
+#include "os_counter.h"
+#include "os_seqlock.h"
 
 #include "fsw_definitions.h"
 #include "msg_definitions.h"
@@ -25,25 +31,174 @@
 MB_State gvMB_state = {0};
 
 
+/**
+ * This function places a message on every pipe registered for its packet id.
+ * Copy pipes receive a copy of the message, and loan pipes receive a pointer
+ * to the loaned buffer, which gains a reference for each pipe it is placed on.
+ *
+ * @param[in] message - the message to deliver.
+ * @param[in] loan - the loan buffer containing the message, or NULL if the
+ *                   message is not loaned. In that case a buffer is loaned
+ *                   and filled with a copy of the message the first time a
+ *                   loan pipe is found.
+ * @param[in] priority - the priority of the message on each pipe.
+ * @param[in] timeout - the timeout to wait for space on each pipe.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_deliver(MSG_Header *message,
+                          MB_LoanBuffer *loan,
+                          MB_PRIORITY_ENUM priority,
+                          OS_Timeout timeout);
+
+/**
+ * This function receives the highest priority loaned message from a loan pipe.
+ *
+ * @param[in] pipe_id - a valid loan pipe.
+ * @param[out] message - filled out with a pointer to the received message.
+ * @param[out] priority - filled out with the priority of the message.
+ * @param[in] timeout - the timeout to wait for a message.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_receive_loan_priority(MB_Pipe pipe_id,
+                                        MSG_Header **message,
+                                        MB_PRIORITY_ENUM *priority,
+                                        OS_Timeout timeout);
+
+/**
+ * This function converts the result of sending on a pipe's queue into
+ * an MB result, updating the send status.
+ *
+ * @param[in] packet_id - the packet id of the message sent.
+ * @param[in] pipe - the pipe that was sent to.
+ * @param[in] os_result - the result of the queue send.
+ *
+ * @return the MB result corresponding to the queue result.
+ */
+MB_RESULT_ENUM mb_send_result(MSG_PACKETID_ENUM packet_id,
+                              MB_Pipe pipe,
+                              OS_RESULT_ENUM os_result);
+
+/**
+ * This function converts the result of receiving from a pipe's queue into
+ * an MB result, updating the receive status.
+ *
+ * @param[in] pipe_id - the pipe that was received from.
+ * @param[in] os_result - the result of the queue receive.
+ * @param[in] num_msgs - the number of messages received.
+ *
+ * @return the MB result corresponding to the queue result.
+ */
+MB_RESULT_ENUM mb_receive_result(MB_Pipe pipe_id,
+                                 OS_RESULT_ENUM os_result,
+                                 uint32_t num_msgs);
+
+/**
+ * This function checks whether a pipe is registered for a packet id.
+ *
+ * @param[in] pipe - the pipe to check.
+ * @param[in] packet_id - the packet id to check.
+ *
+ * @return true if messages with the packet id are delivered to the pipe.
+ */
+bool mb_pipe_registered(MB_Pipe pipe, MSG_PACKETID_ENUM packet_id);
+
+/**
+ * This function adds the subscribers of a packet id to a pipe mask.
+ *
+ * @param[in] packet_id - a valid packet id.
+ * @param[in,out] pipe_mask - a mask of MB_PIPE_MASK_WORDS words, which has
+ *                            the bit of each pipe registered for the packet set.
+ */
+void mb_add_subscribers(MSG_PACKETID_ENUM packet_id, uint64_t *pipe_mask);
+
+/**
+ * This function takes the lowest numbered pipe out of a pipe mask.
+ *
+ * @param[in,out] pipe_mask - a mask of MB_PIPE_MASK_WORDS words. The bit of
+ *                            the returned pipe is cleared.
+ * @param[out] pipe - filled out with the pipe, if there is one.
+ *
+ * @return true if a pipe was taken, or false if the mask is empty.
+ */
+bool mb_next_pipe(uint64_t *pipe_mask, MB_Pipe *pipe);
+
+/**
+ * This function creates a pipe of a given type.
+ *
+ * @param[out] pipe - filled out with the new pipe handle.
+ * @param[in] num_msgs - the maximum number of messages queued on the pipe.
+ * @param[in] queue_msg_size_bytes - the size of each entry in the pipe's queue.
+ * @param[in] pipe_type - whether the pipe holds copies or loaned pointers.
+ *
+ * @return Either success (MB_RESULT_OKAY), or an error code indicating the
+ *         source of the error.
+ */
+MB_RESULT_ENUM mb_create_typed_pipe(MB_Pipe *pipe,
+                                    uint32_t num_msgs,
+                                    uint32_t queue_msg_size_bytes,
+                                    MB_PIPETYPE_ENUM pipe_type);
+
+/**
+ * This function takes a free buffer from the loan pool, giving it a
+ * single reference.
+ *
+ * @param[in] size_bytes - the size of the message to be placed in the buffer.
+ *
+ * @return a pointer to the loaned buffer, or NULL if the pool is exhausted
+ *         or the message is too large.
+ */
+MB_LoanBuffer *mb_loan_acquire(uint32_t size_bytes);
+
+/**
+ * This function finds the loan pool buffer containing a message.
+ *
+ * @param[in] message - a pointer to a message.
+ *
+ * @return the loan buffer whose data starts at 'message', or NULL if the
+ *         message is not in the loan pool.
+ */
+MB_LoanBuffer *mb_loan_buffer(MSG_Header *message);
+
+
 FSW_RESULT_ENUM mb_initialize(void)
 {
     FSW_RESULT_ENUM result = FSW_RESULT_OKAY;
 
     memset(&gvMB_state, 0, sizeof(gvMB_state));
+    os_seqlock_init(&gvMB_state.status_lock);
+    os_counters_init(&gvMB_state.counters);
+
+    // a task sending NULL messages in a loop would raise an event for each
+    // one. If the filter cannot be registered, the event is not filtered.
+    (void)em_filter_event(FSW_MODULEID_MB,
+                          FSW_EVENT_NULL_POINTER,
+                          EM_FILTER_DEFAULT_BURST,
+                          EM_FILTER_DEFAULT_PERIOD);
 
     return result;
 }
 
 MB_RESULT_ENUM mb_send(MSG_Header *message, OS_Timeout timeout)
+{
+    return mb_send_priority(message, MB_PRIORITY_NORMAL, timeout);
+}
+
+MB_RESULT_ENUM mb_send_priority(MSG_Header *message,
+                                MB_PRIORITY_ENUM priority,
+                                OS_Timeout timeout)
 {
     MB_RESULT_ENUM result = MB_RESULT_OKAY;
 
-    gvMB_state.status.messages_sent++;
+    os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGES_SENT, 1);
 
     if (message == NULL)
     {
         result = MB_RESULT_NULL_POINTER;
-        gvMB_state.status.message_sent_errors++;
+        os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
 
         em_event(FSW_MODULEID_MB,
                  FSW_EVENT_NULL_POINTER,
@@ -54,52 +209,260 @@ MB_RESULT_ENUM mb_send(MSG_Header *message, OS_Timeout timeout)
 
     if (result == MB_RESULT_OKAY)
     {
-        // the message size is the size of the data section (the length field)
-        // plus the size of the header itself.
-        uint32_t msg_size = message->length + sizeof(MSG_Header);
+        if (message->packet_id >= MSG_PACKETID_NUM_PACKET_IDS)
+        {
+            result = MB_RESULT_INVALID_PACKET_ID;
+            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+        }
+        else if ((uint32_t)priority >= MB_PRIORITY_NUM_PRIORITIES)
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+        }
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        result = mb_deliver(message, NULL, priority, timeout);
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_send_batch(MSG_Header **messages,
+                             uint32_t num_msgs,
+                             OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    // the buffer loaned for each message the first time a loan pipe needs it,
+    // and the pointer to the loaned message that is placed on loan pipes.
+    MB_LoanBuffer *loans[MB_MAX_BATCH_MSGS] = {0};
+    MSG_Header *loaned_messages[MB_MAX_BATCH_MSGS];
+
+    // the entries of the batch placed on a single pipe
+    uint8_t *pipe_buffers[MB_MAX_BATCH_MSGS];
+    uint32_t pipe_sizes[MB_MAX_BATCH_MSGS];
+    MB_LoanBuffer *pipe_loans[MB_MAX_BATCH_MSGS];
+    uint32_t pipe_msg_indexes[MB_MAX_BATCH_MSGS];
+
+    os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGES_SENT, num_msgs);
+
+    if (messages == NULL)
+    {
+        result = MB_RESULT_NULL_POINTER;
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        if ((num_msgs == 0) || (num_msgs > MB_MAX_BATCH_MSGS))
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+        }
+    }
 
-        MSG_PACKETID_ENUM packet_id =
-            (MSG_PACKETID_ENUM)message->packet_id;
+    for (uint32_t msg_index = 0;
+         (result == MB_RESULT_OKAY) && (msg_index < num_msgs);
+         msg_index++)
+    {
+        if (messages[msg_index] == NULL)
+        {
+            result = MB_RESULT_NULL_POINTER;
+        }
+        else if (messages[msg_index]->packet_id >= MSG_PACKETID_NUM_PACKET_IDS)
+        {
+            result = MB_RESULT_INVALID_PACKET_ID;
+        }
+    }
 
+    if (result != MB_RESULT_OKAY)
+    {
+        os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, num_msgs);
+    }
+    else
+    {
         result = MB_RESULT_NO_RECEIVER;
-        for (uint16_t pipe_index = 0;
-             pipe_index < gvMB_state.packets[packet_id].num_queues;
-             pipe_index++)
+
+        // every pipe that receives at least one message of the batch
+        uint64_t subscribers[MB_PIPE_MASK_WORDS] = {0};
+        for (uint32_t msg_index = 0; msg_index < num_msgs; msg_index++)
         {
-            uint32_t pipe = gvMB_state.packets[packet_id].queues[pipe_index];
-            OS_RESULT_ENUM os_result =
-                os_queue_send(&gvMB_state.pipes[pipe],
-                              (uint8_t*)message,
-                              msg_size,
-                              timeout);
+            mb_add_subscribers((MSG_PACKETID_ENUM)messages[msg_index]->packet_id, subscribers);
+        }
+
+        MB_Pipe pipe = 0;
+        while (mb_next_pipe(subscribers, &pipe))
+        {
+            bool loan_pipe = gvMB_state.pipe_types[pipe] == MB_PIPETYPE_LOAN;
 
-            if (os_result == OS_RESULT_OKAY)
+            uint32_t pipe_msgs = 0;
+
+            for (uint32_t msg_index = 0; msg_index < num_msgs; msg_index++)
             {
-                result = MB_RESULT_OKAY;
+                MSG_Header *message = messages[msg_index];
+                uint32_t msg_size = message->length + sizeof(MSG_Header);
+
+                if (!mb_pipe_registered(pipe, (MSG_PACKETID_ENUM)message->packet_id))
+                {
+                    continue;
+                }
+
+                if (loan_pipe)
+                {
+                    if (loans[msg_index] == NULL)
+                    {
+                        loans[msg_index] = mb_loan_acquire(msg_size);
+
+                        if (loans[msg_index] == NULL)
+                        {
+                            result = MB_RESULT_NO_BUFFERS;
+                            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+                            continue;
+                        }
+
+                        memcpy(loans[msg_index]->data, message, msg_size);
+                        loaned_messages[msg_index] = (MSG_Header*)loans[msg_index]->data;
+                    }
+
+                    // the pipe holds a reference for as long as the pointer is queued
+                    atomic_fetch_add(&loans[msg_index]->references, 1);
+
+                    pipe_buffers[pipe_msgs] = (uint8_t*)&loaned_messages[msg_index];
+                    pipe_sizes[pipe_msgs] = sizeof(MSG_Header*);
+                    pipe_loans[pipe_msgs] = loans[msg_index];
+                }
+                else
+                {
+                    pipe_buffers[pipe_msgs] = (uint8_t*)message;
+                    pipe_sizes[pipe_msgs] = msg_size;
+                    pipe_loans[pipe_msgs] = NULL;
+                }
+
+                pipe_msg_indexes[pipe_msgs] = msg_index;
+                pipe_msgs++;
             }
-            else
+
+            if (pipe_msgs > 0)
             {
-                // Timeouts are handled separately, as they are an expected error
-                // condition in some case.
-                if (os_result == OS_RESULT_TIMEOUT)
+                uint32_t num_sent = 0;
+
+                OS_RESULT_ENUM os_result =
+                    os_queue_send_batch(&gvMB_state.pipes[pipe],
+                                        pipe_buffers,
+                                        pipe_sizes,
+                                        pipe_msgs,
+                                        &num_sent,
+                                        timeout);
+
+                // references taken for messages that were not placed on the pipe
+                for (uint32_t unsent = num_sent; unsent < pipe_msgs; unsent++)
                 {
-                    result = MB_RESULT_TIMEOUT;
+                    if (pipe_loans[unsent] != NULL)
+                    {
+                        atomic_fetch_sub(&pipe_loans[unsent]->references, 1);
+                    }
                 }
-                else
+
+                // an error is reported against the first message not sent
+                uint32_t error_index = pipe_msg_indexes[(num_sent < pipe_msgs) ? num_sent : 0];
+
+                result = mb_send_result((MSG_PACKETID_ENUM)messages[error_index]->packet_id,
+                                        pipe,
+                                        os_result);
+            }
+        }
+
+        // the references taken by loaning are handed over to the pipes
+        for (uint32_t msg_index = 0; msg_index < num_msgs; msg_index++)
+        {
+            if (loans[msg_index] != NULL)
+            {
+                atomic_fetch_sub(&loans[msg_index]->references, 1);
+            }
+        }
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_deliver(MSG_Header *message,
+                          MB_LoanBuffer *loan,
+                          MB_PRIORITY_ENUM priority,
+                          OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_NO_RECEIVER;
+
+    // the message size is the size of the data section (the length field)
+    // plus the size of the header itself.
+    uint32_t msg_size = message->length + sizeof(MSG_Header);
+
+    MSG_PACKETID_ENUM packet_id =
+        (MSG_PACKETID_ENUM)message->packet_id;
+
+    // a buffer loaned here is only used to hand a copied message to loan pipes,
+    // and the reference taken by the loan is released once all pipes have it.
+    bool loaned_here = false;
+
+    uint64_t subscribers[MB_PIPE_MASK_WORDS] = {0};
+    mb_add_subscribers(packet_id, subscribers);
+
+    MB_Pipe pipe = 0;
+    while (mb_next_pipe(subscribers, &pipe))
+    {
+        OS_RESULT_ENUM os_result = OS_RESULT_OKAY;
+
+        if (gvMB_state.pipe_types[pipe] == MB_PIPETYPE_LOAN)
+        {
+            if (loan == NULL)
+            {
+                loan = mb_loan_acquire(msg_size);
+
+                if (loan == NULL)
                 {
-                    // set result to error, but continue the loop in case
-                    // other pipes can continue functioning.
-                    result = MB_RESULT_SEND_ERROR;
-
-                    // usually an em message would be generated here, but we cannot be sure
-                    // that the problem isn't itself caused by an em message.
-                    gvMB_state.status.send_error_packet_id = packet_id;
-                    gvMB_state.status.send_error_pipe_index = pipe_index;
-                    gvMB_state.status.send_error_code = os_result;
-                    gvMB_state.status.message_sent_errors++;
+                    // there is nothing to send to loan pipes, but copy pipes
+                    // can still receive the message.
+                    result = MB_RESULT_NO_BUFFERS;
+                    os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+                    continue;
                 }
+
+                loaned_here = true;
+
+                memcpy(loan->data, message, msg_size);
+            }
+
+            // the pipe holds a reference for as long as the pointer is queued
+            atomic_fetch_add(&loan->references, 1);
+
+            MSG_Header *loaned_message = (MSG_Header*)loan->data;
+            os_result = os_queue_send_priority(&gvMB_state.pipes[pipe],
+                                               (uint8_t*)&loaned_message,
+                                               sizeof(loaned_message),
+                                               priority,
+                                               timeout);
+
+            if (os_result != OS_RESULT_OKAY)
+            {
+                atomic_fetch_sub(&loan->references, 1);
             }
         }
+        else
+        {
+            os_result = os_queue_send_priority(&gvMB_state.pipes[pipe],
+                                               (uint8_t*)message,
+                                               msg_size,
+                                               priority,
+                                               timeout);
+        }
+
+        // set the result, but continue the loop in case
+        // other pipes can continue functioning.
+        result = mb_send_result(packet_id, pipe, os_result);
+    }
+
+    if (loaned_here)
+    {
+        atomic_fetch_sub(&loan->references, 1);
     }
 
     return result;
@@ -109,10 +472,21 @@ MB_RESULT_ENUM mb_receive(MB_Pipe pipe_id,
                           MSG_Header *message,
                           uint32_t *msg_size,
                           OS_Timeout timeout)
+{
+    MB_PRIORITY_ENUM priority = MB_PRIORITY_NORMAL;
+
+    return mb_receive_priority(pipe_id, message, msg_size, &priority, timeout);
+}
+
+MB_RESULT_ENUM mb_receive_priority(MB_Pipe pipe_id,
+                                   MSG_Header *message,
+                                   uint32_t *msg_size,
+                                   MB_PRIORITY_ENUM *priority,
+                                   OS_Timeout timeout)
 {
     MB_RESULT_ENUM result = MB_RESULT_OKAY;
 
-    if ((message == NULL) || (msg_size == NULL))
+    if ((message == NULL) || (msg_size == NULL) || (priority == NULL))
     {
         result = MB_RESULT_NULL_POINTER;
     }
@@ -127,33 +501,269 @@ MB_RESULT_ENUM mb_receive(MB_Pipe pipe_id,
 
     if (result == MB_RESULT_OKAY)
     {
-        OS_RESULT_ENUM os_result =
-            os_queue_receive(&gvMB_state.pipes[pipe_id],
-                             (uint8_t*)message,
-                             sizeof(MSG_Header) + msg_size,
-                             timeout);
-
-        if (os_result == OS_RESULT_OKAY)
+        if (gvMB_state.pipe_types[pipe_id] == MB_PIPETYPE_LOAN)
         {
-            gvMB_state.status.messages_received++;
+            MSG_Header *loaned_message = NULL;
+
+            result = mb_receive_loan_priority(pipe_id, &loaned_message, priority, timeout);
+
+            if (result == MB_RESULT_OKAY)
+            {
+                uint32_t loaned_size = loaned_message->length + sizeof(MSG_Header);
+
+                if (loaned_size <= *msg_size)
+                {
+                    memcpy(message, loaned_message, loaned_size);
+                    *msg_size = loaned_size;
+                }
+                else
+                {
+                    result = MB_RESULT_MSG_TOO_LARGE;
+                }
+
+                // the message was copied out (or cannot be), so the pipe's
+                // reference is given back either way.
+                (void)mb_release(loaned_message);
+            }
         }
         else
         {
-            // Timeouts are handled separately, as they are an expected error
-            // condition in some case.
-            if (os_result == OS_RESULT_TIMEOUT)
+            uint32_t queue_priority = 0;
+
+            OS_RESULT_ENUM os_result =
+                os_queue_receive_priority(&gvMB_state.pipes[pipe_id],
+                                          (uint8_t*)message,
+                                          msg_size,
+                                          &queue_priority,
+                                          timeout);
+
+            result = mb_receive_result(pipe_id, os_result, 1);
+
+            if (result == MB_RESULT_OKAY)
             {
-                result = MB_RESULT_TIMEOUT;
+                *priority = (MB_PRIORITY_ENUM)queue_priority;
             }
-            else
+        }
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_receive_loan(MB_Pipe pipe_id,
+                               MSG_Header **message,
+                               OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    if (message == NULL)
+    {
+        result = MB_RESULT_NULL_POINTER;
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        if (pipe_id >= gvMB_state.num_pipes)
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        if (gvMB_state.pipe_types[pipe_id] != MB_PIPETYPE_LOAN)
+        {
+            result = MB_RESULT_INVALID_PIPE;
+        }
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        MB_PRIORITY_ENUM priority = MB_PRIORITY_NORMAL;
+
+        result = mb_receive_loan_priority(pipe_id, message, &priority, timeout);
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_receive_loan_priority(MB_Pipe pipe_id,
+                                        MSG_Header **message,
+                                        MB_PRIORITY_ENUM *priority,
+                                        OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    MSG_Header *loaned_message = NULL;
+    uint32_t pointer_size = sizeof(loaned_message);
+
+    uint32_t queue_priority = 0;
+
+    OS_RESULT_ENUM os_result =
+        os_queue_receive_priority(&gvMB_state.pipes[pipe_id],
+                                  (uint8_t*)&loaned_message,
+                                  &pointer_size,
+                                  &queue_priority,
+                                  timeout);
+
+    result = mb_receive_result(pipe_id, os_result, 1);
+
+    if (result == MB_RESULT_OKAY)
+    {
+        *message = loaned_message;
+        *priority = (MB_PRIORITY_ENUM)queue_priority;
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_receive_batch(MB_Pipe pipe_id,
+                                uint8_t *buffer,
+                                uint32_t msg_size_bytes,
+                                uint32_t max_msgs,
+                                uint32_t *msg_sizes,
+                                uint32_t *num_msgs,
+                                OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    if ((buffer == NULL) || (msg_sizes == NULL) || (num_msgs == NULL))
+    {
+        result = MB_RESULT_NULL_POINTER;
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        *num_msgs = 0;
+
+        if ((pipe_id >= gvMB_state.num_pipes) || (max_msgs == 0))
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        if (gvMB_state.pipe_types[pipe_id] == MB_PIPETYPE_LOAN)
+        {
+            MSG_Header *loaned_messages[MB_MAX_BATCH_MSGS];
+            uint32_t pointer_sizes[MB_MAX_BATCH_MSGS];
+            uint32_t num_loaned = 0;
+
+            if (max_msgs > MB_MAX_BATCH_MSGS)
+            {
+                max_msgs = MB_MAX_BATCH_MSGS;
+            }
+
+            OS_RESULT_ENUM os_result =
+                os_queue_receive_batch(&gvMB_state.pipes[pipe_id],
+                                       (uint8_t*)loaned_messages,
+                                       sizeof(MSG_Header*),
+                                       pointer_sizes,
+                                       max_msgs,
+                                       &num_loaned,
+                                       timeout);
+
+            result = mb_receive_result(pipe_id, os_result, num_loaned);
+
+            // copy each message out and give back the pipe's reference.
+            // A message that does not fit is dropped, as in mb_receive.
+            for (uint32_t loan_index = 0; loan_index < num_loaned; loan_index++)
             {
-                result = MB_RESULT_PIPE_READ_ERROR;
+                MSG_Header *loaned_message = loaned_messages[loan_index];
+                uint32_t loaned_size = loaned_message->length + sizeof(MSG_Header);
 
-                gvMB_state.status.receive_error_pipe_id = pipe_id;
-                gvMB_state.status.receive_error_code = os_result;
-                gvMB_state.status.message_receive_errors++;
+                if (loaned_size <= msg_size_bytes)
+                {
+                    memcpy(&buffer[*num_msgs * msg_size_bytes], loaned_message, loaned_size);
+                    msg_sizes[*num_msgs] = loaned_size;
+                    (*num_msgs)++;
+                }
+                else
+                {
+                    result = MB_RESULT_MSG_TOO_LARGE;
+                }
+
+                (void)mb_release(loaned_message);
             }
         }
+        else
+        {
+            OS_RESULT_ENUM os_result =
+                os_queue_receive_batch(&gvMB_state.pipes[pipe_id],
+                                       buffer,
+                                       msg_size_bytes,
+                                       msg_sizes,
+                                       max_msgs,
+                                       num_msgs,
+                                       timeout);
+
+            result = mb_receive_result(pipe_id, os_result, *num_msgs);
+        }
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_send_result(MSG_PACKETID_ENUM packet_id,
+                              MB_Pipe pipe,
+                              OS_RESULT_ENUM os_result)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    if (os_result != OS_RESULT_OKAY)
+    {
+        // Timeouts are handled separately, as they are an expected error
+        // condition in some case.
+        if (os_result == OS_RESULT_TIMEOUT)
+        {
+            result = MB_RESULT_TIMEOUT;
+        }
+        else
+        {
+            result = MB_RESULT_SEND_ERROR;
+
+            // usually an em message would be generated here, but we cannot be sure
+            // that the problem isn't itself caused by an em message.
+            os_seqlock_write_begin(&gvMB_state.status_lock);
+            gvMB_state.status.send_error_packet_id = packet_id;
+            gvMB_state.status.send_error_pipe_index = pipe;
+            gvMB_state.status.send_error_code = os_result;
+            os_seqlock_write_end(&gvMB_state.status_lock);
+            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+        }
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_receive_result(MB_Pipe pipe_id,
+                                 OS_RESULT_ENUM os_result,
+                                 uint32_t num_msgs)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    if (os_result == OS_RESULT_OKAY)
+    {
+        os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGES_RECEIVED, num_msgs);
+    }
+    else
+    {
+        // Timeouts are handled separately, as they are an expected error
+        // condition in some case.
+        if (os_result == OS_RESULT_TIMEOUT)
+        {
+            result = MB_RESULT_TIMEOUT;
+        }
+        else
+        {
+            result = MB_RESULT_PIPE_READ_ERROR;
+
+            os_seqlock_write_begin(&gvMB_state.status_lock);
+            gvMB_state.status.receive_error_pipe_id = pipe_id;
+            gvMB_state.status.receive_error_code = os_result;
+            os_seqlock_write_end(&gvMB_state.status_lock);
+            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_RECEIVE_ERRORS, 1);
+        }
     }
 
     return result;
@@ -162,6 +772,28 @@ MB_RESULT_ENUM mb_receive(MB_Pipe pipe_id,
 MB_RESULT_ENUM mb_create_pipe(MB_Pipe *pipe,
                               uint32_t num_msgs,
                               uint32_t msg_size_bytes)
+{
+    // the message size includes the message header, as every caller sizes
+    // pipes by their full message structure.
+    return mb_create_typed_pipe(pipe,
+                                num_msgs,
+                                msg_size_bytes,
+                                MB_PIPETYPE_COPY);
+}
+
+MB_RESULT_ENUM mb_create_loan_pipe(MB_Pipe *pipe, uint32_t num_msgs)
+{
+    // loan pipes only ever hold a pointer to the loaned message
+    return mb_create_typed_pipe(pipe,
+                                num_msgs,
+                                sizeof(MSG_Header*),
+                                MB_PIPETYPE_LOAN);
+}
+
+MB_RESULT_ENUM mb_create_typed_pipe(MB_Pipe *pipe,
+                                    uint32_t num_msgs,
+                                    uint32_t queue_msg_size_bytes,
+                                    MB_PIPETYPE_ENUM pipe_type)
 {
     MB_RESULT_ENUM result = MB_RESULT_OKAY;
 
@@ -183,9 +815,10 @@ MB_RESULT_ENUM mb_create_pipe(MB_Pipe *pipe,
         uint32_t next_pipe = gvMB_state.num_pipes;
 
         OS_RESULT_ENUM os_result =
-            os_queue_create(&gvMB_state.pipes[next_pipe],
-                            num_msgs,
-                            sizeof(MSG_Header) + msg_size_bytes);
+            os_queue_create_type(&gvMB_state.pipes[next_pipe],
+                                 num_msgs,
+                                 queue_msg_size_bytes,
+                                 MB_PIPE_QUEUE_TYPE);
         if (os_result != OS_RESULT_OKAY)
         {
             result = MB_RESULT_PIPE_CREATE_FAILED;
@@ -197,6 +830,8 @@ MB_RESULT_ENUM mb_create_pipe(MB_Pipe *pipe,
     {
         *pipe = gvMB_state.num_pipes;
 
+        gvMB_state.pipe_types[gvMB_state.num_pipes] = pipe_type;
+
         gvMB_state.num_pipes++;
     }
 
@@ -207,43 +842,244 @@ MB_RESULT_ENUM mb_register_packet(MB_Pipe pipe, MSG_PACKETID_ENUM packet_id)
 {
     MB_RESULT_ENUM result = MB_RESULT_OKAY;
 
-    uint32_t next_queue = 0;
-
-    if (pipe > gvMB_state.num_pipes)
+    if (pipe >= gvMB_state.num_pipes)
     {
         result = MB_RESULT_INVALID_PIPE;
     }
 
-    if (packet_id > MSG_PACKETID_NUM_PACKET_IDS)
+    if (packet_id >= MSG_PACKETID_NUM_PACKET_IDS)
     {
         result = MB_RESULT_INVALID_PACKET_ID;
     }
 
     if (result == MB_RESULT_OKAY)
     {
-        next_queue = gvMB_state.packets[packet_id].num_queues;
+        // the pipe is fully created before it is registered, and the release
+        // ordering publishes it to senders that see its bit.
+        atomic_fetch_or_explicit(&gvMB_state.packets[packet_id].subscribers[pipe / 64],
+                                 (uint64_t)1 << (pipe % 64),
+                                 memory_order_release);
+    }
+
+    return result;
+}
 
-        if (next_queue >= MB_MAX_PIPES_PER_PACKET)
+MB_RESULT_ENUM mb_loan(MSG_Header **message, uint32_t size_bytes)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    if (message == NULL)
+    {
+        result = MB_RESULT_NULL_POINTER;
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        if ((size_bytes < sizeof(MSG_Header)) ||
+            (size_bytes > MB_LOAN_BUFFER_SIZE_BYTES))
         {
-            result = MB_RESULT_MAX_PIPES_REACHED;
+            result = MB_RESULT_MSG_TOO_LARGE;
+        }
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        MB_LoanBuffer *loan = mb_loan_acquire(size_bytes);
+
+        if (loan != NULL)
+        {
+            *message = (MSG_Header*)loan->data;
+        }
+        else
+        {
+            result = MB_RESULT_NO_BUFFERS;
+        }
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_publish(MSG_Header *message, OS_Timeout timeout)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    MB_LoanBuffer *loan = NULL;
+
+    os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGES_SENT, 1);
+
+    if (message == NULL)
+    {
+        result = MB_RESULT_NULL_POINTER;
+        os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        loan = mb_loan_buffer(message);
+
+        if ((loan == NULL) ||
+            ((message->length + sizeof(MSG_Header)) > MB_LOAN_BUFFER_SIZE_BYTES))
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+            os_counters_add(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS, 1);
         }
     }
 
     if (result == MB_RESULT_OKAY)
     {
-        gvMB_state.packets[packet_id].queues[next_queue] = pipe;
+        result = mb_deliver(message, loan, MB_PRIORITY_NORMAL, timeout);
+
+        // the publisher's reference is handed over to the pipes that
+        // received the message.
+        (void)mb_release(message);
+    }
+
+    return result;
+}
+
+MB_RESULT_ENUM mb_release(MSG_Header *message)
+{
+    MB_RESULT_ENUM result = MB_RESULT_OKAY;
+
+    MB_LoanBuffer *loan = mb_loan_buffer(message);
+
+    if (loan == NULL)
+    {
+        result = MB_RESULT_INVALID_ARGUMENTS;
+    }
+
+    if (result == MB_RESULT_OKAY)
+    {
+        // decrement only if there is a reference to release, so a double
+        // release cannot free a buffer out from under another holder.
+        unsigned int references = atomic_load(&loan->references);
+        while ((references > 0) &&
+               !atomic_compare_exchange_weak(&loan->references,
+                                             &references,
+                                             references - 1))
+        {
+        }
 
-        gvMB_state.packets[packet_id].num_queues++;
+        if (references == 0)
+        {
+            result = MB_RESULT_INVALID_ARGUMENTS;
+        }
     }
 
     return result;
 }
 
+MB_LoanBuffer *mb_loan_acquire(uint32_t size_bytes)
+{
+    MB_LoanBuffer *loan = NULL;
+
+    if (size_bytes <= MB_LOAN_BUFFER_SIZE_BYTES)
+    {
+        // start each search at a different buffer so that consecutive loans
+        // do not all contend on the first free buffer.
+        uint32_t start = atomic_fetch_add(&gvMB_state.next_loan, 1);
+
+        for (uint32_t offset = 0;
+             (offset < MB_NUM_LOAN_BUFFERS) && (loan == NULL);
+             offset++)
+        {
+            uint32_t index = (start + offset) % MB_NUM_LOAN_BUFFERS;
+
+            unsigned int free_references = 0;
+            if (atomic_compare_exchange_strong(&gvMB_state.loans[index].references,
+                                               &free_references,
+                                               1))
+            {
+                loan = &gvMB_state.loans[index];
+            }
+        }
+    }
+
+    if (loan == NULL)
+    {
+        os_counters_add(&gvMB_state.counters, MB_COUNTER_LOAN_ERRORS, 1);
+    }
+
+    return loan;
+}
+
+bool mb_pipe_registered(MB_Pipe pipe, MSG_PACKETID_ENUM packet_id)
+{
+    uint64_t subscribers =
+        atomic_load_explicit(&gvMB_state.packets[packet_id].subscribers[pipe / 64],
+                             memory_order_acquire);
+
+    return (subscribers & ((uint64_t)1 << (pipe % 64))) != 0;
+}
+
+void mb_add_subscribers(MSG_PACKETID_ENUM packet_id, uint64_t *pipe_mask)
+{
+    for (uint32_t word = 0; word < MB_PIPE_MASK_WORDS; word++)
+    {
+        pipe_mask[word] |=
+            atomic_load_explicit(&gvMB_state.packets[packet_id].subscribers[word],
+                                 memory_order_acquire);
+    }
+}
+
+bool mb_next_pipe(uint64_t *pipe_mask, MB_Pipe *pipe)
+{
+    bool found = false;
+
+    for (uint32_t word = 0; (word < MB_PIPE_MASK_WORDS) && !found; word++)
+    {
+        if (pipe_mask[word] != 0)
+        {
+            *pipe = (word * 64) + (MB_Pipe)__builtin_ctzll(pipe_mask[word]);
+
+            // clear the lowest set bit
+            pipe_mask[word] &= pipe_mask[word] - 1;
+
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+MB_LoanBuffer *mb_loan_buffer(MSG_Header *message)
+{
+    MB_LoanBuffer *loan = NULL;
+
+    uintptr_t address = (uintptr_t)message;
+    uintptr_t pool_start = (uintptr_t)&gvMB_state.loans[0];
+    uintptr_t pool_end = (uintptr_t)&gvMB_state.loans[MB_NUM_LOAN_BUFFERS];
+
+    if ((address >= pool_start) && (address < pool_end))
+    {
+        uint32_t index = (address - pool_start) / sizeof(MB_LoanBuffer);
+
+        // only the start of a buffer's data is a valid message pointer
+        if (message == (MSG_Header*)gvMB_state.loans[index].data)
+        {
+            loan = &gvMB_state.loans[index];
+        }
+    }
+
+    return loan;
+}
+
 void mb_get_status(MB_Status *status)
 {
     if (status != NULL)
     {
-        *status = gvMB_state.status;
+        os_seqlock_read(&gvMB_state.status_lock,
+                        status,
+                        &gvMB_state.status,
+                        sizeof(*status));
+
+        // the counts are summed one at a time, so counts made while they
+        // are summed may be included in some counts but not others.
+        status->messages_sent = os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGES_SENT);
+        status->messages_received = os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGES_RECEIVED);
+        status->message_sent_errors = os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS);
+        status->message_receive_errors = os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGE_RECEIVE_ERRORS);
+        status->loan_errors = os_counters_sum(&gvMB_state.counters, MB_COUNTER_LOAN_ERRORS);
     }
 }
 
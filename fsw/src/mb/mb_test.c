@@ -14,6 +14,8 @@
 #include "unity.h"
 #include "unity_fixture.h"
 
+#include "os_counter.h"
+
 #include "fsw_definitions.h"
 #include "msg_definitions.h"
 #include "em.h"
@@ -113,22 +115,59 @@ TEST(FSW_MB, register_packet_null)
 }
 
 /**
- * Test registering more than the maximum number of packets.
+ * Test registering a pipe or packet id just past the valid range.
  */
-TEST(FSW_MB, register_over_max)
+TEST(FSW_MB, register_out_of_range)
 {
-    MB_Pipe pipe = 0;
+    MB_RESULT_ENUM result;
+
+    // no pipes have been created, so pipe 0 is not valid yet
+    result = mb_register_packet(0, MSG_PACKETID_HEALTHANDSTATUS);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_PIPE, result);
 
-    for (uint32_t packetIndex = 0; packetIndex < MB_MAX_PIPES_PER_PACKET; packetIndex++)
+    MB_Pipe pipe;
+    result = mb_create_pipe(&pipe, FSW_MB_TEST_NUM_MSGS, FSW_MB_TEST_MSG_SIZE);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    result = mb_register_packet(pipe, MSG_PACKETID_NUM_PACKET_IDS);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_PACKET_ID, result);
+}
+
+/**
+ * Test registering a packet on every pipe, across more than one word
+ * of the subscriber mask.
+ */
+TEST(FSW_MB, register_all_pipes)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe pipes[MB_MAX_NUM_PIPES];
+
+    for (uint32_t pipeIndex = 0; pipeIndex < MB_MAX_NUM_PIPES; pipeIndex++)
     {
-        MB_RESULT_ENUM result;
-        result = mb_register_packet(pipe, MSG_PACKETID_HEALTHANDSTATUS);
+        result = mb_create_pipe(&pipes[pipeIndex], 1, FSW_MB_TEST_MSG_SIZE);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+        result = mb_register_packet(pipes[pipeIndex], MSG_PACKETID_COMMAND);
         TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
     }
 
-    MB_RESULT_ENUM result;
-    result = mb_register_packet(pipe, MSG_PACKETID_HEALTHANDSTATUS);
-    TEST_ASSERT_EQUAL(MB_RESULT_MAX_PIPES_REACHED, result);
+    MSG_Header header;
+    (void)msg_command_message(&header, MSG_PACKETID_COMMAND, 0);
+
+    result = mb_send(&header, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    for (uint32_t pipeIndex = 0; pipeIndex < MB_MAX_NUM_PIPES; pipeIndex++)
+    {
+        MSG_Header recvHeader;
+        uint32_t msg_size = sizeof(recvHeader);
+        result = mb_receive(pipes[pipeIndex], &recvHeader, &msg_size, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+        TEST_ASSERT_EQUAL_MEMORY(&header, &recvHeader, sizeof(header));
+    }
+
+    TEST_ASSERT_EQUAL(0, os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGE_SENT_ERRORS));
 }
 
 /**
@@ -184,10 +223,10 @@ TEST(FSW_MB, send_receive)
     TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
 
     MSG_Header recvHeader;
-    uint32_t msg_size = 0;
+    uint32_t msg_size = sizeof(MSG_Header);
     result = mb_receive(pipe, &recvHeader, &msg_size, OS_TIMEOUT_NO_WAIT);
     TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
-    TEST_ASSERT_EQUAL(msg_size, 0);
+    TEST_ASSERT_EQUAL(msg_size, sizeof(MSG_Header));
     TEST_ASSERT_EQUAL_MEMORY(&header, &recvHeader, sizeof(header));
 }
 
@@ -236,6 +275,356 @@ TEST(FSW_MB, send_receive_two_pipes)
     TEST_ASSERT_EQUAL_MEMORY(&header, &recvHeader2, sizeof(header));
 }
 
+/**
+ * Count the loan buffers that are still held by someone.
+ */
+static uint32_t mb_test_loans_held(void)
+{
+    uint32_t held = 0;
+
+    for (uint32_t index = 0; index < MB_NUM_LOAN_BUFFERS; index++)
+    {
+        if (atomic_load(&gvMB_state.loans[index].references) != 0)
+        {
+            held++;
+        }
+    }
+
+    return held;
+}
+
+/**
+ * Get the reference count of the loan buffer holding a message.
+ */
+static uint32_t mb_test_references(MSG_Header *message)
+{
+    uint32_t references = 0;
+
+    for (uint32_t index = 0; index < MB_NUM_LOAN_BUFFERS; index++)
+    {
+        if ((MSG_Header*)gvMB_state.loans[index].data == message)
+        {
+            references = atomic_load(&gvMB_state.loans[index].references);
+        }
+    }
+
+    return references;
+}
+
+/**
+ * Test loaning a message, publishing it, and receiving the same buffer
+ * on a loan pipe without a copy.
+ */
+TEST(FSW_MB, loan_publish_receive)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe pipe;
+    result = mb_create_loan_pipe(&pipe, FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    result = mb_register_packet(pipe, MSG_PACKETID_COMMAND);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MSG_Header *message = NULL;
+    result = mb_loan(&message, sizeof(MSG_Header) + sizeof(uint32_t));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_NOT_NULL(message);
+
+    MSG_RESULT_ENUM msgResult;
+    msgResult = msg_command_message(message, MSG_PACKETID_COMMAND, sizeof(uint32_t));
+    TEST_ASSERT_EQUAL(MSG_RESULT_OKAY, msgResult);
+    *(uint32_t*)(message + 1) = 0x12345678;
+
+    result = mb_publish(message, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(1, mb_test_loans_held());
+
+    MSG_Header *received = NULL;
+    result = mb_receive_loan(pipe, &received, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL_PTR(message, received);
+    TEST_ASSERT_EQUAL(0x12345678, *(uint32_t*)(received + 1));
+
+    result = mb_release(received);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(0, mb_test_loans_held());
+
+    // the buffer has no references left to release
+    result = mb_release(received);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_ARGUMENTS, result);
+}
+
+/**
+ * Test publishing a loaned message to two loan pipes and a copy pipe.
+ */
+TEST(FSW_MB, loan_publish_fan_out)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe loan_pipe1;
+    result = mb_create_loan_pipe(&loan_pipe1, FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MB_Pipe loan_pipe2;
+    result = mb_create_loan_pipe(&loan_pipe2, FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MB_Pipe copy_pipe;
+    result = mb_create_pipe(&copy_pipe, FSW_MB_TEST_NUM_MSGS, FSW_MB_TEST_MSG_SIZE);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(loan_pipe1, MSG_PACKETID_COMMAND));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(loan_pipe2, MSG_PACKETID_COMMAND));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(copy_pipe, MSG_PACKETID_COMMAND));
+
+    MSG_Header *message = NULL;
+    result = mb_loan(&message, sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    (void)msg_command_message(message, MSG_PACKETID_COMMAND, 0);
+
+    result = mb_publish(message, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(2, mb_test_references(message));
+
+    MSG_Header *received1 = NULL;
+    result = mb_receive_loan(loan_pipe1, &received1, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL_PTR(message, received1);
+
+    MSG_Header *received2 = NULL;
+    result = mb_receive_loan(loan_pipe2, &received2, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL_PTR(message, received2);
+
+    // the copy pipe cannot be received from without a copy
+    result = mb_receive_loan(copy_pipe, &received1, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_PIPE, result);
+
+    MSG_Header copy;
+    uint32_t msg_size = sizeof(copy);
+    result = mb_receive(copy_pipe, &copy, &msg_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(sizeof(MSG_Header), msg_size);
+    TEST_ASSERT_EQUAL_MEMORY(message, &copy, sizeof(copy));
+
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_release(received1));
+    TEST_ASSERT_EQUAL(1, mb_test_loans_held());
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_release(received2));
+    TEST_ASSERT_EQUAL(0, mb_test_loans_held());
+}
+
+/**
+ * Test sending a message with mb_send to a loan pipe, and receiving a copy
+ * of it with mb_receive.
+ */
+TEST(FSW_MB, send_receive_loan_pipe)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe pipe;
+    result = mb_create_loan_pipe(&pipe, FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    result = mb_register_packet(pipe, MSG_PACKETID_HEALTHANDSTATUS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MSG_Header header;
+    (void)msg_telemetry_message(&header, MSG_PACKETID_HEALTHANDSTATUS, 0);
+
+    result = mb_send(&header, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(1, mb_test_loans_held());
+
+    MSG_Header recvHeader;
+    uint32_t msg_size = sizeof(recvHeader);
+    result = mb_receive(pipe, &recvHeader, &msg_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(sizeof(MSG_Header), msg_size);
+    TEST_ASSERT_EQUAL_MEMORY(&header, &recvHeader, sizeof(header));
+    TEST_ASSERT_EQUAL(0, mb_test_loans_held());
+}
+
+/**
+ * Test exhausting the loan pool, and loan arguments.
+ */
+TEST(FSW_MB, loan_exhausted)
+{
+    MB_RESULT_ENUM result;
+
+    MSG_Header *message = NULL;
+
+    result = mb_loan(NULL, sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL(MB_RESULT_NULL_POINTER, result);
+
+    result = mb_loan(&message, MB_LOAN_BUFFER_SIZE_BYTES + 1);
+    TEST_ASSERT_EQUAL(MB_RESULT_MSG_TOO_LARGE, result);
+
+    for (uint32_t index = 0; index < MB_NUM_LOAN_BUFFERS; index++)
+    {
+        result = mb_loan(&message, sizeof(MSG_Header));
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    }
+
+    result = mb_loan(&message, sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL(MB_RESULT_NO_BUFFERS, result);
+    TEST_ASSERT_EQUAL(1, os_counters_sum(&gvMB_state.counters, MB_COUNTER_LOAN_ERRORS));
+
+    // a message outside of the loan pool cannot be released
+    MSG_Header header;
+    result = mb_release(&header);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_ARGUMENTS, result);
+
+    result = mb_release(message);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    result = mb_loan(&message, sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+}
+/**
+ * Test sending a batch of messages to a copy pipe and a loan pipe, and
+ * receiving them as a batch.
+ */
+TEST(FSW_MB, send_receive_batch)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe copy_pipe;
+    result = mb_create_pipe(&copy_pipe, FSW_MB_TEST_NUM_MSGS, FSW_MB_TEST_MSG_SIZE);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MB_Pipe loan_pipe;
+    result = mb_create_loan_pipe(&loan_pipe, FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(copy_pipe, MSG_PACKETID_COMMAND));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(copy_pipe, MSG_PACKETID_HEALTHANDSTATUS));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(loan_pipe, MSG_PACKETID_COMMAND));
+
+    MSG_Header headers[3];
+    (void)msg_command_message(&headers[0], MSG_PACKETID_COMMAND, 0);
+    (void)msg_telemetry_message(&headers[1], MSG_PACKETID_HEALTHANDSTATUS, 0);
+    (void)msg_command_message(&headers[2], MSG_PACKETID_COMMAND, 0);
+
+    MSG_Header *messages[3] = { &headers[0], &headers[1], &headers[2] };
+
+    result = mb_send_batch(messages, 3, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    MSG_Header received[FSW_MB_TEST_NUM_MSGS];
+    uint32_t msg_sizes[FSW_MB_TEST_NUM_MSGS];
+    uint32_t num_msgs = 0;
+
+    result = mb_receive_batch(copy_pipe,
+                              (uint8_t*)received,
+                              sizeof(MSG_Header),
+                              FSW_MB_TEST_NUM_MSGS,
+                              msg_sizes,
+                              &num_msgs,
+                              OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(3, num_msgs);
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        TEST_ASSERT_EQUAL(sizeof(MSG_Header), msg_sizes[index]);
+        TEST_ASSERT_EQUAL_MEMORY(&headers[index], &received[index], sizeof(MSG_Header));
+    }
+
+    // the loan pipe only receives the commands, and gives back their buffers
+    TEST_ASSERT_EQUAL(2, mb_test_loans_held());
+
+    result = mb_receive_batch(loan_pipe,
+                              (uint8_t*)received,
+                              sizeof(MSG_Header),
+                              FSW_MB_TEST_NUM_MSGS,
+                              msg_sizes,
+                              &num_msgs,
+                              OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(2, num_msgs);
+    TEST_ASSERT_EQUAL_MEMORY(&headers[0], &received[0], sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL_MEMORY(&headers[2], &received[1], sizeof(MSG_Header));
+    TEST_ASSERT_EQUAL(0, mb_test_loans_held());
+    TEST_ASSERT_EQUAL(5, os_counters_sum(&gvMB_state.counters, MB_COUNTER_MESSAGES_RECEIVED));
+
+    result = mb_receive_batch(copy_pipe,
+                              (uint8_t*)received,
+                              sizeof(MSG_Header),
+                              FSW_MB_TEST_NUM_MSGS,
+                              msg_sizes,
+                              &num_msgs,
+                              OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_TIMEOUT, result);
+    TEST_ASSERT_EQUAL(0, num_msgs);
+
+    result = mb_send_batch(messages, MB_MAX_BATCH_MSGS + 1, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_ARGUMENTS, result);
+}
+
+/**
+ * Test that a command sent at a high priority is received ahead of
+ * a backlog of telemetry, on both copy and loan pipes.
+ */
+TEST(FSW_MB, send_receive_priority)
+{
+    MB_RESULT_ENUM result;
+
+    MB_Pipe pipes[2];
+    result = mb_create_pipe(&pipes[0], FSW_MB_TEST_NUM_MSGS, FSW_MB_TEST_MSG_SIZE);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    result = mb_create_loan_pipe(&pipes[1], FSW_MB_TEST_NUM_MSGS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    for (uint32_t index = 0; index < 2; index++)
+    {
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(pipes[index], MSG_PACKETID_COMMAND));
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_register_packet(pipes[index], MSG_PACKETID_HEALTHANDSTATUS));
+    }
+
+    MSG_Header telemetry;
+    (void)msg_telemetry_message(&telemetry, MSG_PACKETID_HEALTHANDSTATUS, 0);
+
+    MSG_Header command;
+    (void)msg_command_message(&command, MSG_PACKETID_COMMAND, 0);
+
+    result = mb_send_priority(&command, MB_PRIORITY_NUM_PRIORITIES, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_INVALID_ARGUMENTS, result);
+
+    // a telemetry backlog, followed by a command
+    for (uint32_t index = 0; index < FSW_MB_TEST_NUM_MSGS - 1; index++)
+    {
+        result = mb_send_priority(&telemetry, MB_PRIORITY_LOW, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+    }
+
+    result = mb_send_priority(&command, MB_PRIORITY_CRITICAL, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+
+    for (uint32_t index = 0; index < 2; index++)
+    {
+        MSG_Header received;
+        uint32_t msg_size = sizeof(received);
+        MB_PRIORITY_ENUM priority = MB_PRIORITY_NORMAL;
+
+        result = mb_receive_priority(pipes[index], &received, &msg_size, &priority, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+        TEST_ASSERT_EQUAL(MSG_PACKETID_COMMAND, received.packet_id);
+        TEST_ASSERT_EQUAL(MB_PRIORITY_CRITICAL, priority);
+
+        for (uint32_t backlog = 0; backlog < FSW_MB_TEST_NUM_MSGS - 1; backlog++)
+        {
+            msg_size = sizeof(received);
+            result = mb_receive_priority(pipes[index], &received, &msg_size, &priority, OS_TIMEOUT_NO_WAIT);
+            TEST_ASSERT_EQUAL(MB_RESULT_OKAY, result);
+            TEST_ASSERT_EQUAL(MSG_PACKETID_HEALTHANDSTATUS, received.packet_id);
+            TEST_ASSERT_EQUAL(MB_PRIORITY_LOW, priority);
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, mb_test_loans_held());
+}
+
 TEST_GROUP_RUNNER(FSW_MB)
 {
     RUN_TEST_CASE(FSW_MB, create_pipe_null);
@@ -244,8 +633,15 @@ TEST_GROUP_RUNNER(FSW_MB)
     RUN_TEST_CASE(FSW_MB, register_packet_command);
     RUN_TEST_CASE(FSW_MB, register_packet_telemetry);
     RUN_TEST_CASE(FSW_MB, register_packet_null);
-    RUN_TEST_CASE(FSW_MB, register_over_max);
+    RUN_TEST_CASE(FSW_MB, register_out_of_range);
+    RUN_TEST_CASE(FSW_MB, register_all_pipes);
     RUN_TEST_CASE(FSW_MB, send_receive);
     RUN_TEST_CASE(FSW_MB, send_receive_two_pipes);
+    RUN_TEST_CASE(FSW_MB, loan_publish_receive);
+    RUN_TEST_CASE(FSW_MB, loan_publish_fan_out);
+    RUN_TEST_CASE(FSW_MB, send_receive_loan_pipe);
+    RUN_TEST_CASE(FSW_MB, loan_exhausted);
+    RUN_TEST_CASE(FSW_MB, send_receive_batch);
+    RUN_TEST_CASE(FSW_MB, send_receive_priority);
 }
 
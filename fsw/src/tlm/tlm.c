@@ -4,11 +4,23 @@
  * @author Noah Ryan
  *
  * This file contains the implementation of the Telemetry module functions.
+ *
+ * Telemetry packets are built from a table of packet definitions, in
+ * tlm_packets.c. Each packet lists the status providers it is built from,
+ * and the telemetry task builds each packet only on the cycles it is due,
+ * so fast and slow packets share a single task.
+ *
+ * A packet may be delta encoded, in which case only the words that changed
+ * since it was last sent are sent, with a keyframe sent periodically.
  */
 #include "stddef.h"
+#include "stdint.h"
+#include "stdbool.h"
 #include "string.h"
 #include "stdio.h"
 
+#include "os_seqlock.h"
+
 #include "fsw_definitions.h"
 #include "fsw_tasks.h"
 #include "em.h"
@@ -22,23 +34,71 @@
 
 TLM_State gvTLM_state;
 
+/**
+ * The telemetry packet table, defined in tlm_packets.c.
+ */
+extern const TLM_PacketDefinition gvTLM_packet_table[];
+extern const uint32_t gvTLM_packet_table_size;
+
+
+/**
+ * @brief tlm_align
+ *
+ * This function rounds an offset up to a multiple of an alignment.
+ *
+ * @param[in] offset - the offset to align.
+ * @param[in] alignment - the alignment, which is a power of 2.
+ *
+ * @return The aligned offset.
+ */
+uint32_t tlm_align(uint32_t offset, uint32_t alignment);
+
+/**
+ * @brief tlm_send_packet
+ *
+ * This function builds a telemetry packet from its providers and sends it
+ * on the Message Bus.
+ *
+ * @param[in] packet - the packet to send.
+ *
+ * @return true if the packet was sent, or false otherwise.
+ */
+bool tlm_send_packet(TLM_Packet *packet);
+
 
 FSW_RESULT_ENUM tlm_initialize(void)
 {
     FSW_RESULT_ENUM result = FSW_RESULT_OKAY;
 
     memset(&gvTLM_state, 0, sizeof(gvTLM_state));
+    os_seqlock_init(&gvTLM_state.status_lock);
+
+    for (uint32_t packet_index = 0; packet_index < gvTLM_packet_table_size; packet_index++)
+    {
+        TLM_RESULT_ENUM tlm_result = tlm_register_packet(&gvTLM_packet_table[packet_index]);
 
+        if (tlm_result != TLM_RESULT_OKAY)
+        {
+            result = FSW_RESULT_TLM_PACKET_ERROR;
+        }
+    }
+
+    // the task runs once per collection cycle
     TM_RESULT_ENUM tm_result =
         tm_periodic_task(FSW_TASK_NAME_TLM,
                          FSW_TASK_ID_TLM,
                          tlm_telemetry_task,
                          FSW_TASK_NO_ARGUMENT,
-                         FSW_TASK_RATE_1_HZ,
+                         FSW_TASK_RATE_1_HZ / TLM_CYCLES_PER_SECOND,
                          FSW_HEARBEAT_RATE_1_HZ,
                          FSW_DEFAULT_STACK_SIZE,
                          FSW_PRIORITY_TLM_TASK);
 
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        tm_result = tm_task_affinity(FSW_TASK_ID_TLM, FSW_CPUS_TLM_TASK);
+    }
+
     if (tm_result != TM_RESULT_OKAY)
     {
         result = FSW_RESULT_TASK_REGISTRATION_ERROR;
@@ -51,47 +111,242 @@ void tlm_get_status(TLM_Status *status)
 {
     if (status != NULL)
     {
-        *status = gvTLM_state.status;
+        os_seqlock_read(&gvTLM_state.status_lock,
+                        status,
+                        &gvTLM_state.status,
+                        sizeof(*status));
     }
 }
 
-void tlm_telemetry_task(void *argument)
+uint32_t tlm_align(uint32_t offset, uint32_t alignment)
 {
-    (void)argument;
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
 
-    TLM_HealthAndStatusMessage telemetry = {0};
+TLM_RESULT_ENUM tlm_register_packet(const TLM_PacketDefinition *definition)
+{
+    TLM_RESULT_ENUM result = TLM_RESULT_OKAY;
+
+    TLM_Packet *packet = NULL;
 
-    while (tm_running(FSW_TASK_ID_TELEMETRY))
+    if ((definition == NULL) ||
+        (definition->packet_id == MSG_PACKETID_INVALID) ||
+        (definition->packet_id >= MSG_PACKETID_NUM_PACKET_IDS) ||
+        (definition->period == 0) ||
+        (definition->phase >= definition->period) ||
+        (definition->num_providers == 0) ||
+        (definition->num_providers > TLM_MAX_PACKET_PROVIDERS))
+    {
+        result = TLM_RESULT_INVALID_ARGUMENTS;
+    }
+    else if ((definition->encoding >= TLM_ENCODING_NUM_ENCODINGS) ||
+             ((definition->encoding == TLM_ENCODING_DELTA) && (definition->keyframe_period == 0)))
+    {
+        result = TLM_RESULT_INVALID_ARGUMENTS;
+    }
+    else if (gvTLM_state.num_packets >= TLM_MAX_PACKETS)
     {
-        tlm_get_status(&telemetry.telemetry.tlm);
-        mb_get_status(&telemetry.telemetry.mb);
-        em_get_status(&telemetry.telemetry.em);
-        tm_get_status(&telemetry.telemetry.tm);
+        result = TLM_RESULT_PACKETS_FULL;
+    }
 
-        // return value not checked because the message cannot be null.
-        (void)msg_telemetry_message((MSG_Header*)&telemetry,
-                                    MSG_PACKETTYPE_TELEMETRY,
-                                    sizeof(TLM_HealthAndStatusMessage));
+    if (result == TLM_RESULT_OKAY)
+    {
+        packet = &gvTLM_state.packets[gvTLM_state.num_packets];
 
-        MB_RESULT_ENUM mb_result = mb_send(&telemetry.header, OS_TIMEOUT_NO_WAIT);
+        uint32_t packet_alignment = _Alignof(MSG_Header);
 
-        if (mb_result == MB_RESULT_OKAY)
+        for (uint32_t provider_index = 0; provider_index < definition->num_providers; provider_index++)
         {
-            gvTLM_state.status.telemetry_sent++;
+            const TLM_Provider *provider = &definition->providers[provider_index];
+
+            if ((provider->function == NULL) ||
+                (provider->size_bytes == 0) ||
+                (provider->alignment == 0) ||
+                ((provider->alignment & (provider->alignment - 1)) != 0))
+            {
+                result = TLM_RESULT_INVALID_ARGUMENTS;
+            }
+            else if (provider->alignment > packet_alignment)
+            {
+                packet_alignment = provider->alignment;
+            }
         }
-        else
+
+        // the data follows the header as a struct of the providers' status
+        // would, and each status is placed where a member of its type would be.
+        uint32_t offset = tlm_align(sizeof(MSG_Header), packet_alignment);
+
+        for (uint32_t provider_index = 0;
+             (provider_index < definition->num_providers) && (result == TLM_RESULT_OKAY);
+             provider_index++)
+        {
+            const TLM_Provider *provider = &definition->providers[provider_index];
+
+            offset = tlm_align(offset, provider->alignment);
+            packet->offsets[provider_index] = offset;
+            offset += provider->size_bytes;
+        }
+
+        packet->size_bytes = tlm_align(offset, packet_alignment);
+
+        // a delta encoded keyframe is the packet's data after a delta header
+        uint32_t max_size_bytes = TLM_MAX_PACKET_SIZE_BYTES;
+        if (definition->encoding == TLM_ENCODING_DELTA)
+        {
+            max_size_bytes -= sizeof(TLM_DeltaHeader);
+        }
+
+        if ((result == TLM_RESULT_OKAY) && (packet->size_bytes > max_size_bytes))
+        {
+            result = TLM_RESULT_PACKET_TOO_LARGE;
+        }
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        packet->definition = *definition;
+        memset(&packet->delta, 0, sizeof(packet->delta));
+        gvTLM_state.num_packets++;
+    }
+
+    return result;
+}
+
+bool tlm_send_packet(TLM_Packet *packet)
+{
+    // the buffer is aligned for any status type
+    union
+    {
+        MSG_Header header;
+        max_align_t alignment;
+        uint8_t bytes[TLM_MAX_PACKET_SIZE_BYTES];
+    } buffer;
+
+    // the padding between each status is zeroed, so the packet's contents
+    // only depend on its status.
+    // the return of memset is the source pointer, which cannot be NULL.
+    (void)memset(buffer.bytes, 0, packet->size_bytes);
+
+    for (uint32_t provider_index = 0; provider_index < packet->definition.num_providers; provider_index++)
+    {
+        packet->definition.providers[provider_index].function(
+            &buffer.bytes[packet->offsets[provider_index]]);
+    }
+
+    // return value not checked because the message cannot be null.
+    // The message length is the size of the data after the header.
+    (void)msg_telemetry_message(&buffer.header,
+                                packet->definition.packet_id,
+                                packet->size_bytes - sizeof(MSG_Header));
+
+    MSG_Header *message = &buffer.header;
+
+    union
+    {
+        MSG_Header header;
+        uint8_t bytes[TLM_MAX_PACKET_SIZE_BYTES];
+    } delta;
+
+    bool encoded = true;
+
+    if (packet->definition.encoding == TLM_ENCODING_DELTA)
+    {
+        TLM_RESULT_ENUM tlm_result =
+            tlm_delta_encode(&packet->delta,
+                             packet->definition.keyframe_period,
+                             &buffer.header,
+                             &delta.header,
+                             sizeof(delta));
+
+        message = &delta.header;
+        encoded = tlm_result == TLM_RESULT_OKAY;
+    }
+
+    MB_RESULT_ENUM mb_result = MB_RESULT_INVALID;
+
+    if (encoded)
+    {
+        // telemetry is bulk data, so it gives way to other messages on a pipe
+        mb_result = mb_send_priority(message, MB_PRIORITY_LOW, OS_TIMEOUT_NO_WAIT);
+    }
+
+    // a delta that was not sent can not be applied by the receiver, so the
+    // next packet is sent as a keyframe.
+    if (mb_result != MB_RESULT_OKAY)
+    {
+        packet->delta.valid = false;
+    }
+
+    return mb_result == MB_RESULT_OKAY;
+}
+
+uint32_t tlm_collect(void)
+{
+    uint32_t num_sent = 0;
+
+    uint32_t cycle = gvTLM_state.cycle;
+    gvTLM_state.cycle++;
+
+    for (uint32_t packet_index = 0; packet_index < gvTLM_state.num_packets; packet_index++)
+    {
+        TLM_Packet *packet = &gvTLM_state.packets[packet_index];
+
+        // packets that are not due this cycle are not built
+        if ((cycle % packet->definition.period) == packet->definition.phase)
         {
-            gvTLM_state.status.telemetry_errors++;
-            em_event(FSW_MODULEID_TLM,
-                     TLM_EVENT_ID_TLM_ERROR,
-                     __LINE__,
-                     0, 0, 0, 0, 0);
+            if (tlm_send_packet(packet))
+            {
+                os_seqlock_write_begin(&gvTLM_state.status_lock);
+                gvTLM_state.status.telemetry_sent++;
+                os_seqlock_write_end(&gvTLM_state.status_lock);
+
+                num_sent++;
+            }
+            else
+            {
+                os_seqlock_write_begin(&gvTLM_state.status_lock);
+                gvTLM_state.status.telemetry_errors++;
+                os_seqlock_write_end(&gvTLM_state.status_lock);
+                em_event(FSW_MODULEID_TLM,
+                         TLM_EVENT_ID_TLM_ERROR,
+                         __LINE__,
+                         packet->definition.packet_id, 0, 0, 0, 0);
+            }
         }
+    }
 
-        // zero out the telemetry structure so it is ready for the next
-        // set of telemetry definitions.
-        // the return of memset is the source pointer, which cannot be NULL.
-        (void)memset(&telemetry.telemetry, 0, sizeof(telemetry.telemetry));
+    return num_sent;
+}
+
+void tlm_telemetry_task(void *argument)
+{
+    (void)argument;
+
+    while (tm_running(FSW_TASK_ID_TLM))
+    {
+        (void)tlm_collect();
     }
 }
 
+void tlm_get_task_timing(TLM_TaskTimingStatus *timing)
+{
+    if (timing != NULL)
+    {
+        TM_RESULT_ENUM tm_result = TM_RESULT_INVALID;
+
+        timing->task_id = TLM_TIMING_NO_TASK;
+
+        // check each task id once, starting after the last one reported
+        for (int checked = 0; (checked < TM_MAX_TASKS) && (tm_result != TM_RESULT_OKAY); checked++)
+        {
+            gvTLM_state.timing_task_id = (gvTLM_state.timing_task_id + 1) % TM_MAX_TASKS;
+
+            tm_result = tm_get_task_timing(gvTLM_state.timing_task_id,
+                                           &timing->timing);
+            if (tm_result == TM_RESULT_OKAY)
+            {
+                timing->task_id = gvTLM_state.timing_task_id;
+            }
+        }
+    }
+}
@@ -0,0 +1,289 @@
+/**
+ * @file tlm_delta.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the delta encoder and decoder for telemetry packets.
+ *
+ * A delta encoded packet carries only the 32 bit words of a packet's data
+ * that changed since the last packet, with a bitmap marking which words
+ * they are. Every so often a keyframe carries the whole packet, so a
+ * receiver that missed a packet can start decoding again. The decoder is
+ * used by whatever receives the packets, and needs only the packets.
+ */
+#include "stddef.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "string.h"
+
+#include "fsw_definitions.h"
+#include "msg.h"
+
+#include "tlm_definitions.h"
+#include "tlm.h"
+
+
+/**
+ * @brief tlm_delta_num_words
+ *
+ * This function provides the number of 32 bit words holding a packet's data.
+ *
+ * @param[in] length - the length of the packet's data.
+ *
+ * @return The number of words, with the last word padded with zeros.
+ */
+uint32_t tlm_delta_num_words(uint32_t length);
+
+
+uint32_t tlm_delta_num_words(uint32_t length)
+{
+    return (length + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+TLM_RESULT_ENUM tlm_delta_encode(TLM_DeltaState *state,
+                                 uint32_t keyframe_period,
+                                 const MSG_Header *packet,
+                                 MSG_Header *delta,
+                                 uint32_t delta_size_bytes)
+{
+    TLM_RESULT_ENUM result = TLM_RESULT_OKAY;
+
+    uint32_t words[TLM_DELTA_MAX_WORDS] = {0};
+    uint32_t bitmap[TLM_DELTA_BITMAP_WORDS] = {0};
+    uint32_t num_words = 0;
+    uint32_t num_changed = 0;
+    bool keyframe = false;
+
+    if ((state == NULL) || (packet == NULL) || (delta == NULL))
+    {
+        result = TLM_RESULT_NULL_POINTER;
+    }
+    else if (tlm_delta_num_words(packet->length) > TLM_DELTA_MAX_WORDS)
+    {
+        result = TLM_RESULT_PACKET_TOO_LARGE;
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        num_words = tlm_delta_num_words(packet->length);
+
+        // the packet's data is copied into words, as the data after the
+        // header may not be aligned for 32 bit reads.
+        memcpy(words, (const uint8_t*)packet + sizeof(MSG_Header), packet->length);
+
+        // a keyframe is sent if the receiver has nothing to apply a delta to
+        keyframe = !state->valid ||
+                   (state->length != packet->length) ||
+                   ((state->since_keyframe + 1) >= keyframe_period);
+
+        if (!keyframe)
+        {
+            for (uint32_t word_index = 0; word_index < num_words; word_index++)
+            {
+                if (words[word_index] != state->words[word_index])
+                {
+                    bitmap[word_index / 32] |= 1U << (word_index % 32);
+                    num_changed++;
+                }
+            }
+
+            // a delta with most words changed is no smaller than a keyframe
+            uint32_t bitmap_words = (num_words + 31) / 32;
+            if ((bitmap_words + num_changed) >= num_words)
+            {
+                keyframe = true;
+            }
+        }
+
+        if (keyframe)
+        {
+            num_changed = num_words;
+        }
+    }
+
+    uint32_t bitmap_size = 0;
+    uint32_t size_bytes = 0;
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        if (!keyframe)
+        {
+            bitmap_size = ((num_words + 31) / 32) * sizeof(uint32_t);
+        }
+
+        size_bytes = sizeof(MSG_Header) + sizeof(TLM_DeltaHeader) +
+                     bitmap_size + (num_changed * sizeof(uint32_t));
+
+        if (size_bytes > delta_size_bytes)
+        {
+            result = TLM_RESULT_PACKET_TOO_LARGE;
+        }
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        TLM_DeltaHeader header;
+        header.packet_id = packet->packet_id;
+        header.flags = keyframe ? TLM_DELTA_FLAG_KEYFRAME : 0;
+        header.sequence = state->sequence;
+        header.length = packet->length;
+        header.num_changed = (uint16_t)num_changed;
+
+        uint8_t *data = (uint8_t*)delta + sizeof(MSG_Header);
+
+        memcpy(data, &header, sizeof(header));
+        data += sizeof(header);
+
+        memcpy(data, bitmap, bitmap_size);
+        data += bitmap_size;
+
+        for (uint32_t word_index = 0; word_index < num_words; word_index++)
+        {
+            if (keyframe || ((bitmap[word_index / 32] & (1U << (word_index % 32))) != 0))
+            {
+                memcpy(data, &words[word_index], sizeof(uint32_t));
+                data += sizeof(uint32_t);
+            }
+        }
+
+        // return value not checked because the message cannot be null.
+        (void)msg_telemetry_message(delta, MSG_PACKETID_DELTA, size_bytes - sizeof(MSG_Header));
+
+        // the next delta is relative to this packet
+        memcpy(state->words, words, sizeof(state->words));
+        state->length = packet->length;
+        state->sequence++;
+        state->valid = true;
+
+        if (keyframe)
+        {
+            state->since_keyframe = 0;
+        }
+        else
+        {
+            state->since_keyframe++;
+        }
+    }
+
+    return result;
+}
+
+void tlm_delta_decoder_init(TLM_DeltaDecoder *decoder)
+{
+    if (decoder != NULL)
+    {
+        memset(decoder, 0, sizeof(*decoder));
+    }
+}
+
+TLM_RESULT_ENUM tlm_delta_decode(TLM_DeltaDecoder *decoder,
+                                 const MSG_Header *delta,
+                                 MSG_Header *packet,
+                                 uint32_t packet_size_bytes)
+{
+    TLM_RESULT_ENUM result = TLM_RESULT_OKAY;
+
+    TLM_DeltaHeader header;
+    TLM_DeltaState *state = NULL;
+    uint32_t num_words = 0;
+    uint32_t bitmap[TLM_DELTA_BITMAP_WORDS] = {0};
+    uint32_t bitmap_size = 0;
+
+    const uint8_t *data = NULL;
+
+    if ((decoder == NULL) || (delta == NULL) || (packet == NULL))
+    {
+        result = TLM_RESULT_NULL_POINTER;
+    }
+    else if ((delta->packet_id != MSG_PACKETID_DELTA) ||
+             (delta->length < sizeof(TLM_DeltaHeader)))
+    {
+        result = TLM_RESULT_INVALID_PACKET;
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        data = (const uint8_t*)delta + sizeof(MSG_Header);
+
+        memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+
+        num_words = tlm_delta_num_words(header.length);
+
+        if ((header.flags & TLM_DELTA_FLAG_KEYFRAME) == 0)
+        {
+            bitmap_size = ((num_words + 31) / 32) * sizeof(uint32_t);
+        }
+
+        if ((header.packet_id == MSG_PACKETID_INVALID) ||
+            (header.packet_id >= MSG_PACKETID_NUM_PACKET_IDS) ||
+            (num_words > TLM_DELTA_MAX_WORDS) ||
+            (header.num_changed > num_words) ||
+            (delta->length != (sizeof(TLM_DeltaHeader) + bitmap_size +
+                               (header.num_changed * sizeof(uint32_t)))))
+        {
+            result = TLM_RESULT_INVALID_PACKET;
+        }
+        else if (packet_size_bytes < (sizeof(MSG_Header) + header.length))
+        {
+            result = TLM_RESULT_PACKET_TOO_LARGE;
+        }
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        state = &decoder->packets[header.packet_id];
+
+        if ((header.flags & TLM_DELTA_FLAG_KEYFRAME) != 0)
+        {
+            if (header.num_changed != num_words)
+            {
+                result = TLM_RESULT_INVALID_PACKET;
+            }
+            else
+            {
+                memcpy(state->words, data, num_words * sizeof(uint32_t));
+            }
+        }
+        else if (!state->valid ||
+                 (header.sequence != state->sequence) ||
+                 (header.length != state->length))
+        {
+            // a packet was lost, so nothing is decoded until the next keyframe
+            state->valid = false;
+            result = TLM_RESULT_NO_KEYFRAME;
+        }
+        else
+        {
+            memcpy(bitmap, data, bitmap_size);
+            data += bitmap_size;
+
+            uint32_t num_changed = 0;
+
+            for (uint32_t word_index = 0;
+                 (word_index < num_words) && (num_changed < header.num_changed);
+                 word_index++)
+            {
+                if ((bitmap[word_index / 32] & (1U << (word_index % 32))) != 0)
+                {
+                    memcpy(&state->words[word_index], data, sizeof(uint32_t));
+                    data += sizeof(uint32_t);
+                    num_changed++;
+                }
+            }
+        }
+    }
+
+    if (result == TLM_RESULT_OKAY)
+    {
+        state->length = header.length;
+        state->sequence = header.sequence + 1;
+        state->valid = true;
+
+        // return value not checked because the message cannot be null.
+        (void)msg_telemetry_message(packet, header.packet_id, header.length);
+        memcpy((uint8_t*)packet + sizeof(MSG_Header), state->words, header.length);
+    }
+
+    return result;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file tlm_packets.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the telemetry packet table, which defines the
+ * housekeeping packets sent by the Telemetry module. Each packet lists
+ * its status providers in order, its period and its packet id.
+ *
+ * A module's status is added to telemetry by adding its provider to a
+ * packet here, or by defining a new packet, without changing tlm.c.
+ */
+#include "stdint.h"
+
+#include "fsw_definitions.h"
+#include "msg_definitions.h"
+#include "em.h"
+#include "mb.h"
+#include "tm.h"
+
+#include "tlm_definitions.h"
+#include "tlm.h"
+
+
+TLM_PROVIDER_FUNCTION(tlm_get_status, TLM_Status)
+TLM_PROVIDER_FUNCTION(mb_get_status, MB_Status)
+TLM_PROVIDER_FUNCTION(em_get_status, EM_Status)
+TLM_PROVIDER_FUNCTION(tm_get_status, TM_Status)
+TLM_PROVIDER_FUNCTION(tm_get_cpu_usage, TM_CpuUsage)
+TLM_PROVIDER_FUNCTION(tlm_get_task_timing, TLM_TaskTimingStatus)
+
+const TLM_PacketDefinition gvTLM_packet_table[] =
+{
+    // the health and status packet, laid out as a TLM_HealthAndStatus.
+    // Setting its encoding to TLM_ENCODING_DELTA sends it as
+    // MSG_PACKETID_DELTA packets instead.
+    {
+        .packet_id = MSG_PACKETID_HEALTHANDSTATUS,
+        .period = TLM_PERIOD_1_HZ,
+        .phase = 0,
+        .encoding = TLM_ENCODING_FULL,
+        .keyframe_period = TLM_DELTA_DEFAULT_KEYFRAME_PERIOD,
+        .num_providers = 6,
+        .providers =
+        {
+            TLM_PROVIDER(tlm_get_status, TLM_Status),
+            TLM_PROVIDER(mb_get_status, MB_Status),
+            TLM_PROVIDER(em_get_status, EM_Status),
+            TLM_PROVIDER(tm_get_status, TM_Status),
+            TLM_PROVIDER(tm_get_cpu_usage, TM_CpuUsage),
+            TLM_PROVIDER(tlm_get_task_timing, TLM_TaskTimingStatus),
+        },
+    },
+};
+
+const uint32_t gvTLM_packet_table_size =
+    sizeof(gvTLM_packet_table) / sizeof(gvTLM_packet_table[0]);
@@ -0,0 +1,293 @@
+/**
+ * @file tlm_test.c
+ *
+ * @brief Telemetry Module Unit Tests
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the unit tests for the Telemetry module.
+ */
+#include "stddef.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "fsw_definitions.h"
+#include "mb_definitions.h"
+#include "mb.h"
+#include "msg.h"
+
+#include "tlm_definitions.h"
+#include "tlm.h"
+
+
+#define FSW_TLM_TEST_PERIOD 2
+#define FSW_TLM_TEST_PHASE 1
+#define FSW_TLM_TEST_NUM_CYCLES 4
+#define FSW_TLM_TEST_NUM_WORDS 64
+#define FSW_TLM_TEST_KEYFRAME_PERIOD 3
+
+/**
+ * This struct is a packet used to test delta encoding.
+ */
+typedef struct
+{
+    MSG_Header header;
+    uint32_t words[FSW_TLM_TEST_NUM_WORDS];
+} FSW_TLM_TestPacket;
+
+
+TLM_PROVIDER_FUNCTION(tlm_get_status, TLM_Status)
+
+TEST_GROUP(FSW_TLM);
+
+TEST_SETUP(FSW_TLM)
+{
+    // the result is not checked, as the telemetry task is not run by these tests
+    (void)tlm_initialize();
+}
+
+TEST_TEAR_DOWN(FSW_TLM)
+{
+}
+
+TEST(FSW_TLM, register_invalid)
+{
+    TLM_RESULT_ENUM tlm_result;
+
+    TLM_PacketDefinition definition =
+    {
+        .packet_id = MSG_PACKETID_COMMAND,
+        .period = FSW_TLM_TEST_PERIOD,
+        .phase = FSW_TLM_TEST_PERIOD,
+        .num_providers = 1,
+        .providers = { TLM_PROVIDER(tlm_get_status, TLM_Status) },
+    };
+
+    tlm_result = tlm_register_packet(NULL);
+    TEST_ASSERT_EQUAL(TLM_RESULT_INVALID_ARGUMENTS, tlm_result);
+
+    // the phase must be within the period
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_INVALID_ARGUMENTS, tlm_result);
+
+    definition.phase = 0;
+    definition.providers[0].alignment = 3;
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_INVALID_ARGUMENTS, tlm_result);
+
+    definition.providers[0].alignment = 1;
+    definition.providers[0].size_bytes = TLM_MAX_PACKET_SIZE_BYTES;
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_PACKET_TOO_LARGE, tlm_result);
+}
+
+TEST(FSW_TLM, health_and_status)
+{
+    MB_RESULT_ENUM mb_result;
+    MB_Pipe pipe;
+    mb_result = mb_create_pipe(&pipe, 2, sizeof(TLM_HealthAndStatusMessage));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    mb_result = mb_register_packet(pipe, MSG_PACKETID_HEALTHANDSTATUS);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    // the packet is sent once in its period
+    uint32_t num_sent = 0;
+    for (int cycle = 0; cycle < TLM_PERIOD_1_HZ; cycle++)
+    {
+        num_sent += tlm_collect();
+    }
+    TEST_ASSERT_EQUAL(1, num_sent);
+
+    // the packet built from the table has the layout of the packet struct
+    TLM_HealthAndStatusMessage telemetry;
+    uint32_t telemetry_size = sizeof(telemetry);
+    mb_result = mb_receive(pipe, &telemetry.header, &telemetry_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+    TEST_ASSERT_EQUAL(sizeof(TLM_HealthAndStatusMessage), telemetry_size);
+    TEST_ASSERT_EQUAL(MSG_PACKETID_HEALTHANDSTATUS, telemetry.header.packet_id);
+    TEST_ASSERT_EQUAL(0, telemetry.telemetry.tlm.telemetry_sent);
+
+    TLM_Status status;
+    tlm_get_status(&status);
+    TEST_ASSERT_EQUAL(1, status.telemetry_sent);
+}
+
+TEST(FSW_TLM, packet_rate)
+{
+    TLM_RESULT_ENUM tlm_result;
+    MB_RESULT_ENUM mb_result;
+    MB_Pipe pipe;
+    mb_result = mb_create_pipe(&pipe, FSW_TLM_TEST_NUM_CYCLES, sizeof(MSG_Header) + sizeof(TLM_Status));
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    mb_result = mb_register_packet(pipe, MSG_PACKETID_COMMAND);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    TLM_PacketDefinition definition =
+    {
+        .packet_id = MSG_PACKETID_COMMAND,
+        .period = FSW_TLM_TEST_PERIOD,
+        .phase = FSW_TLM_TEST_PHASE,
+        .num_providers = 1,
+        .providers = { TLM_PROVIDER(tlm_get_status, TLM_Status) },
+    };
+
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+
+    for (int cycle = 0; cycle < FSW_TLM_TEST_NUM_CYCLES; cycle++)
+    {
+        (void)tlm_collect();
+    }
+
+    // the packet is only built on the cycles it is due
+    struct
+    {
+        MSG_Header header;
+        TLM_Status status;
+    } telemetry;
+    uint32_t telemetry_size;
+
+    for (int packet_index = 0; packet_index < FSW_TLM_TEST_NUM_CYCLES / FSW_TLM_TEST_PERIOD; packet_index++)
+    {
+        telemetry_size = sizeof(telemetry);
+        mb_result = mb_receive(pipe, &telemetry.header, &telemetry_size, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+        TEST_ASSERT_EQUAL(sizeof(telemetry), telemetry_size);
+    }
+
+    telemetry_size = sizeof(telemetry);
+    mb_result = mb_receive(pipe, &telemetry.header, &telemetry_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_TIMEOUT, mb_result);
+}
+
+TEST(FSW_TLM, delta_round_trip)
+{
+    TLM_RESULT_ENUM tlm_result;
+    TLM_DeltaState encoder = {0};
+    TLM_DeltaDecoder decoder;
+    FSW_TLM_TestPacket packet = {0};
+    FSW_TLM_TestPacket decoded;
+    uint8_t delta[TLM_MAX_PACKET_SIZE_BYTES];
+
+    tlm_delta_decoder_init(&decoder);
+    (void)msg_telemetry_message(&packet.header, MSG_PACKETID_HEALTHANDSTATUS, sizeof(packet.words));
+
+    // the first packet is a keyframe, with every word
+    packet.words[0] = 1;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL(MSG_PACKETID_DELTA, ((MSG_Header*)delta)->packet_id);
+    TEST_ASSERT_EQUAL(sizeof(TLM_DeltaHeader) + sizeof(packet.words), ((MSG_Header*)delta)->length);
+
+    tlm_result = tlm_delta_decode(&decoder, (MSG_Header*)delta, &decoded.header, sizeof(decoded));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL(MSG_PACKETID_HEALTHANDSTATUS, decoded.header.packet_id);
+    TEST_ASSERT_EQUAL_MEMORY(&packet, &decoded, sizeof(packet));
+
+    // a delta carries the bitmap and the changed word
+    packet.words[FSW_TLM_TEST_NUM_WORDS - 1] = 2;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL(sizeof(TLM_DeltaHeader) + (3 * sizeof(uint32_t)), ((MSG_Header*)delta)->length);
+
+    tlm_result = tlm_delta_decode(&decoder, (MSG_Header*)delta, &decoded.header, sizeof(decoded));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL_MEMORY(&packet, &decoded, sizeof(packet));
+
+    // the delta after a lost delta is not decoded, until the next keyframe
+    packet.words[1] = 3;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+
+    packet.words[2] = 4;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL(sizeof(TLM_DeltaHeader) + sizeof(packet.words), ((MSG_Header*)delta)->length);
+
+    tlm_result = tlm_delta_decode(&decoder, (MSG_Header*)delta, &decoded.header, sizeof(decoded));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL_MEMORY(&packet, &decoded, sizeof(packet));
+
+    packet.words[3] = 5;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+
+    packet.words[4] = 6;
+    tlm_result = tlm_delta_encode(&encoder, FSW_TLM_TEST_KEYFRAME_PERIOD, &packet.header,
+                                  (MSG_Header*)delta, sizeof(delta));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+
+    tlm_result = tlm_delta_decode(&decoder, (MSG_Header*)delta, &decoded.header, sizeof(decoded));
+    TEST_ASSERT_EQUAL(TLM_RESULT_NO_KEYFRAME, tlm_result);
+}
+
+TEST(FSW_TLM, delta_packet)
+{
+    TLM_RESULT_ENUM tlm_result;
+    MB_RESULT_ENUM mb_result;
+    MB_Pipe pipe;
+    mb_result = mb_create_pipe(&pipe, FSW_TLM_TEST_NUM_CYCLES, TLM_MAX_PACKET_SIZE_BYTES);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    mb_result = mb_register_packet(pipe, MSG_PACKETID_DELTA);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    TLM_PacketDefinition definition =
+    {
+        .packet_id = MSG_PACKETID_COMMAND,
+        .period = 1,
+        .phase = 0,
+        .encoding = TLM_ENCODING_DELTA,
+        .keyframe_period = 0,
+        .num_providers = 1,
+        .providers = { TLM_PROVIDER(tlm_get_status, TLM_Status) },
+    };
+
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_INVALID_ARGUMENTS, tlm_result);
+
+    definition.keyframe_period = FSW_TLM_TEST_KEYFRAME_PERIOD;
+    tlm_result = tlm_register_packet(&definition);
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+
+    (void)tlm_collect();
+
+    uint8_t delta[TLM_MAX_PACKET_SIZE_BYTES];
+    uint32_t delta_size = sizeof(delta);
+    mb_result = mb_receive(pipe, (MSG_Header*)delta, &delta_size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(MB_RESULT_OKAY, mb_result);
+
+    // the packet is sent encoded, and decodes to the packet's status
+    TLM_DeltaDecoder decoder;
+    tlm_delta_decoder_init(&decoder);
+
+    struct
+    {
+        MSG_Header header;
+        TLM_Status status;
+    } telemetry;
+
+    tlm_result = tlm_delta_decode(&decoder, (MSG_Header*)delta, &telemetry.header, sizeof(telemetry));
+    TEST_ASSERT_EQUAL(TLM_RESULT_OKAY, tlm_result);
+    TEST_ASSERT_EQUAL(MSG_PACKETID_COMMAND, telemetry.header.packet_id);
+    TEST_ASSERT_EQUAL(sizeof(TLM_Status), telemetry.header.length);
+}
+
+TEST_GROUP_RUNNER(FSW_TLM)
+{
+    RUN_TEST_CASE(FSW_TLM, register_invalid);
+    RUN_TEST_CASE(FSW_TLM, health_and_status);
+    RUN_TEST_CASE(FSW_TLM, packet_rate);
+    RUN_TEST_CASE(FSW_TLM, delta_round_trip);
+    RUN_TEST_CASE(FSW_TLM, delta_packet);
+}
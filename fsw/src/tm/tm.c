@@ -7,11 +7,14 @@
  */
 #include "stddef.h"
 #include "stdbool.h"
+#include "stdatomic.h"
 #include "string.h"
 #include "stdio.h"
 
 #include "os_task.h"
 #include "os_sem.h"
+#include "os_seqlock.h"
+#include "os_time.h"
 
 #include "fsw_tasks.h"
 
@@ -24,9 +27,9 @@ TM_State gvTM_state = {0};
 
 /**
  * This function updates a task's structure for a schedule slot tick.
- * It returns a value indicating whether the task is ready to be
- * scheduled, if it missed a heartbeat, or if the scheduler should
- * wait before acting on it.
+ * It returns a value indicating whether the task missed a heartbeat,
+ * or if the scheduler should wait before acting on it. Tasks are
+ * scheduled from the schedule table rather than by this function.
  *
  * @param[in,out] task - the task structure to update
  * 
@@ -61,6 +64,121 @@ void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id);
  */
 bool tm_schedule_callback(void *argument);
 
+/**
+ * @brief tm_register_task
+ *
+ * This function sets a task's type and adds it to the index of registered
+ * tasks, in the group for its type. A task that was already registered is
+ * moved to the group for its new type.
+ *
+ * @param[in] task_id - the id of the task, which must be in range.
+ * @param[in] type - the type of the task.
+ */
+void tm_register_task(TM_TaskId task_id, TM_TASKTYPE_ENUM type);
+
+/**
+ * @brief tm_compile_schedule
+ *
+ * This function compiles the schedule table from the registered periodic
+ * and callback tasks. The major frame is the least common multiple of their
+ * periods, and each task is listed in the slots it is released in.
+ * A task with a period of n slots is released in every nth slot.
+ *
+ * @param[out] schedule - the schedule table to fill out.
+ *
+ * @return TM_RESULT_OKAY, or TM_RESULT_SCHEDULE_ERROR if the schedule
+ * does not fit in the table.
+ */
+TM_RESULT_ENUM tm_compile_schedule(TM_Schedule *schedule);
+
+/**
+ * @brief tm_release_tasks
+ *
+ * This function releases the tasks listed in the schedule table for
+ * the current slot.
+ */
+void tm_release_tasks(void);
+
+/**
+ * @brief tm_start_slot
+ *
+ * This function records the scheduler's wakeup for a schedule slot. It
+ * measures how late the slot started, counts the slot as overrun if it
+ * started a full slot late, and advances the release time given to the
+ * tasks released in the slot.
+ */
+void tm_start_slot(void);
+
+/**
+ * @brief tm_skip_slots
+ *
+ * This function accounts for the slots the scheduler slept through before
+ * the slot it was woken for. Nothing is released in these slots and no task
+ * misses a heartbeat in them, so each task's ticks are simply advanced
+ * past them.
+ */
+void tm_skip_slots(void);
+
+/**
+ * @brief tm_next_wake_slots
+ *
+ * This function finds the next slot the scheduler must wake for. This is
+ * the next slot that releases a task, the next slot in which a task would
+ * miss its heartbeat, or the start of the next frame, whichever is first.
+ *
+ * @return the number of slots from the current slot to the next wakeup,
+ * which is at least 1.
+ */
+uint32_t tm_next_wake_slots(void);
+
+/**
+ * @brief tm_arm_wake
+ *
+ * This function arms the schedule timer to wake the scheduler at the
+ * start of a slot.
+ *
+ * @param[in] wake_release_ns - when the slot is due to start, in nanoseconds.
+ *
+ * @return the result of starting the schedule timer.
+ */
+OS_RESULT_ENUM tm_arm_wake(uint64_t wake_release_ns);
+
+/**
+ * @brief tm_high_rate_wait
+ *
+ * This function waits for a high rate task's next release. The task
+ * sleeps until shortly before the release, and busy-waits for the rest
+ * of the time if it was registered to. A task that is still running when
+ * a release is due is released at once, and the releases it missed are
+ * counted as overruns rather than run late.
+ *
+ * @param[in,out] task - the high rate task to wait for.
+ */
+void tm_high_rate_wait(TM_Task *task);
+
+/**
+ * @brief tm_shutdown_remaining
+ *
+ * This function provides the time left until a shutdown deadline, as a
+ * timeout for joining a task.
+ *
+ * @param[in] timeout - the timeout given to tm_shutdown.
+ * @param[in] deadline_ns - the shutdown deadline, in nanoseconds.
+ *
+ * @return the OS clock ticks until the deadline, OS_TIMEOUT_NO_WAIT if it
+ * has passed, or OS_TIMEOUT_WAIT_FOREVER if 'timeout' is.
+ */
+OS_Timeout tm_shutdown_remaining(OS_Timeout timeout, uint64_t deadline_ns);
+
+/**
+ * @brief tm_sample_cpu
+ *
+ * This function samples the CPU time of each spawned task and of the
+ * whole process, and updates the CPU usage with the utilization since the
+ * previous sample.
+ */
+void tm_sample_cpu(void);
+
 
 FSW_RESULT_ENUM tm_initialize(void)
 {
@@ -71,18 +189,29 @@ FSW_RESULT_ENUM tm_initialize(void)
 
 
     memset(&gvTM_state, 0, sizeof(gvTM_state));
+    os_seqlock_init(&gvTM_state.status_lock);
+    for (TM_TaskId task_id = 0; task_id < TM_MAX_TASKS; task_id++)
+    {
+        os_seqlock_init(&gvTM_state.tasks[task_id].timing_lock);
+    }
     gvTM_state.continue_running = true;
 
 
+    // the scheduler is woken by the schedule timer rather than released
+    // by itself, so it is an event task.
     tm_result =
-        tm_periodic_task(FSW_TASK_NAME_TM_SCHEDULER,
-                         FSW_TASK_ID_TM_SCHEDULER,
-                         tm_scheduler_task,
-                         NULL,
-                         TM_SCHEDULER_PERIOD,
-                         TM_SCHEDULER_PERIOD,
-                         FSW_DEFAULT_STACKS_SIZE,
-                         TM_SCHEDULER_PRIORITY);
+        tm_event_task(FSW_TASK_NAME_TM_SCHEDULER,
+                      FSW_TASK_ID_TM_SCHEDULER,
+                      tm_scheduler_task,
+                      NULL,
+                      TM_SCHEDULER_HEARTBEAT_PERIOD,
+                      FSW_DEFAULT_STACKS_SIZE,
+                      TM_SCHEDULER_PRIORITY);
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        tm_result = tm_task_affinity(FSW_TASK_ID_TM_SCHEDULER, FSW_CPUS_TM_SCHEDULER);
+    }
+
     if (tm_result != TM_RESULT_OKAY)
     {
         fsw_result = FSW_RESULT_TASK_REGISTRATION_ERROR;
@@ -121,34 +250,71 @@ bool tm_schedule_callback(void *argument)
 
 TM_RESULT_ENUM tm_start()
 {
-    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
     OS_RESULT_ENUM os_result = OS_RESULT_OKAY;
 
-    for (int task_id = 0; task_id < TM_MAX_TASKS; task_id++)
+    TM_RESULT_ENUM tm_result = tm_compile_schedule(&gvTM_state.schedule);
+
+    if (tm_result == TM_RESULT_OKAY)
     {
-        if ((gvTM_state.tasks[task_id].type == TM_TASKTYPE_PERIODIC) ||
-            (gvTM_state.tasks[task_id].type == TM_TASKTYPE_EVENT))
+        // periodic, high rate and event tasks are grouped together, and are
+        // spawned as OS tasks.
+        for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+             index < gvTM_state.type_starts[TM_TASKTYPE_EVENT + 1];
+             index++)
         {
+            TM_Task *task = &gvTM_state.tasks[gvTM_state.active_tasks[index]];
+
+            // a high rate task is first released one period after it is spawned
+            if (task->type == TM_TASKTYPE_HIGH_RATE)
+            {
+                atomic_store(&task->release_ns, os_timestamp_nanoseconds());
+            }
+
             os_result = 
-                os_task_spawn(&gvTM_state.tasks[task_id].os_task,
-                              gvTM_state.tasks[task_id].function,
-                              gvTM_state.tasks[task_id].argument,
-                              gvTM_state.tasks[task_id].priority,
-                              gvTM_state.tasks[task_id].stack_size);
+                os_task_spawn_affinity(&task->os_task,
+                                       task->function,
+                                       task->argument,
+                                       task->priority,
+                                       task->stack_size,
+                                       task->cpus);
             if (os_result != OS_RESULT_OKAY)
             {
                 tm_result = TM_RESULT_TASK_SPAWN_ERROR;
             }
         }
-    }
 
-    os_result = os_timer_start(&gvTM_state.schedule_timer,
-                               tm_schedule_callback,
-                               0,
-                               TM_SYSTEM_CLOCK_TICKS_PER_SLOT);
-    if (os_result != OS_RESULT_OKAY)
-    {
-        tm_result = TM_RESULT_TIMER_ERROR;
+        // the workers are only needed if a callback does not run inline
+        bool workers_needed = false;
+        for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_CALLBACK];
+             index < gvTM_state.type_starts[TM_TASKTYPE_CALLBACK + 1];
+             index++)
+        {
+            if (!gvTM_state.tasks[gvTM_state.active_tasks[index]].run_inline)
+            {
+                workers_needed = true;
+            }
+        }
+
+        if (workers_needed && (tm_workers_start() != TM_RESULT_OKAY))
+        {
+            tm_result = TM_RESULT_TASK_SPAWN_ERROR;
+        }
+
+        // slots are due at a fixed period from the start of the schedule
+        gvTM_state.schedule_start_ns = os_timestamp_nanoseconds();
+        gvTM_state.slot_release_ns = gvTM_state.schedule_start_ns;
+
+        // the first CPU sample measures from the start of the schedule
+        gvTM_state.cpu_sample_ns = gvTM_state.schedule_start_ns;
+        gvTM_state.process_cpu_ns = os_process_cpu_nanoseconds();
+
+        // the scheduler wakes for the first slot, and arms the timer for
+        // each slot it must wake for after that.
+        os_result = tm_arm_wake(gvTM_state.schedule_start_ns + TM_SLOT_NANOSECONDS);
+        if (os_result != OS_RESULT_OKAY)
+        {
+            tm_result = TM_RESULT_TIMER_ERROR;
+        }
     }
 
     return tm_result;
@@ -156,51 +322,241 @@ TM_RESULT_ENUM tm_start()
 
 bool tm_running(TM_TaskId task_id)
 {
-    if (gvTM_state.tasks[task_id].type == TM_TASKTYPE_PERIODIC)
+    TM_Task *task = &gvTM_state.tasks[task_id];
+
+    uint64_t now = os_timestamp_nanoseconds();
+
+    // the first call only marks the start of the task's first run
+    if (atomic_load(&task->executing))
     {
-        os_sem_take(&gvTM_state.tasks[task_id].semaphore, OS_TIMEOUT_WAIT_FOREVER);
+        os_seqlock_write_begin(&task->timing_lock);
+        tm_histogram_record(&task->timing.execution, now - task->start_ns);
+        os_seqlock_write_end(&task->timing_lock);
+    }
+
+    // a call to tm_running is an event or high rate task's heartbeat
+    if ((task->type == TM_TASKTYPE_EVENT) || (task->type == TM_TASKTYPE_HIGH_RATE))
+    {
+        atomic_store(&task->ticks, 0);
+    }
+
+    if ((task->type == TM_TASKTYPE_PERIODIC) || (task->type == TM_TASKTYPE_HIGH_RATE))
+    {
+        // the task is not running while blocked, so a release while it
+        // waits is not an overrun.
+        atomic_store(&task->executing, false);
+
+        if (task->type == TM_TASKTYPE_PERIODIC)
+        {
+            os_sem_take(&task->semaphore, OS_TIMEOUT_WAIT_FOREVER);
+        }
+        else
+        {
+            tm_high_rate_wait(task);
+        }
+
+        now = os_timestamp_nanoseconds();
+
+        uint64_t release_ns = atomic_load(&task->release_ns);
+
+        os_seqlock_write_begin(&task->timing_lock);
+        if (now > release_ns)
+        {
+            tm_histogram_record(&task->timing.jitter, now - release_ns);
+        }
+        else
+        {
+            tm_histogram_record(&task->timing.jitter, 0);
+        }
+        os_seqlock_write_end(&task->timing_lock);
     }
 
+    task->start_ns = now;
+    atomic_store(&task->executing, true);
+
     return gvTM_state.continue_running;
 }
 
+void tm_high_rate_wait(TM_Task *task)
+{
+    uint64_t release_ns = atomic_load(&task->release_ns) + task->period_ns;
+
+    uint64_t now = os_timestamp_nanoseconds();
+
+    if (now > release_ns)
+    {
+        // the releases that were missed are not run late- the task is
+        // released at the most recent release that was due.
+        uint64_t missed = (now - release_ns) / task->period_ns;
+
+        os_seqlock_write_begin(&task->timing_lock);
+        task->timing.overruns += (uint32_t)missed + 1;
+        os_seqlock_write_end(&task->timing_lock);
+
+        release_ns += missed * task->period_ns;
+    }
+    else
+    {
+        // The return value is not checked- a sleep that ends early is
+        // finished by the busy-wait below.
+        (void)os_task_delay_until(release_ns - task->spin_ns);
+    }
+
+    atomic_store(&task->release_ns, release_ns);
+
+    while (os_timestamp_nanoseconds() < release_ns)
+    {
+    }
+}
+
 void tm_stop(void)
 {
     gvTM_state.continue_running = false;
 }
 
+OS_Timeout tm_shutdown_remaining(OS_Timeout timeout, uint64_t deadline_ns)
+{
+    OS_Timeout remaining = OS_TIMEOUT_WAIT_FOREVER;
+
+    if (timeout != OS_TIMEOUT_WAIT_FOREVER)
+    {
+        uint64_t now = os_timestamp_nanoseconds();
+
+        remaining = OS_TIMEOUT_NO_WAIT;
+        if (deadline_ns > now)
+        {
+            // rounded up, so a task is never given less than the deadline
+            remaining = (OS_Timeout)
+                ((deadline_ns - now + OS_CONFIG_CLOCK_TICK_NANOSECONDS - 1) /
+                 OS_CONFIG_CLOCK_TICK_NANOSECONDS);
+        }
+    }
+
+    return remaining;
+}
+
+TM_RESULT_ENUM tm_shutdown(OS_Timeout timeout)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    // the timeout is shared by all tasks, so it is kept as a deadline
+    uint64_t deadline_ns =
+        os_timestamp_nanoseconds() + ((uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS);
+
+    tm_stop();
+
+    // The return values are not checked- the system is shutting down, and a
+    // task that is not woken is reported when it is not joined.
+    (void)os_timer_stop(&gvTM_state.schedule_timer);
+
+    // the scheduler unblocks the periodic tasks once it sees the stop
+    (void)os_sem_give(&gvTM_state.schedule_semaphore);
+
+    for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+         index < gvTM_state.type_starts[TM_TASKTYPE_EVENT + 1];
+         index++)
+    {
+        TM_Task *task = &gvTM_state.tasks[gvTM_state.active_tasks[index]];
+
+        if (task->os_task != NULL)
+        {
+            OS_RESULT_ENUM os_result =
+                os_task_join(&task->os_task, tm_shutdown_remaining(timeout, deadline_ns));
+            if (os_result != OS_RESULT_OKAY)
+            {
+                tm_result = TM_RESULT_SHUTDOWN_TIMEOUT;
+            }
+        }
+    }
+
+    // a worker finishes the callback it is running before it sees the stop
+    bool workers_joined = true;
+    for (uint32_t index = 0; index < gvTM_state.num_workers; index++)
+    {
+        TM_Worker *worker = &gvTM_state.workers[index];
+
+        if (worker->os_task != NULL)
+        {
+            (void)os_sem_give(&worker->wake);
+
+            OS_RESULT_ENUM os_result =
+                os_task_join(&worker->os_task, tm_shutdown_remaining(timeout, deadline_ns));
+            if (os_result != OS_RESULT_OKAY)
+            {
+                tm_result = TM_RESULT_SHUTDOWN_TIMEOUT;
+                workers_joined = false;
+            }
+        }
+    }
+
+    // callbacks run inline once there are no workers to run them
+    if (workers_joined)
+    {
+        gvTM_state.num_workers = 0;
+    }
+
+    return tm_result;
+}
+
 void tm_scheduler_task(void *argument)
 {
     (void)argument;
 
-    while (gvTM_state.continue_running)
+    while (tm_running(FSW_TASK_ID_TM_SCHEDULER))
     {
         OS_RESULT_ENUM os_result =
             os_sem_take(&gvTM_state.schedule_semaphore, OS_TIMEOUT_WAIT_FOREVER);
 
-        if (os_result == OS_RESULT_OKAY)
+        // a wakeup before the slot is due is not from the schedule timer,
+        // such as when the schedule is being shut down.
+        if ((os_result == OS_RESULT_OKAY) &&
+            (os_timestamp_nanoseconds() >= gvTM_state.wake_release_ns))
         {
-            for (int task_id = 0; task_id < TM_MAX_TASKS; task_id++)
+            tm_skip_slots();
+
+            tm_start_slot();
+
+            tm_release_tasks();
+
+            // check the status and heartbeat of every registered task
+            for (uint16_t index = 0; index < gvTM_state.num_tasks; index++)
             {
-                // NOTE that the os specific task checking is missing
-                // from this function
-                OS_TASK_STATUS_ENUM task_status = 
-                    os_task_status(&gvTM_state.tasks[task_id].os_task);
-                if (task_status == OS_TASK_STATUS_OKAY)
+                TM_TaskId task_id = gvTM_state.active_tasks[index];
+                TM_Task *task = &gvTM_state.tasks[task_id];
+
+                // only periodic, high rate and event tasks have an OS task to check
+                OS_TASK_STATUS_ENUM task_status = OS_TASK_STATUS_OKAY;
+                if (task->os_task != NULL)
+                {
+                    task_status = os_task_status(&task->os_task);
+                }
+
+                if ((task_status == OS_TASK_STATUS_OKAY) ||
+                    (task_status == OS_TASK_STATUS_TASK_BLOCKED))
                 {
-                    TM_TASKSTATUS_ENUM status =
-                        tm_update_task(&gvTM_state.tasks[task_id]);
+                    TM_TASKSTATUS_ENUM status = tm_update_task(task);
 
                     tm_process_task(status, task_id);
                 }
                 else
                 {
-                    // NOTE treat this like a missed heartbeat-
-                    // task is in a bad state
+                    // a task that has exited can no longer provide a heartbeat
+                    tm_process_task(TM_TASKSTATUS_MISSED_HEARTBEAT, task_id);
                 }
             }
+
+            // CPU usage is measured over each frame
+            if ((gvTM_state.slot_number % TM_SLOTS_PER_FRAME) == 0)
+            {
+                tm_sample_cpu();
+            }
+
+            os_result =
+                tm_arm_wake(gvTM_state.slot_release_ns +
+                            ((uint64_t)tm_next_wake_slots() * TM_SLOT_NANOSECONDS));
         }
-        else
+
+        if (os_result != OS_RESULT_OKAY)
         {
             // If the schedule cannot be run, shut down the system.
             gvTM_state.continue_running = false;
@@ -208,15 +564,273 @@ void tm_scheduler_task(void *argument)
     }
 
     // When shutting down, unblock all tasks to allow them to close cleanly
-    for (int task_id = 0; task_id < TM_MAX_TASKS; task_id++)
+    for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+         index < gvTM_state.type_starts[TM_TASKTYPE_PERIODIC + 1];
+         index++)
+    {
+        // The return value is not checked here- the system is shutting
+        // down so there is nothing to do to handle the error.
+        os_sem_give(&gvTM_state.tasks[gvTM_state.active_tasks[index]].semaphore);
+    }
+}
+
+void tm_start_slot(void)
+{
+    uint64_t now = os_timestamp_nanoseconds();
+
+    os_seqlock_write_begin(&gvTM_state.status_lock);
+
+    gvTM_state.status.cycle++;
+
+    uint64_t release_ns = gvTM_state.slot_release_ns + TM_SLOT_NANOSECONDS;
+
+    // a wakeup before the next slot is due is a timer expiration that was
+    // queued while the scheduler was catching up, and is already accounted for.
+    if (now < release_ns)
+    {
+        release_ns = gvTM_state.slot_release_ns;
+    }
+
+    uint64_t lateness_ns = now - release_ns;
+    tm_histogram_record(&gvTM_state.status.release_jitter, lateness_ns);
+
+    if (lateness_ns >= TM_SLOT_NANOSECONDS)
+    {
+        uint64_t slot =
+            ((release_ns - gvTM_state.schedule_start_ns) / TM_SLOT_NANOSECONDS) - 1;
+        slot = slot % TM_SLOTS_PER_FRAME;
+
+        if (gvTM_state.status.slot_overruns[slot] < UINT16_MAX)
+        {
+            gvTM_state.status.slot_overruns[slot]++;
+        }
+
+        // the slots that were missed are not run late- the schedule
+        // resumes from the most recent slot that was due.
+        release_ns += (lateness_ns / TM_SLOT_NANOSECONDS) * TM_SLOT_NANOSECONDS;
+    }
+
+    os_seqlock_write_end(&gvTM_state.status_lock);
+
+    gvTM_state.slot_release_ns = release_ns;
+    gvTM_state.slot_number =
+        ((release_ns - gvTM_state.schedule_start_ns) / TM_SLOT_NANOSECONDS) - 1;
+}
+
+void tm_skip_slots(void)
+{
+    uint64_t skipped =
+        ((gvTM_state.wake_release_ns - gvTM_state.slot_release_ns) / TM_SLOT_NANOSECONDS) - 1;
+
+    for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+         index < gvTM_state.type_starts[TM_TASKTYPE_EVENT + 1];
+         index++)
+    {
+        TM_TaskId task_id = gvTM_state.active_tasks[index];
+
+        // the scheduler provides its heartbeat each time it wakes
+        if (task_id != FSW_TASK_ID_TM_SCHEDULER)
+        {
+            atomic_fetch_add(&gvTM_state.tasks[task_id].ticks, (uint32_t)skipped);
+        }
+    }
+
+    gvTM_state.slot_release_ns = gvTM_state.wake_release_ns - TM_SLOT_NANOSECONDS;
+}
+
+uint32_t tm_next_wake_slots(void)
+{
+    TM_Schedule *schedule = &gvTM_state.schedule;
+
+    // CPU usage is sampled at the start of each frame
+    uint32_t slots = TM_SLOTS_PER_FRAME - (gvTM_state.slot_number % TM_SLOTS_PER_FRAME);
+
+    bool found = false;
+    for (uint32_t offset = 1; (offset < slots) && !found; offset++)
+    {
+        uint32_t slot = (gvTM_state.slot_number + offset) % schedule->num_slots;
+
+        if (schedule->slot_starts[slot + 1] > schedule->slot_starts[slot])
+        {
+            slots = offset;
+            found = true;
+        }
+    }
+
+    for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+         index < gvTM_state.type_starts[TM_TASKTYPE_EVENT + 1];
+         index++)
+    {
+        TM_TaskId task_id = gvTM_state.active_tasks[index];
+        TM_Task *task = &gvTM_state.tasks[task_id];
+        uint32_t ticks = atomic_load(&task->ticks);
+
+        // A task that has already missed its heartbeat has been reported,
+        // and does not need the scheduler to wake every slot.
+        if ((task_id != FSW_TASK_ID_TM_SCHEDULER) &&
+            (ticks <= task->heartbeat_period))
+        {
+            // the heartbeat is missed in the first slot that starts with
+            // 'ticks' at the heartbeat period.
+            uint32_t deadline = (task->heartbeat_period - ticks) + 1;
+
+            if (deadline < slots)
+            {
+                slots = deadline;
+            }
+        }
+    }
+
+    return slots;
+}
+
+OS_RESULT_ENUM tm_arm_wake(uint64_t wake_release_ns)
+{
+    gvTM_state.wake_release_ns = wake_release_ns;
+
+    return os_timer_start_absolute(&gvTM_state.schedule_timer,
+                                   tm_schedule_callback,
+                                   NULL,
+                                   wake_release_ns);
+}
+
+void tm_release_tasks(void)
+{
+    TM_Schedule *schedule = &gvTM_state.schedule;
+
+    uint32_t slot = gvTM_state.slot_number % schedule->num_slots;
+
+    for (uint32_t entry = schedule->slot_starts[slot];
+         entry < schedule->slot_starts[slot + 1];
+         entry++)
+    {
+        tm_process_task(TM_TASKSTATUS_SCHEDULE, schedule->task_ids[entry]);
+    }
+}
+
+TM_RESULT_ENUM tm_compile_schedule(TM_Schedule *schedule)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    // the periodic, high rate, event and callback groups are stored in
+    // that order, and high rate and event tasks have no schedule period,
+    // so the tasks with a period are found in one pass over the groups.
+    uint16_t first_index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+    uint16_t end_index = gvTM_state.type_starts[TM_TASKTYPE_CALLBACK + 1];
+
+    // the major frame is the least common multiple of the task periods.
+    // Tasks with a period of 0 are never released.
+    uint64_t num_slots = 1;
+    for (uint16_t index = first_index; (index < end_index) && (tm_result == TM_RESULT_OKAY); index++)
+    {
+        TM_Task *task = &gvTM_state.tasks[gvTM_state.active_tasks[index]];
+
+        if (task->schedule_period > 0)
+        {
+            uint64_t divisor = num_slots;
+            uint64_t remainder = task->schedule_period;
+            while (remainder != 0)
+            {
+                uint64_t next = divisor % remainder;
+                divisor = remainder;
+                remainder = next;
+            }
+
+            num_slots = (num_slots / divisor) * task->schedule_period;
+
+            if (num_slots > TM_MAX_SCHEDULE_SLOTS)
+            {
+                tm_result = TM_RESULT_SCHEDULE_ERROR;
+            }
+        }
+    }
+
+    uint32_t num_entries = 0;
+    for (uint32_t slot = 0; (slot < num_slots) && (tm_result == TM_RESULT_OKAY); slot++)
+    {
+        schedule->slot_starts[slot] = num_entries;
+
+        for (uint16_t index = first_index; index < end_index; index++)
+        {
+            TM_TaskId task_id = gvTM_state.active_tasks[index];
+            TM_Task *task = &gvTM_state.tasks[task_id];
+
+            // slot 0 is the first slot after the start, and a task is first
+            // released after one period.
+            if ((task->schedule_period > 0) &&
+                (((slot + 1) % task->schedule_period) == 0))
+            {
+                if (num_entries < TM_MAX_SCHEDULE_ENTRIES)
+                {
+                    schedule->task_ids[num_entries] = task_id;
+                }
+                num_entries++;
+            }
+        }
+    }
+
+    if (num_entries > TM_MAX_SCHEDULE_ENTRIES)
+    {
+        tm_result = TM_RESULT_SCHEDULE_ERROR;
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        schedule->num_slots = num_slots;
+        schedule->slot_starts[num_slots] = num_entries;
+    }
+
+    return tm_result;
+}
+
+void tm_register_task(TM_TaskId task_id, TM_TASKTYPE_ENUM type)
+{
+    TM_TASKTYPE_ENUM old_type = gvTM_state.tasks[task_id].type;
+
+    // remove a task that is registered again from its old group
+    if (old_type != TM_TASKTYPE_INVALID)
     {
-        if (gvTM_state.tasks[task_id].type == TM_TASKTYPE_PERIODIC)
+        uint16_t index = gvTM_state.type_starts[old_type];
+        while (gvTM_state.active_tasks[index] != task_id)
         {
-            // The return value is not checked here- the system is shutting
-            // down so there is nothing to do to handle the error.
-            os_sem_give(&gvTM_state.tasks[task_id].semaphore);
+            index++;
         }
+
+        for (; (index + 1) < gvTM_state.num_tasks; index++)
+        {
+            gvTM_state.active_tasks[index] = gvTM_state.active_tasks[index + 1];
+        }
+
+        for (int later_type = old_type + 1; later_type <= TM_TASKTYPE_NUM_TYPES; later_type++)
+        {
+            gvTM_state.type_starts[later_type]--;
+        }
+
+        gvTM_state.num_tasks--;
+    }
+
+    // find the task's place in its group, which is kept in id order
+    uint16_t index = gvTM_state.type_starts[type + 1];
+    while ((index > gvTM_state.type_starts[type]) &&
+           (gvTM_state.active_tasks[index - 1] > task_id))
+    {
+        index--;
+    }
+
+    for (uint16_t move = gvTM_state.num_tasks; move > index; move--)
+    {
+        gvTM_state.active_tasks[move] = gvTM_state.active_tasks[move - 1];
+    }
+    gvTM_state.active_tasks[index] = task_id;
+
+    for (int later_type = type + 1; later_type <= TM_TASKTYPE_NUM_TYPES; later_type++)
+    {
+        gvTM_state.type_starts[later_type]++;
     }
+
+    gvTM_state.num_tasks++;
+    gvTM_state.tasks[task_id].type = type;
+    gvTM_state.tasks[task_id].cpus = OS_CPU_MASK_ANY;
 }
 
 void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id)
@@ -234,12 +848,25 @@ void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id)
         case TM_TASKSTATUS_SCHEDULE:
             if (gvTM_state.tasks[task_id].type == TM_TASKTYPE_PERIODIC)
             {
+                if (atomic_load(&gvTM_state.tasks[task_id].executing))
+                {
+                    os_seqlock_write_begin(&gvTM_state.tasks[task_id].timing_lock);
+                    gvTM_state.tasks[task_id].timing.overruns++;
+                    os_seqlock_write_end(&gvTM_state.tasks[task_id].timing_lock);
+                }
+
+                atomic_store(&gvTM_state.tasks[task_id].release_ns,
+                             gvTM_state.slot_release_ns);
+                atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
+
                 OS_RESULT_ENUM os_status =
                     os_sem_give(&gvTM_state.tasks[task_id].semaphore);
                 if (os_status == OS_RESULT_OKAY)
                 {
+                    os_seqlock_write_begin(&gvTM_state.status_lock);
                     gvTM_state.status.tasks_scheduled |=
                         (1ULL << task_id);
+                    os_seqlock_write_end(&gvTM_state.status_lock);
                 }
                 else
                 {
@@ -253,9 +880,52 @@ void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id)
                     // NOTE unexpected situation, perhaps treat
                     // as missed heartbeat
                 }
+                else if (!gvTM_state.tasks[task_id].run_inline &&
+                         (gvTM_state.num_workers > 0))
+                {
+                    TM_Task *task = &gvTM_state.tasks[task_id];
+
+                    // a callback still queued or running is not queued again.
+                    // The scheduler only flags the overrun, rather than waiting.
+                    if (atomic_load(&task->executing))
+                    {
+                        os_seqlock_write_begin(&task->timing_lock);
+                        task->timing.overruns++;
+                        os_seqlock_write_end(&task->timing_lock);
+                    }
+                    else
+                    {
+                        atomic_store(&task->release_ns, gvTM_state.slot_release_ns);
+                        atomic_store(&task->executing, true);
+
+                        if (!tm_workers_dispatch(task_id))
+                        {
+                            atomic_store(&task->executing, false);
+
+                            os_seqlock_write_begin(&task->timing_lock);
+                            task->timing.overruns++;
+                            os_seqlock_write_end(&task->timing_lock);
+                        }
+                    }
+                }
                 else
                 {
-                    (*gvTM_state.tasks[task_id].function)(gvTM_state.tasks[task_id].argument);
+                    TM_Task *task = &gvTM_state.tasks[task_id];
+
+                    task->start_ns = os_timestamp_nanoseconds();
+
+                    os_seqlock_write_begin(&task->timing_lock);
+                    tm_histogram_record(&task->timing.jitter,
+                                        task->start_ns - gvTM_state.slot_release_ns);
+                    os_seqlock_write_end(&task->timing_lock);
+
+                    (*task->function)(task->argument);
+
+                    uint64_t execution_ns = os_timestamp_nanoseconds() - task->start_ns;
+
+                    os_seqlock_write_begin(&task->timing_lock);
+                    tm_histogram_record(&task->timing.execution, execution_ns);
+                    os_seqlock_write_end(&task->timing_lock);
                 }
             }
             else
@@ -266,8 +936,10 @@ void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id)
 
         case TM_TASKSTATUS_MISSED_HEARTBEAT:
             // NOTE - missed heartbeat
+            os_seqlock_write_begin(&gvTM_state.status_lock);
             gvTM_state.status.tasks_missed_heartbeat |=
                 (1ULL << task_id);
+            os_seqlock_write_end(&gvTM_state.status_lock);
             break;
 
         case TM_TASKSTATUS_ERROR:
@@ -282,57 +954,37 @@ TM_TASKSTATUS_ENUM tm_update_task(TM_Task *task)
 
     if (task == NULL)
     {
-        tm_status = TM_RESULT_NULL_POINTER;
+        tm_status = TM_TASKSTATUS_ERROR;
     }
 
     if (tm_status == TM_TASKSTATUS_INVALID)
     {
-        task->ticks++;
-
         switch (task->type)
         {
             case TM_TASKTYPE_INVALID:
+            case TM_TASKTYPE_NUM_TYPES:
                 tm_status = TM_TASKSTATUS_ERROR;
                 break;
 
             case TM_TASKTYPE_PERIODIC:
-                tm_status = TM_TASKSTATUS_WAIT;
-
-                // periodic tasks are scheduled with the given period
-                if (task->ticks == task->schedule_period)
-                {
-                    tm_status = TM_TASKSTATUS_SCHEDULE;
-                    task->ticks = 0;
-                }
-
-                // if a heartbeat is missed, report instead of
-                // scheduling
-                if (task->ticks >= task->heartbeat_period)
-                {
-                    tm_status = TM_TASKSTATUS_MISSED_HEARTBEAT;
-                }
-                break;
-
+            case TM_TASKTYPE_HIGH_RATE:
             case TM_TASKTYPE_EVENT:
                 tm_status = TM_TASKSTATUS_WAIT;
 
-                // event tasks are only monitored for missed heartbeats
-                if (task->ticks >= task->heartbeat_period)
+                // the ticks count the slots since a periodic task was
+                // released, or since an event or high rate task's last
+                // heartbeat. The task may reset them concurrently, so they
+                // are read and advanced in one operation.
+                if (atomic_fetch_add(&task->ticks, 1) >= task->heartbeat_period)
                 {
                     tm_status = TM_TASKSTATUS_MISSED_HEARTBEAT;
                 }
                 break;
 
             case TM_TASKTYPE_CALLBACK:
+                // callback tasks are run by the scheduler, so they
+                // cannot miss a heartbeat.
                 tm_status = TM_TASKSTATUS_WAIT;
-
-                // callback tasks are scheduled with the given
-                // period.
-                if (task->ticks == task->schedule_period)
-                {
-                    tm_status = TM_TASKSTATUS_SCHEDULE;
-                    task->ticks = 0;
-                }
                 break;
 
             case TM_TASKTYPE_MONITOR:
@@ -362,6 +1014,14 @@ TM_RESULT_ENUM tm_periodic_task(char *task_name,
         tm_result = TM_RESULT_NULL_POINTER;
     }
 
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
     if (tm_result == TM_RESULT_OKAY)
     {
         if (period == 0)
@@ -372,8 +1032,7 @@ TM_RESULT_ENUM tm_periodic_task(char *task_name,
 
     if (tm_result == TM_RESULT_OKAY)
     {
-        gvTM_state.tasks[task_id].type = TM_TASKTYPE_PERIODIC;
-        gvTM_state.tasks[task_id].ticks = 0;
+        atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
         gvTM_state.tasks[task_id].function = task_function;
         gvTM_state.tasks[task_id].argument = task_argument;
         gvTM_state.tasks[task_id].schedule_period = period;
@@ -390,7 +1049,7 @@ TM_RESULT_ENUM tm_periodic_task(char *task_name,
             os_sem_create(&gvTM_state.tasks[task_id].semaphore);
         if (os_result == OS_RESULT_OKAY)
         {
-            gvTM_state.num_tasks++;
+            tm_register_task(task_id, TM_TASKTYPE_PERIODIC);
         }
         else
         {
@@ -418,21 +1077,77 @@ TM_RESULT_ENUM tm_event_task(char *task_name,
 
     if (tm_result == TM_RESULT_OKAY)
     {
-        gvTM_state.tasks[task_id].type = TM_TASKTYPE_EVENT;
-        gvTM_state.tasks[task_id].ticks = 0;
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
+        gvTM_state.tasks[task_id].function = task_function;
+        gvTM_state.tasks[task_id].argument = task_argument;
+        gvTM_state.tasks[task_id].schedule_period = 0;
+        gvTM_state.tasks[task_id].heartbeat_period = heartbeat_period;
+        gvTM_state.tasks[task_id].stack_size = stack_size;
+        gvTM_state.tasks[task_id].priority = priority;
+
+        // copy the task name, leaving space for a NULL terminator
+        strncpy(gvTM_state.tasks[task_id].name, task_name, TM_MAX_TASK_NAME_LENGTH - 1);
+        // NULL terminate the task name if it is the maximum length
+        gvTM_state.tasks[task_id].name[TM_MAX_TASK_NAME_LENGTH - 1] = '\0';
+
+        tm_register_task(task_id, TM_TASKTYPE_EVENT);
+    }
+
+    return tm_result;
+}
+
+TM_RESULT_ENUM tm_high_rate_task(char *task_name,
+                                 TM_TaskId task_id,
+                                 OS_TASK_FUNC *task_function,
+                                 void *task_argument,
+                                 uint64_t period_ns,
+                                 uint64_t spin_ns,
+                                 int heartbeat_period,
+                                 int stack_size,
+                                 int priority)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    if ((task_name == NULL) || (task_function == NULL))
+    {
+        tm_result = TM_RESULT_NULL_POINTER;
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS) ||
+            (period_ns == 0) || (spin_ns >= period_ns))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
         gvTM_state.tasks[task_id].function = task_function;
         gvTM_state.tasks[task_id].argument = task_argument;
         gvTM_state.tasks[task_id].schedule_period = 0;
         gvTM_state.tasks[task_id].heartbeat_period = heartbeat_period;
         gvTM_state.tasks[task_id].stack_size = stack_size;
         gvTM_state.tasks[task_id].priority = priority;
+        gvTM_state.tasks[task_id].period_ns = period_ns;
+        gvTM_state.tasks[task_id].spin_ns = spin_ns;
 
         // copy the task name, leaving space for a NULL terminator
         strncpy(gvTM_state.tasks[task_id].name, task_name, TM_MAX_TASK_NAME_LENGTH - 1);
         // NULL terminate the task name if it is the maximum length
         gvTM_state.tasks[task_id].name[TM_MAX_TASK_NAME_LENGTH - 1] = '\0';
 
-        gvTM_state.num_tasks++;
+        tm_register_task(task_id, TM_TASKTYPE_HIGH_RATE);
     }
 
     return tm_result;
@@ -453,21 +1168,74 @@ TM_RESULT_ENUM tm_callback_task(char *task_name,
 
     if (tm_result == TM_RESULT_OKAY)
     {
-        gvTM_state.tasks[task_id].type = TM_TASKTYPE_CALLBACK;
-        gvTM_state.tasks[task_id].ticks = 0;
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
         gvTM_state.tasks[task_id].function = task_function;
         gvTM_state.tasks[task_id].argument = task_argument;
         gvTM_state.tasks[task_id].schedule_period = period;
         gvTM_state.tasks[task_id].heartbeat_period = 0;
         gvTM_state.tasks[task_id].stack_size = 0;
         gvTM_state.tasks[task_id].priority = 0;
+        gvTM_state.tasks[task_id].run_inline = false;
 
         // copy the task name, leaving space for a NULL terminator
         strncpy(gvTM_state.tasks[task_id].name, task_name, TM_MAX_TASK_NAME_LENGTH - 1);
         // NULL terminate the task name if it is the maximum length
         gvTM_state.tasks[task_id].name[TM_MAX_TASK_NAME_LENGTH - 1] = '\0';
 
-        gvTM_state.num_tasks++;
+        tm_register_task(task_id, TM_TASKTYPE_CALLBACK);
+    }
+
+    return tm_result;
+}
+
+TM_RESULT_ENUM tm_task_affinity(TM_TaskId task_id, OS_CpuMask cpus)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+    {
+        tm_result = TM_RESULT_INVALID_ARGUMENT;
+    }
+    else if ((gvTM_state.tasks[task_id].type != TM_TASKTYPE_PERIODIC) &&
+             (gvTM_state.tasks[task_id].type != TM_TASKTYPE_HIGH_RATE) &&
+             (gvTM_state.tasks[task_id].type != TM_TASKTYPE_EVENT))
+    {
+        // only tasks spawned by the Task Manager can be given CPUs
+        tm_result = TM_RESULT_INVALID_ARGUMENT;
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        gvTM_state.tasks[task_id].cpus = cpus;
+    }
+
+    return tm_result;
+}
+
+TM_RESULT_ENUM tm_callback_inline(TM_TaskId task_id, bool run_inline)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+    {
+        tm_result = TM_RESULT_INVALID_ARGUMENT;
+    }
+    else if (gvTM_state.tasks[task_id].type != TM_TASKTYPE_CALLBACK)
+    {
+        tm_result = TM_RESULT_INVALID_ARGUMENT;
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        gvTM_state.tasks[task_id].run_inline = run_inline;
     }
 
     return tm_result;
@@ -484,8 +1252,15 @@ TM_RESULT_ENUM tm_monitor_task(char *task_name, int task_id)
 
     if (tm_result == TM_RESULT_OKAY)
     {
-        gvTM_state.tasks[task_id].type = TM_TASKTYPE_MONITOR;
-        gvTM_state.tasks[task_id].ticks = 0;
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        atomic_store(&gvTM_state.tasks[task_id].ticks, 0);
         gvTM_state.tasks[task_id].function = NULL;
         gvTM_state.tasks[task_id].argument = 0;
         gvTM_state.tasks[task_id].schedule_period = 0;
@@ -498,7 +1273,7 @@ TM_RESULT_ENUM tm_monitor_task(char *task_name, int task_id)
         // NULL terminate the task name if it is the maximum length
         gvTM_state.tasks[task_id].name[TM_MAX_TASK_NAME_LENGTH - 1] = '\0';
 
-        gvTM_state.num_tasks++;
+        tm_register_task(task_id, TM_TASKTYPE_MONITOR);
     }
 
     return tm_result;
@@ -508,6 +1283,156 @@ void tm_get_status(TM_Status *status)
 {
     if (status != NULL)
     {
-        *status = gvTM_state.status;
+        os_seqlock_read(&gvTM_state.status_lock,
+                        status,
+                        &gvTM_state.status,
+                        sizeof(*status));
+
+        // the overruns are counted by the timer rather than TM.
+        // The return value is not checked, as the timer and count are not NULL
+        (void)os_timer_get_overruns(&gvTM_state.schedule_timer,
+                                    &status->tick_overruns);
+    }
+}
+
+void tm_get_cpu_usage(TM_CpuUsage *usage)
+{
+    if (usage != NULL)
+    {
+        os_seqlock_read(&gvTM_state.status_lock,
+                        usage,
+                        &gvTM_state.cpu_usage,
+                        sizeof(*usage));
+    }
+}
+
+void tm_sample_cpu(void)
+{
+    uint64_t now = os_timestamp_nanoseconds();
+    uint64_t process_cpu_ns = os_process_cpu_nanoseconds();
+
+    if (now > gvTM_state.cpu_sample_ns)
+    {
+        uint64_t elapsed_ns = now - gvTM_state.cpu_sample_ns;
+
+        os_seqlock_write_begin(&gvTM_state.status_lock);
+
+        for (uint16_t index = gvTM_state.type_starts[TM_TASKTYPE_PERIODIC];
+             index < gvTM_state.type_starts[TM_TASKTYPE_EVENT + 1];
+             index++)
+        {
+            TM_TaskId task_id = gvTM_state.active_tasks[index];
+            TM_Task *task = &gvTM_state.tasks[task_id];
+
+            uint64_t cpu_ns = 0;
+            uint64_t utilization = 0;
+
+            if ((task->os_task != NULL) &&
+                (os_task_cpu_time(&task->os_task, &cpu_ns) == OS_RESULT_OKAY))
+            {
+                if (cpu_ns > task->cpu_ns)
+                {
+                    utilization =
+                        ((cpu_ns - task->cpu_ns) * TM_CPU_UTILIZATION_FULL) / elapsed_ns;
+                }
+
+                task->cpu_ns = cpu_ns;
+            }
+
+            if (utilization > UINT16_MAX)
+            {
+                utilization = UINT16_MAX;
+            }
+            gvTM_state.cpu_usage.tasks[task_id] = (uint16_t)utilization;
+        }
+
+        // the headroom is the capacity of every CPU, less the time used
+        // by every task in the process, including those TM does not spawn.
+        uint32_t num_cpus = os_task_num_cpus();
+        uint64_t capacity = (uint64_t)num_cpus * TM_CPU_UTILIZATION_FULL;
+        uint64_t used = 0;
+        if (process_cpu_ns > gvTM_state.process_cpu_ns)
+        {
+            used = ((process_cpu_ns - gvTM_state.process_cpu_ns) * TM_CPU_UTILIZATION_FULL) / elapsed_ns;
+        }
+
+        gvTM_state.cpu_usage.num_cpus = (num_cpus > UINT16_MAX) ? UINT16_MAX : (uint16_t)num_cpus;
+        gvTM_state.cpu_usage.headroom = (used < capacity) ? (uint32_t)(capacity - used) : 0;
+
+        os_seqlock_write_end(&gvTM_state.status_lock);
+    }
+
+    gvTM_state.cpu_sample_ns = now;
+    gvTM_state.process_cpu_ns = process_cpu_ns;
+}
+
+TM_RESULT_ENUM tm_get_task_timing(TM_TaskId task_id, TM_TaskTiming *timing)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    if (timing == NULL)
+    {
+        tm_result = TM_RESULT_NULL_POINTER;
+    }
+
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        if ((task_id < 0) || (task_id >= TM_MAX_TASKS) ||
+            (gvTM_state.tasks[task_id].type == TM_TASKTYPE_INVALID))
+        {
+            tm_result = TM_RESULT_INVALID_ARGUMENT;
+        }
+    }
+
+    // the timing is updated by the task and the scheduler while it is
+    // copied, so it is read through the task's timing lock.
+    if (tm_result == TM_RESULT_OKAY)
+    {
+        os_seqlock_read(&gvTM_state.tasks[task_id].timing_lock,
+                        timing,
+                        &gvTM_state.tasks[task_id].timing,
+                        sizeof(*timing));
+    }
+
+    return tm_result;
+}
+
+void tm_histogram_record(TM_Histogram *histogram, uint64_t nanoseconds)
+{
+    if (histogram != NULL)
+    {
+        uint64_t microseconds = nanoseconds / 1000;
+        if (microseconds > UINT32_MAX)
+        {
+            microseconds = UINT32_MAX;
+        }
+
+        // bucket n holds samples with their highest set bit at n - 1,
+        // which is the log2 of the sample rounded down, plus one.
+        uint32_t bucket = 0;
+        if (microseconds > 0)
+        {
+            bucket = 64 - __builtin_clzll(microseconds);
+        }
+
+        if (bucket >= TM_HISTOGRAM_NUM_BUCKETS)
+        {
+            bucket = TM_HISTOGRAM_NUM_BUCKETS - 1;
+        }
+
+        if ((histogram->count == 0) || (microseconds < histogram->min_us))
+        {
+            histogram->min_us = microseconds;
+        }
+
+        if (microseconds > histogram->max_us)
+        {
+            histogram->max_us = microseconds;
+        }
+
+        histogram->count++;
+        histogram->total_us += microseconds;
+        histogram->mean_us = histogram->total_us / histogram->count;
+        histogram->buckets[bucket]++;
     }
 }
@@ -0,0 +1,586 @@
+/**
+ * @file tm_test.c
+ *
+ * @brief Task Manager Module Unit Tests
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the unit tests for the Task Manager module.
+ */
+#include "stddef.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdatomic.h"
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "os_time.h"
+
+#include "fsw_definitions.h"
+#include "tm_definitions.h"
+#include "tm.h"
+
+
+#define FSW_TM_TEST_TASK_ID 5
+#define FSW_TM_TEST_PERIOD 10
+#define FSW_TM_TEST_HIGH_RATE_PERIOD_NS 1000000ULL
+#define FSW_TM_TEST_HIGH_RATE_RUNS 20
+
+
+// We need access to the TM state to set up the schedule and assert on its fields.
+extern TM_State gvTM_state;
+
+// These functions are internal to TM, but are run by the tests in place
+// of the scheduler task.
+void tm_start_slot(void);
+TM_RESULT_ENUM tm_compile_schedule(TM_Schedule *schedule);
+void tm_process_task(TM_TASKSTATUS_ENUM status, TM_TaskId task_id);
+void tm_sample_cpu(void);
+void tm_skip_slots(void);
+uint32_t tm_next_wake_slots(void);
+
+static void tm_test_task(void *argument)
+{
+    (void)argument;
+}
+
+static void tm_test_running_task(void *argument)
+{
+    TM_TaskId task_id = *(TM_TaskId*)argument;
+
+    while (tm_running(task_id))
+    {
+        os_task_delay(1);
+    }
+}
+
+static void tm_test_high_rate_task(void *argument)
+{
+    atomic_uint *runs = (atomic_uint*)argument;
+
+    while (tm_running(FSW_TM_TEST_TASK_ID) && (atomic_load(runs) < FSW_TM_TEST_HIGH_RATE_RUNS))
+    {
+        atomic_fetch_add(runs, 1);
+    }
+}
+
+static void tm_test_busy_task(void *argument)
+{
+    (void)argument;
+
+    uint64_t start_ns = os_timestamp_nanoseconds();
+    while ((os_timestamp_nanoseconds() - start_ns) < 50000000ULL)
+    {
+    }
+}
+
+static void tm_test_count_task(void *argument)
+{
+    atomic_fetch_add((atomic_uint*)argument, 1);
+}
+
+static void tm_test_waiting_task(void *argument)
+{
+    (void)os_sem_take((OS_Sem*)argument, OS_TIMEOUT_WAIT_FOREVER);
+}
+
+TEST_GROUP(FSW_TM);
+
+TEST_SETUP(FSW_TM)
+{
+    // tm_initialize is not used because each call creates a new OS timer.
+    memset(&gvTM_state, 0, sizeof(gvTM_state));
+    gvTM_state.continue_running = true;
+}
+
+TEST_TEAR_DOWN(FSW_TM)
+{
+}
+
+TEST(FSW_TM, histogram_record)
+{
+    TM_Histogram histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    tm_histogram_record(&histogram, 500);
+    tm_histogram_record(&histogram, 1000);
+    tm_histogram_record(&histogram, 3000);
+    tm_histogram_record(&histogram, 10000000000ULL);
+
+    TEST_ASSERT_EQUAL(4, histogram.count);
+    TEST_ASSERT_EQUAL(0, histogram.min_us);
+    TEST_ASSERT_EQUAL(10000000, histogram.max_us);
+    TEST_ASSERT_EQUAL(10000004, histogram.total_us);
+    TEST_ASSERT_EQUAL(2500001, histogram.mean_us);
+
+    // under 1 us, [1, 2) us, [2, 4) us, and the overflow bucket
+    TEST_ASSERT_EQUAL(1, histogram.buckets[0]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[1]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[2]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[TM_HISTOGRAM_NUM_BUCKETS - 1]);
+}
+
+TEST(FSW_TM, task_timing_invalid)
+{
+    TM_RESULT_ENUM tm_result;
+    TM_TaskTiming timing;
+
+    tm_result = tm_get_task_timing(FSW_TM_TEST_TASK_ID, NULL);
+    TEST_ASSERT_EQUAL(TM_RESULT_NULL_POINTER, tm_result);
+
+    tm_result = tm_get_task_timing(FSW_TM_TEST_TASK_ID, &timing);
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    tm_result = tm_get_task_timing(TM_MAX_TASKS, &timing);
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+}
+
+TEST(FSW_TM, task_affinity)
+{
+    TM_RESULT_ENUM tm_result;
+
+    tm_result = tm_task_affinity(TM_MAX_TASKS, OS_CPU_MASK(0));
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    // only registered tasks that TM spawns can be given CPUs
+    tm_result = tm_task_affinity(FSW_TM_TEST_TASK_ID, OS_CPU_MASK(0));
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    tm_result = tm_periodic_task("test",
+                                 FSW_TM_TEST_TASK_ID,
+                                 tm_test_task,
+                                 NULL,
+                                 FSW_TM_TEST_PERIOD,
+                                 FSW_TM_TEST_PERIOD,
+                                 0,
+                                 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_task_affinity(FSW_TM_TEST_TASK_ID, OS_CPU_MASK(0));
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(OS_CPU_MASK(0), gvTM_state.tasks[FSW_TM_TEST_TASK_ID].cpus);
+
+    // registering the task again lets it run on any CPU
+    tm_result = tm_periodic_task("test",
+                                 FSW_TM_TEST_TASK_ID,
+                                 tm_test_task,
+                                 NULL,
+                                 FSW_TM_TEST_PERIOD,
+                                 FSW_TM_TEST_PERIOD,
+                                 0,
+                                 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(OS_CPU_MASK_ANY, gvTM_state.tasks[FSW_TM_TEST_TASK_ID].cpus);
+}
+
+TEST(FSW_TM, periodic_task_timing)
+{
+    TM_RESULT_ENUM tm_result;
+    TM_TaskTiming timing;
+
+    tm_result = tm_periodic_task("test",
+                                 FSW_TM_TEST_TASK_ID,
+                                 tm_test_task,
+                                 NULL,
+                                 FSW_TM_TEST_PERIOD,
+                                 FSW_TM_TEST_PERIOD,
+                                 0,
+                                 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    // release the task in the current slot, then run it twice.
+    gvTM_state.slot_release_ns = os_timestamp_nanoseconds();
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID);
+    TEST_ASSERT_TRUE(tm_running(FSW_TM_TEST_TASK_ID));
+
+    // releasing the task while it is running is an overrun
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID);
+    TEST_ASSERT_TRUE(tm_running(FSW_TM_TEST_TASK_ID));
+
+    tm_result = tm_get_task_timing(FSW_TM_TEST_TASK_ID, &timing);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    TEST_ASSERT_EQUAL(2, timing.jitter.count);
+    TEST_ASSERT_EQUAL(1, timing.execution.count);
+    TEST_ASSERT_EQUAL(1, timing.overruns);
+}
+
+TEST(FSW_TM, slot_overrun)
+{
+    uint64_t now = os_timestamp_nanoseconds();
+
+    // start the schedule so the first slot was due two and a half slots ago
+    gvTM_state.schedule_start_ns = now - ((7 * TM_SLOT_NANOSECONDS) / 2);
+    gvTM_state.slot_release_ns = gvTM_state.schedule_start_ns;
+
+    tm_start_slot();
+
+    TEST_ASSERT_EQUAL(1, gvTM_state.status.cycle);
+    TEST_ASSERT_EQUAL(1, gvTM_state.status.slot_overruns[0]);
+    TEST_ASSERT_EQUAL(1, gvTM_state.status.release_jitter.count);
+    TEST_ASSERT_TRUE(gvTM_state.status.release_jitter.min_us >= (2 * TM_SLOT_NANOSECONDS) / 1000);
+
+    // the schedule resumes from the most recent slot, which is the third
+    TEST_ASSERT_EQUAL(gvTM_state.schedule_start_ns + (3 * TM_SLOT_NANOSECONDS),
+                      gvTM_state.slot_release_ns);
+    TEST_ASSERT_EQUAL(2, gvTM_state.slot_number);
+
+    // a queued wakeup while catching up is neither late nor an overrun
+    tm_start_slot();
+
+    TEST_ASSERT_EQUAL(2, gvTM_state.status.cycle);
+    TEST_ASSERT_EQUAL(1, gvTM_state.status.slot_overruns[0]);
+    TEST_ASSERT_EQUAL(0, gvTM_state.status.slot_overruns[2]);
+    TEST_ASSERT_EQUAL(gvTM_state.schedule_start_ns + (3 * TM_SLOT_NANOSECONDS),
+                      gvTM_state.slot_release_ns);
+}
+
+TEST(FSW_TM, tickless_wake)
+{
+    TM_RESULT_ENUM tm_result;
+
+    tm_result = tm_periodic_task("periodic", FSW_TM_TEST_TASK_ID, tm_test_task, NULL, 5, 3, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_event_task("event", FSW_TM_TEST_TASK_ID + 1, tm_test_task, NULL, 20, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_compile_schedule(&gvTM_state.schedule);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    // slot 4 has just released the periodic task
+    gvTM_state.slot_number = 4;
+    gvTM_state.tasks[FSW_TM_TEST_TASK_ID].ticks = 1;
+    gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].ticks = 1;
+
+    // the periodic task's heartbeat is due before its next release
+    TEST_ASSERT_EQUAL(3, tm_next_wake_slots());
+
+    // once the heartbeat is missed, the scheduler wakes for the next release
+    gvTM_state.tasks[FSW_TM_TEST_TASK_ID].ticks = 4;
+    TEST_ASSERT_EQUAL(5, tm_next_wake_slots());
+
+    // the event task's heartbeat is due first
+    gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].ticks = 19;
+    TEST_ASSERT_EQUAL(2, tm_next_wake_slots());
+
+    // the scheduler wakes at the start of each frame to sample the CPU usage
+    gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].ticks = 1;
+    gvTM_state.slot_number = TM_SLOTS_PER_FRAME - 1;
+    TEST_ASSERT_EQUAL(1, tm_next_wake_slots());
+
+    // the slots slept through count towards the tasks' heartbeats
+    gvTM_state.slot_release_ns = 1000 * TM_SLOT_NANOSECONDS;
+    gvTM_state.wake_release_ns = 1005 * TM_SLOT_NANOSECONDS;
+    tm_skip_slots();
+    TEST_ASSERT_EQUAL(1004 * TM_SLOT_NANOSECONDS, gvTM_state.slot_release_ns);
+    TEST_ASSERT_EQUAL(8, gvTM_state.tasks[FSW_TM_TEST_TASK_ID].ticks);
+    TEST_ASSERT_EQUAL(5, gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].ticks);
+}
+
+TEST(FSW_TM, compile_schedule)
+{
+    TM_RESULT_ENUM tm_result;
+    TM_Schedule *schedule = &gvTM_state.schedule;
+
+    tm_result = tm_periodic_task("two", FSW_TM_TEST_TASK_ID, tm_test_task, NULL, 2, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_periodic_task("three", FSW_TM_TEST_TASK_ID + 1, tm_test_task, NULL, 3, 3, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_callback_task("four", FSW_TM_TEST_TASK_ID + 2, tm_test_task, NULL, 4);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_compile_schedule(schedule);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    // the major frame is the least common multiple of the periods, and each
+    // task is first released after one period.
+    TEST_ASSERT_EQUAL(12, schedule->num_slots);
+    TEST_ASSERT_EQUAL(6 + 4 + 3, schedule->slot_starts[12]);
+
+    TEST_ASSERT_EQUAL(0, schedule->slot_starts[1] - schedule->slot_starts[0]);
+
+    TEST_ASSERT_EQUAL(1, schedule->slot_starts[2] - schedule->slot_starts[1]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID, schedule->task_ids[schedule->slot_starts[1]]);
+
+    TEST_ASSERT_EQUAL(2, schedule->slot_starts[4] - schedule->slot_starts[3]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID, schedule->task_ids[schedule->slot_starts[3]]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 2, schedule->task_ids[schedule->slot_starts[3] + 1]);
+
+    TEST_ASSERT_EQUAL(3, schedule->slot_starts[12] - schedule->slot_starts[11]);
+}
+
+TEST(FSW_TM, compile_schedule_too_long)
+{
+    TM_RESULT_ENUM tm_result;
+
+    // periods with no common factor need a frame of their product
+    tm_result = tm_periodic_task("a", FSW_TM_TEST_TASK_ID, tm_test_task, NULL, 997, 997, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_periodic_task("b", FSW_TM_TEST_TASK_ID + 1, tm_test_task, NULL, 991, 991, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_compile_schedule(&gvTM_state.schedule);
+    TEST_ASSERT_EQUAL(TM_RESULT_SCHEDULE_ERROR, tm_result);
+}
+
+TEST(FSW_TM, active_task_index)
+{
+    TM_RESULT_ENUM tm_result;
+
+    tm_result = tm_callback_task("callback", FSW_TM_TEST_TASK_ID + 2, tm_test_task, NULL, 4);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_periodic_task("second", FSW_TM_TEST_TASK_ID + 1, tm_test_task, NULL, 2, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_periodic_task("first", FSW_TM_TEST_TASK_ID, tm_test_task, NULL, 2, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_event_task("event", FSW_TM_TEST_TASK_ID + 3, tm_test_task, NULL, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_periodic_task("invalid", TM_MAX_TASKS, tm_test_task, NULL, 2, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    // tasks are grouped by type, and kept in id order within each group
+    TEST_ASSERT_EQUAL(4, gvTM_state.num_tasks);
+    TEST_ASSERT_EQUAL(0, gvTM_state.type_starts[TM_TASKTYPE_PERIODIC]);
+    TEST_ASSERT_EQUAL(2, gvTM_state.type_starts[TM_TASKTYPE_EVENT]);
+    TEST_ASSERT_EQUAL(3, gvTM_state.type_starts[TM_TASKTYPE_CALLBACK]);
+    TEST_ASSERT_EQUAL(4, gvTM_state.type_starts[TM_TASKTYPE_NUM_TYPES]);
+
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID, gvTM_state.active_tasks[0]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 1, gvTM_state.active_tasks[1]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 3, gvTM_state.active_tasks[2]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 2, gvTM_state.active_tasks[3]);
+
+    // registering a task again moves it to its new group
+    tm_result = tm_callback_task("moved", FSW_TM_TEST_TASK_ID, tm_test_task, NULL, 4);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    TEST_ASSERT_EQUAL(4, gvTM_state.num_tasks);
+    TEST_ASSERT_EQUAL(1, gvTM_state.type_starts[TM_TASKTYPE_EVENT]);
+    TEST_ASSERT_EQUAL(2, gvTM_state.type_starts[TM_TASKTYPE_CALLBACK]);
+
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 1, gvTM_state.active_tasks[0]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 3, gvTM_state.active_tasks[1]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID, gvTM_state.active_tasks[2]);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_TASK_ID + 2, gvTM_state.active_tasks[3]);
+}
+
+TEST(FSW_TM, shutdown)
+{
+    TM_RESULT_ENUM tm_result;
+    OS_RESULT_ENUM os_result;
+
+    static TM_TaskId task_ids[2] = { FSW_TM_TEST_TASK_ID, FSW_TM_TEST_TASK_ID + 1 };
+
+    tm_result = tm_periodic_task("periodic", task_ids[0], tm_test_running_task, &task_ids[0], 2, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_event_task("event", task_ids[1], tm_test_running_task, &task_ids[1], 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    // the tasks are spawned here rather than by tm_start, which would
+    // start the schedule timer.
+    for (uint32_t index = 0; index < 2; index++)
+    {
+        os_result = os_task_spawn(&gvTM_state.tasks[task_ids[index]].os_task,
+                                  tm_test_running_task,
+                                  &task_ids[index],
+                                  20,
+                                  1024 * 20);
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+    }
+
+    // without a scheduler the periodic task is never released, so it
+    // cannot exit by the deadline.
+    tm_result = tm_shutdown(10);
+    TEST_ASSERT_EQUAL(TM_RESULT_SHUTDOWN_TIMEOUT, tm_result);
+    TEST_ASSERT_NOT_NULL(gvTM_state.tasks[task_ids[0]].os_task);
+    TEST_ASSERT_NULL(gvTM_state.tasks[task_ids[1]].os_task);
+
+    // release the task as the scheduler does when it stops
+    os_result = os_sem_give(&gvTM_state.tasks[task_ids[0]].semaphore);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+
+    tm_result = tm_shutdown(OS_CONFIG_CLOCK_RATE);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_NULL(gvTM_state.tasks[task_ids[0]].os_task);
+}
+
+TEST(FSW_TM, high_rate_task)
+{
+    TM_RESULT_ENUM tm_result;
+    OS_RESULT_ENUM os_result;
+    TM_TaskTiming timing;
+
+    static atomic_uint runs;
+    atomic_store(&runs, 0);
+
+    // the spin time must leave time in the period to sleep
+    tm_result = tm_high_rate_task("high_rate", FSW_TM_TEST_TASK_ID, tm_test_high_rate_task, (void*)&runs,
+                                  0, 0, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    tm_result = tm_high_rate_task("high_rate", FSW_TM_TEST_TASK_ID, tm_test_high_rate_task, (void*)&runs,
+                                  FSW_TM_TEST_HIGH_RATE_PERIOD_NS, FSW_TM_TEST_HIGH_RATE_PERIOD_NS, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_result);
+
+    tm_result = tm_high_rate_task("high_rate", FSW_TM_TEST_TASK_ID, tm_test_high_rate_task, (void*)&runs,
+                                  FSW_TM_TEST_HIGH_RATE_PERIOD_NS, 50000, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(TM_TASKTYPE_HIGH_RATE, gvTM_state.tasks[FSW_TM_TEST_TASK_ID].type);
+
+    // the task is spawned here rather than by tm_start, which would
+    // start the schedule timer.
+    uint64_t start_ns = os_timestamp_nanoseconds();
+    atomic_store(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].release_ns, start_ns);
+
+    os_result = os_task_spawn(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].os_task,
+                              tm_test_high_rate_task,
+                              (void*)&runs,
+                              20,
+                              1024 * 20);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+
+    os_result = os_task_join(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].os_task, OS_TIMEOUT_WAIT_FOREVER);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+
+    // the task ran once per period, and was not released before each release was due
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_HIGH_RATE_RUNS, atomic_load(&runs));
+    TEST_ASSERT_TRUE((os_timestamp_nanoseconds() - start_ns) >=
+                     ((FSW_TM_TEST_HIGH_RATE_RUNS + 1) * FSW_TM_TEST_HIGH_RATE_PERIOD_NS));
+
+    // releases stay on the period from the start, however late the task woke
+    uint64_t release_ns = atomic_load(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].release_ns);
+    TEST_ASSERT_TRUE(release_ns >= (start_ns + ((FSW_TM_TEST_HIGH_RATE_RUNS + 1) * FSW_TM_TEST_HIGH_RATE_PERIOD_NS)));
+    TEST_ASSERT_EQUAL(0, (release_ns - start_ns) % FSW_TM_TEST_HIGH_RATE_PERIOD_NS);
+
+    tm_result = tm_get_task_timing(FSW_TM_TEST_TASK_ID, &timing);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_HIGH_RATE_RUNS + 1, timing.jitter.count);
+    TEST_ASSERT_EQUAL(FSW_TM_TEST_HIGH_RATE_RUNS, timing.execution.count);
+}
+
+TEST(FSW_TM, cpu_usage)
+{
+    TM_RESULT_ENUM tm_result;
+    OS_RESULT_ENUM os_result;
+    TM_CpuUsage usage;
+
+    tm_result = tm_event_task("busy", FSW_TM_TEST_TASK_ID, tm_test_busy_task, NULL, 2, 0, 0);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    gvTM_state.cpu_sample_ns = os_timestamp_nanoseconds();
+    gvTM_state.process_cpu_ns = os_process_cpu_nanoseconds();
+
+    os_result = os_task_spawn(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].os_task,
+                              tm_test_busy_task,
+                              NULL,
+                              20,
+                              1024 * 20);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+
+    while (os_task_status(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].os_task) != OS_TASK_STATUS_TASK_EXITED)
+    {
+        os_task_delay(1);
+    }
+
+    tm_sample_cpu();
+    tm_get_cpu_usage(&usage);
+
+    // the task kept a CPU busy for most of the sample
+    TEST_ASSERT_TRUE(usage.tasks[FSW_TM_TEST_TASK_ID] > (TM_CPU_UTILIZATION_FULL / 4));
+    TEST_ASSERT_TRUE(usage.tasks[FSW_TM_TEST_TASK_ID] <= TM_CPU_UTILIZATION_FULL);
+    TEST_ASSERT_TRUE(usage.num_cpus >= 1);
+    TEST_ASSERT_TRUE(usage.headroom < ((uint32_t)usage.num_cpus * TM_CPU_UTILIZATION_FULL));
+
+    os_result = os_task_join(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID].os_task, OS_TIMEOUT_WAIT_FOREVER);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_result);
+}
+
+TEST(FSW_TM, callback_workers)
+{
+    TM_RESULT_ENUM tm_result;
+    OS_Sem sem;
+
+    static atomic_uint count;
+    atomic_store(&count, 0);
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_create(&sem));
+
+    tm_result = tm_callback_task("first", FSW_TM_TEST_TASK_ID, tm_test_count_task, &count, 1);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_callback_task("waiting", FSW_TM_TEST_TASK_ID + 1, tm_test_waiting_task, &sem, 1);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_callback_task("second", FSW_TM_TEST_TASK_ID + 2, tm_test_count_task, &count, 1);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+
+    tm_result = tm_workers_start();
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(TM_NUM_WORKERS, gvTM_state.num_workers);
+
+    // the waiting callback holds the first worker, so the callback queued
+    // behind it is stolen by the other worker.
+    gvTM_state.slot_release_ns = os_timestamp_nanoseconds();
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID + 1);
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID);
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID + 2);
+
+    for (int tries = 0; (tries < 100) && (atomic_load(&count) < 2); tries++)
+    {
+        os_task_delay(1);
+    }
+    TEST_ASSERT_EQUAL(2, atomic_load(&count));
+
+    // releasing the waiting callback while it runs is an overrun, and it
+    // is not queued again.
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID + 1);
+    TEST_ASSERT_EQUAL(1, gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].timing.overruns);
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_give(&sem));
+
+    for (int tries = 0; (tries < 100) && atomic_load(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].executing); tries++)
+    {
+        os_task_delay(1);
+    }
+    TEST_ASSERT_FALSE(atomic_load(&gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].executing));
+    TEST_ASSERT_EQUAL(1, gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].timing.execution.count);
+    TEST_ASSERT_EQUAL(1, gvTM_state.tasks[FSW_TM_TEST_TASK_ID + 1].timing.jitter.count);
+
+    // an inline callback has run by the time it is processed
+    TEST_ASSERT_EQUAL(TM_RESULT_INVALID_ARGUMENT, tm_callback_inline(TM_MAX_TASKS, true));
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_callback_inline(FSW_TM_TEST_TASK_ID, true));
+
+    tm_process_task(TM_TASKSTATUS_SCHEDULE, FSW_TM_TEST_TASK_ID);
+    TEST_ASSERT_EQUAL(3, atomic_load(&count));
+
+    tm_result = tm_shutdown(OS_CONFIG_CLOCK_RATE);
+    TEST_ASSERT_EQUAL(TM_RESULT_OKAY, tm_result);
+    TEST_ASSERT_EQUAL(0, gvTM_state.num_workers);
+}
+
+TEST_GROUP_RUNNER(FSW_TM)
+{
+    RUN_TEST_CASE(FSW_TM, histogram_record);
+    RUN_TEST_CASE(FSW_TM, task_timing_invalid);
+    RUN_TEST_CASE(FSW_TM, task_affinity);
+    RUN_TEST_CASE(FSW_TM, periodic_task_timing);
+    RUN_TEST_CASE(FSW_TM, slot_overrun);
+    RUN_TEST_CASE(FSW_TM, tickless_wake);
+    RUN_TEST_CASE(FSW_TM, compile_schedule);
+    RUN_TEST_CASE(FSW_TM, compile_schedule_too_long);
+    RUN_TEST_CASE(FSW_TM, active_task_index);
+    RUN_TEST_CASE(FSW_TM, shutdown);
+    RUN_TEST_CASE(FSW_TM, high_rate_task);
+    RUN_TEST_CASE(FSW_TM, cpu_usage);
+    RUN_TEST_CASE(FSW_TM, callback_workers);
+}
@@ -0,0 +1,295 @@
+/**
+ * @file tm_workers.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the Task Manager's callback workers, which run
+ * callback tasks so that a long callback does not delay the scheduler.
+ *
+ * Each worker has its own queue, filled in turn by the scheduler. A worker
+ * that runs out of callbacks steals them from the other workers' queues,
+ * so a callback queued behind a long one is run by an idle worker.
+ */
+#include "stddef.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdatomic.h"
+#include "string.h"
+
+#include "os_task.h"
+#include "os_sem.h"
+#include "os_time.h"
+#include "os_seqlock.h"
+
+#include "fsw_tasks.h"
+
+#include "tm_definitions.h"
+#include "tm.h"
+
+
+extern TM_State gvTM_state;
+
+
+/**
+ * @brief tm_work_queue_push
+ *
+ * This function adds a callback to the bottom of a worker's queue. It is
+ * only called by the scheduler.
+ *
+ * @param[in,out] queue - the queue to add to.
+ * @param[in] task_id - the callback task to add.
+ *
+ * @return true if the callback was added, or false if the queue is full.
+ */
+bool tm_work_queue_push(TM_WorkQueue *queue, TM_TaskId task_id);
+
+/**
+ * @brief tm_work_queue_take
+ *
+ * This function takes a callback from the top of a worker's queue. It may
+ * be called by the queue's worker and by other workers at the same time.
+ *
+ * @param[in,out] queue - the queue to take from.
+ * @param[out] task_id - the callback task taken.
+ *
+ * @return true if a callback was taken, or false if the queue is empty.
+ */
+bool tm_work_queue_take(TM_WorkQueue *queue, TM_TaskId *task_id);
+
+/**
+ * @brief tm_worker_find
+ *
+ * This function finds a callback for a worker, checking the worker's own
+ * queue first and then stealing from the other workers' queues in turn.
+ *
+ * @param[in] worker - the worker looking for a callback.
+ * @param[out] task_id - the callback task found.
+ *
+ * @return true if a callback was found.
+ */
+bool tm_worker_find(TM_Worker *worker, TM_TaskId *task_id);
+
+/**
+ * @brief tm_worker_run
+ *
+ * This function runs a callback task in a worker, recording its timing.
+ *
+ * @param[in,out] task - the callback task to run.
+ */
+void tm_worker_run(TM_Task *task);
+
+
+bool tm_work_queue_push(TM_WorkQueue *queue, TM_TaskId task_id)
+{
+    bool pushed = false;
+
+    unsigned int bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed);
+    unsigned int top = atomic_load_explicit(&queue->top, memory_order_acquire);
+
+    // an entry is only reused once the callback in it has been taken
+    if ((bottom - top) < TM_WORKER_QUEUE_SIZE)
+    {
+        atomic_store_explicit(&queue->task_ids[bottom & (TM_WORKER_QUEUE_SIZE - 1)],
+                              (unsigned int)task_id,
+                              memory_order_relaxed);
+
+        atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_release);
+
+        pushed = true;
+    }
+
+    return pushed;
+}
+
+bool tm_work_queue_take(TM_WorkQueue *queue, TM_TaskId *task_id)
+{
+    bool taken = false;
+
+    unsigned int top = atomic_load_explicit(&queue->top, memory_order_acquire);
+    unsigned int bottom = atomic_load_explicit(&queue->bottom, memory_order_acquire);
+
+    while ((top != bottom) && !taken)
+    {
+        // the entry is read before it is claimed. It cannot be reused until
+        // the top moves past it, in which case the claim fails.
+        unsigned int entry =
+            atomic_load_explicit(&queue->task_ids[top & (TM_WORKER_QUEUE_SIZE - 1)],
+                                 memory_order_relaxed);
+
+        if (atomic_compare_exchange_weak_explicit(&queue->top,
+                                                  &top,
+                                                  top + 1,
+                                                  memory_order_acq_rel,
+                                                  memory_order_acquire))
+        {
+            *task_id = (TM_TaskId)entry;
+            taken = true;
+        }
+        else
+        {
+            bottom = atomic_load_explicit(&queue->bottom, memory_order_acquire);
+        }
+    }
+
+    return taken;
+}
+
+TM_RESULT_ENUM tm_workers_start(void)
+{
+    TM_RESULT_ENUM tm_result = TM_RESULT_OKAY;
+
+    gvTM_state.num_workers = 0;
+    gvTM_state.next_worker = 0;
+
+    for (uint32_t index = 0; index < TM_NUM_WORKERS; index++)
+    {
+        // workers are spawned in order, so the running workers are
+        // always the first 'num_workers'.
+        TM_Worker *worker = &gvTM_state.workers[gvTM_state.num_workers];
+
+        memset(&worker->queue, 0, sizeof(worker->queue));
+        atomic_store(&worker->busy, false);
+        worker->index = gvTM_state.num_workers;
+
+        OS_RESULT_ENUM os_result = os_sem_create(&worker->wake);
+        if (os_result != OS_RESULT_OKAY)
+        {
+            tm_result = TM_RESULT_SEM_CREATE_ERROR;
+        }
+        else
+        {
+            os_result = os_task_spawn_affinity(&worker->os_task,
+                                               tm_worker_task,
+                                               worker,
+                                               FSW_PRIORITY_TM_WORKER,
+                                               FSW_DEFAULT_STACK_SIZE,
+                                               FSW_CPUS_TM_WORKERS);
+            if (os_result == OS_RESULT_OKAY)
+            {
+                gvTM_state.num_workers++;
+            }
+            else
+            {
+                tm_result = TM_RESULT_TASK_SPAWN_ERROR;
+            }
+        }
+    }
+
+    return tm_result;
+}
+
+bool tm_workers_dispatch(TM_TaskId task_id)
+{
+    bool dispatched = false;
+
+    TM_Worker *worker = NULL;
+
+    // workers are given callbacks in turn, skipping any whose queue is full
+    for (uint32_t attempt = 0; (attempt < gvTM_state.num_workers) && !dispatched; attempt++)
+    {
+        worker = &gvTM_state.workers[gvTM_state.next_worker];
+
+        gvTM_state.next_worker = (gvTM_state.next_worker + 1) % gvTM_state.num_workers;
+
+        dispatched = tm_work_queue_push(&worker->queue, task_id);
+    }
+
+    if (dispatched)
+    {
+        // The return values are not checked- a worker that is not woken
+        // finds the callback the next time it looks for work.
+        (void)os_sem_give(&worker->wake);
+
+        // a callback queued behind a busy worker is stolen by an idle one
+        if (atomic_load(&worker->busy))
+        {
+            bool woken = false;
+
+            for (uint32_t index = 0; (index < gvTM_state.num_workers) && !woken; index++)
+            {
+                if (!atomic_load(&gvTM_state.workers[index].busy))
+                {
+                    (void)os_sem_give(&gvTM_state.workers[index].wake);
+                    woken = true;
+                }
+            }
+        }
+    }
+
+    return dispatched;
+}
+
+void tm_worker_run(TM_Task *task)
+{
+    task->start_ns = os_timestamp_nanoseconds();
+
+    uint64_t release_ns = atomic_load(&task->release_ns);
+
+    os_seqlock_write_begin(&task->timing_lock);
+    if (task->start_ns > release_ns)
+    {
+        tm_histogram_record(&task->timing.jitter, task->start_ns - release_ns);
+    }
+    else
+    {
+        tm_histogram_record(&task->timing.jitter, 0);
+    }
+    os_seqlock_write_end(&task->timing_lock);
+
+    (*task->function)(task->argument);
+
+    uint64_t execution_ns = os_timestamp_nanoseconds() - task->start_ns;
+
+    os_seqlock_write_begin(&task->timing_lock);
+    tm_histogram_record(&task->timing.execution, execution_ns);
+    os_seqlock_write_end(&task->timing_lock);
+
+    // the callback may be released again once it is done
+    atomic_store(&task->executing, false);
+}
+
+bool tm_worker_find(TM_Worker *worker, TM_TaskId *task_id)
+{
+    bool taken = false;
+
+    for (uint32_t offset = 0; (offset < gvTM_state.num_workers) && !taken; offset++)
+    {
+        uint32_t index = (worker->index + offset) % gvTM_state.num_workers;
+
+        taken = tm_work_queue_take(&gvTM_state.workers[index].queue, task_id);
+    }
+
+    return taken;
+}
+
+void tm_worker_task(void *argument)
+{
+    TM_Worker *worker = (TM_Worker*)argument;
+
+    while (gvTM_state.continue_running)
+    {
+        TM_TaskId task_id = 0;
+
+        bool taken = tm_worker_find(worker, &task_id);
+
+        if (!taken)
+        {
+            // the worker is marked idle before it looks again, so a callback
+            // queued meanwhile is either found here or wakes the worker.
+            atomic_store(&worker->busy, false);
+
+            taken = tm_worker_find(worker, &task_id);
+            if (!taken)
+            {
+                (void)os_sem_take(&worker->wake, OS_TIMEOUT_WAIT_FOREVER);
+            }
+        }
+
+        if (taken)
+        {
+            atomic_store(&worker->busy, true);
+
+            tm_worker_run(&gvTM_state.tasks[task_id]);
+        }
+    }
+}
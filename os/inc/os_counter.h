@@ -0,0 +1,53 @@
+/**
+ * @file os_counter.h
+ *
+ * @author Noah Ryan
+ *
+ * This file contains definitions for the OS sharded counter abstraction
+ * used by the fsw. A set of counters is split into shards, each on its own
+ * cache line, and each task counts in its own shard. Counting never writes
+ * to a cache line used by another task, unless there are more counting tasks
+ * than shards, and the shards are only summed when the counts are read.
+ */
+#ifndef __OS_COUNTER_H__
+#define __OS_COUNTER_H__
+
+#include "stdint.h"
+
+#include "os_definitions.h"
+
+
+/**
+ * @brief os_counters_init
+ *
+ * This function sets every counter in a set to zero.
+ *
+ * @param[in] counters - a non-NULL pointer to the counters to initialize.
+ */
+void os_counters_init(OS_Counters *counters);
+
+/**
+ * @brief os_counters_add
+ *
+ * This function adds to a counter in the calling task's shard.
+ *
+ * @param[in] counters - a non-NULL pointer to the set of counters.
+ * @param[in] counter - the index of the counter, less than OS_COUNTER_MAX_COUNTERS.
+ * @param[in] amount - the amount to add to the counter.
+ */
+void os_counters_add(OS_Counters *counters, uint32_t counter, uint32_t amount);
+
+/**
+ * @brief os_counters_sum
+ *
+ * This function sums a counter over every shard. Counts added while the
+ * shards are summed may or may not be included.
+ *
+ * @param[in] counters - a non-NULL pointer to the set of counters.
+ * @param[in] counter - the index of the counter, less than OS_COUNTER_MAX_COUNTERS.
+ *
+ * @return The total of the counter, which wraps at UINT32_MAX like a plain count.
+ */
+uint32_t os_counters_sum(OS_Counters *counters, uint32_t counter);
+
+#endif // ndef __OS_COUNTER_H__ */
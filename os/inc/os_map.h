@@ -0,0 +1,48 @@
+/**
+ * @file os_map.h
+ *
+ * @author Noah Ryan
+ *
+ * This file contains definitions for the OS mapped file abstraction used
+ * by the fsw. A mapped file is a file whose contents are accessed directly
+ * in memory. Writes to the memory are written to the file by the OS, without
+ * a call per write, and are kept if the process exits or restarts.
+ */
+#ifndef __OS_MAP_H__
+#define __OS_MAP_H__
+
+#include "stdint.h"
+
+#include "os_definitions.h"
+
+
+/**
+ * @brief os_map_file
+ *
+ * This function maps a file into memory, creating the file if it does not
+ * exist. The file is resized to the size of the mapping, and any new part
+ * of the file reads as zeros.
+ *
+ * @param[out] map - a non-NULL pointer to the mapped file to fill out.
+ * @param[in] path - a non-NULL path to the file.
+ * @param[in] size_bytes - the size of the mapping, which must not be 0.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_map_file(OS_MappedFile *map, const char *path, uint32_t size_bytes);
+
+/**
+ * @brief os_unmap_file
+ *
+ * This function unmaps a file mapped with os_map_file. The file's contents
+ * are kept.
+ *
+ * @param[in] map - a non-NULL pointer to the mapped file.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_unmap_file(OS_MappedFile *map);
+
+#endif // ndef __OS_MAP_H__ */
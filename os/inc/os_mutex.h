@@ -20,13 +20,26 @@
 /**
  * @brief os_mutex_create
  *
- * This function creates a mutex.
+ * This function creates a mutex of the default type.
  *
  * @return A OS result type either indicating success (OS_RESULT_OKAY)
  * or an error code indicating the cause of the error.
  */
 OS_RESULT_ENUM os_mutex_create(OS_Mutex *mutex);
 
+/**
+ * @brief os_mutex_create_type
+ *
+ * This function creates a mutex of the given type.
+ *
+ * @param[out] mutex - the mutex to create.
+ * @param[in] type - the type of mutex to create.
+ *
+ * @return A OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_mutex_create_type(OS_Mutex *mutex, OS_MUTEX_TYPE_ENUM type);
+
 /**
  * @brief os_mutex_take
  *
@@ -54,4 +67,18 @@ OS_RESULT_ENUM os_mutex_take(OS_Mutex *mutex, OS_Timeout timeout);
  */
 OS_RESULT_ENUM os_mutex_give(OS_Mutex *mutex);
 
+/**
+ * @brief os_mutex_get_stats
+ *
+ * This function copies a mutex's contention statistics. The mutex is taken
+ * while the statistics are copied, so they are consistent with each other.
+ *
+ * @param[in] mutex - the mutex to read.
+ * @param[out] stats - a non-NULL pointer to fill out with the statistics.
+ *
+ * @return An OS result indicating either success (OS_RESULT_OKAY)
+ * or indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_mutex_get_stats(OS_Mutex *mutex, OS_MutexStats *stats);
+
 #endif // ndef __OS_MUTEX_H__ */
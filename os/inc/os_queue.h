@@ -40,6 +40,30 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
                                uint32_t num_msgs,
                                uint32_t msg_size_bytes);
 
+/**
+ * @brief os_queue_create_type
+ *
+ * This function creates a new queue of a given type. OS_QUEUE_TYPE_DEFAULT
+ * creates the same queue as os_queue_create. The ring types create a
+ * lock-free ring, which only blocks in the OS when the ring is empty
+ * (on receive) or full (on send).
+ *
+ * Ring queues round their capacity up to a power of two, and must be used
+ * with the number of senders and receivers their type allows.
+ *
+ * @param[in,out] queue - a non-NULL pointer to a OS_Queue.
+ * @param[in] num_msgs - the number of messages that this queue supports.
+ * @param[in] msg_size_bytes - the maximum size of a message place on this queue.
+ * @param[in] type - the type of queue to create.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_queue_create_type(OS_Queue *queue,
+                                    uint32_t num_msgs,
+                                    uint32_t msg_size_bytes,
+                                    OS_QUEUE_TYPE_ENUM type);
+
 /**
  * @brief os_queue_send
  *
@@ -58,6 +82,29 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
                              uint32_t buffer_size_bytes,
                              OS_Timeout timeout);
 
+/**
+ * @brief os_queue_send_priority
+ *
+ * This function attempts to send a message on the given queue with a
+ * priority. Higher priority messages are received before lower priority
+ * messages, and messages of the same priority are received in order.
+ * os_queue_send sends with OS_QUEUE_PRIORITY_DEFAULT.
+ *
+ * @param[in] queue - a non-NULL pointer to a OS_Queue.
+ * @param[in] buffer - a pointer to a buffer to place on the queue.
+ * @param[in] buffer_size_bytes - the size of the buffer to copy.
+ * @param[in] priority - the message priority, less than OS_QUEUE_NUM_PRIORITIES.
+ * @param[in] timeout - the timeout to wait in case the queue is full.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_queue_send_priority(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t buffer_size_bytes,
+                                      uint32_t priority,
+                                      OS_Timeout timeout);
+
 /**
  * @brief os_queue_receive
  *
@@ -78,4 +125,83 @@ OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
                                 uint32_t *buffer_size_bytes,
                                 OS_Timeout timeout);
 
+/**
+ * @brief os_queue_receive_priority
+ *
+ * This function attempts to receive the highest priority message
+ * from a given queue.
+ *
+ * @param[in] queue - a non-NULL pointer to a OS_Queue.
+ * @param[in] buffer - a pointer to a buffer to place the message in.
+ * @param[in,out] buffer_size_bytes - a pointer to the size of the buffer
+ *                 to copy into. The pointer will be filled with the
+ *                 actual message size if this function returns OS_RESULT_OKAY.
+ * @param[out] priority - filled out with the priority of the message.
+ * @param[in] timeout - the timeout to wait in case the queue is empty.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_queue_receive_priority(OS_Queue *queue,
+                                         uint8_t *buffer,
+                                         uint32_t *buffer_size_bytes,
+                                         uint32_t *priority,
+                                         OS_Timeout timeout);
+
+/**
+ * @brief os_queue_send_batch
+ *
+ * This function sends a batch of messages on the given queue, in order,
+ * with OS_QUEUE_PRIORITY_DEFAULT.
+ * Ring and portable queues place every message that fits while holding the
+ * queue once, and only wait when the queue is full. The timeout applies to
+ * each wait for space.
+ *
+ * @param[in] queue - a non-NULL pointer to a OS_Queue.
+ * @param[in] buffers - an array of pointers to the messages to send.
+ * @param[in] buffer_sizes_bytes - an array of the size of each message.
+ * @param[in] num_msgs - the number of messages in the batch.
+ * @param[out] num_sent - filled out with the number of messages sent. Messages
+ *                 are sent in order, so these are the first 'num_sent' messages.
+ * @param[in] timeout - the timeout to wait in case the queue is full.
+ *
+ * @return OS_RESULT_OKAY if every message was sent, or an error code
+ * indicating why the message after the last one sent was not sent.
+ */
+OS_RESULT_ENUM os_queue_send_batch(OS_Queue *queue,
+                                   uint8_t **buffers,
+                                   uint32_t *buffer_sizes_bytes,
+                                   uint32_t num_msgs,
+                                   uint32_t *num_sent,
+                                   OS_Timeout timeout);
+
+/**
+ * @brief os_queue_receive_batch
+ *
+ * This function receives up to a given number of messages from a queue.
+ * It waits up to the timeout for the first message, and then takes every
+ * message already on the queue, up to 'max_msgs', without waiting again.
+ * Messages are received highest priority first.
+ *
+ * @param[in] queue - a non-NULL pointer to a OS_Queue.
+ * @param[out] buffer - a buffer of 'max_msgs' messages of 'msg_size_bytes'
+ *                 each. Message n is placed at offset n * msg_size_bytes.
+ * @param[in] msg_size_bytes - the space for each message in the buffer.
+ * @param[out] msg_sizes - an array of 'max_msgs' sizes, filled out with
+ *                 the size of each received message.
+ * @param[in] max_msgs - the maximum number of messages to receive.
+ * @param[out] num_received - filled out with the number of messages received.
+ * @param[in] timeout - the timeout to wait in case the queue is empty.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_queue_receive_batch(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t msg_size_bytes,
+                                      uint32_t *msg_sizes,
+                                      uint32_t max_msgs,
+                                      uint32_t *num_received,
+                                      OS_Timeout timeout);
+
 #endif // ndef __OS_QUEUE_H__ */
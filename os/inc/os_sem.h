@@ -55,4 +55,18 @@ OS_RESULT_ENUM os_sem_give(OS_Sem *sem);
  */
 OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout);
 
+/**
+ * @brief os_sem_delete
+ *
+ * This function deletes a semaphore, releasing any resources it holds.
+ * No task may be blocked on the semaphore, and it may not be used again
+ * unless it is created again.
+ *
+ * @param[in] sem - the semaphore to delete.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_sem_delete(OS_Sem *sem);
+
 #endif // ndef __OS_SEM_H__ */
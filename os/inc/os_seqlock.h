@@ -0,0 +1,68 @@
+/**
+ * @file os_seqlock.h
+ *
+ * @author Noah Ryan
+ *
+ * This file contains definitions for the OS sequence lock abstraction
+ * used by the fsw. A sequence lock protects data that is updated often
+ * and read rarely, such as a module's status counters. Writers never wait,
+ * and a reader copies the data again if a write happened during its copy,
+ * so a reader always gets a consistent copy without blocking writers.
+ *
+ * Any number of tasks may write at the same time. Writers are not
+ * serialized with each other, so data written by more than one task at a
+ * time must still be updated with atomic operations, or by a single writer.
+ */
+#ifndef __OS_SEQLOCK_H__
+#define __OS_SEQLOCK_H__
+
+#include "stdint.h"
+
+#include "os_definitions.h"
+
+
+/**
+ * @brief os_seqlock_init
+ *
+ * This function initializes a sequence lock with no writes in progress.
+ *
+ * @param[in] lock - a non-NULL pointer to the lock to initialize.
+ */
+void os_seqlock_init(OS_Seqlock *lock);
+
+/**
+ * @brief os_seqlock_write_begin
+ *
+ * This function starts an update of the data protected by a lock.
+ * Readers that overlap the update copy the data again.
+ *
+ * @param[in] lock - a non-NULL pointer to the lock.
+ */
+void os_seqlock_write_begin(OS_Seqlock *lock);
+
+/**
+ * @brief os_seqlock_write_end
+ *
+ * This function ends an update started by os_seqlock_write_begin.
+ *
+ * @param[in] lock - a non-NULL pointer to the lock.
+ */
+void os_seqlock_write_end(OS_Seqlock *lock);
+
+/**
+ * @brief os_seqlock_read
+ *
+ * This function copies the data protected by a lock, retrying until the
+ * copy did not overlap an update.
+ *
+ * @param[in] lock - a non-NULL pointer to the lock.
+ * @param[out] destination - a non-NULL pointer to copy the data to.
+ * @param[in] source - a non-NULL pointer to the data protected by the lock.
+ * @param[in] size_bytes - the size of the data.
+ */
+void os_seqlock_read(OS_Seqlock *lock,
+                     void *destination,
+                     const void *source,
+                     uint32_t size_bytes);
+
+#endif // ndef __OS_SEQLOCK_H__ */
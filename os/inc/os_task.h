@@ -27,9 +27,11 @@ typedef void (OS_TASK_FUNC)(void*);
 typedef enum
 {
   OS_TASK_STATUS_INVALID      = 0,
-  OS_TASK_STATUS_OKAY         = 1,
-  OS_TASK_STATUS_TASK_UNKNOWN = 2,
+  OS_TASK_STATUS_OKAY         = 1, /*<< The task is running, or ready to run */
+  OS_TASK_STATUS_TASK_UNKNOWN = 2, /*<< The task was not spawned, or has been joined */
   OS_TASK_STATUS_TASK_CRASHED = 3,
+  OS_TASK_STATUS_TASK_EXITED  = 4, /*<< The task's function has returned */
+  OS_TASK_STATUS_TASK_BLOCKED = 5, /*<< The task is waiting in an OS abstraction */
   OS_TASK_STATUS_NUM_STATUS
 } OS_TASK_STATUS_ENUM;
 
@@ -37,7 +39,12 @@ typedef enum
 /**
  * @brief os_task_spawn
  *
- * This function spawns a new task.
+ * This function spawns a new task. The task's control block comes from a
+ * fixed table of OS_CONFIG_MAX_TASKS blocks rather than the heap, and the
+ * task's stack is prefaulted (and locked if OS_CONFIG_TASK_LOCK_STACKS is
+ * set) before this function returns, so the task does not page fault on
+ * its stack once it is running. The task is joinable, and its control
+ * block is returned to the table by os_task_join.
  *
  * @return A OS result type either indicating success (OS_RESULT_OKAY)
  * or an error code indicating the cause of the error.
@@ -48,17 +55,129 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
                              int priority,
                              int stack_size);
 
+/**
+ * @brief os_task_spawn_affinity
+ *
+ * This function spawns a new task that only runs on the given CPUs.
+ * Pinning a task to CPUs keeps it from migrating between CPUs, and keeps
+ * other tasks' data out of its CPUs' caches.
+ *
+ * @param[in] cpus - the CPUs the task may run on, or OS_CPU_MASK_ANY to
+ * let the task run on any CPU, as os_task_spawn does.
+ *
+ * @return A OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_task_spawn_affinity(OS_Task *task,
+                                      OS_TASK_FUNC *function,
+                                      void *argument,
+                                      int priority,
+                                      int stack_size,
+                                      OS_CpuMask cpus);
+
+/**
+ * @brief os_task_join
+ *
+ * This function waits for a task to exit, and then releases its control
+ * block. A task that is joined must not be used again, and its handle is
+ * cleared.
+ *
+ * @param[in,out] task - the task to join.
+ * @param[in] timeout - the number of system clock ticks to wait for the task
+ * to exit, OS_TIMEOUT_NO_WAIT, or OS_TIMEOUT_WAIT_FOREVER.
+ *
+ * @return OS_RESULT_OKAY if the task exited, OS_RESULT_TIMEOUT if it is
+ * still running at the timeout, or an error code indicating the cause of
+ * the error.
+ */
+OS_RESULT_ENUM os_task_join(OS_Task *task, OS_Timeout timeout);
+
+/**
+ * @brief os_task_isolated_cpus
+ *
+ * This function provides the CPUs isolated from the OS scheduler, such as
+ * with the isolcpus kernel parameter. Only tasks pinned to these CPUs run
+ * on them, so they are suited to tasks sensitive to jitter.
+ *
+ * @param[out] cpus - the isolated CPUs, or OS_CPU_MASK_ANY if none are isolated.
+ *
+ * @return A OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_task_isolated_cpus(OS_CpuMask *cpus);
+
+/**
+ * @brief os_task_num_cpus
+ *
+ * This function provides the number of CPUs online.
+ *
+ * @return the number of CPUs, which is at least 1.
+ */
+uint32_t os_task_num_cpus(void);
+
 /**
  * @brief os_task_status
  *
  * This function returns a OS_TASK_STATUS_ENUM value indicating the
- * current status of the task.
+ * current status of the task. A task is blocked while it waits on a
+ * semaphore, queue, futex or delay of the OS abstraction, and has exited
+ * once its function returns.
  *
  * @return A value of type OS_TASK_STATUS_ENUM, indicating the
  * current status of the task.
  */
 OS_TASK_STATUS_ENUM os_task_status(OS_Task *task);
 
+/**
+ * @brief os_task_cpu_time
+ *
+ * This function provides the CPU time a task has used, measured on the
+ * task's thread CPU clock. The CPU time of a task that has exited is its
+ * total CPU time.
+ *
+ * @param[in] task - the task to measure.
+ * @param[out] nanoseconds - the task's CPU time, in nanoseconds.
+ *
+ * @return A OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_task_cpu_time(OS_Task *task, uint64_t *nanoseconds);
+
+/**
+ * @brief os_task_block_begin
+ *
+ * This function marks the calling task as blocked, for os_task_status.
+ * It is called by OS abstractions before they wait, and does nothing in a
+ * thread that was not spawned by os_task_spawn.
+ */
+void os_task_block_begin(void);
+
+/**
+ * @brief os_task_block_end
+ *
+ * This function marks the calling task as running again after a wait
+ * started with os_task_block_begin.
+ */
+void os_task_block_end(void);
+
+/**
+ * @brief os_task_on_exit
+ *
+ * This function registers a hook that is called by the calling task when
+ * its function returns. Hooks are called in the reverse of the order they
+ * were registered, and allow a module to release a resource that the task
+ * claimed for itself.
+ *
+ * @param[in] hook - the function to call when the task exits.
+ * @param[in] argument - the argument passed to the hook.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error. A thread that was
+ * not spawned by os_task_spawn, or that has registered
+ * OS_CONFIG_MAX_TASK_EXIT_HOOKS hooks, can not register a hook.
+ */
+OS_RESULT_ENUM os_task_on_exit(void (*hook)(void *argument), void *argument);
+
 /**
  * @brief os_task_delay
  *
@@ -67,7 +186,24 @@ OS_TASK_STATUS_ENUM os_task_status(OS_Task *task);
  *
  * @param timeout - the number of system clock ticks to delay.
  *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_task_delay(OS_Timeout timeout);
+
+/**
+ * @brief os_task_delay_until
+ *
+ * This function delays (sleeps) a task until an absolute time, on the
+ * clock of os_timestamp_nanoseconds. Sleeping to a deadline rather than
+ * for a duration keeps a task that repeats the delay from drifting by
+ * the time it spends running. A time that has passed returns immediately.
+ *
+ * @param deadline_ns - the time to sleep until, in nanoseconds.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
  */
-OS_TASK_STATUS_ENUM os_task_delay(OS_Timeout timeout);
+OS_RESULT_ENUM os_task_delay_until(uint64_t deadline_ns);
 
 #endif // ndef __OS_TASK_H__ */
@@ -52,4 +52,26 @@ OS_TimeStamp os_timestamp(void);
  */
 double os_timestamp_double(void);
 
+/**
+ * This function provides a timestamp as a number of nanoseconds. This is
+ * the same timestamp provided by os_timestamp, in a form that can be
+ * subtracted directly to measure short intervals.
+ *
+ * @return the current time in nanoseconds.
+ * If an error occurs in sampling the time then the return value
+ * will be 0.
+ */
+uint64_t os_timestamp_nanoseconds(void);
+
+/**
+ * This function provides the CPU time used by all tasks in the process,
+ * as a number of nanoseconds. Dividing the CPU time used over an interval
+ * by the length of the interval gives the number of CPUs kept busy.
+ *
+ * @return the process's CPU time in nanoseconds.
+ * If an error occurs in sampling the time then the return value
+ * will be 0.
+ */
+uint64_t os_process_cpu_nanoseconds(void);
+
 #endif // ndef __OS_TIME_H__ */
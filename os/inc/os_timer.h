@@ -10,12 +10,18 @@
 #define __OS_TIMER_H__
 
 #include "stdbool.h"
+#include "stdint.h"
 
 #include <signal.h>
 
 #include "os_definitions.h"
 
 
+/**
+ * This definition is the maximum number of timers when timers are
+ * implemented with real time signals. Timers that run in a timer task
+ * are not limited.
+ */
 #define OS_MAX_TIMERS 32
 
 
@@ -65,4 +71,50 @@ OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
  */
 OS_RESULT_ENUM os_timer_stop(OS_Timer *timer);
 
+/**
+ * This function starts a timer which expires once, at an absolute time,
+ * given a pointer to a timer created by os_timer_create and a callback.
+ * The time is on the clock of os_timestamp_nanoseconds, and a time that
+ * has already passed expires the timer immediately. Starting the timer
+ * again replaces the previous expiration, and the return value of the
+ * callback has no effect.
+ *
+ * @param[in] timer - a pointer to a timer.
+ * @param[in] function - the callback function to run when the timer executes.
+ * @param[in] argument - the argument that will be passed to the 'callback' function
+ *                       when the timer triggers.
+ * @param[in] deadline_ns - the time at which the timer executes, in nanoseconds.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_timer_start_absolute(OS_Timer *timer,
+                                       OS_TIMER_FUNC callback,
+                                       void *argument,
+                                       uint64_t deadline_ns);
+
+/**
+ * This function stops a timer and releases its resources. The timer
+ * must be created again before it can be started.
+ *
+ * @param[in] timer - a pointer to a timer.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_timer_delete(OS_Timer *timer);
+
+/**
+ * This function provides the number of times a timer expired without
+ * its callback being run, because the callback for an earlier expiration
+ * had not yet been run. This is counted from when the timer was created.
+ *
+ * @param[in] timer - a pointer to a timer.
+ * @param[out] overruns - a non-NULL pointer to fill out with the count.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_timer_get_overruns(OS_Timer *timer, uint32_t *overruns);
+
 #endif // ndef __OS_TIMER_H__ */
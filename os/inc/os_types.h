@@ -8,6 +8,7 @@
  */
 #ifndef __OS_TYPES_H__
 #define __OS_TYPES_H__
+#include "stdint.h"
 #include "stdbool.h"
 
 
@@ -32,6 +33,29 @@
  */
 #define OS_CONFIG_MAX_NAME_LENGTH (256)
 
+/**
+ * This definition is the maximum number of exit hooks each task can
+ * register with os_task_on_exit.
+ */
+#define OS_CONFIG_MAX_TASK_EXIT_HOOKS (4)
+
+/**
+ * This definition is the maximum number of tasks that can exist at once.
+ * Each task uses a task control block from a fixed table, which is only
+ * returned to the table once the task has been joined.
+ */
+#define OS_CONFIG_MAX_TASKS (64)
+
+/**
+ * This definition determines whether each task's stack is locked into
+ * memory with mlock when the task is spawned, so the task never takes a
+ * page fault on its stack. Locking may need privileges or a raised
+ * RLIMIT_MEMLOCK, and a task whose stack cannot be locked still runs.
+ */
+#ifndef OS_CONFIG_TASK_LOCK_STACKS
+#define OS_CONFIG_TASK_LOCK_STACKS 0
+#endif
+
 /**
  * This definition is the number of nanoseconds per second.
  */
@@ -56,6 +80,35 @@
  */
 #define OS_HANDLE_INVALID (0)
 
+/**
+ * This definition is the number of message priorities supported by queues.
+ * Priorities run from 0 (lowest) to OS_QUEUE_NUM_PRIORITIES - 1 (highest),
+ * and a queue gives out its highest priority messages first.
+ */
+#define OS_QUEUE_NUM_PRIORITIES 4
+
+/**
+ * This definition is the priority of messages sent without a priority.
+ * It leaves a lower priority for bulk traffic.
+ */
+#define OS_QUEUE_PRIORITY_DEFAULT 1
+
+/**
+ * This definition is the number of CPUs that can be named in an OS_CpuMask.
+ */
+#define OS_CPU_MAX 64
+
+/**
+ * This definition is a CPU mask that does not restrict a task to any CPU,
+ * leaving the OS to choose where the task runs.
+ */
+#define OS_CPU_MASK_ANY (0ULL)
+
+/**
+ * This definition is the CPU mask with only the given CPU in it.
+ */
+#define OS_CPU_MASK(cpu) (1ULL << (cpu))
+
 
 /**
  * An OS timeout is used for indicating whether to block
@@ -63,6 +116,12 @@
  */
 typedef int OS_Timeout;
 
+/**
+ * An OS CPU mask is a set of CPUs, with bit n set if the task may run on
+ * CPU n. A mask of OS_CPU_MASK_ANY lets the task run on any CPU.
+ */
+typedef uint64_t OS_CpuMask;
+
 /**
  * An OS_TIMER_FUNC is the callback function provided to a timer to
  * be called on a timeout.
@@ -85,7 +144,48 @@ typedef enum OS_RESULT_ENUM
 	OS_RESULT_ERROR              = 6, /*<< An error was returned by an OS function */
 	OS_RESULT_INVALID_ARGUMENTS  = 7, /*<< Invalid arguments provided to an os abstraction function */
 	OS_RESULT_QUEUE_CREATE_ERROR = 8, /*<< Error creating queue */
+	OS_RESULT_MAX_TASKS_REACHED  = 9, /*<< Maximum number of tasks reached */
 	OS_RESULT_NUM_RESULTS /*<< Number of result codes */
 } OS_RESULT_ENUM;
 
+/**
+ * This definition is the type of queue to create with os_queue_create_type.
+ * The default queue is the OS's own queue, while the ring types are lock-free
+ * rings that only call into the OS when a sender or receiver has to block.
+ */
+typedef enum OS_QUEUE_TYPE_ENUM
+{
+	OS_QUEUE_TYPE_DEFAULT   = 0, /*<< The OS abstraction's default queue */
+	OS_QUEUE_TYPE_SPSC      = 1, /*<< Lock-free ring with a single sender and a single receiver */
+	OS_QUEUE_TYPE_MPSC      = 2, /*<< Lock-free ring with multiple senders and a single receiver */
+	OS_QUEUE_TYPE_NUM_TYPES      /*<< Number of queue types */
+} OS_QUEUE_TYPE_ENUM;
+
+/**
+ * This definition is the type of mutex to create with os_mutex_create_type.
+ * An adaptive mutex spins briefly when it is held by another task before
+ * blocking, which avoids a context switch for short critical sections.
+ */
+typedef enum OS_MUTEX_TYPE_ENUM
+{
+	OS_MUTEX_TYPE_DEFAULT   = 0, /*<< Blocks as soon as the mutex is held by another task */
+	OS_MUTEX_TYPE_ADAPTIVE  = 1, /*<< Spins before blocking when the mutex is held by another task */
+	OS_MUTEX_TYPE_NUM_TYPES      /*<< Number of mutex types */
+} OS_MUTEX_TYPE_ENUM;
+
+/**
+ * This definition is the contention statistics kept by each mutex.
+ * A recursive take or give by the task holding the mutex is not counted.
+ */
+typedef struct OS_MutexStats
+{
+	uint32_t takes;           /*<< Number of times the mutex was taken */
+	uint32_t contended_takes; /*<< Number of takes that found the mutex held by another task */
+	uint32_t spin_takes;      /*<< Number of contended takes that took the mutex while spinning */
+	uint64_t wait_ns;         /*<< Total time spent waiting in contended takes */
+	uint64_t max_wait_ns;     /*<< Longest wait in a contended take */
+	uint64_t hold_ns;         /*<< Total time the mutex was held */
+	uint64_t max_hold_ns;     /*<< Longest time the mutex was held */
+} OS_MutexStats;
+
 #endif // ndef __OS_TYPES_H__ */
@@ -6,8 +6,13 @@
  * This file contains the unit tests for the OS module of the Protoflight software.
  * The test are Unity (ThrowTheSwitch) test fixtures.
  */
+// sched_getcpu is a GNU extension
+#define _GNU_SOURCE
+
 #include "stdbool.h"
+#include "stdatomic.h"
 #include "string.h"
+#include "sched.h"
 
 #include "errno.h"
 
@@ -21,12 +26,16 @@
 #include "os_task.h"
 #include "os_mutex.h"
 #include "os_sem.h"
+#include "os_seqlock.h"
+#include "os_counter.h"
+#include "os_map.h"
 
 
 const uint32_t OS_QUEUE_TEST_MSG_SIZE = 8;
 const uint32_t OS_QUEUE_TEST_NUM_MSGS = 3;
 
 OS_Queue gvOS_test_queue;
+OS_Queue gvOS_test_ring;
 OS_Timer gvOS_test_timer;
 OS_Mutex gvOS_test_mutex;
 OS_Sem gvOS_test_sem;
@@ -34,6 +43,25 @@ OS_Sem gvOS_test_sem;
 bool gvOS_timerFlag = false;
 bool gvOS_taskFlag = false;
 
+const uint32_t OS_QUEUE_RING_TEST_NUM_MSGS = 4;
+const uint32_t OS_QUEUE_RING_TEST_PRODUCER_MSGS = 10000;
+
+#define OS_SEQLOCK_TEST_NUM_WORDS 64
+#define OS_SEQLOCK_TEST_NUM_WRITES 4096
+
+OS_Seqlock gvOS_test_seqlock;
+uint32_t gvOS_test_seqlock_data[OS_SEQLOCK_TEST_NUM_WORDS];
+atomic_bool gvOS_test_seqlock_done;
+
+#define OS_COUNTER_TEST_NUM_TASKS 4
+#define OS_COUNTER_TEST_NUM_ADDS 10000
+
+OS_Counters gvOS_test_counters;
+OS_Sem gvOS_test_counters_done;
+
+#define OS_MAP_TEST_SIZE 4096
+#define OS_MAP_TEST_OFFSET 100
+
 
 /* Test Queues */
 TEST_GROUP(OS_QUEUE);
@@ -222,6 +250,316 @@ TEST(OS_QUEUE, queue_receive_empty)
   TEST_ASSERT_EQUAL(OS_QUEUE_TEST_MSG_SIZE, size);
 }
 
+void os_test_queue_batch(OS_Queue *queue, uint32_t capacity)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint8_t messages[5][8];
+  uint8_t *buffers[5];
+  uint32_t sizes[5];
+
+  uint8_t received[5][8];
+  uint32_t received_sizes[5];
+
+  uint32_t num_sent = 0;
+  uint32_t num_received = 0;
+
+  for (uint32_t index = 0; index < 5; index++)
+  {
+    memset(messages[index], index, sizeof(messages[index]));
+    buffers[index] = messages[index];
+    sizes[index] = OS_QUEUE_TEST_MSG_SIZE - index;
+  }
+
+  // the batch stops at the first message that does not fit
+  result = os_queue_send_batch(queue, buffers, sizes, 5, &num_sent, OS_TIMEOUT_NO_WAIT);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+  TEST_ASSERT_EQUAL(capacity, num_sent);
+
+  result = os_queue_receive_batch(queue, (uint8_t*)received, sizeof(received[0]), received_sizes, 2, &num_received, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_EQUAL(2, num_received);
+
+  result = os_queue_receive_batch(queue, (uint8_t*)&received[2], sizeof(received[0]), &received_sizes[2], 3, &num_received, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_EQUAL(capacity - 2, num_received);
+
+  for (uint32_t index = 0; index < capacity; index++)
+  {
+    TEST_ASSERT_EQUAL(sizes[index], received_sizes[index]);
+    TEST_ASSERT_EQUAL_MEMORY(messages[index], received[index], received_sizes[index]);
+  }
+
+  result = os_queue_receive_batch(queue, (uint8_t*)received, sizeof(received[0]), received_sizes, 5, &num_received, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+  TEST_ASSERT_EQUAL(0, num_received);
+}
+
+TEST(OS_QUEUE, queue_batch)
+{
+  os_test_queue_batch(&gvOS_test_queue, OS_QUEUE_TEST_NUM_MSGS);
+}
+
+TEST(OS_QUEUE, queue_batch_invalid)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint8_t buffer[8];
+  uint8_t *buffers[1] = { buffer };
+  uint32_t sizes[1] = { sizeof(buffer) };
+  uint32_t count = 0;
+
+  result = os_queue_send_batch(NULL, buffers, sizes, 1, &count, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  result = os_queue_send_batch(&gvOS_test_queue, NULL, sizes, 1, &count, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  result = os_queue_receive_batch(&gvOS_test_queue, NULL, sizeof(buffer), sizes, 1, &count, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  result = os_queue_receive_batch(&gvOS_test_queue, buffer, sizeof(buffer), sizes, 0, &count, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+}
+
+void os_test_queue_priority(OS_Queue *queue)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint8_t buffer[8];
+  uint32_t size = OS_QUEUE_TEST_MSG_SIZE;
+  uint32_t priority = 0;
+
+  // messages are sent lowest priority first, and the two messages of the
+  // same priority must keep their order.
+  uint32_t send_priorities[3] = { 0, OS_QUEUE_NUM_PRIORITIES - 1, OS_QUEUE_NUM_PRIORITIES - 1 };
+  uint8_t expected_order[3] = { 1, 2, 0 };
+
+  result = os_queue_send_priority(queue, buffer, sizeof(buffer), OS_QUEUE_NUM_PRIORITIES, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+
+  for (uint32_t index = 0; index < 3; index++)
+  {
+    memset(buffer, index, sizeof(buffer));
+
+    result = os_queue_send_priority(queue, buffer, sizeof(buffer), send_priorities[index], 1);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  for (uint32_t index = 0; index < 3; index++)
+  {
+    size = OS_QUEUE_TEST_MSG_SIZE;
+    result = os_queue_receive_priority(queue, buffer, &size, &priority, 1);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(expected_order[index], buffer[0]);
+    TEST_ASSERT_EQUAL(send_priorities[expected_order[index]], priority);
+  }
+
+  // os_queue_send uses the default priority
+  result = os_queue_send(queue, buffer, sizeof(buffer), 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  size = OS_QUEUE_TEST_MSG_SIZE;
+  result = os_queue_receive_priority(queue, buffer, &size, &priority, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_EQUAL(OS_QUEUE_PRIORITY_DEFAULT, priority);
+
+  result = os_queue_receive_priority(queue, buffer, &size, NULL, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+}
+
+TEST(OS_QUEUE, queue_priority)
+{
+  os_test_queue_priority(&gvOS_test_queue);
+}
+
+
+/* Test Ring Queues */
+TEST_GROUP(OS_QUEUE_RING);
+
+TEST_SETUP(OS_QUEUE_RING)
+{
+}
+
+TEST_TEAR_DOWN(OS_QUEUE_RING)
+{
+  memset(&gvOS_test_ring, 0, sizeof(OS_Queue));
+}
+
+void os_test_ring_fill_and_drain(OS_QUEUE_TYPE_ENUM type)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint32_t size = OS_QUEUE_TEST_MSG_SIZE;
+
+  uint8_t buffer[8];
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, type);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  // empty ring times out without a message
+  result = os_queue_receive(&gvOS_test_ring, buffer, &size, OS_TIMEOUT_NO_WAIT);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+
+  // fill the ring with messages of different sizes
+  for (uint32_t index = 0; index < OS_QUEUE_RING_TEST_NUM_MSGS; index++)
+  {
+    memset(buffer, index, sizeof(buffer));
+
+    result = os_queue_send(&gvOS_test_ring, buffer, OS_QUEUE_TEST_MSG_SIZE - index, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  result = os_queue_send(&gvOS_test_ring, buffer, OS_QUEUE_TEST_MSG_SIZE, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+
+  // messages come out in order with their sizes
+  for (uint32_t index = 0; index < OS_QUEUE_RING_TEST_NUM_MSGS; index++)
+  {
+    size = OS_QUEUE_TEST_MSG_SIZE;
+    result = os_queue_receive(&gvOS_test_ring, buffer, &size, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(OS_QUEUE_TEST_MSG_SIZE - index, size);
+    TEST_ASSERT_EQUAL(index, buffer[0]);
+  }
+
+  size = OS_QUEUE_TEST_MSG_SIZE;
+  result = os_queue_receive(&gvOS_test_ring, buffer, &size, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+}
+
+TEST(OS_QUEUE_RING, ring_create_invalid)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  result = os_queue_create_type(NULL, 10, 10, OS_QUEUE_TYPE_SPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  result = os_queue_create_type(&gvOS_test_ring, 10, 10, OS_QUEUE_TYPE_NUM_TYPES);
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+
+  result = os_queue_create_type(&gvOS_test_ring, 0, 10, OS_QUEUE_TYPE_SPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+
+  result = os_queue_create_type(&gvOS_test_ring, 10, 0, OS_QUEUE_TYPE_MPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+}
+
+TEST(OS_QUEUE_RING, ring_sizes)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint32_t size = OS_QUEUE_TEST_MSG_SIZE - 1;
+
+  uint8_t buffer[16];
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, OS_QUEUE_TYPE_SPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  result = os_queue_send(&gvOS_test_ring, buffer, OS_QUEUE_TEST_MSG_SIZE + 1, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_MSG_SIZE_ERROR, result);
+
+  result = os_queue_send(&gvOS_test_ring, buffer, OS_QUEUE_TEST_MSG_SIZE, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  // the receive buffer must hold the largest message, like the other queues
+  result = os_queue_receive(&gvOS_test_ring, buffer, &size, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_MSG_SIZE_ERROR, result);
+
+  result = os_queue_receive(&gvOS_test_ring, NULL, &size, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+}
+
+TEST(OS_QUEUE_RING, ring_spsc)
+{
+  os_test_ring_fill_and_drain(OS_QUEUE_TYPE_SPSC);
+}
+
+TEST(OS_QUEUE_RING, ring_mpsc)
+{
+  os_test_ring_fill_and_drain(OS_QUEUE_TYPE_MPSC);
+}
+
+TEST(OS_QUEUE_RING, ring_priority)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, OS_QUEUE_TYPE_SPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  os_test_queue_priority(&gvOS_test_ring);
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, OS_QUEUE_TYPE_MPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  os_test_queue_priority(&gvOS_test_ring);
+}
+
+TEST(OS_QUEUE_RING, ring_batch)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, OS_QUEUE_TYPE_SPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  os_test_queue_batch(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS);
+
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, OS_QUEUE_TEST_MSG_SIZE, OS_QUEUE_TYPE_MPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  os_test_queue_batch(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS);
+}
+
+void os_test_ring_producer(void *argument)
+{
+  uint32_t message[2];
+
+  message[0] = *(uint32_t*)argument;
+
+  for (uint32_t index = 0; index < OS_QUEUE_RING_TEST_PRODUCER_MSGS; index++)
+  {
+    message[1] = index;
+
+    (void)os_queue_send(&gvOS_test_ring, (uint8_t*)message, sizeof(message), OS_TIMEOUT_WAIT_FOREVER);
+  }
+}
+
+TEST(OS_QUEUE_RING, ring_mpsc_producers)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  static uint32_t producer_ids[2] = { 0, 1 };
+  uint32_t next_index[2] = { 0, 0 };
+
+  uint32_t message[2];
+  uint32_t size = sizeof(message);
+
+  OS_Task tasks[2];
+
+  // a small ring makes the producers and the receiver block on each other
+  result = os_queue_create_type(&gvOS_test_ring, OS_QUEUE_RING_TEST_NUM_MSGS, sizeof(message), OS_QUEUE_TYPE_MPSC);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  for (uint32_t task_index = 0; task_index < 2; task_index++)
+  {
+    result = os_task_spawn(&tasks[task_index], os_test_ring_producer, &producer_ids[task_index], 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  // every message arrives, and each producer's messages arrive in order
+  for (uint32_t index = 0; index < (2 * OS_QUEUE_RING_TEST_PRODUCER_MSGS); index++)
+  {
+    size = sizeof(message);
+    result = os_queue_receive(&gvOS_test_ring, (uint8_t*)message, &size, 1000);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(sizeof(message), size);
+    TEST_ASSERT_TRUE(message[0] < 2);
+    TEST_ASSERT_EQUAL(next_index[message[0]], message[1]);
+
+    next_index[message[0]]++;
+  }
+
+  size = sizeof(message);
+  result = os_queue_receive(&gvOS_test_ring, (uint8_t*)message, &size, 1);
+  TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+}
+
 
 /* Test Timers */
 TEST_GROUP(OS_TIMER);
@@ -236,6 +574,7 @@ TEST_SETUP(OS_TIMER)
 TEST_TEAR_DOWN(OS_TIMER)
 {
   os_timer_stop(&gvOS_test_timer);
+  os_timer_delete(&gvOS_test_timer);
   memset(&gvOS_test_timer, 0, sizeof(OS_Timer));
 }
 
@@ -243,6 +582,9 @@ TEST(OS_TIMER, timer_create)
 {
   OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
+  result = os_timer_delete(&gvOS_test_timer);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
   result = os_timer_create(&gvOS_test_timer);
   TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
   os_timer_stop(&gvOS_test_timer);
@@ -350,6 +692,124 @@ TEST(OS_TIMER, timer_start_reset)
   os_timer_stop(&gvOS_test_timer);
 }
 
+TEST(OS_TIMER, timer_start_absolute)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  OS_Timeout timeout = 10;
+
+  uint64_t deadline_ns =
+      os_timestamp_nanoseconds() + (timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS);
+
+  // the callback requests a restart, which a one-shot timer ignores
+  result =
+      os_timer_start_absolute(&gvOS_test_timer,
+                              (OS_TIMER_FUNC)os_timer_test_reset,
+                              (void*)&gvOS_timerFlag,
+                              deadline_ns);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  TEST_ASSERT_EQUAL(false, gvOS_timerFlag);
+
+  os_task_delay(timeout + 2);
+  TEST_ASSERT_EQUAL(true, gvOS_timerFlag);
+  TEST_ASSERT_TRUE(os_timestamp_nanoseconds() >= deadline_ns);
+
+  // does not retrigger
+  os_task_delay(timeout + 2);
+  TEST_ASSERT_EQUAL(true, gvOS_timerFlag);
+
+  // a deadline that has passed expires immediately
+  result =
+      os_timer_start_absolute(&gvOS_test_timer,
+                              (OS_TIMER_FUNC)os_timer_test_reset,
+                              (void*)&gvOS_timerFlag,
+                              deadline_ns);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  os_task_delay(2);
+  TEST_ASSERT_EQUAL(false, gvOS_timerFlag);
+
+  result =
+      os_timer_start_absolute(&gvOS_test_timer,
+                              NULL,
+                              NULL,
+                              deadline_ns);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  os_timer_stop(&gvOS_test_timer);
+}
+
+bool os_timer_test_overrun(void *argument)
+{
+    bool *flag = (bool*)argument;
+
+    // the first callback holds up the timer, so the expirations during
+    // it are missed.
+    if (!(*flag))
+    {
+        *flag = true;
+        os_task_delay(20);
+    }
+
+    return true;
+}
+
+TEST(OS_TIMER, timer_overruns)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint32_t overruns = 0;
+
+  result = os_timer_get_overruns(&gvOS_test_timer, &overruns);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_EQUAL(0, overruns);
+
+  result =
+      os_timer_start(&gvOS_test_timer,
+                     (OS_TIMER_FUNC)os_timer_test_overrun,
+                     (void*)&gvOS_timerFlag,
+                     2);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  os_task_delay(40);
+
+  result = os_timer_stop(&gvOS_test_timer);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  result = os_timer_get_overruns(&gvOS_test_timer, &overruns);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_TRUE(overruns > 0);
+
+  result = os_timer_get_overruns(NULL, &overruns);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+  result = os_timer_get_overruns(&gvOS_test_timer, NULL);
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+}
+
+#if defined(OS_TIMER_THREAD)
+TEST(OS_TIMER, timer_create_many)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  // timers in the timer task are not limited by the number of signals
+  OS_Timer timers[OS_MAX_TIMERS * 2];
+
+  for (uint32_t index = 0; index < (OS_MAX_TIMERS * 2); index++)
+  {
+    result = os_timer_create(&timers[index]);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  for (uint32_t index = 0; index < (OS_MAX_TIMERS * 2); index++)
+  {
+    result = os_timer_delete(&timers[index]);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+}
+#endif
+
 TEST_GROUP(OS_TIME);
 
 TEST_SETUP(OS_TIME)
@@ -360,6 +820,21 @@ TEST_TEAR_DOWN(OS_TIME)
 {
 }
 
+TEST(OS_TIME, time_delay_until)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    uint64_t deadline_ns = os_timestamp_nanoseconds() + 500000;
+
+    result = os_task_delay_until(deadline_ns);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    TEST_ASSERT_TRUE(os_timestamp_nanoseconds() >= deadline_ns);
+
+    // a deadline that has passed does not sleep
+    result = os_task_delay_until(deadline_ns);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+}
+
 TEST(OS_TIME, time_not_zero)
 {
     double time_double = os_timestamp_double();
@@ -371,6 +846,22 @@ TEST(OS_TIME, time_not_zero)
     TEST_ASSERT_TRUE((timestamp.seconds != 0) || (timestamp.nanoseconds != 0));
 }
 
+TEST(OS_TIME, time_nanoseconds)
+{
+    uint64_t before = os_timestamp_nanoseconds();
+
+    OS_TimeStamp timestamp = os_timestamp();
+
+    uint64_t after = os_timestamp_nanoseconds();
+
+    uint64_t nanoseconds =
+        ((uint64_t)timestamp.seconds * OS_NANOSECONDS_PER_SECOND) + timestamp.nanoseconds;
+
+    TEST_ASSERT_TRUE(before != 0);
+    TEST_ASSERT_TRUE(before <= nanoseconds);
+    TEST_ASSERT_TRUE(nanoseconds <= after);
+}
+
 TEST(OS_TIME, time_delay)
 {
     double before = os_timestamp_double();
@@ -403,8 +894,31 @@ void os_test_task(void *argument)
     *taskFlag = !(*taskFlag);
 }
 
-TEST_GROUP(OS_TASK);
-
+void os_test_exit_hook(void *argument)
+{
+    (void)os_sem_give((OS_Sem*)argument);
+}
+
+void os_test_exit_hook_task(void *argument)
+{
+    (void)os_task_on_exit(os_test_exit_hook, argument);
+    (void)os_task_on_exit(os_test_exit_hook, argument);
+}
+
+void os_test_cpu_task(void *argument)
+{
+    atomic_int *cpu = (atomic_int*)argument;
+
+    atomic_store(cpu, sched_getcpu());
+}
+
+void os_test_waiting_task(void *argument)
+{
+    (void)os_sem_take((OS_Sem*)argument, OS_TIMEOUT_WAIT_FOREVER);
+}
+
+TEST_GROUP(OS_TASK);
+
 TEST_SETUP(OS_TASK)
 {
     gvOS_taskFlag = false;
@@ -448,6 +962,165 @@ TEST(OS_TASK, task_spawn)
     TEST_ASSERT_EQUAL(true, gvOS_taskFlag);
 }
 
+TEST(OS_TASK, task_spawn_affinity)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+    OS_Task task;
+
+    atomic_int cpu = -1;
+
+    // the task runs on the one CPU in its mask
+    result = os_task_spawn_affinity(&task, os_test_cpu_task, &cpu, 20, 1024 * 10, OS_CPU_MASK(0));
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    os_task_delay(10);
+
+    TEST_ASSERT_EQUAL(0, atomic_load(&cpu));
+
+    OS_CpuMask cpus;
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_task_isolated_cpus(NULL));
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_isolated_cpus(&cpus));
+}
+
+TEST(OS_TASK, task_join)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+    OS_Task task;
+    OS_Sem sem;
+
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_task_join(NULL, OS_TIMEOUT_NO_WAIT));
+
+    result = os_sem_create(&sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_task_spawn(&task, os_test_waiting_task, &sem, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // the task is blocked until the semaphore is given
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, os_task_join(&task, OS_TIMEOUT_NO_WAIT));
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, os_task_join(&task, 5));
+    TEST_ASSERT_NOT_NULL(task);
+
+    result = os_sem_give(&sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&task, OS_TIMEOUT_WAIT_FOREVER));
+    TEST_ASSERT_NULL(task);
+
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_task_join(&task, OS_TIMEOUT_NO_WAIT));
+}
+
+TEST(OS_TASK, task_status)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+    OS_Task task = NULL;
+    OS_Sem sem;
+
+    uint64_t cpu_ns = 0;
+
+    TEST_ASSERT_EQUAL(OS_TASK_STATUS_TASK_UNKNOWN, os_task_status(NULL));
+    TEST_ASSERT_EQUAL(OS_TASK_STATUS_TASK_UNKNOWN, os_task_status(&task));
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_task_cpu_time(&task, &cpu_ns));
+
+    result = os_sem_create(&sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_task_spawn(&task, os_test_waiting_task, &sem, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // the task blocks on the semaphore soon after it starts
+    for (int tries = 0; (tries < 100) && (os_task_status(&task) != OS_TASK_STATUS_TASK_BLOCKED); tries++)
+    {
+        os_task_delay(1);
+    }
+    TEST_ASSERT_EQUAL(OS_TASK_STATUS_TASK_BLOCKED, os_task_status(&task));
+
+    result = os_sem_give(&sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    for (int tries = 0; (tries < 100) && (os_task_status(&task) != OS_TASK_STATUS_TASK_EXITED); tries++)
+    {
+        os_task_delay(1);
+    }
+    TEST_ASSERT_EQUAL(OS_TASK_STATUS_TASK_EXITED, os_task_status(&task));
+
+    // an exited task keeps its CPU time until it is joined
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_cpu_time(&task, &cpu_ns));
+    TEST_ASSERT_TRUE(cpu_ns > 0);
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&task, OS_TIMEOUT_WAIT_FOREVER));
+    TEST_ASSERT_EQUAL(OS_TASK_STATUS_TASK_UNKNOWN, os_task_status(&task));
+
+    TEST_ASSERT_TRUE(os_task_num_cpus() >= 1);
+    TEST_ASSERT_TRUE(os_process_cpu_nanoseconds() > 0);
+}
+
+TEST(OS_TASK, task_spawn_max)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+    OS_Task tasks[OS_CONFIG_MAX_TASKS];
+    OS_Task task;
+    OS_Sem sem;
+
+    uint32_t num_tasks = 0;
+
+    result = os_sem_create(&sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // other tests' tasks may still hold control blocks, so tasks are
+    // spawned until the table is full.
+    while ((result == OS_RESULT_OKAY) && (num_tasks < OS_CONFIG_MAX_TASKS))
+    {
+        result = os_task_spawn(&tasks[num_tasks], os_test_waiting_task, &sem, 20, 1024 * 10);
+        if (result == OS_RESULT_OKAY)
+        {
+            num_tasks++;
+        }
+    }
+
+    result = os_task_spawn(&task, os_test_waiting_task, &sem, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_MAX_TASKS_REACHED, result);
+    TEST_ASSERT_NULL(task);
+
+    for (uint32_t index = 0; index < num_tasks; index++)
+    {
+        (void)os_sem_give(&sem);
+    }
+
+    // joining the tasks returns their control blocks to the table
+    for (uint32_t index = 0; index < num_tasks; index++)
+    {
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&tasks[index], OS_TIMEOUT_WAIT_FOREVER));
+    }
+
+    result = os_task_spawn(&task, os_test_task, &gvOS_taskFlag, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&task, OS_TIMEOUT_WAIT_FOREVER));
+    TEST_ASSERT_EQUAL(true, gvOS_taskFlag);
+}
+
+TEST(OS_TASK, task_on_exit)
+{
+    OS_Task task;
+    OS_Sem sem;
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_create(&sem));
+
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_task_on_exit(NULL, &sem));
+
+    // only tasks spawned by os_task_spawn have exit hooks
+    TEST_ASSERT_EQUAL(OS_RESULT_ERROR, os_task_on_exit(os_test_exit_hook, &sem));
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_spawn(&task, os_test_exit_hook_task, &sem, 20, 1024 * 10));
+
+    // both hooks run once the task's function returns
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_take(&sem, 1000));
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_sem_take(&sem, 1000));
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, os_sem_take(&sem, OS_TIMEOUT_NO_WAIT));
+
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, os_task_join(&task, OS_TIMEOUT_WAIT_FOREVER));
+}
+
 TEST_GROUP(OS_MUTEX);
 
 TEST_SETUP(OS_MUTEX)
@@ -471,6 +1144,12 @@ TEST(OS_MUTEX, mutex_invalid)
 
     result = os_mutex_give(NULL);
     TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+    result = os_mutex_create_type(&gvOS_test_mutex, OS_MUTEX_TYPE_NUM_TYPES);
+    TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, result);
+
+    result = os_mutex_get_stats(&gvOS_test_mutex, NULL);
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
 }
 
 TEST(OS_MUTEX, mutex_basics)
@@ -492,6 +1171,94 @@ TEST(OS_MUTEX, mutex_basics)
     TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
 }
 
+TEST(OS_MUTEX, mutex_stats)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_MutexStats stats;
+
+    // a recursive take is part of the same hold
+    result = os_mutex_take(&gvOS_test_mutex, OS_TIMEOUT_WAIT_FOREVER);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_mutex_take(&gvOS_test_mutex, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_mutex_give(&gvOS_test_mutex);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    os_task_delay(1);
+
+    result = os_mutex_give(&gvOS_test_mutex);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // the mutex is not held, so it cannot be given
+    result = os_mutex_give(&gvOS_test_mutex);
+    TEST_ASSERT_EQUAL(OS_RESULT_ERROR, result);
+
+    result = os_mutex_get_stats(&gvOS_test_mutex, &stats);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    TEST_ASSERT_EQUAL(1, stats.takes);
+    TEST_ASSERT_EQUAL(0, stats.contended_takes);
+    TEST_ASSERT_EQUAL(0, stats.wait_ns);
+    TEST_ASSERT_TRUE(stats.hold_ns >= OS_CONFIG_CLOCK_TICK_NANOSECONDS);
+    TEST_ASSERT_EQUAL(stats.hold_ns, stats.max_hold_ns);
+}
+
+void os_test_mutex_holder(void *argument)
+{
+  (void)argument;
+
+  (void)os_mutex_take(&gvOS_test_mutex, OS_TIMEOUT_WAIT_FOREVER);
+  os_task_delay(20);
+  (void)os_mutex_give(&gvOS_test_mutex);
+}
+
+TEST(OS_MUTEX, mutex_contended)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_MutexStats stats;
+
+    OS_Task task;
+
+    result = os_mutex_create_type(&gvOS_test_mutex, OS_MUTEX_TYPE_ADAPTIVE);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_task_spawn(&task, os_test_mutex_holder, NULL, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    os_task_delay(5);
+
+    // a task that does not hold the mutex cannot give it
+    result = os_mutex_give(&gvOS_test_mutex);
+    TEST_ASSERT_EQUAL(OS_RESULT_ERROR, result);
+
+    result = os_mutex_take(&gvOS_test_mutex, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+
+    result = os_mutex_take(&gvOS_test_mutex, 1);
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+
+    result = os_mutex_take(&gvOS_test_mutex, 1000);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_mutex_get_stats(&gvOS_test_mutex, &stats);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // only the successful take is counted
+    TEST_ASSERT_EQUAL(2, stats.takes);
+    TEST_ASSERT_EQUAL(1, stats.contended_takes);
+    TEST_ASSERT_EQUAL(0, stats.spin_takes);
+    TEST_ASSERT_TRUE(stats.wait_ns > 0);
+    TEST_ASSERT_EQUAL(stats.wait_ns, stats.max_wait_ns);
+    TEST_ASSERT_TRUE(stats.max_hold_ns >= (10 * OS_CONFIG_CLOCK_TICK_NANOSECONDS));
+
+    result = os_mutex_give(&gvOS_test_mutex);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+}
+
 TEST_GROUP(OS_SEM);
 
 TEST_SETUP(OS_SEM)
@@ -515,6 +1282,9 @@ TEST(OS_SEM, sem_invalid)
 
     result = os_sem_give(NULL);
     TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
+
+    result = os_sem_delete(NULL);
+    TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, result);
 }
 
 TEST(OS_SEM, sem_basics)
@@ -562,6 +1332,239 @@ TEST(OS_SEM, sem_timeouts)
     TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
 }
 
+TEST(OS_SEM, sem_count)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    // each give allows exactly one take
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        result = os_sem_give(&gvOS_test_sem);
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    }
+
+    for (uint32_t index = 0; index < 3; index++)
+    {
+        result = os_sem_take(&gvOS_test_sem, OS_TIMEOUT_NO_WAIT);
+        TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+    }
+
+    result = os_sem_take(&gvOS_test_sem, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+}
+
+void os_test_sem_giver(void *argument)
+{
+  // give the semaphore after the test has blocked on it
+  os_task_delay(10);
+
+  (void)os_sem_give((OS_Sem*)argument);
+}
+
+TEST(OS_SEM, sem_wake)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_Task task;
+
+    result = os_task_spawn(&task, os_test_sem_giver, &gvOS_test_sem, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_sem_take(&gvOS_test_sem, 1000);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_sem_take(&gvOS_test_sem, 5);
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+}
+
+TEST(OS_SEM, sem_delete)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    result = os_sem_give(&gvOS_test_sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_sem_delete(&gvOS_test_sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    // a deleted semaphore can be created again, empty
+    result = os_sem_create(&gvOS_test_sem);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+    result = os_sem_take(&gvOS_test_sem, OS_TIMEOUT_NO_WAIT);
+    TEST_ASSERT_EQUAL(OS_RESULT_TIMEOUT, result);
+}
+
+TEST_GROUP(OS_SEQLOCK);
+
+TEST_SETUP(OS_SEQLOCK)
+{
+  os_seqlock_init(&gvOS_test_seqlock);
+  memset(gvOS_test_seqlock_data, 0, sizeof(gvOS_test_seqlock_data));
+  atomic_store(&gvOS_test_seqlock_done, false);
+}
+
+TEST_TEAR_DOWN(OS_SEQLOCK)
+{
+}
+
+void os_test_seqlock_writer(void *argument)
+{
+  (void)argument;
+
+  for (uint32_t write = 1; write <= OS_SEQLOCK_TEST_NUM_WRITES; write++)
+  {
+    os_seqlock_write_begin(&gvOS_test_seqlock);
+    for (uint32_t index = 0; index < OS_SEQLOCK_TEST_NUM_WORDS; index++)
+    {
+      gvOS_test_seqlock_data[index] = write;
+    }
+    os_seqlock_write_end(&gvOS_test_seqlock);
+
+    // the writer sleeps now and then, so that it wakes during a read
+    if ((write % 64) == 0)
+    {
+      os_task_delay(1);
+    }
+  }
+
+  atomic_store(&gvOS_test_seqlock_done, true);
+}
+
+TEST(OS_SEQLOCK, seqlock_consistent)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  uint32_t copy[OS_SEQLOCK_TEST_NUM_WORDS];
+
+  uint32_t last_write = 0;
+
+  OS_Task task;
+
+  result = os_task_spawn(&task, os_test_seqlock_writer, NULL, 20, 1024 * 10);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+
+  // every copy is from a single write, and writes are never seen out of order
+  while (!atomic_load(&gvOS_test_seqlock_done))
+  {
+    os_seqlock_read(&gvOS_test_seqlock, copy, gvOS_test_seqlock_data, sizeof(copy));
+
+    for (uint32_t index = 1; index < OS_SEQLOCK_TEST_NUM_WORDS; index++)
+    {
+      TEST_ASSERT_EQUAL(copy[0], copy[index]);
+    }
+
+    TEST_ASSERT_TRUE(copy[0] >= last_write);
+    last_write = copy[0];
+  }
+
+  os_seqlock_read(&gvOS_test_seqlock, copy, gvOS_test_seqlock_data, sizeof(copy));
+  TEST_ASSERT_EQUAL(OS_SEQLOCK_TEST_NUM_WRITES, copy[0]);
+}
+
+TEST_GROUP(OS_COUNTER);
+
+TEST_SETUP(OS_COUNTER)
+{
+  os_counters_init(&gvOS_test_counters);
+  os_sem_create(&gvOS_test_counters_done);
+}
+
+TEST_TEAR_DOWN(OS_COUNTER)
+{
+}
+
+void os_test_counter_task(void *argument)
+{
+  (void)argument;
+
+  for (uint32_t index = 0; index < OS_COUNTER_TEST_NUM_ADDS; index++)
+  {
+    os_counters_add(&gvOS_test_counters, 1, 1);
+  }
+
+  (void)os_sem_give(&gvOS_test_counters_done);
+}
+
+TEST(OS_COUNTER, counter_sum)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  OS_Task tasks[OS_COUNTER_TEST_NUM_TASKS];
+
+  // each shard is on its own cache line
+  TEST_ASSERT_EQUAL(0, ((uintptr_t)&gvOS_test_counters.shards[1]) % 64);
+
+  os_counters_add(&gvOS_test_counters, 2, 5);
+  os_counters_add(&gvOS_test_counters, 2, 7);
+
+  for (uint32_t task_index = 0; task_index < OS_COUNTER_TEST_NUM_TASKS; task_index++)
+  {
+    result = os_task_spawn(&tasks[task_index], os_test_counter_task, NULL, 20, 1024 * 10);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  for (uint32_t task_index = 0; task_index < OS_COUNTER_TEST_NUM_TASKS; task_index++)
+  {
+    result = os_sem_take(&gvOS_test_counters_done, 1000);
+    TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  }
+
+  // no count is lost, whether or not the tasks shared a shard
+  TEST_ASSERT_EQUAL(0, os_counters_sum(&gvOS_test_counters, 0));
+  TEST_ASSERT_EQUAL(OS_COUNTER_TEST_NUM_TASKS * OS_COUNTER_TEST_NUM_ADDS,
+                    os_counters_sum(&gvOS_test_counters, 1));
+  TEST_ASSERT_EQUAL(12, os_counters_sum(&gvOS_test_counters, 2));
+}
+
+/* Test Mapped Files */
+TEST_GROUP(OS_MAP);
+
+TEST_SETUP(OS_MAP)
+{
+}
+
+TEST_TEAR_DOWN(OS_MAP)
+{
+}
+
+TEST(OS_MAP, map_invalid)
+{
+  OS_MappedFile map;
+
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_map_file(NULL, OS_MAP_TEST_PATH, OS_MAP_TEST_SIZE));
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_map_file(&map, NULL, OS_MAP_TEST_SIZE));
+  TEST_ASSERT_EQUAL(OS_RESULT_INVALID_ARGUMENTS, os_map_file(&map, OS_MAP_TEST_PATH, 0));
+  TEST_ASSERT_EQUAL(OS_RESULT_NULL_POINTER, os_unmap_file(NULL));
+}
+
+TEST(OS_MAP, map_persists)
+{
+  OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+  OS_MappedFile map;
+
+  result = os_map_file(&map, OS_MAP_TEST_PATH, OS_MAP_TEST_SIZE);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_NOT_NULL(map.data);
+  TEST_ASSERT_EQUAL(OS_MAP_TEST_SIZE, map.size_bytes);
+
+  uint8_t value = map.data[OS_MAP_TEST_OFFSET] + 1;
+  map.data[OS_MAP_TEST_OFFSET] = value;
+
+  result = os_unmap_file(&map);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_NULL(map.data);
+
+  // the write is in the file when it is mapped again
+  result = os_map_file(&map, OS_MAP_TEST_PATH, OS_MAP_TEST_SIZE);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+  TEST_ASSERT_EQUAL(value, map.data[OS_MAP_TEST_OFFSET]);
+
+  result = os_unmap_file(&map);
+  TEST_ASSERT_EQUAL(OS_RESULT_OKAY, result);
+}
+
 TEST_GROUP_RUNNER(OS_QUEUE)
 {
   RUN_TEST_CASE(OS_QUEUE, queue_create_null);
@@ -577,12 +1580,28 @@ TEST_GROUP_RUNNER(OS_QUEUE)
   RUN_TEST_CASE(OS_QUEUE, queue_receive_small);
   RUN_TEST_CASE(OS_QUEUE, queue_receive_empty);
   RUN_TEST_CASE(OS_QUEUE, queue_receive_okay);
+  RUN_TEST_CASE(OS_QUEUE, queue_batch);
+  RUN_TEST_CASE(OS_QUEUE, queue_batch_invalid);
+  RUN_TEST_CASE(OS_QUEUE, queue_priority);
+}
+
+TEST_GROUP_RUNNER(OS_QUEUE_RING)
+{
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_create_invalid);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_sizes);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_spsc);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_mpsc);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_priority);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_batch);
+  RUN_TEST_CASE(OS_QUEUE_RING, ring_mpsc_producers);
 }
 
 TEST_GROUP_RUNNER(OS_TIME)
 {
     RUN_TEST_CASE(OS_TIME, time_delay);
+    RUN_TEST_CASE(OS_TIME, time_delay_until);
     RUN_TEST_CASE(OS_TIME, time_not_zero);
+    RUN_TEST_CASE(OS_TIME, time_nanoseconds);
 }
 
 TEST_GROUP_RUNNER(OS_TIMER)
@@ -591,18 +1610,30 @@ TEST_GROUP_RUNNER(OS_TIMER)
   RUN_TEST_CASE(OS_TIMER, timer_start_null);
   RUN_TEST_CASE(OS_TIMER, timer_start_single);
   RUN_TEST_CASE(OS_TIMER, timer_start_reset);
+  RUN_TEST_CASE(OS_TIMER, timer_start_absolute);
+  RUN_TEST_CASE(OS_TIMER, timer_overruns);
+#if defined(OS_TIMER_THREAD)
+  RUN_TEST_CASE(OS_TIMER, timer_create_many);
+#endif
 }
 
 TEST_GROUP_RUNNER(OS_TASK)
 {
     RUN_TEST_CASE(OS_TASK, task_spawn_invalid);
     RUN_TEST_CASE(OS_TASK, task_spawn);
+    RUN_TEST_CASE(OS_TASK, task_spawn_affinity);
+    RUN_TEST_CASE(OS_TASK, task_join);
+    RUN_TEST_CASE(OS_TASK, task_status);
+    RUN_TEST_CASE(OS_TASK, task_spawn_max);
+    RUN_TEST_CASE(OS_TASK, task_on_exit);
 }
 
 TEST_GROUP_RUNNER(OS_MUTEX)
 {
     RUN_TEST_CASE(OS_MUTEX, mutex_invalid);
     RUN_TEST_CASE(OS_MUTEX, mutex_basics);
+  RUN_TEST_CASE(OS_MUTEX, mutex_stats);
+  RUN_TEST_CASE(OS_MUTEX, mutex_contended);
 }
 
 TEST_GROUP_RUNNER(OS_SEM)
@@ -610,4 +1641,23 @@ TEST_GROUP_RUNNER(OS_SEM)
   RUN_TEST_CASE(OS_SEM, sem_invalid);
   RUN_TEST_CASE(OS_SEM, sem_basics);
   RUN_TEST_CASE(OS_SEM, sem_timeouts);
+  RUN_TEST_CASE(OS_SEM, sem_count);
+  RUN_TEST_CASE(OS_SEM, sem_wake);
+  RUN_TEST_CASE(OS_SEM, sem_delete);
+}
+
+TEST_GROUP_RUNNER(OS_SEQLOCK)
+{
+  RUN_TEST_CASE(OS_SEQLOCK, seqlock_consistent);
+}
+
+TEST_GROUP_RUNNER(OS_COUNTER)
+{
+  RUN_TEST_CASE(OS_COUNTER, counter_sum);
+}
+
+TEST_GROUP_RUNNER(OS_MAP)
+{
+  RUN_TEST_CASE(OS_MAP, map_invalid);
+  RUN_TEST_CASE(OS_MAP, map_persists);
 }
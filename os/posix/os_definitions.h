@@ -10,6 +10,9 @@
 #define __OS_DEFINITIONS_H__
 
 #include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "stdatomic.h"
 
 #include "time.h" // included because of CLOCKS_PER_SEC
 
@@ -23,53 +26,168 @@
  * This definition is for the internal representation of a mutex
  * within the OS abstraction.
  */
-typedef pthread_mutex_t OS_Mutex;
+typedef struct OS_Mutex
+{
+  pthread_mutex_t mutex;
+  OS_MUTEX_TYPE_ENUM type;
+  uint32_t depth;      /*<< The number of times the holding task has taken the mutex */
+  uint64_t taken_ns;   /*<< The time the holding task first took the mutex */
+  OS_MutexStats stats; /*<< Updated only by the task holding the mutex */
+} OS_Mutex;
 
 /**
  * This definition is for the internal representation of a semaphore
  * within the OS abstraction.
  */
+#if defined(OS_SEM_FUTEX)
+typedef struct OS_Sem
+{
+  atomic_uint count;   /*<< The number of times the semaphore can be taken */
+  atomic_uint waiters; /*<< The number of tasks blocked taking the semaphore */
+} OS_Sem;
+#else
 typedef sem_t OS_Sem;
+#endif
+
+/**
+ * This definition is for the internal representation of a sequence lock
+ * within the OS abstraction.
+ */
+typedef struct OS_Seqlock
+{
+  atomic_uint begun; /*<< The number of updates that have begun */
+  atomic_uint ended; /*<< The number of updates that have ended */
+} OS_Seqlock;
+
+/**
+ * This definition is the number of shards in a set of counters. Tasks
+ * beyond this number share shards with other tasks.
+ */
+#define OS_COUNTER_NUM_SHARDS 16
+
+/**
+ * This definition is the number of counters in a set of counters. A shard
+ * of a set of counters fills one 64 byte cache line.
+ */
+#define OS_COUNTER_MAX_COUNTERS 16
+
+/**
+ * This definition is one shard of a set of counters.
+ */
+typedef struct OS_CounterShard
+{
+  _Alignas(OS_COUNTER_MAX_COUNTERS * sizeof(atomic_uint))
+  atomic_uint counts[OS_COUNTER_MAX_COUNTERS];
+} OS_CounterShard;
+
+/**
+ * This definition is for the internal representation of a set of
+ * counters within the OS abstraction.
+ */
+typedef struct OS_Counters
+{
+  OS_CounterShard shards[OS_COUNTER_NUM_SHARDS];
+} OS_Counters;
+
+/**
+ * This definition is for the internal representation of a file mapped
+ * into memory within the OS abstraction.
+ */
+typedef struct OS_MappedFile
+{
+  uint8_t *data;       /*<< The file's contents, or NULL if no file is mapped */
+  uint32_t size_bytes; /*<< The size of the mapping */
+} OS_MappedFile;
+
+/**
+ * This definition is the lock-free ring used by the ring queue types.
+ * It is only accessed through a pointer, and is defined in os_queue_ring.h.
+ */
+typedef struct OS_QueueRing OS_QueueRing;
 
 /**
  * This definition is the underlying data definition for queues.
+ * Queues created with a ring type use only the 'ring' field.
  */
 #if defined(OS_WSL)
 #include "pthread.h"
 
 typedef struct OS_Queue
 {
+  OS_QUEUE_TYPE_ENUM type;
+  OS_QueueRing *ring;
+
   pthread_mutex_t mutex;
   pthread_cond_t write_condition;
   pthread_cond_t read_condition;
 
   uint8_t *buffer;
   uint32_t *msg_sizes;
+  uint32_t *next_msgs;
 
   uint32_t num_msgs;
   uint32_t msg_size_bytes;
-  uint32_t read_offset;
-  uint32_t write_offset;
+
+  uint32_t free_head;
+  uint32_t lane_heads[OS_QUEUE_NUM_PRIORITIES];
+  uint32_t lane_tails[OS_QUEUE_NUM_PRIORITIES];
 
   uint32_t num_queued;
 } OS_Queue;
 #else
 #include "mqueue.h"
 
-typedef mqd_t OS_Queue;
+typedef struct OS_Queue
+{
+  OS_QUEUE_TYPE_ENUM type;
+  OS_QueueRing *ring;
+
+  mqd_t queue;
+} OS_Queue;
 #endif
 
+/**
+ * This definition is the control block of a task. Control blocks come from
+ * a fixed table rather than the heap, so spawning a task does not allocate.
+ */
+typedef struct OS_TaskControlBlock
+{
+  atomic_bool in_use;              /*<< Set from spawn until the task is joined */
+  atomic_uint status;              /*<< The task's OS_TASK_STATUS_ENUM status */
+  pthread_t thread;
+  void (*function)(void *argument);
+  void *argument;
+  OS_Sem started;                  /*<< Given by the task once its stack is prefaulted */
+  void *stack;                     /*<< The lowest usable address of the task's stack */
+  size_t stack_size;               /*<< The usable size of the task's stack */
+  bool stack_locked;               /*<< Whether the task's stack is locked in memory */
+  uint64_t exit_cpu_ns;            /*<< The task's CPU time when it exited */
+  void (*exit_hooks[OS_CONFIG_MAX_TASK_EXIT_HOOKS])(void *argument); /*<< Called by the task when its function returns */
+  void *exit_hook_arguments[OS_CONFIG_MAX_TASK_EXIT_HOOKS];
+  uint32_t num_exit_hooks;         /*<< The number of exit hooks registered by the task */
+} OS_TaskControlBlock;
+
 /**
  * The OS_Task type is the implementation dependant type for
  * tasks. This type is used as a pointer, allowing it to either
  * point to task data, or to a handle passed to OS functions.
  */
-typedef pthread_t OS_Task;
+typedef OS_TaskControlBlock *OS_Task;
 
 /**
  * Ths OS_Timer type is the implementation dependant type for
  * timers. It is used to initialize, start, and stop a timer.
  */
+#if defined(OS_TIMER_THREAD)
+typedef struct OS_Timer
+{
+  int fd;
+  OS_TIMER_FUNC callback;
+  void *argument;
+  OS_Timeout timeout;
+  atomic_uint overruns;
+} OS_Timer;
+#else
 typedef struct OS_Timer
 {
   timer_t timer;
@@ -77,6 +195,8 @@ typedef struct OS_Timer
   OS_TIMER_FUNC callback;
   void *argument;
   OS_Timeout timeout;
+  atomic_uint overruns;
 } OS_Timer;
+#endif
 
 #endif // ndef __OS_DEFINITIONS_H__ */
@@ -0,0 +1,75 @@
+/**
+ * @file os_futex.h
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the internal interface for waiting on a 32 bit word
+ * within the POSIX OS abstraction. On Linux this is a futex, allowing
+ * lock-free structures to block only when they have to.
+ * This header is not part of the OS abstraction interface.
+ */
+#ifndef __OS_FUTEX_H__
+#define __OS_FUTEX_H__
+
+#include "stdint.h"
+#include "stdatomic.h"
+
+#include "time.h"
+
+#include "os_types.h"
+
+
+/**
+ * @brief os_futex_deadline
+ *
+ * This function converts a timeout in clock ticks into an absolute deadline
+ * on the monotonic clock, for use with os_futex_wait.
+ *
+ * @param[in] timeout - the timeout in clock ticks. This must not be
+ *            OS_TIMEOUT_WAIT_FOREVER, which has no deadline.
+ * @param[out] deadline - a non-NULL pointer to the deadline to fill out.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_futex_deadline(OS_Timeout timeout, struct timespec *deadline);
+
+/**
+ * @brief os_futex_wait
+ *
+ * This function blocks while the given word holds the expected value, until
+ * it is woken by os_futex_wake or the deadline passes.
+ * The wait may return early, so the caller must check its condition again.
+ *
+ * @param[in] word - a non-NULL pointer to the word to wait on.
+ * @param[in] expected - the value that the word must have to block.
+ * @param[in] deadline - an absolute time on the monotonic clock,
+ *            or NULL to wait forever.
+ *
+ * @return OS_RESULT_OKAY if the wait returned before the deadline,
+ * OS_RESULT_TIMEOUT if the deadline passed, or OS_RESULT_ERROR.
+ */
+OS_RESULT_ENUM os_futex_wait(atomic_uint *word,
+                             uint32_t expected,
+                             const struct timespec *deadline);
+
+/**
+ * @brief os_futex_wake
+ *
+ * This function wakes all threads blocked in os_futex_wait on the given word.
+ *
+ * @param[in] word - a non-NULL pointer to the word to wake.
+ */
+void os_futex_wake(atomic_uint *word);
+
+/**
+ * @brief os_futex_wake_one
+ *
+ * This function wakes one thread blocked in os_futex_wait on the given word,
+ * for when only one waiter can make progress.
+ *
+ * @param[in] word - a non-NULL pointer to the word to wake.
+ */
+void os_futex_wake_one(atomic_uint *word);
+
+#endif // ndef __OS_FUTEX_H__ */
@@ -0,0 +1,164 @@
+/**
+ * @file os_queue_ring.h
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the internal definitions for the lock-free ring queues
+ * of the POSIX OS abstraction. The ring queues are used by os_queue_send and
+ * os_queue_receive for queues created with a ring OS_QUEUE_TYPE_ENUM.
+ * This header is not part of the OS abstraction interface.
+ */
+#ifndef __OS_QUEUE_RING_H__
+#define __OS_QUEUE_RING_H__
+
+#include "stdint.h"
+#include "stdatomic.h"
+
+#include "os_definitions.h"
+
+
+/**
+ * This definition is the size of a cache line. Indices written by different
+ * threads are placed on separate cache lines so that a sender and a receiver
+ * do not invalidate each other's cache line on every message.
+ */
+#define OS_QUEUE_RING_CACHE_LINE_BYTES 64
+
+/**
+ * This definition is the header of a slot in a ring. The message is stored
+ * directly after the header.
+ */
+typedef struct OS_QueueRingSlot
+{
+    atomic_uint sequence; /*<< The position this slot is ready for (MPSC only) */
+    uint32_t size_bytes; /*<< The size of the message in this slot */
+    _Alignas(8) uint8_t data[]; /*<< The message */
+} OS_QueueRingSlot;
+
+/**
+ * This definition is the indices of a single priority lane of a ring.
+ *
+ * The SPSC ring uses the tail (written by the sender) and the head
+ * (written by the receiver) to find free and full slots. Each side
+ * caches the other side's index and only reloads it when the lane looks
+ * full or empty.
+ *
+ * The MPSC ring claims slots by compare-and-swap on the tail, and each
+ * slot's sequence tells the receiver when the slot's message is complete.
+ */
+typedef struct OS_QueueRingLane
+{
+    _Alignas(OS_QUEUE_RING_CACHE_LINE_BYTES)
+    atomic_uint tail; /*<< Position of the next message to send */
+    uint32_t cached_head; /*<< The sender's copy of head (SPSC only) */
+
+    _Alignas(OS_QUEUE_RING_CACHE_LINE_BYTES)
+    atomic_uint head; /*<< Position of the next message to receive */
+    uint32_t cached_tail; /*<< The receiver's copy of tail (SPSC only) */
+} OS_QueueRingLane;
+
+/**
+ * This definition is a lock-free ring. Each message priority has its own
+ * lane of 'num_msgs' slots, and the receiver takes from the highest
+ * priority lane that has a message.
+ *
+ * When a sender or receiver has to block, it registers itself as waiting
+ * and waits on the matching event word, which the other side increments
+ * and wakes only when there are waiters.
+ */
+struct OS_QueueRing
+{
+    OS_QueueRingLane lanes[OS_QUEUE_NUM_PRIORITIES]; /*<< The lane for each priority */
+
+    _Alignas(OS_QUEUE_RING_CACHE_LINE_BYTES)
+    atomic_uint not_empty; /*<< Event word incremented when a message is sent to waiting receivers */
+    atomic_uint receivers_waiting; /*<< Number of receivers blocked on not_empty */
+
+    _Alignas(OS_QUEUE_RING_CACHE_LINE_BYTES)
+    atomic_uint not_full; /*<< Event word incremented when a message is received with waiting senders */
+    atomic_uint senders_waiting; /*<< Number of senders blocked on not_full */
+
+    _Alignas(OS_QUEUE_RING_CACHE_LINE_BYTES)
+    OS_QUEUE_TYPE_ENUM type; /*<< The type of ring */
+    uint32_t num_msgs; /*<< The number of slots in each lane, a power of two */
+    uint32_t mask; /*<< Mask from a position to a slot index */
+    uint32_t msg_size_bytes; /*<< The maximum message size */
+    uint32_t slot_size_bytes; /*<< The size of a slot, including its header */
+    uint8_t *slots; /*<< The slot storage, with each lane's slots stored together */
+};
+
+
+/**
+ * @brief os_queue_ring_create
+ *
+ * This function allocates and initializes a ring.
+ *
+ * @param[out] ring - a non-NULL pointer to fill out with the new ring.
+ * @param[in] num_msgs - the number of messages in each priority lane,
+ *                       rounded up to a power of two.
+ * @param[in] msg_size_bytes - the maximum size of a message.
+ * @param[in] type - OS_QUEUE_TYPE_SPSC or OS_QUEUE_TYPE_MPSC.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_queue_ring_create(OS_QueueRing **ring,
+                                    uint32_t num_msgs,
+                                    uint32_t msg_size_bytes,
+                                    OS_QUEUE_TYPE_ENUM type);
+
+/**
+ * @brief os_queue_ring_send
+ *
+ * This function sends a message on a ring's priority lane, blocking up to
+ * the timeout if the lane is full. It has the same results as
+ * os_queue_send_priority.
+ */
+OS_RESULT_ENUM os_queue_ring_send(OS_QueueRing *ring,
+                                  uint8_t *buffer,
+                                  uint32_t buffer_size_bytes,
+                                  uint32_t priority,
+                                  OS_Timeout timeout);
+
+/**
+ * @brief os_queue_ring_receive
+ *
+ * This function receives the highest priority message from a ring, blocking
+ * up to the timeout if the ring is empty. It has the same results as
+ * os_queue_receive_priority.
+ */
+OS_RESULT_ENUM os_queue_ring_receive(OS_QueueRing *ring,
+                                     uint8_t *buffer,
+                                     uint32_t *buffer_size_bytes,
+                                     uint32_t *priority,
+                                     OS_Timeout timeout);
+
+/**
+ * @brief os_queue_ring_send_batch
+ *
+ * This function sends a batch of messages on a ring's priority lane, waking
+ * receivers once for the whole batch. It has the same results as os_queue_send_batch.
+ */
+OS_RESULT_ENUM os_queue_ring_send_batch(OS_QueueRing *ring,
+                                        uint8_t **buffers,
+                                        uint32_t *buffer_sizes_bytes,
+                                        uint32_t num_msgs,
+                                        uint32_t priority,
+                                        uint32_t *num_sent,
+                                        OS_Timeout timeout);
+
+/**
+ * @brief os_queue_ring_receive_batch
+ *
+ * This function receives a batch of messages from a ring, waking senders once
+ * for the whole batch. It has the same results as os_queue_receive_batch.
+ */
+OS_RESULT_ENUM os_queue_ring_receive_batch(OS_QueueRing *ring,
+                                           uint8_t *buffer,
+                                           uint32_t msg_size_bytes,
+                                           uint32_t *msg_sizes,
+                                           uint32_t max_msgs,
+                                           uint32_t *num_received,
+                                           OS_Timeout timeout);
+
+#endif // ndef __OS_QUEUE_RING_H__ */
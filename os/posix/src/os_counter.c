@@ -0,0 +1,70 @@
+/**
+ * @file os_counter.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation of sharded counters for the OS
+ * abstraction used by the FSW.
+ *
+ * Each task is given a shard the first time it counts, in turn, so that the
+ * first OS_COUNTER_NUM_SHARDS counting tasks each have a shard to themselves.
+ * Tasks beyond that share shards, which is why counts are still added
+ * atomically, although an atomic add on a cache line that only one task
+ * writes does not bounce between processors.
+ */
+#include "stdint.h"
+#include "stdatomic.h"
+
+#include "os_definitions.h"
+#include "os_counter.h"
+
+
+/**
+ * The shard of the calling task, plus one, or 0 if the task has not
+ * counted yet.
+ */
+static _Thread_local uint32_t gvOS_counter_shard = 0;
+
+/**
+ * The shard given to the next task to count.
+ */
+static atomic_uint gvOS_counter_next_shard = 0;
+
+
+void os_counters_init(OS_Counters *counters)
+{
+    for (uint32_t shard = 0; shard < OS_COUNTER_NUM_SHARDS; shard++)
+    {
+        for (uint32_t counter = 0; counter < OS_COUNTER_MAX_COUNTERS; counter++)
+        {
+            atomic_init(&counters->shards[shard].counts[counter], 0);
+        }
+    }
+}
+
+void os_counters_add(OS_Counters *counters, uint32_t counter, uint32_t amount)
+{
+    if (gvOS_counter_shard == 0)
+    {
+        uint32_t shard = atomic_fetch_add_explicit(&gvOS_counter_next_shard, 1, memory_order_relaxed);
+
+        gvOS_counter_shard = (shard % OS_COUNTER_NUM_SHARDS) + 1;
+    }
+
+    atomic_fetch_add_explicit(&counters->shards[gvOS_counter_shard - 1].counts[counter],
+                              amount,
+                              memory_order_relaxed);
+}
+
+uint32_t os_counters_sum(OS_Counters *counters, uint32_t counter)
+{
+    uint32_t sum = 0;
+
+    for (uint32_t shard = 0; shard < OS_COUNTER_NUM_SHARDS; shard++)
+    {
+        sum += atomic_load_explicit(&counters->shards[shard].counts[counter],
+                                    memory_order_relaxed);
+    }
+
+    return sum;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file os_futex.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation of waiting on a 32 bit word
+ * for the POSIX OS abstraction. Linux uses a futex, while other systems
+ * fall back to sleeping for a clock tick between checks of the word.
+ */
+#include "stdint.h"
+#include "stdatomic.h"
+
+#include "errno.h"
+#include "time.h"
+
+#if defined(__linux__)
+#include "unistd.h"
+#include "limits.h"
+#include "sys/syscall.h"
+#include "linux/futex.h"
+#endif
+
+#include "os_types.h"
+#include "os_task.h"
+#include "os_futex.h"
+
+
+OS_RESULT_ENUM os_futex_deadline(OS_Timeout timeout, struct timespec *deadline)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    if (deadline == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (timeout < 0)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        ret_code = clock_gettime(CLOCK_MONOTONIC, deadline);
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        uint64_t nanoseconds = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+        nanoseconds += deadline->tv_nsec;
+
+        deadline->tv_sec += nanoseconds / OS_NANOSECONDS_PER_SECOND;
+        deadline->tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;
+    }
+
+    return result;
+}
+
+#if defined(__linux__)
+
+OS_RESULT_ENUM os_futex_wait(atomic_uint *word,
+                             uint32_t expected,
+                             const struct timespec *deadline)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    long ret_code = 0;
+
+    os_task_block_begin();
+
+    // FUTEX_WAIT_BITSET takes an absolute deadline, so a wait that is
+    // restarted after a spurious wakeup does not extend the timeout.
+    ret_code = syscall(SYS_futex,
+                       (uint32_t*)word,
+                       FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                       expected,
+                       deadline,
+                       NULL,
+                       FUTEX_BITSET_MATCH_ANY);
+
+    // marking the task as running does not change errno
+    os_task_block_end();
+
+    if (ret_code != 0)
+    {
+        if (errno == ETIMEDOUT)
+        {
+            result = OS_RESULT_TIMEOUT;
+        }
+        // the word changed before blocking, or a signal was received.
+        // Either way the caller checks its condition again.
+        else if ((errno != EAGAIN) && (errno != EINTR))
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
+
+void os_futex_wake(atomic_uint *word)
+{
+    (void)syscall(SYS_futex,
+                  (uint32_t*)word,
+                  FUTEX_WAKE | FUTEX_PRIVATE_FLAG,
+                  INT_MAX,
+                  NULL,
+                  NULL,
+                  0);
+}
+
+void os_futex_wake_one(atomic_uint *word)
+{
+    (void)syscall(SYS_futex,
+                  (uint32_t*)word,
+                  FUTEX_WAKE | FUTEX_PRIVATE_FLAG,
+                  1,
+                  NULL,
+                  NULL,
+                  0);
+}
+
+#else
+
+OS_RESULT_ENUM os_futex_wait(atomic_uint *word,
+                             uint32_t expected,
+                             const struct timespec *deadline)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    struct timespec now;
+
+    struct timespec tick;
+    tick.tv_sec = 0;
+    tick.tv_nsec = OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+
+    if (atomic_load(word) == expected)
+    {
+        if (deadline != NULL)
+        {
+            (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+            if ((now.tv_sec > deadline->tv_sec) ||
+                ((now.tv_sec == deadline->tv_sec) && (now.tv_nsec >= deadline->tv_nsec)))
+            {
+                result = OS_RESULT_TIMEOUT;
+            }
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            os_task_block_begin();
+            (void)nanosleep(&tick, NULL);
+            os_task_block_end();
+        }
+    }
+
+    return result;
+}
+
+void os_futex_wake(atomic_uint *word)
+{
+    (void)word;
+}
+
+void os_futex_wake_one(atomic_uint *word)
+{
+    (void)word;
+}
+
+#endif /* defined __linux__ */
@@ -0,0 +1,109 @@
+/**
+ * @file os_map.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation of mapped files for the OS
+ * abstraction used by the FSW. Files are mapped shared, so writes to the
+ * mapping reach the file through the page cache even if the process exits
+ * without unmapping it.
+ */
+#include "stdint.h"
+#include "stddef.h"
+
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+
+#include "os_definitions.h"
+#include "os_map.h"
+
+
+/**
+ * This definition is the permissions of a file created by os_map_file.
+ */
+#define OS_MAP_FILE_MODE 0644
+
+
+OS_RESULT_ENUM os_map_file(OS_MappedFile *map, const char *path, uint32_t size_bytes)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int fd = -1;
+
+    if ((map == NULL) || (path == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (size_bytes == 0)
+    {
+        result = OS_RESULT_INVALID_ARGUMENTS;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        map->data = NULL;
+        map->size_bytes = 0;
+
+        fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, OS_MAP_FILE_MODE);
+        if (fd == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        int ret_code = ftruncate(fd, size_bytes);
+        if (ret_code == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        void *data = mmap(NULL, size_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            map->data = (uint8_t*)data;
+            map->size_bytes = size_bytes;
+        }
+    }
+
+    // the mapping keeps the file open, so the file descriptor is not needed
+    if (fd != -1)
+    {
+        (void)close(fd);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_unmap_file(OS_MappedFile *map)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((map == NULL) || (map->data == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        int ret_code = munmap(map->data, map->size_bytes);
+        if (ret_code == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+
+        map->data = NULL;
+        map->size_bytes = 0;
+    }
+
+    return result;
+}
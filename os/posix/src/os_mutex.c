@@ -6,18 +6,60 @@
  * This file contains the implementations of mutex functions for the OS
  * abstraction used by the FSW.
  */
+#include "stdint.h"
 #include "stdbool.h"
 #include "string.h"
 
 #include "errno.h"
+#include "time.h"
 
 #include "pthread.h"
 
 #include "os_definitions.h"
 #include "os_mutex.h"
+#include "os_time.h"
+
+
+/**
+ * This definition is the number of times an adaptive mutex tries to take
+ * a mutex held by another task before blocking.
+ */
+#define OS_MUTEX_SPIN_COUNT 100
+
+/**
+ * This definition tells the processor that it is in a spin loop, which
+ * saves power and lets the other hardware thread of a core run.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define OS_MUTEX_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define OS_MUTEX_PAUSE() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define OS_MUTEX_PAUSE()
+#endif
+
+
+/**
+ * @brief os_mutex_lock
+ *
+ * This function takes the underlying mutex, spinning first if the mutex is
+ * adaptive, and records the wait in the mutex's statistics.
+ *
+ * @param[in] mutex - the mutex to take.
+ * @param[in] timeout - the amount of time (in system clock ticks) to block.
+ *
+ * @return 0 if the mutex was taken, or the error from pthread_mutex_trylock,
+ * pthread_mutex_lock or pthread_mutex_timedlock.
+ */
+int os_mutex_lock(OS_Mutex *mutex, OS_Timeout timeout);
 
 
 OS_RESULT_ENUM os_mutex_create(OS_Mutex *mutex)
+{
+    return os_mutex_create_type(mutex, OS_MUTEX_TYPE_DEFAULT);
+}
+
+OS_RESULT_ENUM os_mutex_create_type(OS_Mutex *mutex, OS_MUTEX_TYPE_ENUM type)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
     int ret_code = 0;
@@ -33,6 +75,18 @@ OS_RESULT_ENUM os_mutex_create(OS_Mutex *mutex)
         ret_code = -1;
         result = OS_RESULT_NULL_POINTER;
     }
+    else if ((type < 0) || (type >= OS_MUTEX_TYPE_NUM_TYPES))
+    {
+        ret_code = -1;
+        result = OS_RESULT_INVALID_ARGUMENTS;
+    }
+    else
+    {
+        mutex->type = type;
+        mutex->depth = 0;
+        mutex->taken_ns = 0;
+        memset(&mutex->stats, 0, sizeof(mutex->stats));
+    }
 
     if (ret_code == 0)
     {
@@ -52,7 +106,7 @@ OS_RESULT_ENUM os_mutex_create(OS_Mutex *mutex)
 
     if (ret_code == 0)
     {
-        ret_code = pthread_mutex_init(mutex, &attr);
+        ret_code = pthread_mutex_init(&mutex->mutex, &attr);
     }
 
     if (attribute_init)
@@ -71,12 +125,82 @@ OS_RESULT_ENUM os_mutex_create(OS_Mutex *mutex)
     return result;
 }
 
+int os_mutex_lock(OS_Mutex *mutex, OS_Timeout timeout)
+{
+    uint64_t wait_start_ns = 0;
+
+    bool spun = false;
+
+    int ret_code = pthread_mutex_trylock(&mutex->mutex);
+
+    // the clock is only read when the mutex is held by another task
+    if (ret_code == EBUSY)
+    {
+        wait_start_ns = os_timestamp_nanoseconds();
+
+        if (mutex->type == OS_MUTEX_TYPE_ADAPTIVE)
+        {
+            for (int spin = 0; (spin < OS_MUTEX_SPIN_COUNT) && (ret_code == EBUSY); spin++)
+            {
+                OS_MUTEX_PAUSE();
+
+                ret_code = pthread_mutex_trylock(&mutex->mutex);
+            }
+
+            spun = ret_code == 0;
+        }
+    }
+
+    if ((ret_code == EBUSY) && (timeout != OS_TIMEOUT_NO_WAIT))
+    {
+        if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+        {
+            ret_code = pthread_mutex_lock(&mutex->mutex);
+        }
+        else
+        {
+            struct timespec timeout_spec;
+
+            // pthread_mutex_timedlock takes a deadline on the realtime clock
+            ret_code = clock_gettime(CLOCK_REALTIME, &timeout_spec);
+            if (ret_code == 0)
+            {
+                uint64_t nanoseconds = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+                nanoseconds += timeout_spec.tv_nsec;
+
+                timeout_spec.tv_sec += nanoseconds / OS_NANOSECONDS_PER_SECOND;
+                timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;
+
+                ret_code = pthread_mutex_timedlock(&mutex->mutex, &timeout_spec);
+            }
+        }
+    }
+
+    // the statistics are only updated while the mutex is held
+    if ((ret_code == 0) && (wait_start_ns != 0))
+    {
+        uint64_t wait_ns = os_timestamp_nanoseconds() - wait_start_ns;
+
+        mutex->stats.contended_takes++;
+        mutex->stats.wait_ns += wait_ns;
+        if (wait_ns > mutex->stats.max_wait_ns)
+        {
+            mutex->stats.max_wait_ns = wait_ns;
+        }
+
+        if (spun)
+        {
+            mutex->stats.spin_takes++;
+        }
+    }
+
+    return ret_code;
+}
+
 OS_RESULT_ENUM os_mutex_take(OS_Mutex *mutex, OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
-    struct timespec timeout_spec;
-
     if (mutex == NULL)
     {
         result = OS_RESULT_NULL_POINTER;
@@ -84,54 +208,118 @@ OS_RESULT_ENUM os_mutex_take(OS_Mutex *mutex, OS_Timeout timeout)
 
     if (result == OS_RESULT_OKAY)
     {
-        int ret_code = 0;
+        int ret_code = os_mutex_lock(mutex, timeout);
 
-        if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+        if (ret_code == 0)
         {
-            ret_code = pthread_mutex_lock(mutex);
+            mutex->depth++;
+
+            // a recursive take does not start a new hold
+            if (mutex->depth == 1)
+            {
+                mutex->taken_ns = os_timestamp_nanoseconds();
+                mutex->stats.takes++;
+            }
+        }
+        else if ((ret_code == ETIMEDOUT) || (ret_code == EBUSY))
+        {
+            result = OS_RESULT_TIMEOUT;
         }
         else
         {
-            int nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
-            timeout_spec.tv_sec = nanoseconds / OS_NANOSECONDS_PER_SECOND;
-            timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;;
-
-            ret_code = pthread_mutex_timedlock(mutex, &timeout_spec);
+            result = OS_RESULT_ERROR;
         }
+    }
 
+    return result;
+}
+
+OS_RESULT_ENUM os_mutex_give(OS_Mutex *mutex)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (mutex == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    // only the task holding the mutex may give it. The mutex is recursive,
+    // so trying to lock it again succeeds only for the task holding it, or
+    // when no task holds it, and the depth and statistics are then read and
+    // updated under the lock. Another task holding it makes the try fail.
+    if (result == OS_RESULT_OKAY)
+    {
+        int ret_code = pthread_mutex_trylock(&mutex->mutex);
         if (ret_code != 0)
         {
-            if (errno == ETIMEDOUT)
-            {
-                result = OS_RESULT_TIMEOUT;
-            }
-            else
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (mutex->depth == 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            mutex->depth--;
+
+            if (mutex->depth == 0)
             {
-                result = OS_RESULT_ERROR;
+                uint64_t hold_ns = os_timestamp_nanoseconds() - mutex->taken_ns;
+
+                mutex->stats.hold_ns += hold_ns;
+                if (hold_ns > mutex->stats.max_hold_ns)
+                {
+                    mutex->stats.max_hold_ns = hold_ns;
+                }
             }
         }
+
+        // release the lock taken above, and then the caller's hold
+        int ret_code = pthread_mutex_unlock(&mutex->mutex);
+        if ((ret_code == 0) && (result == OS_RESULT_OKAY))
+        {
+            ret_code = pthread_mutex_unlock(&mutex->mutex);
+        }
+
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
     }
 
     return result;
 }
 
-OS_RESULT_ENUM os_mutex_give(OS_Mutex *mutex)
+OS_RESULT_ENUM os_mutex_get_stats(OS_Mutex *mutex, OS_MutexStats *stats)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
-    if (mutex == NULL)
+    if ((mutex == NULL) || (stats == NULL))
     {
         result = OS_RESULT_NULL_POINTER;
     }
 
+    // the underlying mutex is used directly so that reading the
+    // statistics is not counted in them.
     if (result == OS_RESULT_OKAY)
     {
-        int ret_code = pthread_mutex_unlock(mutex);
+        int ret_code = pthread_mutex_lock(&mutex->mutex);
         if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
+    if (result == OS_RESULT_OKAY)
+    {
+        *stats = mutex->stats;
+
+        (void)pthread_mutex_unlock(&mutex->mutex);
+    }
+
     return result;
 }
@@ -10,9 +10,11 @@
 
 #include "stdint.h"
 #include "stdio.h"
+#include "time.h"
 
 #include "fcntl.h"
 #include "errno.h"
+#include "unistd.h"
 
 #include "sys/stat.h"
 
@@ -20,6 +22,8 @@
 
 #include "os_definitions.h"
 #include "os_queue.h"
+#include "os_queue_ring.h"
+#include "os_task.h"
 
 
 /**
@@ -28,11 +32,72 @@
 #define OS_QUEUE_MODE (0733)
 
 /**
- * This definition is for the priority used when sending messages on
- * a message queue. All messages used the same priority.
+ * @brief os_queue_mqueue_send
+ *
+ * This function sends a message on a POSIX message queue, using the message
+ * queue's own priorities. It implements os_queue_send_priority for
+ * OS_QUEUE_TYPE_DEFAULT queues.
  */
-#define OS_QUEUE_PRIORITY 1
+static OS_RESULT_ENUM os_queue_mqueue_send(OS_Queue *queue,
+                                           uint8_t *buffer,
+                                           uint32_t buffer_size_bytes,
+                                           uint32_t priority,
+                                           OS_Timeout timeout);
 
+/**
+ * @brief os_queue_mqueue_receive
+ *
+ * This function receives the highest priority message from a POSIX message
+ * queue. It implements os_queue_receive_priority for OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_mqueue_receive(OS_Queue *queue,
+                                              uint8_t *buffer,
+                                              uint32_t *buffer_size_bytes,
+                                              uint32_t *priority,
+                                              OS_Timeout timeout);
+
+/**
+ * @brief os_queue_mqueue_deadline
+ *
+ * This function converts a timeout in clock ticks into the absolute
+ * CLOCK_REALTIME deadline taken by mq_timedsend and mq_timedreceive.
+ * A timeout of OS_TIMEOUT_NO_WAIT gives a deadline that has already passed.
+ *
+ * @param[in] timeout - the timeout in clock ticks, not OS_TIMEOUT_WAIT_FOREVER.
+ * @param[out] deadline - the deadline to fill out.
+ *
+ * @return OS_RESULT_OKAY, or OS_RESULT_ERROR if the clock could not be read.
+ */
+static OS_RESULT_ENUM os_queue_mqueue_deadline(OS_Timeout timeout, struct timespec *deadline);
+
+/**
+ * @brief os_queue_mqueue_send_batch
+ *
+ * This function sends a batch of messages on a POSIX message queue.
+ * Message queues have no batch operation, so each message is sent on its own.
+ * It implements os_queue_send_batch for OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_mqueue_send_batch(OS_Queue *queue,
+                                                 uint8_t **buffers,
+                                                 uint32_t *buffer_sizes_bytes,
+                                                 uint32_t num_msgs,
+                                                 uint32_t *num_sent,
+                                                 OS_Timeout timeout);
+
+/**
+ * @brief os_queue_mqueue_receive_batch
+ *
+ * This function receives a batch of messages from a POSIX message queue,
+ * one message at a time. Only the first message waits for the timeout.
+ * It implements os_queue_receive_batch for OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_mqueue_receive_batch(OS_Queue *queue,
+                                                    uint8_t *buffer,
+                                                    uint32_t msg_size_bytes,
+                                                    uint32_t *msg_sizes,
+                                                    uint32_t max_msgs,
+                                                    uint32_t *num_received,
+                                                    OS_Timeout timeout);
 
 /**
  * This global variable is the number of queues allocated.
@@ -73,7 +138,12 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
 
     if (result == OS_RESULT_OKAY)
     {
-        ret_code = sprintf(queue_name, "/Fsw_Queue_%d", gvOS_queue_num_queues);
+        // the process id is part of the name so that another process cannot
+        // open the same queue.
+        ret_code = sprintf(queue_name,
+                           "/Fsw_Queue_%d_%d",
+                           (int)getpid(),
+                           gvOS_queue_num_queues);
 
         if (ret_code < 0)
         {
@@ -90,7 +160,15 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
 
         if (temp_queue != ((mqd_t) -1))
         {
-            *queue = temp_queue;
+            queue->type = OS_QUEUE_TYPE_DEFAULT;
+            queue->ring = NULL;
+            queue->queue = temp_queue;
+
+            // The queue is only used through its descriptor, so its name is
+            // removed immediately. This way the queue does not outlive the
+            // process, and messages (which may contain pointers) left on it
+            // are never received by a later process.
+            (void)mq_unlink(queue_name);
         }
         else
         {
@@ -105,12 +183,136 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
                              uint8_t *buffer,
                              uint32_t buffer_size_bytes,
                              OS_Timeout timeout)
+{
+    return os_queue_send_priority(queue, buffer, buffer_size_bytes, OS_QUEUE_PRIORITY_DEFAULT, timeout);
+}
+
+OS_RESULT_ENUM os_queue_send_priority(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t buffer_size_bytes,
+                                      uint32_t priority,
+                                      OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
-    ssize_t msg_size = 0;
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_send(queue->ring, buffer, buffer_size_bytes, priority, timeout);
+    }
+    else
+    {
+        result = os_queue_mqueue_send(queue, buffer, buffer_size_bytes, priority, timeout);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
+                                uint8_t *buffer,
+                                uint32_t *buffer_size_bytes,
+                                OS_Timeout timeout)
+{
+    uint32_t priority = 0;
+
+    return os_queue_receive_priority(queue, buffer, buffer_size_bytes, &priority, timeout);
+}
+
+OS_RESULT_ENUM os_queue_receive_priority(OS_Queue *queue,
+                                         uint8_t *buffer,
+                                         uint32_t *buffer_size_bytes,
+                                         uint32_t *priority,
+                                         OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_receive(queue->ring, buffer, buffer_size_bytes, priority, timeout);
+    }
+    else
+    {
+        result = os_queue_mqueue_receive(queue, buffer, buffer_size_bytes, priority, timeout);
+    }
 
-    struct timespec timeout_spec;
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_send_batch(OS_Queue *queue,
+                                   uint8_t **buffers,
+                                   uint32_t *buffer_sizes_bytes,
+                                   uint32_t num_msgs,
+                                   uint32_t *num_sent,
+                                   OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_send_batch(queue->ring,
+                                          buffers,
+                                          buffer_sizes_bytes,
+                                          num_msgs,
+                                          OS_QUEUE_PRIORITY_DEFAULT,
+                                          num_sent,
+                                          timeout);
+    }
+    else
+    {
+        result = os_queue_mqueue_send_batch(queue, buffers, buffer_sizes_bytes, num_msgs, num_sent, timeout);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_receive_batch(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t msg_size_bytes,
+                                      uint32_t *msg_sizes,
+                                      uint32_t max_msgs,
+                                      uint32_t *num_received,
+                                      OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_receive_batch(queue->ring, buffer, msg_size_bytes, msg_sizes, max_msgs, num_received, timeout);
+    }
+    else
+    {
+        result = os_queue_mqueue_receive_batch(queue, buffer, msg_size_bytes, msg_sizes, max_msgs, num_received, timeout);
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_mqueue_send(OS_Queue *queue,
+                                           uint8_t *buffer,
+                                           uint32_t buffer_size_bytes,
+                                           uint32_t priority,
+                                           OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    struct timespec deadline;
 
     if ((queue == NULL) || (buffer == NULL))
     {
@@ -119,14 +321,36 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
 
     if (result == OS_RESULT_OKAY)
     {
-        int nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
-        timeout_spec.tv_sec = nanoseconds / OS_NANOSECONDS_PER_SECOND;
-        timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;;
+        if (priority >= OS_QUEUE_NUM_PRIORITIES)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
 
-        msg_size =
-            mq_timedsend(*queue, (const char*)buffer, buffer_size_bytes, OS_QUEUE_PRIORITY, &timeout_spec);
+    if ((result == OS_RESULT_OKAY) && (timeout != OS_TIMEOUT_WAIT_FOREVER))
+    {
+        result = os_queue_mqueue_deadline(timeout, &deadline);
+    }
 
-        if (msg_size < 0)
+    if (result == OS_RESULT_OKAY)
+    {
+        // message queues give out their highest priority message first,
+        // matching the order of OS queue priorities.
+        os_task_block_begin();
+
+        if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+        {
+            ret_code = mq_send(queue->queue, (const char*)buffer, buffer_size_bytes, priority);
+        }
+        else
+        {
+            ret_code = mq_timedsend(queue->queue, (const char*)buffer, buffer_size_bytes, priority, &deadline);
+        }
+
+        // marking the task as running does not change errno
+        os_task_block_end();
+
+        if (ret_code < 0)
         {
             if (errno == ETIMEDOUT)
             {
@@ -146,43 +370,57 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
     return result;
 }
 
-OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
-                                uint8_t *buffer,
-                                uint32_t *buffer_size_bytes,
-                                OS_Timeout timeout)
+static OS_RESULT_ENUM os_queue_mqueue_receive(OS_Queue *queue,
+                                              uint8_t *buffer,
+                                              uint32_t *buffer_size_bytes,
+                                              uint32_t *priority,
+                                              OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
     ssize_t msg_size = 0;
 
-    struct timespec timeout_spec;
+    unsigned msg_priority = 0;
+
+    struct timespec deadline;
 
-    if ((queue == NULL) || (buffer_size_bytes == NULL))
+    if ((queue == NULL) || (buffer == NULL) || (buffer_size_bytes == NULL) || (priority == NULL))
     {
         result = OS_RESULT_NULL_POINTER;
     }
 
+    if ((result == OS_RESULT_OKAY) && (timeout != OS_TIMEOUT_WAIT_FOREVER))
+    {
+        result = os_queue_mqueue_deadline(timeout, &deadline);
+    }
+
     if (result == OS_RESULT_OKAY)
     {
-        int nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
-        timeout_spec.tv_sec = nanoseconds / OS_NANOSECONDS_PER_SECOND;
-        timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;;
+        os_task_block_begin();
+
+        if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+        {
+            msg_size = mq_receive(queue->queue, (char*)buffer, *buffer_size_bytes, &msg_priority);
+        }
+        else
+        {
+            msg_size = mq_timedreceive(queue->queue, (char*)buffer, *buffer_size_bytes, &msg_priority, &deadline);
+        }
 
-        int priority = OS_QUEUE_PRIORITY;
-        msg_size =
-            mq_timedreceive(*queue, (char*)buffer, *buffer_size_bytes, (unsigned*)&priority, &timeout_spec);
+        os_task_block_end();
 
-        if (msg_size > 0)
+        if (msg_size >= 0)
         {
             *buffer_size_bytes = msg_size;
+            *priority = msg_priority;
         }
         else
         {
-            if (msg_size == ETIMEDOUT)
+            if (errno == ETIMEDOUT)
             {
                 result = OS_RESULT_TIMEOUT;
             }
-            else if (msg_size == EMSGSIZE)
+            else if (errno == EMSGSIZE)
             {
                 result = OS_RESULT_MSG_SIZE_ERROR;
             }
@@ -196,4 +434,127 @@ OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
     return result;
 }
 
+static OS_RESULT_ENUM os_queue_mqueue_send_batch(OS_Queue *queue,
+                                                 uint8_t **buffers,
+                                                 uint32_t *buffer_sizes_bytes,
+                                                 uint32_t num_msgs,
+                                                 uint32_t *num_sent,
+                                                 OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((buffers == NULL) || (buffer_sizes_bytes == NULL) || (num_sent == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_sent = 0;
+
+        while ((result == OS_RESULT_OKAY) && (*num_sent < num_msgs))
+        {
+            result = os_queue_mqueue_send(queue,
+                                          buffers[*num_sent],
+                                          buffer_sizes_bytes[*num_sent],
+                                          OS_QUEUE_PRIORITY_DEFAULT,
+                                          timeout);
+
+            if (result == OS_RESULT_OKAY)
+            {
+                (*num_sent)++;
+            }
+        }
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_mqueue_receive_batch(OS_Queue *queue,
+                                                    uint8_t *buffer,
+                                                    uint32_t msg_size_bytes,
+                                                    uint32_t *msg_sizes,
+                                                    uint32_t max_msgs,
+                                                    uint32_t *num_received,
+                                                    OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_RESULT_ENUM receive_result = OS_RESULT_OKAY;
+
+    // the priority of each message is not returned by a batch receive
+    uint32_t priority = 0;
+
+    if ((buffer == NULL) || (msg_sizes == NULL) || (num_received == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_received = 0;
+
+        if (max_msgs == 0)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        msg_sizes[0] = msg_size_bytes;
+        result = os_queue_mqueue_receive(queue, buffer, &msg_sizes[0], &priority, timeout);
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_received = 1;
+
+        // the rest of the batch is whatever is already on the queue
+        while ((receive_result == OS_RESULT_OKAY) && (*num_received < max_msgs))
+        {
+            msg_sizes[*num_received] = msg_size_bytes;
+
+            receive_result =
+                os_queue_mqueue_receive(queue,
+                                        &buffer[(size_t)*num_received * msg_size_bytes],
+                                        &msg_sizes[*num_received],
+                                        &priority,
+                                        OS_TIMEOUT_NO_WAIT);
+
+            if (receive_result == OS_RESULT_OKAY)
+            {
+                (*num_received)++;
+            }
+        }
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_mqueue_deadline(OS_Timeout timeout, struct timespec *deadline)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    // message queue timeouts are absolute times on the realtime clock
+    ret_code = clock_gettime(CLOCK_REALTIME, deadline);
+    if (ret_code != 0)
+    {
+        result = OS_RESULT_ERROR;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        uint64_t nanoseconds = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+        nanoseconds += deadline->tv_nsec;
+
+        deadline->tv_sec += nanoseconds / OS_NANOSECONDS_PER_SECOND;
+        deadline->tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;
+    }
+
+    return result;
+}
+
 #endif /* defined OS_WSL */
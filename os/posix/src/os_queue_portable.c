@@ -8,6 +8,10 @@
  * This implementation uses only pthreads to implement a queue. It is not
  * intended for high performance, but rather as a simple alternative queue
  * for systems that do not implement librt.
+ *
+ * Messages are stored in a pool of slots. Each priority has a list of the
+ * slots holding its messages, in the order they were sent, and free slots
+ * are kept on their own list.
  */
 #include "stdint.h"
 #include "stdio.h"
@@ -24,7 +28,109 @@
 
 #include "os_definitions.h"
 #include "os_queue.h"
+#include "os_queue_ring.h"
+#include "os_futex.h"
+
+/**
+ * This definition marks the end of a list of slots in a portable queue.
+ */
+#define OS_QUEUE_SLOT_NONE (UINT32_MAX)
+
+/**
+ * @brief os_queue_portable_send
+ *
+ * This function sends a message on a portable queue.
+ * It implements os_queue_send_priority for OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_portable_send(OS_Queue *queue,
+                                             uint8_t *buffer,
+                                             uint32_t buffer_size_bytes,
+                                             uint32_t priority,
+                                             OS_Timeout timeout);
 
+/**
+ * @brief os_queue_portable_receive
+ *
+ * This function receives the highest priority message from a portable queue.
+ * It implements os_queue_receive_priority for OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_portable_receive(OS_Queue *queue,
+                                                uint8_t *buffer,
+                                                uint32_t *buffer_size_bytes,
+                                                uint32_t *priority,
+                                                OS_Timeout timeout);
+
+/**
+ * @brief os_queue_portable_send_batch
+ *
+ * This function sends a batch of messages on a portable queue while holding
+ * the queue mutex. It implements os_queue_send_batch for
+ * OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_portable_send_batch(OS_Queue *queue,
+                                                   uint8_t **buffers,
+                                                   uint32_t *buffer_sizes_bytes,
+                                                   uint32_t num_msgs,
+                                                   uint32_t priority,
+                                                   uint32_t *num_sent,
+                                                   OS_Timeout timeout);
+
+/**
+ * @brief os_queue_portable_receive_batch
+ *
+ * This function receives a batch of messages from a portable queue while
+ * holding the queue mutex. It implements os_queue_receive_batch for
+ * OS_QUEUE_TYPE_DEFAULT queues.
+ */
+static OS_RESULT_ENUM os_queue_portable_receive_batch(OS_Queue *queue,
+                                                      uint8_t *buffer,
+                                                      uint32_t msg_size_bytes,
+                                                      uint32_t *msg_sizes,
+                                                      uint32_t max_msgs,
+                                                      uint32_t *num_received,
+                                                      OS_Timeout timeout);
+
+/**
+ * @brief os_queue_portable_wait
+ *
+ * This function waits on one of the queue's condition variables, with the
+ * queue mutex held, until it is signaled or the deadline passes.
+ *
+ * @param[in] queue - the queue whose mutex is held.
+ * @param[in] condition - the condition variable to wait on.
+ * @param[in] timeout - the timeout the deadline was computed from.
+ * @param[in] deadline - the absolute deadline on the monotonic clock.
+ *
+ * @return OS_RESULT_OKAY if signaled, OS_RESULT_TIMEOUT, or OS_RESULT_ERROR.
+ */
+static OS_RESULT_ENUM os_queue_portable_wait(OS_Queue *queue,
+                                             pthread_cond_t *condition,
+                                             OS_Timeout timeout,
+                                             struct timespec *deadline);
+
+/**
+ * @brief os_queue_portable_push
+ *
+ * This function copies a message into a free slot and appends the slot to
+ * the list for the message's priority. The queue mutex must be held and the
+ * queue must not be full.
+ */
+static void os_queue_portable_push(OS_Queue *queue,
+                                   uint8_t *buffer,
+                                   uint32_t buffer_size_bytes,
+                                   uint32_t priority);
+
+/**
+ * @brief os_queue_portable_pop
+ *
+ * This function copies out the oldest message of the highest priority and
+ * returns its slot to the free list. The queue mutex must be held and the
+ * queue must not be empty.
+ */
+static void os_queue_portable_pop(OS_Queue *queue,
+                                  uint8_t *buffer,
+                                  uint32_t *buffer_size_bytes,
+                                  uint32_t *priority);
 
 OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
                                uint32_t num_msgs,
@@ -44,6 +150,7 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
 
     uint8_t *buffer = NULL;
     uint32_t *msg_sizes = NULL;
+    uint32_t *next_msgs = NULL;
 
 
     if (queue == NULL)
@@ -147,10 +254,22 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
         }
     }
 
+    // allocate space for the links between slots
+    if (result == OS_RESULT_OKAY)
+    {
+        next_msgs = (uint32_t*)malloc(num_msgs * sizeof(uint32_t));
+        if (next_msgs == NULL)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
     if (result == OS_RESULT_OKAY)
     {
         memset(queue, 0, sizeof(OS_Queue));
 
+        queue->type = OS_QUEUE_TYPE_DEFAULT;
+        queue->ring = NULL;
         queue->mutex = mutex;
         queue->write_condition = write_condition;
         queue->read_condition = read_condition;
@@ -158,9 +277,22 @@ OS_RESULT_ENUM os_queue_create(OS_Queue *queue,
         queue->msg_size_bytes = msg_size_bytes;
         queue->buffer = buffer;
         queue->msg_sizes = msg_sizes;
-        queue->read_offset = 0;
-        queue->write_offset = 0;
+        queue->next_msgs = next_msgs;
         queue->num_queued = 0;
+
+        // every slot starts on the free list
+        for (uint32_t slot = 0; slot < num_msgs; slot++)
+        {
+            next_msgs[slot] = slot + 1;
+        }
+        next_msgs[num_msgs - 1] = OS_QUEUE_SLOT_NONE;
+        queue->free_head = 0;
+
+        for (uint32_t lane = 0; lane < OS_QUEUE_NUM_PRIORITIES; lane++)
+        {
+            queue->lane_heads[lane] = OS_QUEUE_SLOT_NONE;
+            queue->lane_tails[lane] = OS_QUEUE_SLOT_NONE;
+        }
     }
 
     return result;
@@ -170,16 +302,142 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
                              uint8_t *buffer,
                              uint32_t buffer_size_bytes,
                              OS_Timeout timeout)
+{
+    return os_queue_send_priority(queue, buffer, buffer_size_bytes, OS_QUEUE_PRIORITY_DEFAULT, timeout);
+}
+
+OS_RESULT_ENUM os_queue_send_priority(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t buffer_size_bytes,
+                                      uint32_t priority,
+                                      OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
-    int ret_code = 0;
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_send(queue->ring, buffer, buffer_size_bytes, priority, timeout);
+    }
+    else
+    {
+        result = os_queue_portable_send(queue, buffer, buffer_size_bytes, priority, timeout);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
+                                uint8_t *buffer,
+                                uint32_t *buffer_size_bytes,
+                                OS_Timeout timeout)
+{
+    uint32_t priority = 0;
 
-    struct timespec timeout_spec;
+    return os_queue_receive_priority(queue, buffer, buffer_size_bytes, &priority, timeout);
+}
 
-    // this flag is required to ensure that the queue mutex is always
-    // released, even in error conditions.
-    bool mutex_taken = false;
+OS_RESULT_ENUM os_queue_receive_priority(OS_Queue *queue,
+                                         uint8_t *buffer,
+                                         uint32_t *buffer_size_bytes,
+                                         uint32_t *priority,
+                                         OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_receive(queue->ring, buffer, buffer_size_bytes, priority, timeout);
+    }
+    else
+    {
+        result = os_queue_portable_receive(queue, buffer, buffer_size_bytes, priority, timeout);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_send_batch(OS_Queue *queue,
+                                   uint8_t **buffers,
+                                   uint32_t *buffer_sizes_bytes,
+                                   uint32_t num_msgs,
+                                   uint32_t *num_sent,
+                                   OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_send_batch(queue->ring,
+                                          buffers,
+                                          buffer_sizes_bytes,
+                                          num_msgs,
+                                          OS_QUEUE_PRIORITY_DEFAULT,
+                                          num_sent,
+                                          timeout);
+    }
+    else
+    {
+        result = os_queue_portable_send_batch(queue,
+                                              buffers,
+                                              buffer_sizes_bytes,
+                                              num_msgs,
+                                              OS_QUEUE_PRIORITY_DEFAULT,
+                                              num_sent,
+                                              timeout);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_receive_batch(OS_Queue *queue,
+                                      uint8_t *buffer,
+                                      uint32_t msg_size_bytes,
+                                      uint32_t *msg_sizes,
+                                      uint32_t max_msgs,
+                                      uint32_t *num_received,
+                                      OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if (queue->type != OS_QUEUE_TYPE_DEFAULT)
+    {
+        result = os_queue_ring_receive_batch(queue->ring, buffer, msg_size_bytes, msg_sizes, max_msgs, num_received, timeout);
+    }
+    else
+    {
+        result = os_queue_portable_receive_batch(queue, buffer, msg_size_bytes, msg_sizes, max_msgs, num_received, timeout);
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_portable_send(OS_Queue *queue,
+                                             uint8_t *buffer,
+                                             uint32_t buffer_size_bytes,
+                                             uint32_t priority,
+                                             OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    struct timespec deadline;
 
     // check input pointers
     if ((queue == NULL) || (buffer == NULL))
@@ -194,99 +452,110 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
         {
             result = OS_RESULT_MSG_SIZE_ERROR;
         }
+        else if (priority >= OS_QUEUE_NUM_PRIORITIES)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    // the deadline is absolute, so waking up without space does not
+    // extend the timeout.
+    if ((result == OS_RESULT_OKAY) && (timeout > 0))
+    {
+        result = os_futex_deadline(timeout, &deadline);
     }
 
-    // get the current time, using the clock configured for this mutex
     if (result == OS_RESULT_OKAY)
     {
-        ret_code = clock_gettime(CLOCK_MONOTONIC, &timeout_spec);
-        if (ret_code < 0)
+        ret_code = pthread_mutex_lock(&queue->mutex);
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
-    // wait on the queue mutex
     if (result == OS_RESULT_OKAY)
     {
-        // NOTE does rollover need to be checked here?
-        uint64_t nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
-        timeout_spec.tv_sec += nanoseconds / OS_NANOSECONDS_PER_SECOND;
-        timeout_spec.tv_nsec += nanoseconds % OS_NANOSECONDS_PER_SECOND;
-
-        int ret_code = pthread_mutex_timedlock(&queue->mutex, &timeout_spec);
+        // wait for the queue to empty by at least one
+        while ((result == OS_RESULT_OKAY) && (queue->num_queued == queue->num_msgs))
+        {
+            result = os_queue_portable_wait(queue, &queue->write_condition, timeout, &deadline);
+        }
 
-        if (ret_code < 0)
+        if (result == OS_RESULT_OKAY)
         {
-            if (errno == ETIMEDOUT)
-            {
-                result = OS_RESULT_TIMEOUT;
-            }
-            else
-            {
-                result = OS_RESULT_ERROR;
-            }
+            os_queue_portable_push(queue, buffer, buffer_size_bytes, priority);
+
+            // if any threads where blocking waiting for a message to arrive, signal them.
+            (void)pthread_cond_signal(&queue->read_condition);
         }
-        else
+
+        ret_code = pthread_mutex_unlock(&queue->mutex);
+        if (ret_code != 0)
         {
-            mutex_taken = true;
+            result = OS_RESULT_ERROR;
         }
     }
 
-    // check if there is data in the queue
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_portable_receive(OS_Queue *queue,
+                                                uint8_t *buffer,
+                                                uint32_t *buffer_size_bytes,
+                                                uint32_t *priority,
+                                                OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    struct timespec deadline;
+
+    if ((queue == NULL) || (buffer == NULL) || (buffer_size_bytes == NULL) || (priority == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
     if (result == OS_RESULT_OKAY)
     {
-        // if write pointer is at read pointer, the queue is full
-        if (queue->num_queued == queue->num_msgs)
+        if (*buffer_size_bytes < queue->msg_size_bytes)
         {
-            // wait for the queue to empty by at least one
-            ret_code = pthread_cond_timedwait(&queue->write_condition, &queue->mutex, &timeout_spec);
-            if (ret_code != 0)
-            {
-                // note that we check the return code instead of errno, per the pthread_cond_timedwait manual page
-                if (ret_code == ETIMEDOUT)
-                {
-                    result = OS_RESULT_TIMEOUT;
-                }
-                else
-                {
-                    result = OS_RESULT_ERROR;
-                }
-
-                mutex_taken = false;
-
-            }
+            result = OS_RESULT_MSG_SIZE_ERROR;
         }
     }
 
-    if (result == OS_RESULT_OKAY)
+    if ((result == OS_RESULT_OKAY) && (timeout > 0))
     {
-        // store the message size
-        queue->msg_sizes[queue->write_offset] = buffer_size_bytes;
-
-        // either we took the mutex and there was space, or we were signaled by the write_condition
-        // condition variable and took the mutex that way. Either way, there is space in the queue.
-        int buffer_offset = queue->msg_size_bytes * queue->write_offset;
-        memcpy(&queue->buffer[buffer_offset], buffer, buffer_size_bytes);
-
-        // update the write pointer
-        queue->write_offset = (queue->write_offset + 1) % queue->num_msgs;
-
-        queue->num_queued++;
+        result = os_futex_deadline(timeout, &deadline);
+    }
 
-        // if any threads where blocking waiting for a message to arrive, signal them.
-        // This also has the effect of releasing the queue mutex.
-        ret_code = pthread_cond_signal(&queue->read_condition);
-        if (ret_code < 0)
+    if (result == OS_RESULT_OKAY)
+    {
+        ret_code = pthread_mutex_lock(&queue->mutex);
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
-    if (mutex_taken)
+    if (result == OS_RESULT_OKAY)
     {
+        while ((result == OS_RESULT_OKAY) && (queue->num_queued == 0))
+        {
+            result = os_queue_portable_wait(queue, &queue->read_condition, timeout, &deadline);
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            os_queue_portable_pop(queue, buffer, buffer_size_bytes, priority);
+
+            // signal to any threads waiting for space to open up that a message was read.
+            (void)pthread_cond_signal(&queue->write_condition);
+        }
+
         ret_code = pthread_mutex_unlock(&queue->mutex);
-        if (ret_code < 0)
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
@@ -294,107 +563,171 @@ OS_RESULT_ENUM os_queue_send(OS_Queue *queue,
 
     return result;
 }
-
-OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
-                                uint8_t *buffer,
-                                uint32_t *buffer_size_bytes,
-                                OS_Timeout timeout)
+static OS_RESULT_ENUM os_queue_portable_send_batch(OS_Queue *queue,
+                                                   uint8_t **buffers,
+                                                   uint32_t *buffer_sizes_bytes,
+                                                   uint32_t num_msgs,
+                                                   uint32_t priority,
+                                                   uint32_t *num_sent,
+                                                   OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
     int ret_code = 0;
 
-    // this flag is necessary to ensure that we finish this function with the
-    // queue mutex released.
-    bool mutex_taken = false;
-
-    struct timespec timeout_spec;
+    struct timespec deadline;
 
-    if ((queue == NULL) || (buffer == NULL) || (buffer_size_bytes == NULL))
+    if ((buffers == NULL) || (buffer_sizes_bytes == NULL) || (num_sent == NULL))
     {
         result = OS_RESULT_NULL_POINTER;
     }
 
     if (result == OS_RESULT_OKAY)
     {
-        if (*buffer_size_bytes < queue->msg_size_bytes)
+        *num_sent = 0;
+
+        if (priority >= OS_QUEUE_NUM_PRIORITIES)
         {
-            result = OS_RESULT_MSG_SIZE_ERROR;
+            result = OS_RESULT_INVALID_ARGUMENTS;
         }
     }
 
-    if (result == OS_RESULT_OKAY)
+    if ((result == OS_RESULT_OKAY) && (timeout > 0))
     {
-        int nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
-        timeout_spec.tv_sec = nanoseconds / OS_NANOSECONDS_PER_SECOND;
-        timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;;
-
-        ret_code = pthread_mutex_timedlock(&queue->mutex, &timeout_spec);
+        result = os_futex_deadline(timeout, &deadline);
+    }
 
-        if (ret_code < 0)
+    if (result == OS_RESULT_OKAY)
+    {
+        ret_code = pthread_mutex_lock(&queue->mutex);
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
-        else
-        {
-            mutex_taken = true;
-        }
     }
 
     if (result == OS_RESULT_OKAY)
     {
-        // check if the queue is empty
-        if (queue->num_queued == 0)
+        while ((result == OS_RESULT_OKAY) && (*num_sent < num_msgs))
         {
-            ret_code = pthread_cond_timedwait(&queue->read_condition, &queue->mutex, &timeout_spec);
-            if (ret_code != 0)
+            uint32_t buffer_size_bytes = buffer_sizes_bytes[*num_sent];
+
+            if (buffers[*num_sent] == NULL)
             {
-                // note that we check the return code instead of errno, per the pthread_cond_timedwait manual page
-                if (ret_code == ETIMEDOUT)
-                {
-                    result = OS_RESULT_TIMEOUT;
-                }
-                else
-                {
-                    result = OS_RESULT_ERROR;
-                }
-
-                // pthread_cond_timedwait gives the mutex, and if it fails we do not have it.
-                mutex_taken = false;
+                result = OS_RESULT_NULL_POINTER;
+            }
+            else if (buffer_size_bytes > queue->msg_size_bytes)
+            {
+                result = OS_RESULT_MSG_SIZE_ERROR;
+            }
+
+            while ((result == OS_RESULT_OKAY) && (queue->num_queued == queue->num_msgs))
+            {
+                // let receivers drain the messages sent so far while waiting
+                (void)pthread_cond_broadcast(&queue->read_condition);
+
+                result = os_queue_portable_wait(queue, &queue->write_condition, timeout, &deadline);
+            }
+
+            if (result == OS_RESULT_OKAY)
+            {
+                os_queue_portable_push(queue, buffers[*num_sent], buffer_size_bytes, priority);
+
+                (*num_sent)++;
             }
         }
+
+        if (*num_sent > 0)
+        {
+            (void)pthread_cond_broadcast(&queue->read_condition);
+        }
+
+        ret_code = pthread_mutex_unlock(&queue->mutex);
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
     }
 
-    if (result == OS_RESULT_OKAY)
-    {
-        // update buffer size with the size stored for this message
-        *buffer_size_bytes = queue->msg_sizes[queue->read_offset];
+    return result;
+}
 
-        // at this point, we either took the mutex and found a message, or we where signaled
-        // indicating that a new message is available.
-        int buffer_offset = queue->msg_size_bytes * queue->read_offset;
+static OS_RESULT_ENUM os_queue_portable_receive_batch(OS_Queue *queue,
+                                                      uint8_t *buffer,
+                                                      uint32_t msg_size_bytes,
+                                                      uint32_t *msg_sizes,
+                                                      uint32_t max_msgs,
+                                                      uint32_t *num_received,
+                                                      OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
-        // copy the message into the given buffer
-        memcpy(buffer, &queue->buffer[buffer_offset], *buffer_size_bytes);
+    int ret_code = 0;
 
-        // update the read pointer
-        queue->read_offset = (queue->read_offset + 1) % queue->num_msgs;
+    struct timespec deadline;
 
-        queue->num_queued--;
+    // the priority of each message is not returned by a batch receive
+    uint32_t priority = 0;
 
-        // signal to any threads waiting for space to open up that a message was read.
-        // This has the effect of releasing the queue mutex as well.
-        ret_code = pthread_cond_signal(&queue->write_condition);
-        if (ret_code < 0)
+    if ((buffer == NULL) || (msg_sizes == NULL) || (num_received == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_received = 0;
+
+        if (msg_size_bytes < queue->msg_size_bytes)
+        {
+            result = OS_RESULT_MSG_SIZE_ERROR;
+        }
+        else if (max_msgs == 0)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if ((result == OS_RESULT_OKAY) && (timeout > 0))
+    {
+        result = os_futex_deadline(timeout, &deadline);
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        ret_code = pthread_mutex_lock(&queue->mutex);
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
-    if (mutex_taken)
+    if (result == OS_RESULT_OKAY)
     {
+        while ((result == OS_RESULT_OKAY) && (queue->num_queued == 0))
+        {
+            result = os_queue_portable_wait(queue, &queue->read_condition, timeout, &deadline);
+        }
+
+        while ((result == OS_RESULT_OKAY) &&
+               (queue->num_queued > 0) &&
+               (*num_received < max_msgs))
+        {
+            os_queue_portable_pop(queue,
+                                  &buffer[(size_t)*num_received * msg_size_bytes],
+                                  &msg_sizes[*num_received],
+                                  &priority);
+
+            (*num_received)++;
+        }
+
+        if (*num_received > 0)
+        {
+            (void)pthread_cond_broadcast(&queue->write_condition);
+        }
+
         ret_code = pthread_mutex_unlock(&queue->mutex);
-        if (ret_code < 0)
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
@@ -402,3 +735,98 @@ OS_RESULT_ENUM os_queue_receive(OS_Queue *queue,
 
     return result;
 }
+
+static OS_RESULT_ENUM os_queue_portable_wait(OS_Queue *queue,
+                                             pthread_cond_t *condition,
+                                             OS_Timeout timeout,
+                                             struct timespec *deadline)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    if (timeout == OS_TIMEOUT_NO_WAIT)
+    {
+        result = OS_RESULT_TIMEOUT;
+    }
+    else if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+    {
+        ret_code = pthread_cond_wait(condition, &queue->mutex);
+    }
+    else
+    {
+        ret_code = pthread_cond_timedwait(condition, &queue->mutex, deadline);
+    }
+
+    // note that we check the return code instead of errno, per the pthread_cond_timedwait manual page
+    if (ret_code == ETIMEDOUT)
+    {
+        result = OS_RESULT_TIMEOUT;
+    }
+    else if (ret_code != 0)
+    {
+        result = OS_RESULT_ERROR;
+    }
+
+    return result;
+}
+
+static void os_queue_portable_push(OS_Queue *queue,
+                                   uint8_t *buffer,
+                                   uint32_t buffer_size_bytes,
+                                   uint32_t priority)
+{
+    uint32_t slot = queue->free_head;
+
+    queue->free_head = queue->next_msgs[slot];
+
+    queue->msg_sizes[slot] = buffer_size_bytes;
+    memcpy(&queue->buffer[(size_t)slot * queue->msg_size_bytes], buffer, buffer_size_bytes);
+
+    // append the slot to its priority's list
+    queue->next_msgs[slot] = OS_QUEUE_SLOT_NONE;
+
+    if (queue->lane_tails[priority] == OS_QUEUE_SLOT_NONE)
+    {
+        queue->lane_heads[priority] = slot;
+    }
+    else
+    {
+        queue->next_msgs[queue->lane_tails[priority]] = slot;
+    }
+    queue->lane_tails[priority] = slot;
+
+    queue->num_queued++;
+}
+
+static void os_queue_portable_pop(OS_Queue *queue,
+                                  uint8_t *buffer,
+                                  uint32_t *buffer_size_bytes,
+                                  uint32_t *priority)
+{
+    uint32_t lane = OS_QUEUE_NUM_PRIORITIES - 1;
+
+    // the caller ensures there is a message, so a lane is not empty
+    while (queue->lane_heads[lane] == OS_QUEUE_SLOT_NONE)
+    {
+        lane--;
+    }
+
+    uint32_t slot = queue->lane_heads[lane];
+
+    *buffer_size_bytes = queue->msg_sizes[slot];
+    *priority = lane;
+    memcpy(buffer, &queue->buffer[(size_t)slot * queue->msg_size_bytes], queue->msg_sizes[slot]);
+
+    queue->lane_heads[lane] = queue->next_msgs[slot];
+    if (queue->lane_heads[lane] == OS_QUEUE_SLOT_NONE)
+    {
+        queue->lane_tails[lane] = OS_QUEUE_SLOT_NONE;
+    }
+
+    // return the slot to the free list
+    queue->next_msgs[slot] = queue->free_head;
+    queue->free_head = slot;
+
+    queue->num_queued--;
+}
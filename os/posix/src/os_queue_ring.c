@@ -0,0 +1,731 @@
+/**
+ * @file os_queue_ring.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation of the lock-free ring queues for the
+ * POSIX OS abstraction. These are used with either of the default queue
+ * implementations, which dispatch to these functions for ring queues.
+ *
+ * Sending and receiving do not take a lock or make a system call unless
+ * the ring is full (for senders) or empty (for receivers), in which case
+ * the thread waits on an event word with os_futex_wait.
+ */
+#include "stdint.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdatomic.h"
+
+#include "time.h"
+
+#include "os_definitions.h"
+#include "os_queue.h"
+#include "os_queue_ring.h"
+#include "os_futex.h"
+
+
+/**
+ * @brief os_queue_ring_slot
+ *
+ * This function returns the slot for a given position in a ring's lane.
+ */
+static OS_QueueRingSlot *os_queue_ring_slot(OS_QueueRing *ring, uint32_t lane, uint32_t position);
+
+/**
+ * @brief os_queue_ring_try_send
+ *
+ * This function attempts to place a message in a ring's lane without blocking.
+ *
+ * @return OS_RESULT_OKAY if the message was placed in the lane, or
+ * OS_RESULT_TIMEOUT if the lane was full.
+ */
+static OS_RESULT_ENUM os_queue_ring_try_send(OS_QueueRing *ring,
+                                             uint32_t lane,
+                                             uint8_t *buffer,
+                                             uint32_t buffer_size_bytes);
+
+/**
+ * @brief os_queue_ring_try_receive
+ *
+ * This function attempts to take the highest priority message from a ring
+ * without blocking.
+ *
+ * @return OS_RESULT_OKAY if a message was received, or
+ * OS_RESULT_TIMEOUT if the ring was empty.
+ */
+static OS_RESULT_ENUM os_queue_ring_try_receive(OS_QueueRing *ring,
+                                                uint8_t *buffer,
+                                                uint32_t *buffer_size_bytes,
+                                                uint32_t *priority);
+
+/**
+ * @brief os_queue_ring_try_receive_lane
+ *
+ * This function attempts to take a message from one of a ring's lanes
+ * without blocking.
+ *
+ * @return OS_RESULT_OKAY if a message was received, or
+ * OS_RESULT_TIMEOUT if the lane was empty.
+ */
+static OS_RESULT_ENUM os_queue_ring_try_receive_lane(OS_QueueRing *ring,
+                                                     uint32_t lane,
+                                                     uint8_t *buffer,
+                                                     uint32_t *buffer_size_bytes);
+
+/**
+ * @brief os_queue_ring_wait
+ *
+ * This function repeats a send or receive attempt, blocking on an event word
+ * between attempts, until the attempt succeeds or the timeout expires.
+ *
+ * @param[in] ring - the ring to send on or receive from.
+ * @param[in] send - true to send, false to receive.
+ * @param[in,out] priority - the lane to send on, or filled out with the
+ *                priority of the received message.
+ * @param[in] event - the event word to wait on.
+ * @param[in] waiting - the count of threads waiting on the event word.
+ *
+ * @return The result of the last attempt, OS_RESULT_TIMEOUT if the timeout
+ * expired, or OS_RESULT_ERROR.
+ */
+static OS_RESULT_ENUM os_queue_ring_wait(OS_QueueRing *ring,
+                                         bool send,
+                                         uint8_t *buffer,
+                                         uint32_t *buffer_size_bytes,
+                                         uint32_t *priority,
+                                         OS_Timeout timeout,
+                                         atomic_uint *event,
+                                         atomic_uint *waiting);
+
+/**
+ * @brief os_queue_ring_notify
+ *
+ * This function wakes any threads waiting on an event word.
+ * The event word is only written, and the OS is only called, when there
+ * are waiting threads.
+ */
+static void os_queue_ring_notify(atomic_uint *event, atomic_uint *waiting);
+
+
+OS_RESULT_ENUM os_queue_create_type(OS_Queue *queue,
+                                    uint32_t num_msgs,
+                                    uint32_t msg_size_bytes,
+                                    OS_QUEUE_TYPE_ENUM type)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_QueueRing *ring = NULL;
+
+    if (queue == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (type >= OS_QUEUE_TYPE_NUM_TYPES)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (type == OS_QUEUE_TYPE_DEFAULT)
+        {
+            result = os_queue_create(queue, num_msgs, msg_size_bytes);
+        }
+        else
+        {
+            result = os_queue_ring_create(&ring, num_msgs, msg_size_bytes, type);
+
+            if (result == OS_RESULT_OKAY)
+            {
+                memset(queue, 0, sizeof(OS_Queue));
+
+                queue->type = type;
+                queue->ring = ring;
+            }
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_ring_create(OS_QueueRing **ring,
+                                    uint32_t num_msgs,
+                                    uint32_t msg_size_bytes,
+                                    OS_QUEUE_TYPE_ENUM type)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_QueueRing *new_ring = NULL;
+
+    uint32_t capacity = 1;
+
+    if (ring == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if ((num_msgs == 0) ||
+            (num_msgs > (UINT32_MAX / 2)) ||
+            (msg_size_bytes == 0) ||
+            ((type != OS_QUEUE_TYPE_SPSC) && (type != OS_QUEUE_TYPE_MPSC)))
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        new_ring = (OS_QueueRing*)aligned_alloc(OS_QUEUE_RING_CACHE_LINE_BYTES, sizeof(OS_QueueRing));
+        if (new_ring == NULL)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        memset(new_ring, 0, sizeof(OS_QueueRing));
+
+        // positions wrap around at 2^32, so the number of slots must be
+        // a power of two for a position to always map to the same slot.
+        while (capacity < num_msgs)
+        {
+            capacity <<= 1;
+        }
+
+        new_ring->type = type;
+        new_ring->num_msgs = capacity;
+        new_ring->mask = capacity - 1;
+        new_ring->msg_size_bytes = msg_size_bytes;
+        new_ring->slot_size_bytes =
+            (sizeof(OS_QueueRingSlot) + msg_size_bytes + 7) & ~(uint32_t)7;
+
+        new_ring->slots =
+            (uint8_t*)malloc((size_t)OS_QUEUE_NUM_PRIORITIES * capacity * new_ring->slot_size_bytes);
+        if (new_ring->slots == NULL)
+        {
+            free(new_ring);
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        atomic_init(&new_ring->not_empty, 0);
+        atomic_init(&new_ring->receivers_waiting, 0);
+        atomic_init(&new_ring->not_full, 0);
+        atomic_init(&new_ring->senders_waiting, 0);
+
+        for (uint32_t lane = 0; lane < OS_QUEUE_NUM_PRIORITIES; lane++)
+        {
+            atomic_init(&new_ring->lanes[lane].tail, 0);
+            atomic_init(&new_ring->lanes[lane].head, 0);
+
+            for (uint32_t slot_index = 0; slot_index < capacity; slot_index++)
+            {
+                atomic_init(&os_queue_ring_slot(new_ring, lane, slot_index)->sequence, slot_index);
+            }
+        }
+
+        *ring = new_ring;
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_ring_send(OS_QueueRing *ring,
+                                  uint8_t *buffer,
+                                  uint32_t buffer_size_bytes,
+                                  uint32_t priority,
+                                  OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((ring == NULL) || (buffer == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (buffer_size_bytes > ring->msg_size_bytes)
+        {
+            result = OS_RESULT_MSG_SIZE_ERROR;
+        }
+        else if (priority >= OS_QUEUE_NUM_PRIORITIES)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        result = os_queue_ring_try_send(ring, priority, buffer, buffer_size_bytes);
+
+        if ((result == OS_RESULT_TIMEOUT) && (timeout != OS_TIMEOUT_NO_WAIT))
+        {
+            result = os_queue_ring_wait(ring,
+                                        true,
+                                        buffer,
+                                        &buffer_size_bytes,
+                                        &priority,
+                                        timeout,
+                                        &ring->not_full,
+                                        &ring->senders_waiting);
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        os_queue_ring_notify(&ring->not_empty, &ring->receivers_waiting);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_ring_receive(OS_QueueRing *ring,
+                                     uint8_t *buffer,
+                                     uint32_t *buffer_size_bytes,
+                                     uint32_t *priority,
+                                     OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((ring == NULL) || (buffer == NULL) || (buffer_size_bytes == NULL) || (priority == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        if (*buffer_size_bytes < ring->msg_size_bytes)
+        {
+            result = OS_RESULT_MSG_SIZE_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        result = os_queue_ring_try_receive(ring, buffer, buffer_size_bytes, priority);
+
+        if ((result == OS_RESULT_TIMEOUT) && (timeout != OS_TIMEOUT_NO_WAIT))
+        {
+            result = os_queue_ring_wait(ring,
+                                        false,
+                                        buffer,
+                                        buffer_size_bytes,
+                                        priority,
+                                        timeout,
+                                        &ring->not_empty,
+                                        &ring->receivers_waiting);
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        os_queue_ring_notify(&ring->not_full, &ring->senders_waiting);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_ring_send_batch(OS_QueueRing *ring,
+                                        uint8_t **buffers,
+                                        uint32_t *buffer_sizes_bytes,
+                                        uint32_t num_msgs,
+                                        uint32_t priority,
+                                        uint32_t *num_sent,
+                                        OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((ring == NULL) || (buffers == NULL) || (buffer_sizes_bytes == NULL) || (num_sent == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_sent = 0;
+
+        if (priority >= OS_QUEUE_NUM_PRIORITIES)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        while ((result == OS_RESULT_OKAY) && (*num_sent < num_msgs))
+        {
+            uint8_t *buffer = buffers[*num_sent];
+            uint32_t buffer_size_bytes = buffer_sizes_bytes[*num_sent];
+
+            if (buffer == NULL)
+            {
+                result = OS_RESULT_NULL_POINTER;
+            }
+            else if (buffer_size_bytes > ring->msg_size_bytes)
+            {
+                result = OS_RESULT_MSG_SIZE_ERROR;
+            }
+            else
+            {
+                result = os_queue_ring_try_send(ring, priority, buffer, buffer_size_bytes);
+            }
+
+            if ((result == OS_RESULT_TIMEOUT) && (timeout != OS_TIMEOUT_NO_WAIT))
+            {
+                // the receiver must see the messages sent so far, or it
+                // could be waiting for them while this sender waits for space.
+                os_queue_ring_notify(&ring->not_empty, &ring->receivers_waiting);
+
+                result = os_queue_ring_wait(ring,
+                                            true,
+                                            buffer,
+                                            &buffer_size_bytes,
+                                            &priority,
+                                            timeout,
+                                            &ring->not_full,
+                                            &ring->senders_waiting);
+            }
+
+            if (result == OS_RESULT_OKAY)
+            {
+                (*num_sent)++;
+            }
+        }
+
+        if (*num_sent > 0)
+        {
+            os_queue_ring_notify(&ring->not_empty, &ring->receivers_waiting);
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_queue_ring_receive_batch(OS_QueueRing *ring,
+                                           uint8_t *buffer,
+                                           uint32_t msg_size_bytes,
+                                           uint32_t *msg_sizes,
+                                           uint32_t max_msgs,
+                                           uint32_t *num_received,
+                                           OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    // the priority of each message is not returned by a batch receive
+    uint32_t priority = 0;
+
+    if ((ring == NULL) || (buffer == NULL) || (msg_sizes == NULL) || (num_received == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *num_received = 0;
+
+        if (msg_size_bytes < ring->msg_size_bytes)
+        {
+            result = OS_RESULT_MSG_SIZE_ERROR;
+        }
+        else if (max_msgs == 0)
+        {
+            result = OS_RESULT_INVALID_ARGUMENTS;
+        }
+    }
+
+    // wait only for the first message
+    if (result == OS_RESULT_OKAY)
+    {
+        result = os_queue_ring_try_receive(ring, buffer, &msg_sizes[0], &priority);
+
+        if ((result == OS_RESULT_TIMEOUT) && (timeout != OS_TIMEOUT_NO_WAIT))
+        {
+            result = os_queue_ring_wait(ring,
+                                        false,
+                                        buffer,
+                                        &msg_sizes[0],
+                                        &priority,
+                                        timeout,
+                                        &ring->not_empty,
+                                        &ring->receivers_waiting);
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        OS_RESULT_ENUM receive_result = OS_RESULT_OKAY;
+
+        *num_received = 1;
+
+        while ((receive_result == OS_RESULT_OKAY) && (*num_received < max_msgs))
+        {
+            size_t offset = (size_t)*num_received * msg_size_bytes;
+
+            receive_result = os_queue_ring_try_receive(ring,
+                                                       &buffer[offset],
+                                                       &msg_sizes[*num_received],
+                                                       &priority);
+
+            if (receive_result == OS_RESULT_OKAY)
+            {
+                (*num_received)++;
+            }
+        }
+
+        os_queue_ring_notify(&ring->not_full, &ring->senders_waiting);
+    }
+
+    return result;
+}
+
+static OS_QueueRingSlot *os_queue_ring_slot(OS_QueueRing *ring, uint32_t lane, uint32_t position)
+{
+    size_t slot_index = ((size_t)lane * ring->num_msgs) + (position & ring->mask);
+    size_t offset = slot_index * ring->slot_size_bytes;
+
+    return (OS_QueueRingSlot*)&ring->slots[offset];
+}
+
+static OS_RESULT_ENUM os_queue_ring_try_send(OS_QueueRing *ring,
+                                             uint32_t lane,
+                                             uint8_t *buffer,
+                                             uint32_t buffer_size_bytes)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_QueueRingSlot *slot = NULL;
+
+    OS_QueueRingLane *indices = &ring->lanes[lane];
+
+    uint32_t position = atomic_load_explicit(&indices->tail, memory_order_relaxed);
+
+    if (ring->type == OS_QUEUE_TYPE_SPSC)
+    {
+        // only reload the receiver's index when the ring looks full
+        if ((position - indices->cached_head) >= ring->num_msgs)
+        {
+            indices->cached_head = atomic_load_explicit(&indices->head, memory_order_acquire);
+
+            if ((position - indices->cached_head) >= ring->num_msgs)
+            {
+                result = OS_RESULT_TIMEOUT;
+            }
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            slot = os_queue_ring_slot(ring, lane, position);
+            slot->size_bytes = buffer_size_bytes;
+            memcpy(slot->data, buffer, buffer_size_bytes);
+
+            atomic_store_explicit(&indices->tail, position + 1, memory_order_release);
+        }
+    }
+    else
+    {
+        // claim a slot whose sequence shows that it is free for this position.
+        // A slot behind this position is still full, so the ring is full.
+        while (slot == NULL)
+        {
+            OS_QueueRingSlot *candidate = os_queue_ring_slot(ring, lane, position);
+
+            uint32_t sequence = atomic_load_explicit(&candidate->sequence, memory_order_acquire);
+            int32_t difference = (int32_t)(sequence - position);
+
+            if (difference == 0)
+            {
+                if (atomic_compare_exchange_weak_explicit(&indices->tail,
+                                                          &position,
+                                                          position + 1,
+                                                          memory_order_relaxed,
+                                                          memory_order_relaxed))
+                {
+                    slot = candidate;
+                }
+            }
+            else if (difference < 0)
+            {
+                result = OS_RESULT_TIMEOUT;
+                break;
+            }
+            else
+            {
+                position = atomic_load_explicit(&indices->tail, memory_order_relaxed);
+            }
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            slot->size_bytes = buffer_size_bytes;
+            memcpy(slot->data, buffer, buffer_size_bytes);
+
+            // publish the message to the receiver
+            atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+        }
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_ring_try_receive(OS_QueueRing *ring,
+                                                uint8_t *buffer,
+                                                uint32_t *buffer_size_bytes,
+                                                uint32_t *priority)
+{
+    OS_RESULT_ENUM result = OS_RESULT_TIMEOUT;
+
+    // check the lanes from the highest priority down
+    for (uint32_t lane = OS_QUEUE_NUM_PRIORITIES;
+         (result == OS_RESULT_TIMEOUT) && (lane > 0);
+         lane--)
+    {
+        result = os_queue_ring_try_receive_lane(ring, lane - 1, buffer, buffer_size_bytes);
+
+        if (result == OS_RESULT_OKAY)
+        {
+            *priority = lane - 1;
+        }
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_ring_try_receive_lane(OS_QueueRing *ring,
+                                                     uint32_t lane,
+                                                     uint8_t *buffer,
+                                                     uint32_t *buffer_size_bytes)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_QueueRingSlot *slot = NULL;
+
+    OS_QueueRingLane *indices = &ring->lanes[lane];
+
+    uint32_t position = atomic_load_explicit(&indices->head, memory_order_relaxed);
+
+    if (ring->type == OS_QUEUE_TYPE_SPSC)
+    {
+        // only reload the sender's index when the ring looks empty
+        if (position == indices->cached_tail)
+        {
+            indices->cached_tail = atomic_load_explicit(&indices->tail, memory_order_acquire);
+
+            if (position == indices->cached_tail)
+            {
+                result = OS_RESULT_TIMEOUT;
+            }
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            slot = os_queue_ring_slot(ring, lane, position);
+            *buffer_size_bytes = slot->size_bytes;
+            memcpy(buffer, slot->data, slot->size_bytes);
+
+            atomic_store_explicit(&indices->head, position + 1, memory_order_release);
+        }
+    }
+    else
+    {
+        slot = os_queue_ring_slot(ring, lane, position);
+
+        uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+
+        // the slot is full once its sender has published position + 1
+        if ((int32_t)(sequence - (position + 1)) < 0)
+        {
+            result = OS_RESULT_TIMEOUT;
+        }
+
+        if (result == OS_RESULT_OKAY)
+        {
+            *buffer_size_bytes = slot->size_bytes;
+            memcpy(buffer, slot->data, slot->size_bytes);
+
+            // free the slot for the sender one lap ahead
+            atomic_store_explicit(&slot->sequence, position + ring->num_msgs, memory_order_release);
+            atomic_store_explicit(&indices->head, position + 1, memory_order_relaxed);
+        }
+    }
+
+    return result;
+}
+
+static OS_RESULT_ENUM os_queue_ring_wait(OS_QueueRing *ring,
+                                         bool send,
+                                         uint8_t *buffer,
+                                         uint32_t *buffer_size_bytes,
+                                         uint32_t *priority,
+                                         OS_Timeout timeout,
+                                         atomic_uint *event,
+                                         atomic_uint *waiting)
+{
+    OS_RESULT_ENUM result = OS_RESULT_TIMEOUT;
+    OS_RESULT_ENUM wait_result = OS_RESULT_OKAY;
+
+    struct timespec deadline;
+    struct timespec *deadline_pointer = NULL;
+
+    if (timeout != OS_TIMEOUT_WAIT_FOREVER)
+    {
+        wait_result = os_futex_deadline(timeout, &deadline);
+        deadline_pointer = &deadline;
+    }
+
+    while ((result == OS_RESULT_TIMEOUT) && (wait_result == OS_RESULT_OKAY))
+    {
+        // read the event before registering as a waiter and trying again.
+        // If the other side makes progress after the attempt, it sees the
+        // waiter and changes the event, so the wait returns immediately.
+        uint32_t event_value = atomic_load(event);
+
+        atomic_fetch_add(waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (send)
+        {
+            result = os_queue_ring_try_send(ring, *priority, buffer, *buffer_size_bytes);
+        }
+        else
+        {
+            result = os_queue_ring_try_receive(ring, buffer, buffer_size_bytes, priority);
+        }
+
+        if (result == OS_RESULT_TIMEOUT)
+        {
+            wait_result = os_futex_wait(event, event_value, deadline_pointer);
+        }
+
+        atomic_fetch_sub(waiting, 1);
+    }
+
+    if (result == OS_RESULT_TIMEOUT)
+    {
+        result = wait_result;
+    }
+
+    return result;
+}
+
+static void os_queue_ring_notify(atomic_uint *event, atomic_uint *waiting)
+{
+    // order the message above before the check for waiters, matching the
+    // fence between registering as a waiter and trying again.
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(waiting, memory_order_relaxed) > 0)
+    {
+        atomic_fetch_add(event, 1);
+        os_futex_wake(event);
+    }
+}
@@ -6,6 +6,7 @@
  * This file contains the implementations of semaphore functions for the OS
  * abstraction used by the FSW.
  */
+#include "stdint.h"
 #include "string.h"
 
 #include "errno.h"
@@ -14,6 +15,7 @@
 
 #include "os_definitions.h"
 #include "os_sem.h"
+#include "os_task.h"
 
 
 #define OS_SEM_SHARED 0
@@ -74,6 +76,8 @@ OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout)
   
     if (result == OS_RESULT_OKAY)
     {
+        os_task_block_begin();
+
         if (timeout == OS_TIMEOUT_WAIT_FOREVER)
         {
             ret_code = sem_wait(sem);
@@ -82,11 +86,14 @@ OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout)
         {
             struct timespec timeout_spec;
       
-            clock_gettime(CLOCK_MONOTONIC, &timeout_spec);
+            // sem_timedwait measures its deadline on the realtime clock
+            clock_gettime(CLOCK_REALTIME, &timeout_spec);
       
-            int nanoseconds = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+            uint64_t nanoseconds = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+            nanoseconds += timeout_spec.tv_nsec;
+
             timeout_spec.tv_sec += nanoseconds / OS_NANOSECONDS_PER_SECOND;
-            timeout_spec.tv_nsec += nanoseconds % OS_NANOSECONDS_PER_SECOND;;
+            timeout_spec.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;
       
             ret_code = sem_timedwait(sem, &timeout_spec);
             while ((ret_code == -1) && (errno == EINTR))
@@ -94,6 +101,9 @@ OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout)
                 ret_code = sem_timedwait(sem, &timeout_spec);
             }
         }
+
+        // marking the task as running does not change errno
+        os_task_block_end();
     }
 
     if (ret_code != 0)
@@ -111,3 +121,24 @@ OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout)
     return result;
 }
 
+
+OS_RESULT_ENUM os_sem_delete(OS_Sem *sem)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (sem == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        int ret_code = sem_destroy(sem);
+        if (ret_code < 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
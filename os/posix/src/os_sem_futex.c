@@ -0,0 +1,167 @@
+/**
+ * @file os_sem_futex.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementations of semaphore functions for the OS
+ * abstraction used by the FSW, using an atomic count and a futex.
+ *
+ * A give or take that does not have to wait only updates the count in user
+ * space. The kernel is only entered when a task has to block on an empty
+ * semaphore, or when a give finds tasks blocked on the semaphore.
+ * A give does not take any locks, so it may be used in a signal handler.
+ */
+#include "stdint.h"
+#include "stdbool.h"
+#include "stdatomic.h"
+
+#include "time.h"
+
+#include "os_definitions.h"
+#include "os_futex.h"
+#include "os_sem.h"
+
+
+/**
+ * @brief os_sem_try_take
+ *
+ * This function takes one from the semaphore's count if it is not zero.
+ *
+ * @param[in] sem - the semaphore to take.
+ *
+ * @return true if the semaphore was taken, or false if its count was zero.
+ */
+bool os_sem_try_take(OS_Sem *sem);
+
+
+bool os_sem_try_take(OS_Sem *sem)
+{
+    uint32_t count = atomic_load_explicit(&sem->count, memory_order_relaxed);
+
+    // a failed exchange reloads the count, so this only loops while
+    // other tasks are taking the semaphore at the same time.
+    while ((count > 0) &&
+           !atomic_compare_exchange_weak_explicit(&sem->count,
+                                                  &count,
+                                                  count - 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed))
+    {
+    }
+
+    return count > 0;
+}
+
+OS_RESULT_ENUM os_sem_create(OS_Sem *sem)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (sem == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        atomic_init(&sem->count, 0);
+        atomic_init(&sem->waiters, 0);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_sem_give(OS_Sem *sem)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (sem == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        // the count is incremented before the waiters are checked, and a
+        // waiter is counted before it checks the count, so either this
+        // give sees the waiter or the waiter sees the new count.
+        atomic_fetch_add(&sem->count, 1);
+
+        if (atomic_load(&sem->waiters) > 0)
+        {
+            os_futex_wake_one(&sem->count);
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_sem_take(OS_Sem *sem, OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    bool taken = false;
+
+    struct timespec deadline;
+    struct timespec *deadline_pointer = NULL;
+
+    if (sem == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        taken = os_sem_try_take(sem);
+
+        if (!taken && (timeout == OS_TIMEOUT_NO_WAIT))
+        {
+            result = OS_RESULT_TIMEOUT;
+        }
+    }
+
+    // the clock is only read when the task has to block
+    if ((result == OS_RESULT_OKAY) && !taken && (timeout != OS_TIMEOUT_WAIT_FOREVER))
+    {
+        result = os_futex_deadline(timeout, &deadline);
+        deadline_pointer = &deadline;
+    }
+
+    if ((result == OS_RESULT_OKAY) && !taken)
+    {
+        atomic_fetch_add(&sem->waiters, 1);
+
+        while ((result == OS_RESULT_OKAY) && !taken)
+        {
+            taken = os_sem_try_take(sem);
+
+            if (!taken)
+            {
+                result = os_futex_wait(&sem->count, 0, deadline_pointer);
+            }
+        }
+
+        // a give at the deadline is still taken, so that its wakeup is
+        // not lost when no other waiter was woken for it.
+        if ((result == OS_RESULT_TIMEOUT) && os_sem_try_take(sem))
+        {
+            result = OS_RESULT_OKAY;
+        }
+
+        atomic_fetch_sub(&sem->waiters, 1);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_sem_delete(OS_Sem *sem)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    // the semaphore is only an atomic count, so there is nothing to release
+    if (sem == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    return result;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file os_seqlock.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation of sequence locks for the OS
+ * abstraction used by the FSW.
+ *
+ * A lock counts the updates that have begun and the updates that have ended.
+ * When the counts are equal no update is in progress, and a copy made while
+ * the begun count does not change is consistent.
+ */
+#include "stdint.h"
+#include "stdatomic.h"
+#include "string.h"
+
+#include "os_definitions.h"
+#include "os_seqlock.h"
+
+
+void os_seqlock_init(OS_Seqlock *lock)
+{
+    atomic_init(&lock->begun, 0);
+    atomic_init(&lock->ended, 0);
+}
+
+void os_seqlock_write_begin(OS_Seqlock *lock)
+{
+    atomic_fetch_add_explicit(&lock->begun, 1, memory_order_relaxed);
+
+    // the data is not written until the begun count is visible
+    atomic_thread_fence(memory_order_release);
+}
+
+void os_seqlock_write_end(OS_Seqlock *lock)
+{
+    atomic_fetch_add_explicit(&lock->ended, 1, memory_order_release);
+}
+
+void os_seqlock_read(OS_Seqlock *lock,
+                     void *destination,
+                     const void *source,
+                     uint32_t size_bytes)
+{
+    uint32_t ended = 0;
+    uint32_t begun = 0;
+    uint32_t begun_after = 0;
+
+    do
+    {
+        // the ended count is read first, so an equal begun count means
+        // every update that had begun had also ended.
+        ended = atomic_load_explicit(&lock->ended, memory_order_acquire);
+        begun = atomic_load_explicit(&lock->begun, memory_order_acquire);
+
+        if (begun == ended)
+        {
+            // the result of memcpy is not checked
+            (void)memcpy(destination, source, size_bytes);
+
+            // the copy is complete before the begun count is checked again
+            atomic_thread_fence(memory_order_acquire);
+
+            begun_after = atomic_load_explicit(&lock->begun, memory_order_relaxed);
+        }
+    } while ((begun != ended) || (begun_after != begun));
+}
@@ -6,39 +6,213 @@
  * This file contains the implementation for the OS task abstraction used
  * by the fsw.
  */
+// pthread_attr_setaffinity_np and the CPU_SET macros are GNU extensions
+#define _GNU_SOURCE
+
 #include "stdlib.h"
+#include "stdio.h"
 #include "stdint.h"
 #include "string.h"
 
 #include "signal.h"
 #include "errno.h"
 #include "unistd.h"
+#include "limits.h"
+#include "alloca.h"
 #include "sys/types.h"
+#include "sys/mman.h"
 
 #include "pthread.h"
+#include "sched.h"
 
 #include "os_definitions.h"
 #include "os_task.h"
+#include "os_sem.h"
+
+
+/**
+ * This definition is the file listing the CPUs isolated from the
+ * scheduler with the isolcpus kernel parameter.
+ */
+#define OS_TASK_ISOLATED_CPUS_PATH "/sys/devices/system/cpu/isolated"
+
+
+/**
+ * This definition is the number of pages left untouched below the frame
+ * that prefaults a task's stack, leaving room for a signal frame.
+ */
+#define OS_TASK_PREFAULT_MARGIN_PAGES 2
+
+
+/**
+ * This global variable is the table of task control blocks. A block is
+ * claimed when a task is spawned, and released when the task is joined.
+ */
+static OS_TaskControlBlock gvOS_tasks[OS_CONFIG_MAX_TASKS];
+
+/**
+ * This thread local variable is the control block of the calling task, or
+ * NULL in a thread that was not spawned by os_task_spawn.
+ */
+static _Thread_local OS_TaskControlBlock *gvOS_task_current = NULL;
+
+
+/**
+ * @brief os_task_claim
+ *
+ * This function claims an unused task control block from the table.
+ *
+ * @return the claimed block, or NULL if every block is in use.
+ */
+static OS_TaskControlBlock *os_task_claim(void);
+
+/**
+ * @brief os_task_release
+ *
+ * This function returns a task control block to the table.
+ *
+ * @param[in] tcb - the block to release.
+ */
+static void os_task_release(OS_TaskControlBlock *tcb);
+
+/**
+ * @brief os_task_prefault_stack
+ *
+ * This function touches every page of the calling task's stack below its
+ * current frame, so that the task does not page fault as its stack grows,
+ * and locks the stack into memory if OS_CONFIG_TASK_LOCK_STACKS is set.
+ *
+ * @param[in,out] tcb - the control block of the calling task.
+ */
+static void os_task_prefault_stack(OS_TaskControlBlock *tcb);
+
+/**
+ * @brief os_task_pthread_function
+ *
+ * This function is the start function of every task's thread. It prepares
+ * the task's stack, signals the spawning task, and then runs the task.
+ *
+ * @param[in] argument - the control block of the task.
+ */
+static void *os_task_pthread_function(void *argument);
 
 
-typedef struct OS_Task_Arg
+static OS_TaskControlBlock *os_task_claim(void)
 {
-    void *argument;
-    OS_TASK_FUNC *function;
-} OS_Task_Arg;
+    OS_TaskControlBlock *tcb = NULL;
 
+    for (uint32_t index = 0; (index < OS_CONFIG_MAX_TASKS) && (tcb == NULL); index++)
+    {
+        bool in_use = false;
+
+        if (atomic_compare_exchange_strong(&gvOS_tasks[index].in_use, &in_use, true))
+        {
+            tcb = &gvOS_tasks[index];
+        }
+    }
+
+    return tcb;
+}
+
+static void os_task_release(OS_TaskControlBlock *tcb)
+{
+    atomic_store(&tcb->in_use, false);
+}
+
+static void os_task_prefault_stack(OS_TaskControlBlock *tcb)
+{
+    pthread_attr_t attr;
+
+    void *stack = NULL;
+    size_t stack_size = 0;
+    size_t guard_size = 0;
+
+    tcb->stack = NULL;
+    tcb->stack_size = 0;
+    tcb->stack_locked = false;
+
+    if (pthread_getattr_np(pthread_self(), &attr) == 0)
+    {
+        if ((pthread_attr_getstack(&attr, &stack, &stack_size) == 0) &&
+            (pthread_attr_getguardsize(&attr, &guard_size) == 0) &&
+            (stack_size > guard_size))
+        {
+            // the guard pages may be reported as part of the stack, and are
+            // skipped as touching them faults.
+            tcb->stack = (uint8_t*)stack + guard_size;
+            tcb->stack_size = stack_size - guard_size;
+        }
+
+        (void)pthread_attr_destroy(&attr);
+    }
+
+    if (tcb->stack != NULL)
+    {
+        uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+        uintptr_t lowest = (uintptr_t)tcb->stack;
+        uintptr_t frame = (uintptr_t)&attr;
+
+        // the unused stack is claimed with alloca so that it belongs to
+        // this frame while it is touched- a signal taken meanwhile is
+        // delivered below it.
+        uintptr_t margin = OS_TASK_PREFAULT_MARGIN_PAGES * page_size;
+        if ((frame > lowest) && ((frame - lowest) > margin))
+        {
+            size_t unused_size = (size_t)(frame - lowest - margin);
+            volatile uint8_t *unused = (volatile uint8_t*)alloca(unused_size);
+
+            for (size_t offset = 0; offset < unused_size; offset += page_size)
+            {
+                unused[offset] = 0;
+            }
+        }
 
-void *os_task_pthread_function(void *argument)
+#if OS_CONFIG_TASK_LOCK_STACKS
+        // locking also faults in any pages that were not touched above
+        tcb->stack_locked = (mlock(tcb->stack, tcb->stack_size) == 0);
+#endif
+    }
+}
+
+static void *os_task_pthread_function(void *argument)
 {
-    OS_Task_Arg *task_arg = (OS_Task_Arg*)argument;
+    OS_TaskControlBlock *tcb = (OS_TaskControlBlock*)argument;
+
+    gvOS_task_current = tcb;
+
+    os_task_prefault_stack(tcb);
+
+    // the return value is not checked- the spawning task is waiting, and
+    // the semaphore was created for this task.
+    (void)os_sem_give(&tcb->started);
+
+    // the task argument is not checked for NULL- a task that does not use
+    // the argument may have NULL passed in.
+    tcb->function(tcb->argument);
+
+    while (tcb->num_exit_hooks > 0)
+    {
+        tcb->num_exit_hooks--;
+        tcb->exit_hooks[tcb->num_exit_hooks](tcb->exit_hook_arguments[tcb->num_exit_hooks]);
+    }
+
+    if (tcb->stack_locked)
+    {
+        (void)munlock(tcb->stack, tcb->stack_size);
+        tcb->stack_locked = false;
+    }
 
-    if ((task_arg != NULL) && (task_arg->function != NULL))
+    // the total CPU time is kept before the task is marked as exited, for
+    // os_task_cpu_time.
+    struct timespec cpu_time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time) == 0)
     {
-        // the task argument is not checked for NULL- a task that does not use
-        // the argument may have NULL passed in.
-        task_arg->function(task_arg->argument);
+        tcb->exit_cpu_ns =
+            ((uint64_t)cpu_time.tv_sec * OS_NANOSECONDS_PER_SECOND) + cpu_time.tv_nsec;
     }
 
+    atomic_store(&tcb->status, OS_TASK_STATUS_TASK_EXITED);
+
     return NULL;
 }
 
@@ -47,6 +221,16 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
                              void *argument,
                              int priority,
                              int stack_size)
+{
+    return os_task_spawn_affinity(task, function, argument, priority, stack_size, OS_CPU_MASK_ANY);
+}
+
+OS_RESULT_ENUM os_task_spawn_affinity(OS_Task *task,
+                                      OS_TASK_FUNC function,
+                                      void *argument,
+                                      int priority,
+                                      int stack_size,
+                                      OS_CpuMask cpus)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
@@ -54,16 +238,26 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
     int ret_code = 0;
 
     pthread_attr_t attr;
+    bool attr_initialized = false;
+
+    OS_TaskControlBlock *tcb = NULL;
+
+    bool started_created = false;
+    bool created = false;
 
     // check input parameters for NULL pointers
     if ((task == NULL) || (function == NULL))
     {
         result = OS_RESULT_NULL_POINTER;
     }
+    else
+    {
+        *task = NULL;
+    }
 
     if (result == OS_RESULT_OKAY)
     {
-        if ((stack_size == 0) || (priority < 0))
+        if ((stack_size <= 0) || (priority < 0))
         {
             result = OS_RESULT_INVALID_ARGUMENTS;
         }
@@ -77,6 +271,32 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
         }
     }
 
+    // the control block comes from a fixed table, so spawning does not
+    // allocate.
+    if (result == OS_RESULT_OKAY)
+    {
+        tcb = os_task_claim();
+        if (tcb == NULL)
+        {
+            result = OS_RESULT_MAX_TASKS_REACHED;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        tcb->function = function;
+        tcb->argument = argument;
+        tcb->stack = NULL;
+        tcb->stack_size = 0;
+        tcb->stack_locked = false;
+        tcb->num_exit_hooks = 0;
+        tcb->exit_cpu_ns = 0;
+        atomic_store(&tcb->status, OS_TASK_STATUS_OKAY);
+
+        result = os_sem_create(&tcb->started);
+        started_created = result == OS_RESULT_OKAY;
+    }
+
     // initialize the pthread attributes
     if (result == OS_RESULT_OKAY)
     {
@@ -87,7 +307,28 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
         memset(&attr, 0, sizeof(pthread_attr_t));
         ret_code = pthread_attr_init(&attr);
 
-        if (ret_code < 0)
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            attr_initialized = true;
+        }
+    }
+
+    // the stack size is set for every task, as the whole stack is prefaulted.
+    // Sizes under the pthread minimum are raised to the minimum.
+    if (result == OS_RESULT_OKAY)
+    {
+        size_t size_bytes = (size_t)stack_size;
+        if (size_bytes < (size_t)PTHREAD_STACK_MIN)
+        {
+            size_bytes = (size_t)PTHREAD_STACK_MIN;
+        }
+
+        ret_code = pthread_attr_setstacksize(&attr, size_bytes);
+        if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
@@ -106,15 +347,6 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
             }
         }
 
-        if (result == OS_RESULT_OKAY)
-        {
-            ret_code = pthread_attr_setstacksize(&attr, (size_t)stack_size);
-            if (ret_code < 0)
-            {
-                result = OS_RESULT_ERROR;
-            }
-        }
-
         if (result == OS_RESULT_OKAY)
         {
             ret_code = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
@@ -143,60 +375,328 @@ OS_RESULT_ENUM os_task_spawn(OS_Task *task,
         }
     }
 
-    // create the thread itself
+    // the affinity does not need root, and is set from the start so the
+    // task never runs on a CPU outside its mask.
+    if ((result == OS_RESULT_OKAY) && (cpus != OS_CPU_MASK_ANY))
+    {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+
+        for (int cpu = 0; cpu < OS_CPU_MAX; cpu++)
+        {
+            if ((cpus & OS_CPU_MASK(cpu)) != 0)
+            {
+                CPU_SET(cpu, &cpu_set);
+            }
+        }
+
+        ret_code = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set), &cpu_set);
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    // create the thread itself. The thread is left joinable so that it
+    // can be joined when the system shuts down.
     if (result == OS_RESULT_OKAY)
     {
-        OS_Task_Arg *pthread_argument =
-            (OS_Task_Arg*)calloc(1, sizeof(OS_Task_Arg));
+        ret_code = pthread_create(&tcb->thread, &attr, os_task_pthread_function, tcb);
 
-        pthread_argument->argument = argument;
-        pthread_argument->function = function;
+        // pthread_create returns a positive error number, such as when
+        // the task's CPUs do not exist.
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            created = true;
+        }
+    }
+
+    // wait for the task to prefault its stack, so the task is ready to run
+    // without page faults once this function returns.
+    if (result == OS_RESULT_OKAY)
+    {
+        result = os_sem_take(&tcb->started, OS_TIMEOUT_WAIT_FOREVER);
+    }
 
-        ret_code = pthread_create(task, &attr, os_task_pthread_function, pthread_argument);
+    // the semaphore is only used to wait for the task to start, so it is
+    // deleted once the task has given it, or if the task was not created.
+    if (started_created && (!created || (result == OS_RESULT_OKAY)))
+    {
+        OS_RESULT_ENUM delete_result = os_sem_delete(&tcb->started);
 
-        if (ret_code < 0)
+        if (result == OS_RESULT_OKAY)
+        {
+            result = delete_result;
+        }
+    }
+
+    // clean up attributes, even if a later step failed, as setting the
+    // affinity allocates a CPU set in them.
+    if (attr_initialized)
+    {
+        ret_code = pthread_attr_destroy(&attr);
+
+        if ((ret_code != 0) && (result == OS_RESULT_OKAY))
         {
             result = OS_RESULT_ERROR;
         }
     }
 
-    // detach the thread, cleaning up resources (taken from NASA OSAL)
+    // a task that was created keeps its control block until it is joined,
+    // even if a later step failed.
+    if (created)
+    {
+        *task = tcb;
+    }
+    else if (tcb != NULL)
+    {
+        os_task_release(tcb);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_task_join(OS_Task *task, OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    if ((task == NULL) || (*task == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
     if (result == OS_RESULT_OKAY)
     {
-        ret_code = pthread_detach(*task);
+        if (timeout == OS_TIMEOUT_WAIT_FOREVER)
+        {
+            ret_code = pthread_join((*task)->thread, NULL);
+        }
+        else if (timeout == OS_TIMEOUT_NO_WAIT)
+        {
+            ret_code = pthread_tryjoin_np((*task)->thread, NULL);
+        }
+        else
+        {
+            // pthread_timedjoin_np takes a CLOCK_REALTIME deadline
+            struct timespec deadline;
+            ret_code = clock_gettime(CLOCK_REALTIME, &deadline);
+
+            if (ret_code == 0)
+            {
+                uint64_t deadline_ns = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+                deadline_ns += deadline.tv_nsec;
+
+                deadline.tv_sec  += deadline_ns / OS_NANOSECONDS_PER_SECOND;
+                deadline.tv_nsec  = deadline_ns % OS_NANOSECONDS_PER_SECOND;
+
+                ret_code = pthread_timedjoin_np((*task)->thread, NULL, &deadline);
+            }
+            else
+            {
+                ret_code = errno;
+            }
+        }
 
-        if (ret_code < 0)
+        if ((ret_code == ETIMEDOUT) || (ret_code == EBUSY))
+        {
+            result = OS_RESULT_TIMEOUT;
+        }
+        else if (ret_code != 0)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
-    // clean up attributes
     if (result == OS_RESULT_OKAY)
     {
-        ret_code = pthread_attr_destroy(&attr);
+        os_task_release(*task);
+        *task = NULL;
+    }
 
-        if (ret_code < 0)
+    return result;
+}
+
+OS_RESULT_ENUM os_task_isolated_cpus(OS_CpuMask *cpus)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    FILE *file = NULL;
+
+    if (cpus == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *cpus = OS_CPU_MASK_ANY;
+
+        file = fopen(OS_TASK_ISOLATED_CPUS_PATH, "r");
+        if (file == NULL)
         {
             result = OS_RESULT_ERROR;
         }
     }
 
+    // the file is a list of CPUs and CPU ranges, such as "2-3,6", and is
+    // empty if no CPUs are isolated.
+    if (result == OS_RESULT_OKAY)
+    {
+        int first = 0;
+        int last = 0;
+        int matched = fscanf(file, "%d", &first);
+
+        while (matched == 1)
+        {
+            last = first;
+
+            int separator = fgetc(file);
+            if (separator == '-')
+            {
+                if (fscanf(file, "%d", &last) == 1)
+                {
+                    separator = fgetc(file);
+                }
+            }
+
+            for (int cpu = first; (cpu <= last) && (cpu < OS_CPU_MAX); cpu++)
+            {
+                if (cpu >= 0)
+                {
+                    *cpus |= OS_CPU_MASK(cpu);
+                }
+            }
+
+            matched = 0;
+            if (separator == ',')
+            {
+                matched = fscanf(file, "%d", &first);
+            }
+        }
+
+        (void)fclose(file);
+    }
+
     return result;
 }
 
+uint32_t os_task_num_cpus(void)
+{
+    uint32_t num_cpus = 1;
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online > 1)
+    {
+        num_cpus = (uint32_t)online;
+    }
+
+    return num_cpus;
+}
+
 OS_TASK_STATUS_ENUM os_task_status(OS_Task *task)
 {
-    (void)task;
-    OS_TASK_STATUS_ENUM task_status = OS_TASK_STATUS_OKAY;
+    OS_TASK_STATUS_ENUM task_status = OS_TASK_STATUS_TASK_UNKNOWN;
 
-    // NOTE no implementation appears possible for POSIX?
-    // may need to track tasks, such as setitng a flag on exit
+    if ((task != NULL) && (*task != NULL))
+    {
+        task_status = (OS_TASK_STATUS_ENUM)atomic_load(&(*task)->status);
+    }
 
     return task_status;
 }
 
-OS_TASK_STATUS_ENUM os_task_delay(OS_Timeout timeout)
+OS_RESULT_ENUM os_task_cpu_time(OS_Task *task, uint64_t *nanoseconds)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    clockid_t clock;
+    struct timespec cpu_time;
+
+    if ((task == NULL) || (*task == NULL) || (nanoseconds == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    // the thread's CPU clock is not valid once the thread has exited, and
+    // its id may be reused, so an exited task's total CPU time is used.
+    if ((result == OS_RESULT_OKAY) &&
+        (atomic_load(&(*task)->status) == OS_TASK_STATUS_TASK_EXITED))
+    {
+        *nanoseconds = (*task)->exit_cpu_ns;
+    }
+    else if (result == OS_RESULT_OKAY)
+    {
+        if ((pthread_getcpuclockid((*task)->thread, &clock) != 0) ||
+            (clock_gettime(clock, &cpu_time) != 0))
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            *nanoseconds =
+                ((uint64_t)cpu_time.tv_sec * OS_NANOSECONDS_PER_SECOND) + cpu_time.tv_nsec;
+        }
+    }
+
+    // the clock is also invalid if the task exited while it was read
+    if ((result == OS_RESULT_ERROR) &&
+        (atomic_load(&(*task)->status) == OS_TASK_STATUS_TASK_EXITED))
+    {
+        *nanoseconds = (*task)->exit_cpu_ns;
+        result = OS_RESULT_OKAY;
+    }
+
+    return result;
+}
+
+void os_task_block_begin(void)
+{
+    if (gvOS_task_current != NULL)
+    {
+        atomic_store(&gvOS_task_current->status, OS_TASK_STATUS_TASK_BLOCKED);
+    }
+}
+
+void os_task_block_end(void)
+{
+    if (gvOS_task_current != NULL)
+    {
+        atomic_store(&gvOS_task_current->status, OS_TASK_STATUS_OKAY);
+    }
+}
+
+OS_RESULT_ENUM os_task_on_exit(void (*hook)(void *argument), void *argument)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    OS_TaskControlBlock *tcb = gvOS_task_current;
+
+    if (hook == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+    else if ((tcb == NULL) || (tcb->num_exit_hooks >= OS_CONFIG_MAX_TASK_EXIT_HOOKS))
+    {
+        result = OS_RESULT_ERROR;
+    }
+    else
+    {
+        // the hooks are only used by the task itself, so no lock is needed
+        tcb->exit_hooks[tcb->num_exit_hooks] = hook;
+        tcb->exit_hook_arguments[tcb->num_exit_hooks] = argument;
+        tcb->num_exit_hooks++;
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_task_delay(OS_Timeout timeout)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
@@ -204,10 +704,15 @@ OS_TASK_STATUS_ENUM os_task_delay(OS_Timeout timeout)
 
     int ret_code = clock_gettime(CLOCK_MONOTONIC, &timespec_timeout);
 
-    uint64_t timeout_ns = timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+    // the nanoseconds are carried into the seconds, as a deadline
+    // with more than a second of nanoseconds is invalid.
+    uint64_t timeout_ns = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+    timeout_ns += timespec_timeout.tv_nsec;
 
-    timespec_timeout.tv_sec  += timeout_ns / 1000000000;
-    timespec_timeout.tv_nsec += timeout_ns % 1000000000;
+    timespec_timeout.tv_sec  += timeout_ns / OS_NANOSECONDS_PER_SECOND;
+    timespec_timeout.tv_nsec  = timeout_ns % OS_NANOSECONDS_PER_SECOND;
+
+    os_task_block_begin();
 
     // drain down the timeout, even if the sleep is interrupted by signal
     ret_code =
@@ -224,6 +729,35 @@ OS_TASK_STATUS_ENUM os_task_delay(OS_Timeout timeout)
                     &timespec_timeout);
     }
 
+    os_task_block_end();
+
+    if (ret_code != 0)
+    {
+        result = OS_RESULT_ERROR;
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_task_delay_until(uint64_t deadline_ns)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    struct timespec deadline;
+    deadline.tv_sec = deadline_ns / OS_NANOSECONDS_PER_SECOND;
+    deadline.tv_nsec = deadline_ns % OS_NANOSECONDS_PER_SECOND;
+
+    os_task_block_begin();
+
+    // an absolute sleep is simply restarted if interrupted by a signal
+    int ret_code = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    while (ret_code == EINTR)
+    {
+        ret_code = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+    }
+
+    os_task_block_end();
+
     if (ret_code != 0)
     {
         result = OS_RESULT_ERROR;
@@ -40,3 +40,30 @@ double os_timestamp_double(void)
 
     return time;
 }
+
+uint64_t os_timestamp_nanoseconds(void)
+{
+    OS_TimeStamp timestamp = os_timestamp();
+
+    uint64_t time = (uint64_t)timestamp.seconds * OS_NANOSECONDS_PER_SECOND;
+
+    time += timestamp.nanoseconds;
+
+    return time;
+}
+
+uint64_t os_process_cpu_nanoseconds(void)
+{
+    uint64_t time = 0;
+
+    struct timespec cpu_time;
+
+    int ret_code = clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time);
+
+    if (ret_code == 0)
+    {
+        time = ((uint64_t)cpu_time.tv_sec * OS_NANOSECONDS_PER_SECOND) + cpu_time.tv_nsec;
+    }
+
+    return time;
+}
@@ -7,6 +7,7 @@
  * used by the fsw.
  */
 #include "stdint.h"
+#include "stdatomic.h"
 #include "string.h"
 
 #include "unistd.h"
@@ -27,6 +28,19 @@ static int gvOS_currentSignal = 0;
 static OS_Timer *gvOS_timers[OS_MAX_TIMERS];
 
 
+/**
+ * @brief os_timer_set_handler
+ *
+ * This function installs the signal handler for a timer's signal.
+ *
+ * @param[in] timer - the timer whose signal to handle.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_timer_set_handler(OS_Timer *timer);
+
+
 void os_timer_function(int signal)
 {
     int timer_index = signal - SIGRTMIN;
@@ -37,6 +51,13 @@ void os_timer_function(int signal)
 
         if (timer != NULL)
         {
+            // expirations while this signal was pending were not delivered
+            int overruns = timer_getoverrun(timer->timer);
+            if (overruns > 0)
+            {
+                atomic_fetch_add(&timer->overruns, (unsigned int)overruns);
+            }
+
             if (timer->callback != NULL)
             {
                 bool restart_requested =
@@ -44,8 +65,9 @@ void os_timer_function(int signal)
 
                 // the POSIX timer is configured to reset automatically (to
                 // avoid issues with delays in signal handling), so we have
-                // to stop it on request by the callback
-                if (!restart_requested)
+                // to stop it on request by the callback. A timer that
+                // expires once is already disarmed.
+                if (!restart_requested && (timer->timeout != 0))
                 {
                     os_timer_stop(timer);
                 }
@@ -69,7 +91,9 @@ OS_RESULT_ENUM os_timer_create(OS_Timer *timer)
 
     if (result == OS_RESULT_OKAY)
     {
-        if (gvOS_currentSignal == SIGRTMAX)
+        // each timer has its own signal, and its own entry in gvOS_timers
+        if ((gvOS_currentSignal >= OS_MAX_TIMERS) ||
+            ((SIGRTMIN + gvOS_currentSignal) > SIGRTMAX))
         {
             result = OS_RESULT_MAX_TIMERS_REACHED;
         }
@@ -90,6 +114,7 @@ OS_RESULT_ENUM os_timer_create(OS_Timer *timer)
         if (ret_code == 0)
         {
             timer->signal = gvOS_currentSignal + SIGRTMIN;
+            atomic_store(&timer->overruns, 0);
 
             gvOS_timers[gvOS_currentSignal] = timer;
         }
@@ -107,10 +132,7 @@ OS_RESULT_ENUM os_timer_create(OS_Timer *timer)
     return result;
 }
 
-OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
-                              OS_TIMER_FUNC callback,
-                              void *argument,
-                              OS_Timeout timeout)
+OS_RESULT_ENUM os_timer_set_handler(OS_Timer *timer)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
 
@@ -121,31 +143,18 @@ OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
     // the result of memset is not checked
     (void)memset((void*)&signal_action, 0, sizeof(signal_action));
 
+    sigset_t signal_set;
+    // no errors are defined for sigemptyset so its return value is ignored
+    (void)sigemptyset(&signal_set);
 
-    if ((timer == NULL) || (callback == NULL))
+    ret_code = sigaddset(&signal_set, timer->signal);
+    if (ret_code < 0)
     {
-        result = OS_RESULT_NULL_POINTER;
+        result = OS_RESULT_ERROR;
     }
-
-    if (result == OS_RESULT_OKAY)
+    else
     {
-        timer->callback = callback;
-        timer->argument = argument;
-        timer->timeout = timeout;
-
-        sigset_t signal_set;
-        // no errors are defined for sigemptyset so its return value is ignored
-        (void)sigemptyset(&signal_set);
-
-        ret_code = sigaddset(&signal_set, timer->signal);
-        if (ret_code < 0)
-        {
-            result = OS_RESULT_ERROR;
-        }
-        else
-        {
-            signal_action.sa_mask = signal_set;
-        }
+        signal_action.sa_mask = signal_set;
     }
 
     if (result == OS_RESULT_OKAY)
@@ -167,6 +176,32 @@ OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
         }
     }
 
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
+                              OS_TIMER_FUNC callback,
+                              void *argument,
+                              OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    int ret_code = 0;
+
+    if ((timer == NULL) || (callback == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        timer->callback = callback;
+        timer->argument = argument;
+        timer->timeout = timeout;
+
+        result = os_timer_set_handler(timer);
+    }
+
     if (result == OS_RESULT_OKAY)
     {
         // start the timer, setting it off after a given timeout period
@@ -197,6 +232,53 @@ OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
     return result;
 }
 
+OS_RESULT_ENUM os_timer_start_absolute(OS_Timer *timer,
+                                       OS_TIMER_FUNC callback,
+                                       void *argument,
+                                       uint64_t deadline_ns)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((timer == NULL) || (callback == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        timer->callback = callback;
+        timer->argument = argument;
+        timer->timeout = 0;
+
+        result = os_timer_set_handler(timer);
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        // the timer uses CLOCK_MONOTONIC, as os_timestamp does. The
+        // interval is left at 0, so the timer expires once.
+        struct itimerspec timer_spec;
+        // the result of memset is not checked
+        (void)memset(&timer_spec, 0, sizeof(timer_spec));
+
+        timer_spec.it_value.tv_sec = deadline_ns / OS_NANOSECONDS_PER_SECOND;
+        timer_spec.it_value.tv_nsec = deadline_ns % OS_NANOSECONDS_PER_SECOND;
+
+        int ret_code =
+            timer_settime(timer->timer,
+                          TIMER_ABSTIME,
+                          &timer_spec,
+                          NULL);
+
+        if (ret_code < 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
+
 OS_RESULT_ENUM os_timer_stop(OS_Timer *timer)
 {
     OS_RESULT_ENUM result = OS_RESULT_OKAY;
@@ -226,3 +308,45 @@ OS_RESULT_ENUM os_timer_stop(OS_Timer *timer)
 
     return result;
 }
+
+OS_RESULT_ENUM os_timer_delete(OS_Timer *timer)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (timer == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        // the timer's signal is not reused, so a signal that is already
+        // pending finds no timer and is ignored.
+        gvOS_timers[timer->signal - SIGRTMIN] = NULL;
+
+        int ret_code = timer_delete(timer->timer);
+        if (ret_code == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_get_overruns(OS_Timer *timer, uint32_t *overruns)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((timer == NULL) || (overruns == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *overruns = atomic_load(&timer->overruns);
+    }
+
+    return result;
+}
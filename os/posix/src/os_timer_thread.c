@@ -0,0 +1,442 @@
+/**
+ * @file os_timer_thread.c
+ *
+ * @author Noah Ryan
+ *
+ * This file contains the implementation for the timer abstraction
+ * used by the fsw, with timer callbacks run in a dedicated timer task.
+ *
+ * Each timer is a timerfd, and the timer task waits on all timers with a
+ * single epoll instance. Callbacks are run one at a time in the timer task,
+ * so they are not limited to async-signal-safe functions, and other
+ * tasks' blocking calls are not interrupted by timer signals.
+ */
+#include "stdint.h"
+#include "stdatomic.h"
+#include "string.h"
+
+#include "unistd.h"
+#include "errno.h"
+#include "pthread.h"
+#include "sys/epoll.h"
+#include "sys/timerfd.h"
+
+#include "os_definitions.h"
+#include "os_task.h"
+#include "os_timer.h"
+
+
+/**
+ * The priority of the timer task. This is the highest task priority,
+ * so timer callbacks are run as soon as a timer expires.
+ */
+#define OS_TIMER_TASK_PRIORITY 0
+
+/**
+ * The stack size of the timer task.
+ */
+#define OS_TIMER_TASK_STACK_SIZE (1024 * 64)
+
+/**
+ * The maximum number of timer expirations handled per wakeup of the timer task.
+ */
+#define OS_TIMER_MAX_EVENTS 16
+
+
+/**
+ * The epoll instance that the timer task waits on.
+ */
+static int gvOS_timer_epoll = -1;
+
+/**
+ * The timer task, started when the first timer is created.
+ */
+static OS_Task gvOS_timer_task;
+
+/**
+ * The result of starting the timer task.
+ */
+static OS_RESULT_ENUM gvOS_timer_task_result = OS_RESULT_INVALID;
+
+/**
+ * Ensures the timer task is only started once.
+ */
+static pthread_once_t gvOS_timer_once = PTHREAD_ONCE_INIT;
+
+/**
+ * This lock is held by the timer task while it handles expirations, and by
+ * tasks starting or deleting a timer, so a timer's callback is not changed
+ * or its timer deleted while the timer task uses it. It is recursive, so a
+ * callback may start, stop or delete its own timer.
+ */
+static pthread_mutex_t gvOS_timer_lock;
+
+/**
+ * The number of timers deleted, protected by gvOS_timer_lock. The timer
+ * task discards the events of a wait during which a timer was deleted, as
+ * they may refer to the deleted timer.
+ */
+static uint32_t gvOS_timer_generation = 0;
+
+
+/**
+ * @brief os_timer_task
+ *
+ * This function is the timer task. It waits for timers to expire and
+ * runs their callbacks.
+ *
+ * @param[in] argument - this is unused, but is required by the type of
+ *            a task function.
+ */
+void os_timer_task(void *argument);
+
+/**
+ * @brief os_timer_expire
+ *
+ * This function handles the expiration of a timer, counting its overruns
+ * and running its callback.
+ *
+ * @param[in] timer - the timer that expired.
+ */
+void os_timer_expire(OS_Timer *timer);
+
+/**
+ * @brief os_timer_initialize
+ *
+ * This function creates the timer lock and the epoll instance, and spawns
+ * the timer task.
+ * It is run once, when the first timer is created, and sets
+ * gvOS_timer_task_result.
+ */
+void os_timer_initialize(void);
+
+/**
+ * @brief os_timer_settime
+ *
+ * This function arms a timer to expire periodically, or disarms it.
+ *
+ * @param[in] timer - the timer to arm.
+ * @param[in] timeout - the period of the timer in clock ticks, or 0 to disarm it.
+ *
+ * @return An OS result type either indicating success (OS_RESULT_OKAY)
+ * or an error code indicating the cause of the error.
+ */
+OS_RESULT_ENUM os_timer_settime(OS_Timer *timer, OS_Timeout timeout);
+
+
+void os_timer_initialize(void)
+{
+    gvOS_timer_task_result = OS_RESULT_OKAY;
+
+    pthread_mutexattr_t attr;
+
+    if ((pthread_mutexattr_init(&attr) != 0) ||
+        (pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE) != 0) ||
+        (pthread_mutex_init(&gvOS_timer_lock, &attr) != 0))
+    {
+        gvOS_timer_task_result = OS_RESULT_ERROR;
+    }
+
+    // the result is not checked, as destroying an attribute object does
+    // not fail on Linux.
+    (void)pthread_mutexattr_destroy(&attr);
+
+    if (gvOS_timer_task_result == OS_RESULT_OKAY)
+    {
+        gvOS_timer_epoll = epoll_create1(EPOLL_CLOEXEC);
+        if (gvOS_timer_epoll == -1)
+        {
+            gvOS_timer_task_result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (gvOS_timer_task_result == OS_RESULT_OKAY)
+    {
+        gvOS_timer_task_result =
+            os_task_spawn(&gvOS_timer_task,
+                          os_timer_task,
+                          NULL,
+                          OS_TIMER_TASK_PRIORITY,
+                          OS_TIMER_TASK_STACK_SIZE);
+    }
+}
+
+void os_timer_task(void *argument)
+{
+    (void)argument;
+
+    struct epoll_event events[OS_TIMER_MAX_EVENTS];
+
+    while (true)
+    {
+        (void)pthread_mutex_lock(&gvOS_timer_lock);
+        uint32_t generation = gvOS_timer_generation;
+        (void)pthread_mutex_unlock(&gvOS_timer_lock);
+
+        // an interrupted wait returns -1, and is simply waited on again.
+        int num_events =
+            epoll_wait(gvOS_timer_epoll, events, OS_TIMER_MAX_EVENTS, -1);
+
+        (void)pthread_mutex_lock(&gvOS_timer_lock);
+
+        // the timerfds are level triggered, so discarded events of timers
+        // that were not deleted are returned again by the next wait.
+        if (generation == gvOS_timer_generation)
+        {
+            for (int event_index = 0; event_index < num_events; event_index++)
+            {
+                os_timer_expire((OS_Timer*)events[event_index].data.ptr);
+            }
+        }
+
+        (void)pthread_mutex_unlock(&gvOS_timer_lock);
+    }
+}
+
+void os_timer_expire(OS_Timer *timer)
+{
+    uint64_t expirations = 0;
+
+    // the timerfd is non-blocking, so a timer that was stopped after
+    // this event was returned does not block the timer task here.
+    ssize_t size = read(timer->fd, &expirations, sizeof(expirations));
+
+    if ((size == sizeof(expirations)) && (expirations > 0))
+    {
+        // every expiration after the first was missed
+        atomic_fetch_add(&timer->overruns, (unsigned int)(expirations - 1));
+
+        if (timer->callback != NULL)
+        {
+            bool restart_requested = timer->callback(timer->argument);
+
+            // a timer that expires once is already disarmed
+            if (!restart_requested && (timer->timeout != 0))
+            {
+                os_timer_stop(timer);
+            }
+        }
+    }
+}
+
+OS_RESULT_ENUM os_timer_settime(OS_Timer *timer, OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    struct itimerspec timer_spec;
+    // the result of memset is not checked
+    (void)memset(&timer_spec, 0, sizeof(timer_spec));
+
+    // a timeout of 0 leaves the time at 0, which disarms the timer
+    uint64_t nanoseconds = (uint64_t)timeout * OS_CONFIG_CLOCK_TICK_NANOSECONDS;
+    timer_spec.it_value.tv_sec = nanoseconds / OS_NANOSECONDS_PER_SECOND;
+    timer_spec.it_value.tv_nsec = nanoseconds % OS_NANOSECONDS_PER_SECOND;
+    timer_spec.it_interval = timer_spec.it_value;
+
+    int ret_code = timerfd_settime(timer->fd, 0, &timer_spec, NULL);
+    if (ret_code == -1)
+    {
+        result = OS_RESULT_ERROR;
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_create(OS_Timer *timer)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (timer == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        int ret_code = pthread_once(&gvOS_timer_once, os_timer_initialize);
+        if (ret_code != 0)
+        {
+            result = OS_RESULT_ERROR;
+        }
+        else
+        {
+            result = gvOS_timer_task_result;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        timer->callback = NULL;
+        timer->argument = NULL;
+        timer->timeout = 0;
+        atomic_store(&timer->overruns, 0);
+
+        timer->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer->fd == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        struct epoll_event event;
+        // the result of memset is not checked
+        (void)memset(&event, 0, sizeof(event));
+
+        event.events = EPOLLIN;
+        event.data.ptr = timer;
+
+        int ret_code = epoll_ctl(gvOS_timer_epoll, EPOLL_CTL_ADD, timer->fd, &event);
+        if (ret_code == -1)
+        {
+            (void)close(timer->fd);
+            timer->fd = -1;
+
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_start(OS_Timer *timer,
+                              OS_TIMER_FUNC callback,
+                              void *argument,
+                              OS_Timeout timeout)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((timer == NULL) || (callback == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        (void)pthread_mutex_lock(&gvOS_timer_lock);
+
+        timer->callback = callback;
+        timer->argument = argument;
+        timer->timeout = timeout;
+
+        // the timer repeats at the given interval until it is stopped
+        result = os_timer_settime(timer, timeout);
+
+        (void)pthread_mutex_unlock(&gvOS_timer_lock);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_start_absolute(OS_Timer *timer,
+                                       OS_TIMER_FUNC callback,
+                                       void *argument,
+                                       uint64_t deadline_ns)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((timer == NULL) || (callback == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        (void)pthread_mutex_lock(&gvOS_timer_lock);
+
+        timer->callback = callback;
+        timer->argument = argument;
+        timer->timeout = 0;
+
+        struct itimerspec timer_spec;
+        // the result of memset is not checked
+        (void)memset(&timer_spec, 0, sizeof(timer_spec));
+
+        // the timerfd uses CLOCK_MONOTONIC, as os_timestamp does. The
+        // interval is left at 0, so the timer expires once.
+        timer_spec.it_value.tv_sec = deadline_ns / OS_NANOSECONDS_PER_SECOND;
+        timer_spec.it_value.tv_nsec = deadline_ns % OS_NANOSECONDS_PER_SECOND;
+
+        int ret_code = timerfd_settime(timer->fd, TFD_TIMER_ABSTIME, &timer_spec, NULL);
+        if (ret_code == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+
+        (void)pthread_mutex_unlock(&gvOS_timer_lock);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_stop(OS_Timer *timer)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (timer == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        result = os_timer_settime(timer, 0);
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_delete(OS_Timer *timer)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if (timer == NULL)
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        // the lock waits for the timer task to finish with any expiration
+        // it is handling, and the new generation makes it discard events
+        // returned by a wait that may refer to this timer.
+        (void)pthread_mutex_lock(&gvOS_timer_lock);
+
+        int ret_code = epoll_ctl(gvOS_timer_epoll, EPOLL_CTL_DEL, timer->fd, NULL);
+
+        if (close(timer->fd) == -1)
+        {
+            ret_code = -1;
+        }
+        timer->fd = -1;
+
+        gvOS_timer_generation++;
+
+        (void)pthread_mutex_unlock(&gvOS_timer_lock);
+
+        if (ret_code == -1)
+        {
+            result = OS_RESULT_ERROR;
+        }
+    }
+
+    return result;
+}
+
+OS_RESULT_ENUM os_timer_get_overruns(OS_Timer *timer, uint32_t *overruns)
+{
+    OS_RESULT_ENUM result = OS_RESULT_OKAY;
+
+    if ((timer == NULL) || (overruns == NULL))
+    {
+        result = OS_RESULT_NULL_POINTER;
+    }
+
+    if (result == OS_RESULT_OKAY)
+    {
+        *overruns = atomic_load(&timer->overruns);
+    }
+
+    return result;
+}
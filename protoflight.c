@@ -93,6 +93,10 @@ int main(int argc, char *argv[])
         os_task_delay(10);
     }
 
+    // the return value is not checked- the process exits whether or not
+    // every task exited in time.
+    (void)tm_shutdown(TM_SHUTDOWN_TIMEOUT);
+
 	return 0;
 }
 
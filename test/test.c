@@ -15,16 +15,22 @@ static void Test_RunAllTests(void)
 {
     // OS Test Groups
     RUN_TEST_GROUP(OS_QUEUE);
+    RUN_TEST_GROUP(OS_QUEUE_RING);
     RUN_TEST_GROUP(OS_TIME);
     RUN_TEST_GROUP(OS_TIMER);
     RUN_TEST_GROUP(OS_TASK);
     RUN_TEST_GROUP(OS_MUTEX);
     RUN_TEST_GROUP(OS_SEM);
+    RUN_TEST_GROUP(OS_SEQLOCK);
+    RUN_TEST_GROUP(OS_COUNTER);
+    RUN_TEST_GROUP(OS_MAP);
 
     // FSW Test Groups
     RUN_TEST_GROUP(FSW_MB);
     RUN_TEST_GROUP(FSW_MSG);
     RUN_TEST_GROUP(FSW_EM);
+    RUN_TEST_GROUP(FSW_TM);
+    RUN_TEST_GROUP(FSW_TLM);
 }
 
 int main(int argc, char const *argv[])